@@ -38,6 +38,12 @@
 using namespace caret;
 using namespace std;
 
+namespace
+{
+    const int TILE_ROWS = 64;//rows that one thread correlates together, so that each cached row is loaded once per tile instead of once per row
+    const int TILE_COLS = 128;//cached rows per call to the tile kernel, keeps their current slice in L2
+}
+
 AString AlgorithmCiftiCorrelation::getCommandSwitch()
 {
     return "-cifti-correlation";
@@ -79,13 +85,24 @@ OperationParameters* AlgorithmCiftiCorrelation::getParameters()
     OptionalParameter* memLimitOpt = ret->createOptionalParameter(6, "-mem-limit", "restrict memory usage");
     memLimitOpt->addDoubleParameter(1, "limit-GB", "memory limit in gigabytes");
     
+    OptionalParameter* sparseOpt = ret->createOptionalParameter(9, "-sparse", "write the output in the row-indexed sparse format");
+    OptionalParameter* thresholdOpt = sparseOpt->createOptionalParameter(1, "-threshold", "drop values with smaller magnitude than a threshold");
+    thresholdOpt->addDoubleParameter(1, "value", "the smallest magnitude to keep");
+    OptionalParameter* topKOpt = sparseOpt->createOptionalParameter(2, "-top-k", "keep only the largest magnitude values in each row");
+    topKOpt->addIntegerParameter(1, "count", "number of values to keep per row");
+    sparseOpt->createOptionalParameter(3, "-quantize", "store values as 16-bit integers with a scale per row");
+    
     ret->setHelpText(
         AString("For each row (or each row inside an roi if -roi-override is specified), correlate to all other rows.  ") +
         "The -cifti-roi suboption to -roi-override may not be specified with any other -*-roi suboption, but you may specify the other -*-roi suboptions together.\n\n" +
         "When using the -fisher-z option, the output is NOT a Z-score, it is artanh(r), to do further math on this output, consider using -cifti-math.\n\n" +
         "Restricting the memory usage will make it calculate the output in chunks, and if the input file size is more than 70% of the memory limit, " +
         "it will also read through the input file as rows are required, resulting in several passes through the input file (once per chunk).  " +
-        "Memory limit does not need to be an integer, you may also specify 0 to calculate a single output row at a time (this may be very slow)."
+        "Memory limit does not need to be an integer, you may also specify 0 to calculate a single output row at a time (this may be very slow).\n\n" +
+        "The -sparse option writes only the values that pass -threshold and -top-k (all nonzero values if neither is given), with an index of where each row starts, " +
+        "so that loading one row reads only that row.  " +
+        "Values that are dropped read back as zero, and -top-k makes the output no longer symmetric.  " +
+        "The sparse file is not a nifti file, so it should be named with the .dconn.csf extension rather than .dconn.nii, wb_command and wb_view read it as a cifti file."
     );
     return ret;
 }
@@ -174,6 +191,25 @@ void AlgorithmCiftiCorrelation::useParameters(OperationParameters* myParams, Pro
     }
     bool noDemean = myParams->getOptionalParameter(7)->m_present;
     bool covariance = myParams->getOptionalParameter(8)->m_present;
+    OptionalParameter* sparseOpt = myParams->getOptionalParameter(9);
+    if (sparseOpt->m_present)
+    {
+        float threshold = 0.0f;
+        int64_t topK = -1;
+        OptionalParameter* thresholdOpt = sparseOpt->getOptionalParameter(1);
+        if (thresholdOpt->m_present)
+        {
+            threshold = (float)thresholdOpt->getDouble(1);
+            if (threshold < 0.0f) throw AlgorithmException("sparse threshold cannot be negative");
+        }
+        OptionalParameter* topKOpt = sparseOpt->getOptionalParameter(2);
+        if (topKOpt->m_present)
+        {
+            topK = topKOpt->getInteger(1);
+            if (topK < 1) throw AlgorithmException("sparse top-k count must be positive");
+        }
+        myCiftiOut->setWritingSparse(threshold, topK, sparseOpt->getOptionalParameter(3)->m_present);
+    }
     if (roiOverrideMode)
     {
         if (ciftiRoiMode)
@@ -239,34 +275,65 @@ AlgorithmCiftiCorrelation::AlgorithmCiftiCorrelation(ProgressObject* myProgObj,
                 outRows[i - startrow] = CaretArray<float>(numRows);
             }
         }
-        int curRow = 0;//because we can't trust the order threads hit the critical section
-#pragma omp CARET_PARFOR schedule(dynamic)
-        for (int i = 0; i < numRows; ++i)
+        int numCached = endrow - startrow;
+        vector<const float*> cachePtrs(numCached);
+        vector<float> cacheRrs(numCached);
+        for (int j = 0; j < numCached; ++j)
         {
-            float movingRrs;
-            int myrow;
-            const float* movingRow;
-#pragma omp critical
-            {//CiftiFile may explode if we request multiple rows concurrently (needs mutexes), but we should force sequential requests anyway
-                myrow = curRow;//so, manually force it to read sequentially
-                ++curRow;
-                movingRow = getRow(myrow, movingRrs);
-            }
-            for (int j = startrow; j < endrow; ++j)
+            cachePtrs[j] = getRow(j + startrow, cacheRrs[j], true);
+        }
+        int curRow = 0;//because we can't trust the order threads hit the critical section
+        int numTiles = (numRows + m_tileRows - 1) / m_tileRows;
+#pragma omp CARET_PAR
+        {
+            vector<float> scratchRows;
+            if (!cacheFullInput) scratchRows.resize((int64_t)m_tileRows * m_numCols);//rows outside the cache need somewhere to go
+            vector<const float*> movingPtrs(m_tileRows);
+            vector<float> movingRrs(m_tileRows);
+            vector<double> accum(m_tileRows * TILE_COLS);
+            vector<float> tileOut(m_tileRows * TILE_COLS);
+#pragma omp CARET_FOR schedule(dynamic)
+            for (int t = 0; t < numTiles; ++t)
             {
-                if (myrow >= startrow && myrow < endrow)//check whether we are in the output memory area
+                int tileStart;
+#pragma omp critical
+                {//hand out rows in order, so the reads stay roughly sequential on disk
+                    tileStart = curRow;
+                    curRow += m_tileRows;
+                }
+                int tileEnd = min(tileStart + m_tileRows, numRows);
+                int numMoving = tileEnd - tileStart;
+                for (int i = 0; i < numMoving; ++i)
+                {//CiftiFile::getRow is thread-safe, so the reads themselves can overlap
+                    movingPtrs[i] = getRow(tileStart + i, movingRrs[i], false, (cacheFullInput ? NULL : scratchRows.data() + (int64_t)i * m_numCols));
+                }
+                int firstCol = startrow;
+                if (tileStart >= startrow && tileEnd <= endrow) firstCol = tileStart;//entirely in the output memory area, so only the upper half is needed
+                for (int colStart = firstCol; colStart < endrow; colStart += TILE_COLS)
                 {
-                    if (j >= myrow)//if so, only compute one half, and store both places
+                    int colEnd = min(colStart + TILE_COLS, endrow);
+                    int numCols = colEnd - colStart;
+                    correlateTile(movingPtrs.data(), movingRrs.data(), numMoving,
+                                  cachePtrs.data() + colStart - startrow, cacheRrs.data() + colStart - startrow, numCols,
+                                  fisherZ, accum.data(), tileOut.data());
+                    for (int i = 0; i < numMoving; ++i)
                     {
-                        float cacheRrs;
-                        const float* cacheRow = getRow(j, cacheRrs, true);
-                        outRows[j - startrow][myrow] = correlate(movingRow, movingRrs, cacheRow, cacheRrs, fisherZ);
-                        outRows[myrow - startrow][j] = outRows[j - startrow][myrow];
+                        int myrow = tileStart + i;
+                        const float* tileRow = tileOut.data() + i * numCols;
+                        for (int j = colStart; j < colEnd; ++j)
+                        {
+                            if (myrow >= startrow && myrow < endrow)//check whether we are in the output memory area
+                            {
+                                if (j >= myrow)//if so, only use one half, and store both places
+                                {
+                                    outRows[j - startrow][myrow] = tileRow[j - colStart];
+                                    outRows[myrow - startrow][j] = tileRow[j - colStart];
+                                }
+                            } else {
+                                outRows[j - startrow][myrow] = tileRow[j - colStart];
+                            }
+                        }
                     }
-                } else {
-                    float cacheRrs;
-                    const float* cacheRow = getRow(j, cacheRrs, true);
-                    outRows[j - startrow][myrow] = correlate(movingRow, movingRrs, cacheRow, cacheRrs, fisherZ);
                 }
             }
         }
@@ -428,33 +495,70 @@ AlgorithmCiftiCorrelation::AlgorithmCiftiCorrelation(ProgressObject* myProgObj,
             }
             indexReverse[ciftiIndexList[i].first] = i;
         }
-#pragma omp CARET_PARFOR schedule(dynamic)
-        for (int i = 0; i < numRows; ++i)
+        int numCached = endrow - startrow;
+        vector<const float*> cachePtrs(numCached);
+        vector<float> cacheRrs(numCached);
+        for (int j = 0; j < numCached; ++j)
         {
-            float movingRrs;
-            int myrow;
-            const float* movingRow;
-#pragma omp critical
-            {//CiftiFile may explode if we request multiple rows concurrently (needs mutexes), but we should force sequential requests anyway
-                myrow = curRow;//so, manually force it to read sequentially
-                ++curRow;
-                movingRow = getRow(myrow, movingRrs);
-            }
-            for (int j = startrow; j < endrow; ++j)
+            cachePtrs[j] = getRow(ciftiIndexList[j + startrow].first, cacheRrs[j], true);
+        }
+        int numTiles = (numRows + m_tileRows - 1) / m_tileRows;
+#pragma omp CARET_PAR
+        {
+            vector<float> scratchRows;
+            if (!cacheFullInput) scratchRows.resize((int64_t)m_tileRows * m_numCols);//rows outside the cache need somewhere to go
+            vector<const float*> movingPtrs(m_tileRows);
+            vector<float> movingRrs(m_tileRows);
+            vector<double> accum(m_tileRows * TILE_COLS);
+            vector<float> tileOut(m_tileRows * TILE_COLS);
+#pragma omp CARET_FOR schedule(dynamic)
+            for (int t = 0; t < numTiles; ++t)
             {
-                if (indexReverse[myrow] != -1)//check if we are on a row that is in the output memory range
+                int tileStart;
+#pragma omp critical
+                {//hand out rows in order, so the reads stay roughly sequential on disk
+                    tileStart = curRow;
+                    curRow += m_tileRows;
+                }
+                int tileEnd = min(tileStart + m_tileRows, numRows);
+                int numMoving = tileEnd - tileStart;
+                int firstCol = endrow;
+                for (int i = 0; i < numMoving; ++i)
+                {//CiftiFile::getRow is thread-safe, so the reads themselves can overlap
+                    int myrow = tileStart + i;
+                    movingPtrs[i] = getRow(myrow, movingRrs[i], false, (cacheFullInput ? NULL : scratchRows.data() + (int64_t)i * m_numCols));
+                    if (indexReverse[myrow] != -1)
+                    {
+                        firstCol = min(firstCol, indexReverse[myrow]);//rows in the output memory range only need the upper half
+                    } else {
+                        firstCol = startrow;
+                    }
+                }
+                for (int colStart = firstCol; colStart < endrow; colStart += TILE_COLS)
                 {
-                    if (indexReverse[myrow] <= j)//if so, only compute one of the elements, then store it both places
+                    int colEnd = min(colStart + TILE_COLS, endrow);
+                    int numCols = colEnd - colStart;
+                    correlateTile(movingPtrs.data(), movingRrs.data(), numMoving,
+                                  cachePtrs.data() + colStart - startrow, cacheRrs.data() + colStart - startrow, numCols,
+                                  fisherZ, accum.data(), tileOut.data());
+                    for (int i = 0; i < numMoving; ++i)
                     {
-                        float cacheRrs;
-                        const float* cacheRow = getRow(ciftiIndexList[j].first, cacheRrs, true);
-                        outRows[j - startrow][myrow] = correlate(movingRow, movingRrs, cacheRow, cacheRrs, fisherZ);
-                        outRows[indexReverse[myrow] - startrow][ciftiIndexList[j].first] = outRows[j - startrow][myrow];
+                        int myrow = tileStart + i;
+                        const float* tileRow = tileOut.data() + i * numCols;
+                        for (int j = colStart; j < colEnd; ++j)
+                        {
+                            if (indexReverse[myrow] != -1)//check if we are on a row that is in the output memory range
+                            {
+                                if (indexReverse[myrow] <= j)//if so, only use one of the elements, then store it both places
+                                {
+                                    outRows[j - startrow][myrow] = tileRow[j - colStart];
+                                    outRows[indexReverse[myrow] - startrow][ciftiIndexList[j].first] = tileRow[j - colStart];
+                                }
+                            } else {
+                                outRows[j - startrow][myrow] = tileRow[j - colStart];
+                            }
+                        }
                     }
-                } else {
-                    float cacheRrs;
-                    const float* cacheRow = getRow(ciftiIndexList[j].first, cacheRrs, true);
-                    outRows[j - startrow][myrow] = correlate(movingRow, movingRrs, cacheRow, cacheRrs, fisherZ);
                 }
             }
         }
@@ -517,17 +621,32 @@ AlgorithmCiftiCorrelation::AlgorithmCiftiCorrelation(ProgressObject* myProgObj,
     AlgorithmCiftiCorrelation(myProgObj, myCifti, myCiftiOut, leftRoiPtr, rightRoiPtr, cerebRoiPtr, volRoiPtr, weights, fisherZ, memLimitGB, noDemean, covariance);//HACK: pass through our progress object
 }
 
-float AlgorithmCiftiCorrelation::correlate(const float* row1, const float& rrs1, const float* row2, const float& rrs2, const bool& fisherZ)
+void AlgorithmCiftiCorrelation::correlateTile(const float* const* rows1, const float* rrs1, const int& numRows1,
+                                              const float* const* rows2, const float* rrs2, const int& numRows2,
+                                              const bool& fisherZ, double* accumScratch, float* tileOut)
+{//treat the (demeaned, weighted) rows as two matrices, and let the blocked kernel compute all the dot products at once
+    int rowLength = m_numCols;
+    if (m_weightedMode) rowLength = (int)m_weightIndexes.size();//because we compacted the data in the row to not include any zero weights
+    dsdot_tile(rows1, numRows1, rows2, numRows2, rowLength, accumScratch, numRows2);
+    for (int i = 0; i < numRows1; ++i)
+    {
+        for (int j = 0; j < numRows2; ++j)
+        {
+            tileOut[i * numRows2 + j] = finishCorrelation(accumScratch[i * numRows2 + j], rrs1[i], rrs2[j], rows1[i] == rows2[j], fisherZ);
+        }
+    }
+}
+
+float AlgorithmCiftiCorrelation::finishCorrelation(const double& accum, const float& rrs1, const float& rrs2, const bool& sameRow, const bool& fisherZ)
 {
     double r;
-    if (row1 == row2 && !m_covariance)
+    if (sameRow && !m_covariance)
     {
         r = 1.0;//short circuit for same row
     } else {
         if (m_weightedMode)
         {
-            int numWeights = (int)m_weightIndexes.size();//because we compacted the data in the row to not include any zero weights
-            double accum = dsdot(row1, row2, numWeights);//these have already had the weighted row means subtracted out, and weights applied
+            int numWeights = (int)m_weightIndexes.size();//these have already had the weighted row means subtracted out, and weights applied
             if (m_covariance)
             {
                 if (m_binaryWeights)
@@ -539,8 +658,7 @@ float AlgorithmCiftiCorrelation::correlate(const float* row1, const float& rrs1,
             } else {
                 r = accum / (rrs1 * rrs2);//as do these
             }
-        } else {
-            double accum = dsdot(row1, row2, m_numCols);//these have already had the row means subtracted out
+        } else {//these have already had the row means subtracted out
             if (m_covariance)
             {
                 r = accum / m_numCols;
@@ -572,6 +690,7 @@ void AlgorithmCiftiCorrelation::init(const CiftiFile* input, const vector<float>
     m_rowInfo.resize(m_inputCifti->getNumberOfRows());
     m_cacheUsed = 0;
     m_numCols = m_inputCifti->getNumberOfColumns();
+    m_tileRows = TILE_ROWS;
     if (weights != NULL)
     {
         m_weightedMode = true;
@@ -638,7 +757,7 @@ void AlgorithmCiftiCorrelation::clearCache()
     m_cacheUsed = 0;
 }
 
-const float* AlgorithmCiftiCorrelation::getRow(const int& ciftiIndex, float& rootResidSqr, const bool& mustBeCached)
+const float* AlgorithmCiftiCorrelation::getRow(const int& ciftiIndex, float& rootResidSqr, const bool& mustBeCached, float* scratchRow)
 {
     float* ret;
     CaretAssertVectorIndex(m_rowInfo, ciftiIndex);
@@ -651,7 +770,8 @@ const float* AlgorithmCiftiCorrelation::getRow(const int& ciftiIndex, float& roo
         {
             throw AlgorithmException("something very bad happened, notify the developers");
         }
-        ret = getTempRow();
+        CaretAssert(scratchRow != NULL);
+        ret = scratchRow;
         m_inputCifti->getRow(ret, ciftiIndex);
         if (!m_rowInfo[ciftiIndex].m_haveCalculated)
         {
@@ -710,7 +830,7 @@ void AlgorithmCiftiCorrelation::computeRowStats(const float* row, float& mean, f
             {
                 accum += m_weights[i];
             }
-            rootResidSqr = accum;//repurpose this variable to store the weight sum - NOTE: don't take sqrt in case negative sum (whatever that means), so must not divide by both in correlate() in covariance mode
+            rootResidSqr = accum;//repurpose this variable to store the weight sum - NOTE: don't take sqrt in case negative sum (whatever that means), so must not divide by both in finishCorrelation() in covariance mode
         }
     } else {
         if (m_weightedMode)
@@ -769,42 +889,25 @@ void AlgorithmCiftiCorrelation::doSubtract(float* row, const float& mean)
     }
 }
 
-float* AlgorithmCiftiCorrelation::getTempRow()
-{
-#ifdef CARET_OMP
-    int oldsize = (int)m_tempRows.size();
-    int threadNum = omp_get_thread_num();
-    if (threadNum >= oldsize)
-    {
-        m_tempRows.resize(threadNum + 1);
-        for (int i = oldsize; i <= threadNum; ++i)
-        {
-            m_tempRows[i] = CaretArray<float>(m_numCols);
-        }
-    }
-    return m_tempRows[threadNum].getArray();
-#else
-    if (m_tempRows.size() == 0)
-    {
-        m_tempRows.resize(1);
-        m_tempRows[0] = CaretArray<float>(m_numCols);
-    }
-    return m_tempRows[0].getArray();
-#endif
-}
-
 int AlgorithmCiftiCorrelation::numRowsForMem(const float& memLimitGB, bool& cacheFullInput)
 {
     int numRows = m_inputCifti->getNumberOfRows();
     int inrowBytes = m_numCols * sizeof(float), outrowBytes = numRows * sizeof(float);
     int64_t targetBytes = (int64_t)(memLimitGB * 1024 * 1024 * 1024);
     if (m_inputCifti->isInMemory()) targetBytes -= numRows * m_numCols * 4;//count in-memory input against the total too
+    targetBytes -= numRows * sizeof(RowInfo);//storage for mean, stdev, and info about caching
 #ifdef CARET_OMP
-    targetBytes -= inrowBytes * omp_get_max_threads();
+    int numThreads = omp_get_max_threads();
 #else
-    targetBytes -= inrowBytes;//1 row in memory that isn't a reference to cache
+    int numThreads = 1;
 #endif
-    targetBytes -= numRows * sizeof(RowInfo);//storage for mean, stdev, and info about caching
+    int64_t perTileRowBytes = inrowBytes + TILE_COLS * (sizeof(double) + sizeof(float));//per thread: moving rows that aren't references to cache, and the tile accumulators
+    m_tileRows = TILE_ROWS;
+    while (m_tileRows > 1 && numThreads * m_tileRows * perTileRowBytes > targetBytes / 10)//don't let the tiles take much of the limit away from the output rows
+    {
+        m_tileRows /= 2;
+    }
+    targetBytes -= numThreads * m_tileRows * perTileRowBytes;
     int64_t perRowBytes = inrowBytes + outrowBytes;//cache and memory collation for output rows
     if (numRows * m_numCols * 4 < targetBytes * 0.7f)//if caching the entire input file would take less than 70% of remaining allotted memory, do it to reduce IO
     {
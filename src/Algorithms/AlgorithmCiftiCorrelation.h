@@ -48,20 +48,22 @@ namespace caret {
         };
         std::vector<CacheRow> m_rowCache;
         std::vector<RowInfo> m_rowInfo;
-        std::vector<CaretArray<float> > m_tempRows;//reuse return values in getRow instead of reallocating
         std::vector<float> m_weights;
         std::vector<int> m_weightIndexes;
         bool m_binaryWeights, m_weightedMode, m_noDemean, m_covariance;
         int m_cacheUsed;//reuse cache entries instead of reallocating them
         int m_numCols;
+        int m_tileRows;//number of rows each thread correlates against the cache at once, may be lowered by numRowsForMem
         const CiftiFile* m_inputCifti;//so that accesses work through the cache functions
         void cacheRow(const int& ciftiIndex);
         void computeRowStats(const float* row, float& mean, float& rootResidSqr);
         void doSubtract(float* row, const float& mean);
         void clearCache();
-        const float* getRow(const int& ciftiIndex, float& rootResidSqr, const bool& mustBeCached = false);
-        float* getTempRow();
-        float correlate(const float* row1, const float& rrs1, const float* row2, const float& rrs2, const bool& fisherZ);
+        const float* getRow(const int& ciftiIndex, float& rootResidSqr, const bool& mustBeCached = false, float* scratchRow = NULL);
+        void correlateTile(const float* const* rows1, const float* rrs1, const int& numRows1,
+                           const float* const* rows2, const float* rrs2, const int& numRows2,
+                           const bool& fisherZ, double* accumScratch, float* tileOut);
+        float finishCorrelation(const double& accum, const float& rrs1, const float& rrs2, const bool& sameRow, const bool& fisherZ);
         void init(const CiftiFile* input, const std::vector<float>* weights, const bool& noDemean, const bool& covariance);
         int numRowsForMem(const float& memLimitGB, bool& cacheFullInput);
     protected:
@@ -22,6 +22,7 @@
 #include "AlgorithmException.h"
 #include "CaretAssert.h"
 #include "CaretLogger.h"
+#include "CaretOMP.h"
 #include "CiftiFile.h"
 #include "MultiDimIterator.h"
 #include "ReductionOperation.h"
@@ -112,18 +113,31 @@ AlgorithmCiftiReduce::AlgorithmCiftiReduce(ProgressObject* myProgObj, const Cift
         {
             CaretLogWarning("-cifti-reduce is being used for a length=1 reduction on file '" + ciftiIn->getFileName() + "'");
         }
-        vector<float> scratchInRow(inDims[0]);
+        vector<vector<int64_t> > rowSelects;//collect the row indices first, so the rows can be read in parallel
         for (MultiDimIterator<int64_t> iter(vector<int64_t>(inDims.begin() + 1, inDims.end())); !iter.atEnd(); ++iter)
         {// + 1 to exclude row dimension, because getRow/setRow
-            ciftiIn->getRow(scratchInRow.data(), *iter);
-            float result = -1;
-            if (onlyNumeric)
+            rowSelects.push_back(*iter);
+        }
+        int64_t numRows = (int64_t)rowSelects.size();
+        vector<float> results(numRows);
+#pragma omp CARET_PAR
+        {
+            vector<float> scratchInRow(inDims[0]);
+#pragma omp CARET_FOR schedule(dynamic)
+            for (int64_t i = 0; i < numRows; ++i)
             {
-                result = ReductionOperation::reduceOnlyNumeric(scratchInRow.data(), inDims[0], myReduce);
-            } else {
-                result = ReductionOperation::reduce(scratchInRow.data(), inDims[0], myReduce);
+                ciftiIn->getRow(scratchInRow.data(), rowSelects[i]);
+                if (onlyNumeric)
+                {
+                    results[i] = ReductionOperation::reduceOnlyNumeric(scratchInRow.data(), inDims[0], myReduce);
+                } else {
+                    results[i] = ReductionOperation::reduce(scratchInRow.data(), inDims[0], myReduce);
+                }
             }
-            ciftiOut->setRow(&result, *iter);//if reducing along row, length of output row is 1
+        }
+        for (int64_t i = 0; i < numRows; ++i)
+        {
+            ciftiOut->setRow(&(results[i]), rowSelects[i]);//if reducing along row, length of output row is 1
         }
     } else {
         if (inDims[direction] == 1)
@@ -139,10 +153,12 @@ AlgorithmCiftiReduce::AlgorithmCiftiReduce(ProgressObject* myProgObj, const Cift
         {
             vector<int64_t> indexvec = *iter;
             indexvec.insert(indexvec.begin() + direction - 1, -1);//dummy value in place of reduce direction
+#pragma omp CARET_PARFOR schedule(dynamic)
             for (int64_t i = 0; i < inDims[direction]; ++i)
-            {
-                indexvec[direction - 1] = i;
-                ciftiIn->getRow(scratchInRows[i].data(), indexvec);
+            {//CiftiFile::getRow is thread-safe, so read the rows being reduced across in parallel
+                vector<int64_t> rowSelect = indexvec;
+                rowSelect[direction - 1] = i;
+                ciftiIn->getRow(scratchInRows[i].data(), rowSelect);
             }
             for (int64_t i = 0; i < inDims[0]; ++i)
             {
@@ -179,12 +195,26 @@ AlgorithmCiftiReduce::AlgorithmCiftiReduce(ProgressObject* myProgObj, const Cift
     vector<int64_t> inDims = inputXML.getDimensions();
     if (direction == CiftiXML::ALONG_ROW)
     {
-        vector<float> scratchInRow(inDims[0]);
+        vector<vector<int64_t> > rowSelects;//collect the row indices first, so the rows can be read in parallel
         for (MultiDimIterator<int64_t> iter(vector<int64_t>(inDims.begin() + 1, inDims.end())); !iter.atEnd(); ++iter)
         {// + 1 to exclude row dimension, because getRow/setRow
-            ciftiIn->getRow(scratchInRow.data(), *iter);
-            float result = ReductionOperation::reduceExcludeDev(scratchInRow.data(), inDims[0], myReduce, sigmaBelow, sigmaAbove);
-            ciftiOut->setRow(&result, *iter);//if reducing along row, length of output row is 1
+            rowSelects.push_back(*iter);
+        }
+        int64_t numRows = (int64_t)rowSelects.size();
+        vector<float> results(numRows);
+#pragma omp CARET_PAR
+        {
+            vector<float> scratchInRow(inDims[0]);
+#pragma omp CARET_FOR schedule(dynamic)
+            for (int64_t i = 0; i < numRows; ++i)
+            {
+                ciftiIn->getRow(scratchInRow.data(), rowSelects[i]);
+                results[i] = ReductionOperation::reduceExcludeDev(scratchInRow.data(), inDims[0], myReduce, sigmaBelow, sigmaAbove);
+            }
+        }
+        for (int64_t i = 0; i < numRows; ++i)
+        {
+            ciftiOut->setRow(&(results[i]), rowSelects[i]);//if reducing along row, length of output row is 1
         }
     } else {
         vector<vector<float> > scratchInRows(inDims[direction], vector<float>(inDims[0]));
@@ -196,10 +226,12 @@ AlgorithmCiftiReduce::AlgorithmCiftiReduce(ProgressObject* myProgObj, const Cift
         {
             vector<int64_t> indexvec = *iter;
             indexvec.insert(indexvec.begin() + direction - 1, -1);//dummy value in place of reduce direction
+#pragma omp CARET_PARFOR schedule(dynamic)
             for (int64_t i = 0; i < inDims[direction]; ++i)
-            {
-                indexvec[direction - 1] = i;
-                ciftiIn->getRow(scratchInRows[i].data(), indexvec);
+            {//CiftiFile::getRow is thread-safe, so read the rows being reduced across in parallel
+                vector<int64_t> rowSelect = indexvec;
+                rowSelect[direction - 1] = i;
+                ciftiIn->getRow(scratchInRows[i].data(), rowSelect);
             }
             for (int64_t i = 0; i < inDims[0]; ++i)
             {
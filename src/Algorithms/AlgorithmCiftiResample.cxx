@@ -132,6 +132,9 @@ OperationParameters* AlgorithmCiftiResample::getParameters()
             cerebAreaMetricsOpt->addMetricParameter(1, "current-area", "a metric file with vertex areas for the current mesh");
             cerebAreaMetricsOpt->addMetricParameter(2, "new-area", "a metric file with vertex areas for the new mesh");
     
+    OptionalParameter* cacheOpt = ret->createOptionalParameter(16, "-weights-cache", "reuse surface resampling weights saved by previous runs with the same inputs");
+        cacheOpt->addStringParameter(1, "directory", "the directory to save and load weights files in");
+    
     AString myHelpText =
         AString("Resample cifti data to a different brainordinate space.  Use COLUMN for the direction to resample dscalar, dlabel, or dtseries.  ") +
         "Resampling both dimensions of a dconn requires running this command twice, once with COLUMN and once with ROW.  " +
@@ -143,6 +146,8 @@ OperationParameters* AlgorithmCiftiResample::getParameters()
         "If neither -affine nor -warpfield are specified, the identity transform is assumed for the volume data.\n\n" +
         "The recommended resampling methods are ADAP_BARY_AREA and CUBIC (cubic spline), except for label data which should use ADAP_BARY_AREA and ENCLOSING_VOXEL.  " +
         "Using ADAP_BARY_AREA requires specifying an area option to each used -*-spheres option.\n\n" +
+        "The -weights-cache option saves the surface resampling weights to files in the given directory, named by a hash of the spheres, vertex areas, data roi and method, " +
+        "and later runs with the same inputs load them from there instead of recomputing them.\n\n" +
         "The <volume-method> argument must be one of the following:\n\n" +
         "CUBIC\nENCLOSING_VOXEL\nTRILINEAR\n\n" +
         "The <surface-method> argument must be one of the following:\n\n";
@@ -407,19 +412,25 @@ void AlgorithmCiftiResample::useParameters(OperationParameters* myParams, Progre
             newCerebAreas = cerebAreaMetricsOpt->getMetric(2);
         }
     }
+    AString weightCacheDirectory;
+    OptionalParameter* cacheOpt = myParams->getOptionalParameter(16);
+    if (cacheOpt->m_present)
+    {
+        weightCacheDirectory = cacheOpt->getString(1);
+    }
     if (warpfieldOpt->m_present)
     {
         AlgorithmCiftiResample(myProgObj, myCiftiIn, direction, myTemplate, templateDir, mySurfMethod, myVolMethod, myCiftiOut, surfLargest, voldilatemm, surfdilatemm, myWarpfield.getWarpfield(),
                                curLeftSphere, newLeftSphere, curLeftAreas, newLeftAreas,
                                curRightSphere, newRightSphere, curRightAreas, newRightAreas,
                                curCerebSphere, newCerebSphere, curCerebAreas, newCerebAreas,
-                               volDilateMethod, volDilateExponent, surfDilateMethod, surfDilateExponent, volLegacyCutoff, surfLegacyCutoff);
+                               volDilateMethod, volDilateExponent, surfDilateMethod, surfDilateExponent, volLegacyCutoff, surfLegacyCutoff, weightCacheDirectory);
     } else {//rely on AffineFile() being the identity transform for if neither option is specified
         AlgorithmCiftiResample(myProgObj, myCiftiIn, direction, myTemplate, templateDir, mySurfMethod, myVolMethod, myCiftiOut, surfLargest, voldilatemm, surfdilatemm, myAffine.getMatrix(),
                                curLeftSphere, newLeftSphere, curLeftAreas, newLeftAreas,
                                curRightSphere, newRightSphere, curRightAreas, newRightAreas,
                                curCerebSphere, newCerebSphere, curCerebAreas, newCerebAreas,
-                               volDilateMethod, volDilateExponent, surfDilateMethod, surfDilateExponent, volLegacyCutoff, surfLegacyCutoff);
+                               volDilateMethod, volDilateExponent, surfDilateMethod, surfDilateExponent, volLegacyCutoff, surfLegacyCutoff, weightCacheDirectory);
     }
 }
 
@@ -525,7 +536,8 @@ namespace
                             const SurfaceResamplingMethodEnum::Enum& mySurfMethod, const float& voldilatemm, const FloatMatrix* affine, const VolumeFile* warpfield,
                             const SurfaceFile* curLeftSphere, const SurfaceFile* newLeftSphere, const MetricFile* curLeftAreas, const MetricFile* newLeftAreas,
                             const SurfaceFile* curRightSphere, const SurfaceFile* newRightSphere, const MetricFile* curRightAreas, const MetricFile* newRightAreas,
-                            const SurfaceFile* curCerebSphere, const SurfaceFile* newCerebSphere, const MetricFile* curCerebAreas, const MetricFile* newCerebAreas)
+                            const SurfaceFile* curCerebSphere, const SurfaceFile* newCerebSphere, const MetricFile* curCerebAreas, const MetricFile* newCerebAreas,
+                            const AString& weightCacheDirectory)
     {
         const CiftiXML& myInputXML = myCiftiIn->getCiftiXML(), &myOutXML = myCiftiOut->getCiftiXML();
         bool labelMode = (myInputXML.getMappingType(CiftiXML::ALONG_COLUMN) == CiftiMappingType::LABELS);
@@ -583,7 +595,7 @@ namespace
             {
                 tempRoi[myCache.inSurfMap[j].m_surfaceNode] = 1.0f;
             }
-            myCache.surfResamp = SurfaceResamplingHelper(mySurfMethod, curSphere, newSphere, curAreasPtr, newAreasPtr, tempRoi.data());//resampling is already a helper, so use it as such
+            myCache.surfResamp = SurfaceResamplingHelper(mySurfMethod, curSphere, newSphere, curAreasPtr, newAreasPtr, tempRoi.data(), weightCacheDirectory);//resampling is already a helper, so use it as such
             tempRoi.resize(newSphere->getNumberOfNodes());
             myCache.surfResamp.getResampleValidROI(tempRoi.data());
             myCache.surfDilateRoi.setNumberOfNodesAndColumns(newSphere->getNumberOfNodes(), 1);
@@ -880,7 +892,7 @@ AlgorithmCiftiResample::AlgorithmCiftiResample(ProgressObject* myProgObj, const
                                                const SurfaceFile* curCerebSphere, const SurfaceFile* newCerebSphere, const MetricFile* curCerebAreas, const MetricFile* newCerebAreas,
                                                const AlgorithmVolumeDilate::Method& volDilateMethod, const float& volDilateExponent,
                                                const AlgorithmMetricDilate::Method& surfDilateMethod, const float& surfDilateExponent,
-                                               const bool volLegacyCutoff, const bool surfLegacyCutoff) : AbstractAlgorithm(myProgObj)
+                                               const bool volLegacyCutoff, const bool surfLegacyCutoff, const AString& weightCacheDirectory) : AbstractAlgorithm(myProgObj)
 {
     LevelProgress myProgress(myProgObj);
     pair<bool, AString> myError = checkForErrors(myCiftiIn, direction, myTemplate, templateDir, mySurfMethod,
@@ -924,7 +936,7 @@ AlgorithmCiftiResample::AlgorithmCiftiResample(ProgressObject* myProgObj, const
                     throw AlgorithmException("unsupported surface structure: " + StructureEnum::toGuiName(surfList[i]));
                     break;
             }
-            processSurfaceComponent(myCiftiIn, direction, surfList[i], mySurfMethod, myCiftiOut, surfLargest, surfdilatemm, curSphere, newSphere, curAreas, newAreas, surfDilateMethod, surfDilateExponent, surfLegacyCutoff);
+            processSurfaceComponent(myCiftiIn, direction, surfList[i], mySurfMethod, myCiftiOut, surfLargest, surfdilatemm, curSphere, newSphere, curAreas, newAreas, surfDilateMethod, surfDilateExponent, surfLegacyCutoff, weightCacheDirectory);
         }
         for (int i = 0; i < (int)volList.size(); ++i)
         {
@@ -948,7 +960,7 @@ AlgorithmCiftiResample::AlgorithmCiftiResample(ProgressObject* myProgObj, const
         setupRowResampling(surfCache, volCache, myCiftiIn, myCiftiOut, mySurfMethod, voldilatemm, NULL, warpfield,
                            curLeftSphere, newLeftSphere, curLeftAreas, newLeftAreas,
                            curRightSphere, newRightSphere, curRightAreas, newRightAreas,
-                           curCerebSphere, newCerebSphere, curCerebAreas, newCerebAreas);
+                           curCerebSphere, newCerebSphere, curCerebAreas, newCerebAreas, weightCacheDirectory);
         int64_t numRows = myInputXML.getDimensionLength(CiftiXML::ALONG_COLUMN);
         vector<float> inRow(myInputXML.getDimensionLength(CiftiXML::ALONG_ROW)), outRow(myOutXML.getDimensionLength(CiftiXML::ALONG_ROW));
         for (int64_t row = 0; row < numRows; ++row)
@@ -980,7 +992,7 @@ AlgorithmCiftiResample::AlgorithmCiftiResample(ProgressObject* myProgObj, const
                                                const SurfaceFile* curCerebSphere, const SurfaceFile* newCerebSphere, const MetricFile* curCerebAreas, const MetricFile* newCerebAreas,
                                                const AlgorithmVolumeDilate::Method& volDilateMethod, const float& volDilateExponent,
                                                const AlgorithmMetricDilate::Method& surfDilateMethod, const float& surfDilateExponent,
-                                               const bool volLegacyCutoff, const bool surfLegacyCutoff) : AbstractAlgorithm(myProgObj)
+                                               const bool volLegacyCutoff, const bool surfLegacyCutoff, const AString& weightCacheDirectory) : AbstractAlgorithm(myProgObj)
 {
     LevelProgress myProgress(myProgObj);
     pair<bool, AString> myError = checkForErrors(myCiftiIn, direction, myTemplate, templateDir, mySurfMethod,
@@ -1024,7 +1036,7 @@ AlgorithmCiftiResample::AlgorithmCiftiResample(ProgressObject* myProgObj, const
                     throw AlgorithmException("unsupported surface structure: " + StructureEnum::toGuiName(surfList[i]));
                     break;
             }
-            processSurfaceComponent(myCiftiIn, direction, surfList[i], mySurfMethod, myCiftiOut, surfLargest, surfdilatemm, curSphere, newSphere, curAreas, newAreas, surfDilateMethod, surfDilateExponent, surfLegacyCutoff);
+            processSurfaceComponent(myCiftiIn, direction, surfList[i], mySurfMethod, myCiftiOut, surfLargest, surfdilatemm, curSphere, newSphere, curAreas, newAreas, surfDilateMethod, surfDilateExponent, surfLegacyCutoff, weightCacheDirectory);
         }
         for (int i = 0; i < (int)volList.size(); ++i)
         {
@@ -1048,7 +1060,7 @@ AlgorithmCiftiResample::AlgorithmCiftiResample(ProgressObject* myProgObj, const
         setupRowResampling(surfCache, volCache, myCiftiIn, myCiftiOut, mySurfMethod, voldilatemm, &affine, NULL,
                            curLeftSphere, newLeftSphere, curLeftAreas, newLeftAreas,
                            curRightSphere, newRightSphere, curRightAreas, newRightAreas,
-                           curCerebSphere, newCerebSphere, curCerebAreas, newCerebAreas);
+                           curCerebSphere, newCerebSphere, curCerebAreas, newCerebAreas, weightCacheDirectory);
         int64_t numRows = myInputXML.getDimensionLength(CiftiXML::ALONG_COLUMN);
         vector<float> inRow(myInputXML.getDimensionLength(CiftiXML::ALONG_ROW)), outRow(myOutXML.getDimensionLength(CiftiXML::ALONG_ROW));
         for (int64_t row = 0; row < numRows; ++row)
@@ -1074,7 +1086,8 @@ AlgorithmCiftiResample::AlgorithmCiftiResample(ProgressObject* myProgObj, const
 void AlgorithmCiftiResample::processSurfaceComponent(const CiftiFile* myCiftiIn, const int& direction, const StructureEnum::Enum& myStruct, const SurfaceResamplingMethodEnum::Enum& mySurfMethod,
                                                      CiftiFile* myCiftiOut, const bool& surfLargest, const float& surfdilatemm, const SurfaceFile* curSphere, const SurfaceFile* newSphere,
                                                      const MetricFile* curAreas, const MetricFile* newAreas,
-                                                     const AlgorithmMetricDilate::Method& surfDilateMethod, const float& surfDilateExponent, const bool surfLegacyCutoff)
+                                                     const AlgorithmMetricDilate::Method& surfDilateMethod, const float& surfDilateExponent, const bool surfLegacyCutoff,
+                                                     const AString& weightCacheDirectory)
 {
     const CiftiXML& myInputXML = myCiftiIn->getCiftiXML();
     if (myInputXML.getMappingType(1 - direction) == CiftiMappingType::LABELS)
@@ -1085,7 +1098,7 @@ void AlgorithmCiftiResample::processSurfaceComponent(const CiftiFile* myCiftiIn,
         LabelFile newLabel, newDilate, *newUse = &newLabel;
         if (curSphere != NULL)
         {
-            AlgorithmLabelResample(NULL, &origLabel, curSphere, newSphere, mySurfMethod, &newLabel, curAreas, newAreas, &origRoi, &resampleROI, surfLargest);
+            AlgorithmLabelResample(NULL, &origLabel, curSphere, newSphere, mySurfMethod, &newLabel, curAreas, newAreas, &origRoi, &resampleROI, surfLargest, weightCacheDirectory);
             origLabel.clear();//delete the data we no longer need to keep memory use down
             if (surfdilatemm > 0.0f)
             {
@@ -1110,7 +1123,7 @@ void AlgorithmCiftiResample::processSurfaceComponent(const CiftiFile* myCiftiIn,
         MetricFile newMetric, newDilate, resampleROI, *newUse = &newMetric;
         if (curSphere != NULL)
         {
-            AlgorithmMetricResample(NULL, &origMetric, curSphere, newSphere, mySurfMethod, &newMetric, curAreas, newAreas, &origROI, &resampleROI, surfLargest);
+            AlgorithmMetricResample(NULL, &origMetric, curSphere, newSphere, mySurfMethod, &newMetric, curAreas, newAreas, &origROI, &resampleROI, surfLargest, weightCacheDirectory);
             origMetric.clear();//ditto
             if (surfdilatemm > 0.0f)
             {
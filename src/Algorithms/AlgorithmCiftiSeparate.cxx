@@ -29,12 +29,40 @@
 #include "Vector3D.h"
 #include "VolumeFile.h"
 
+#include <algorithm>
 #include <cstdlib>
 #include <map>
 
 using namespace caret;
 using namespace std;
 
+namespace
+{
+    const int64_t BLOCK_BYTES = 1<<24;//16MiB of rows per read
+    
+    int64_t getBlockRows(const int64_t& rowLength)
+    {
+        return max((int64_t)1, BLOCK_BYTES / (max((int64_t)1, rowLength) * (int64_t)sizeof(float)));
+    }
+    
+    //reads the rows of the map from blockStart up to blockLimit in one read, but stops at the first gap in cifti indices, returns where it stopped
+    //the map is in cifti index order, so gaps are only between models, and rows outside the map (like other structures between models) are never read
+    template <typename T>
+    int64_t readMapRows(const CiftiFile* ciftiIn, const vector<T>& myMap, const int64_t& blockStart, const int64_t& blockLimit, vector<float>& rowBlock, int64_t& firstRowOut)
+    {
+        firstRowOut = myMap[blockStart].m_ciftiIndex;
+        int64_t blockEnd = blockStart + 1;
+        while (blockEnd < blockLimit && myMap[blockEnd].m_ciftiIndex == firstRowOut + (blockEnd - blockStart))
+        {
+            ++blockEnd;
+        }
+        const int64_t numRows = blockEnd - blockStart;
+        rowBlock.resize(numRows * ciftiIn->getNumberOfColumns());
+        ciftiIn->getRowBlock(rowBlock.data(), firstRowOut, numRows);
+        return blockEnd;
+    }
+}
+
 AString AlgorithmCiftiSeparate::getCommandSwitch()
 {
     return "-cifti-separate";
@@ -227,15 +255,22 @@ AlgorithmCiftiSeparate::AlgorithmCiftiSeparate(ProgressObject* myProgObj, const
             roiOut->setStructure(myStruct);
         }
         int mapSize = (int)myMap.size();
-        CaretArray<float> rowScratch(rowSize);
         CaretArray<float> nodeUsed(numNodes, 0.0f);
-        for (int i = 0; i < mapSize; ++i)
-        {
-            ciftiIn->getRow(rowScratch, myMap[i].m_ciftiIndex);
-            nodeUsed[myMap[i].m_surfaceNode] = 1.0f;
-            for (int j = 0; j < rowSize; ++j)
+        vector<float> rowBlock;
+        const int64_t blockRows = getBlockRows(rowSize);
+        int64_t blockEnd = 0;
+        for (int64_t blockStart = 0; blockStart < mapSize; blockStart = blockEnd)
+        {
+            int64_t firstRow;
+            blockEnd = readMapRows(ciftiIn, myMap, blockStart, min(blockStart + blockRows, (int64_t)mapSize), rowBlock, firstRow);
+            for (int64_t i = blockStart; i < blockEnd; ++i)
             {
-                metricOut->setValue(myMap[i].m_surfaceNode, j, rowScratch[j]);
+                const float* rowScratch = rowBlock.data() + (myMap[i].m_ciftiIndex - firstRow) * rowSize;
+                nodeUsed[myMap[i].m_surfaceNode] = 1.0f;
+                for (int j = 0; j < rowSize; ++j)
+                {
+                    metricOut->setValue(myMap[i].m_surfaceNode, j, rowScratch[j]);
+                }
             }
         }
         if (roiOut != NULL)
@@ -267,7 +302,7 @@ AlgorithmCiftiSeparate::AlgorithmCiftiSeparate(ProgressObject* myProgObj, const
             roiOut->setStructure(myStruct);
         }
         int mapSize = (int)myMap.size();
-        CaretArray<float> rowScratch(rowSize), metricScratch(numNodes, 0.0f);
+        CaretArray<float> metricScratch(numNodes, 0.0f);
         if (roiOut != NULL)
         {
             CaretArray<float> nodeUsed(numNodes, 0.0f);
@@ -277,14 +312,22 @@ AlgorithmCiftiSeparate::AlgorithmCiftiSeparate(ProgressObject* myProgObj, const
             }
             roiOut->setValuesForColumn(0, nodeUsed);
         }
-        for (int i = 0; i < colSize; ++i)
+        vector<float> rowBlock;
+        const int64_t blockRows = getBlockRows(rowSize);
+        for (int64_t blockStart = 0; blockStart < colSize; blockStart += blockRows)
         {
-            ciftiIn->getRow(rowScratch, i);
-            for (int j = 0; j < mapSize; ++j)
+            const int64_t blockEnd = min(blockStart + blockRows, (int64_t)colSize);
+            rowBlock.resize((blockEnd - blockStart) * rowSize);
+            ciftiIn->getRowBlock(rowBlock.data(), blockStart, blockEnd - blockStart);//one large read for many rows
+            for (int64_t i = blockStart; i < blockEnd; ++i)
             {
-                metricScratch[myMap[j].m_surfaceNode] = rowScratch[myMap[j].m_ciftiIndex];
+                const float* rowScratch = rowBlock.data() + (i - blockStart) * rowSize;
+                for (int j = 0; j < mapSize; ++j)
+                {
+                    metricScratch[myMap[j].m_surfaceNode] = rowScratch[myMap[j].m_ciftiIndex];
+                }
+                metricOut->setValuesForColumn(i, metricScratch);
             }
-            metricOut->setValuesForColumn(i, metricScratch);
         }
     }
 }
@@ -319,7 +362,6 @@ AlgorithmCiftiSeparate::AlgorithmCiftiSeparate(ProgressObject* myProgObj, const
             roiOut->setStructure(myStruct);
         }
         int64_t mapSize = (int64_t)myMap.size();
-        CaretArray<float> rowScratch(rowSize);
         CaretArray<float> nodeUsed(numNodes, 0.0f);
         GiftiLabelTable myTable;
         map<int32_t, int32_t> cumulativeRemap;
@@ -328,19 +370,27 @@ AlgorithmCiftiSeparate::AlgorithmCiftiSeparate(ProgressObject* myProgObj, const
             map<int32_t, int32_t> thisRemap = myTable.append(*(myLabelsMap.getMapLabelTable(i)));
             cumulativeRemap.insert(thisRemap.begin(), thisRemap.end());
         }
-        for (int64_t i = 0; i < mapSize; ++i)
+        vector<float> rowBlock;
+        const int64_t blockRows = getBlockRows(rowSize);
+        int64_t blockEnd = 0;
+        for (int64_t blockStart = 0; blockStart < mapSize; blockStart = blockEnd)
         {
-            ciftiIn->getRow(rowScratch, myMap[i].m_ciftiIndex);
-            nodeUsed[myMap[i].m_surfaceNode] = 1.0f;
-            for (int j = 0; j < rowSize; ++j)
+            int64_t firstRow;
+            blockEnd = readMapRows(ciftiIn, myMap, blockStart, min(blockStart + blockRows, (int64_t)mapSize), rowBlock, firstRow);
+            for (int64_t i = blockStart; i < blockEnd; ++i)
             {
-                int32_t inVal = (int32_t)floor(rowScratch[j] + 0.5f);
-                map<int32_t, int32_t>::const_iterator iter = cumulativeRemap.find(inVal);
-                if (iter == cumulativeRemap.end())
+                const float* rowScratch = rowBlock.data() + (myMap[i].m_ciftiIndex - firstRow) * rowSize;
+                nodeUsed[myMap[i].m_surfaceNode] = 1.0f;
+                for (int j = 0; j < rowSize; ++j)
                 {
-                    labelOut->setLabelKey(myMap[i].m_surfaceNode, j, inVal);
-                } else {
-                    labelOut->setLabelKey(myMap[i].m_surfaceNode, j, iter->second);
+                    int32_t inVal = (int32_t)floor(rowScratch[j] + 0.5f);
+                    map<int32_t, int32_t>::const_iterator iter = cumulativeRemap.find(inVal);
+                    if (iter == cumulativeRemap.end())
+                    {
+                        labelOut->setLabelKey(myMap[i].m_surfaceNode, j, inVal);
+                    } else {
+                        labelOut->setLabelKey(myMap[i].m_surfaceNode, j, iter->second);
+                    }
                 }
             }
         }
@@ -384,7 +434,6 @@ AlgorithmCiftiSeparate::AlgorithmCiftiSeparate(ProgressObject* myProgObj, const
             }
             roiOut->setValuesForColumn(0, nodeUsed);
         }
-        CaretArray<float> rowScratch(rowSize);
         CaretArray<int> nodeUsed(numNodes, 0);
         for (int64_t j = 0; j < mapSize; ++j)
         {
@@ -399,25 +448,33 @@ AlgorithmCiftiSeparate::AlgorithmCiftiSeparate(ProgressObject* myProgObj, const
         }
         *(labelOut->getLabelTable()) = myTable;
         int32_t unusedLabel = myTable.getUnassignedLabelKey();
-        for (int64_t i = 0; i < colSize; ++i)
-        {
-            ciftiIn->getRow(rowScratch, i);
-            for (int64_t j = 0; j < mapSize; ++j)
+        vector<float> rowBlock;
+        const int64_t blockRows = getBlockRows(rowSize);
+        for (int64_t blockStart = 0; blockStart < colSize; blockStart += blockRows)
+        {
+            const int64_t blockEnd = min(blockStart + blockRows, (int64_t)colSize);
+            rowBlock.resize((blockEnd - blockStart) * rowSize);
+            ciftiIn->getRowBlock(rowBlock.data(), blockStart, blockEnd - blockStart);//one large read for many rows
+            for (int64_t i = blockStart; i < blockEnd; ++i)
             {
-                int32_t inVal = (int32_t)floor(rowScratch[j] + 0.5f);
-                map<int32_t, int32_t>::const_iterator iter = cumulativeRemap.find(inVal);
-                if (iter == cumulativeRemap.end())
+                const float* rowScratch = rowBlock.data() + (i - blockStart) * rowSize;
+                for (int64_t j = 0; j < mapSize; ++j)
                 {
-                    labelOut->setLabelKey(myMap[j].m_surfaceNode, i, inVal);
-                } else {
-                    labelOut->setLabelKey(myMap[j].m_surfaceNode, i, iter->second);
+                    int32_t inVal = (int32_t)floor(rowScratch[j] + 0.5f);
+                    map<int32_t, int32_t>::const_iterator iter = cumulativeRemap.find(inVal);
+                    if (iter == cumulativeRemap.end())
+                    {
+                        labelOut->setLabelKey(myMap[j].m_surfaceNode, i, inVal);
+                    } else {
+                        labelOut->setLabelKey(myMap[j].m_surfaceNode, i, iter->second);
+                    }
                 }
-            }
-            for (int64_t j = 0; j < numNodes; ++j)//set unused columns to unassigned
-            {
-                if (nodeUsed[j] == 0)
+                for (int64_t j = 0; j < numNodes; ++j)//set unused columns to unassigned
                 {
-                    labelOut->setLabelKey(j, i, unusedLabel);
+                    if (nodeUsed[j] == 0)
+                    {
+                        labelOut->setLabelKey(j, i, unusedLabel);
+                    }
                 }
             }
         }
@@ -458,7 +515,6 @@ AlgorithmCiftiSeparate::AlgorithmCiftiSeparate(ProgressObject* myProgObj, const
         roiOut->reinitialize(newdims, mySform);
         roiOut->setValueAllVoxels(0.0f);
     }
-    CaretArray<float> rowScratch(rowSize);
     if (myDir == CiftiXML::ALONG_COLUMN)
     {
         if (rowSize > 1) newdims.push_back(rowSize);
@@ -478,17 +534,25 @@ AlgorithmCiftiSeparate::AlgorithmCiftiSeparate(ProgressObject* myProgObj, const
                 *(volOut->getMapLabelTable(j)) = *(myLabelsMap.getMapLabelTable(j));
             }
         }
-        for (int64_t i = 0; i < numVoxels; ++i)
+        vector<float> rowBlock;
+        const int64_t blockRows = getBlockRows(rowSize);
+        int64_t blockEnd = 0;
+        for (int64_t blockStart = 0; blockStart < numVoxels; blockStart = blockEnd)
         {
-            int64_t thisvoxel[3] = { myMap[i].m_ijk[0] - offsetOut[0], myMap[i].m_ijk[1] - offsetOut[1], myMap[i].m_ijk[2] - offsetOut[2] };
-            if (roiOut != NULL)
-            {
-                roiOut->setValue(1.0f, thisvoxel);
-            }
-            ciftiIn->getRow(rowScratch, myMap[i].m_ciftiIndex);
-            for (int j = 0; j < rowSize; ++j)
+            int64_t firstRow;
+            blockEnd = readMapRows(ciftiIn, myMap, blockStart, min(blockStart + blockRows, (int64_t)numVoxels), rowBlock, firstRow);
+            for (int64_t i = blockStart; i < blockEnd; ++i)
             {
-                volOut->setValue(rowScratch[j], thisvoxel, j);
+                const float* rowScratch = rowBlock.data() + (myMap[i].m_ciftiIndex - firstRow) * rowSize;
+                int64_t thisvoxel[3] = { myMap[i].m_ijk[0] - offsetOut[0], myMap[i].m_ijk[1] - offsetOut[1], myMap[i].m_ijk[2] - offsetOut[2] };
+                if (roiOut != NULL)
+                {
+                    roiOut->setValue(1.0f, thisvoxel);
+                }
+                for (int j = 0; j < rowSize; ++j)
+                {
+                    volOut->setValue(rowScratch[j], thisvoxel, j);
+                }
             }
         }
     } else {
@@ -509,17 +573,25 @@ AlgorithmCiftiSeparate::AlgorithmCiftiSeparate(ProgressObject* myProgObj, const
                 *(volOut->getMapLabelTable(j)) = *(myLabelsMap.getMapLabelTable(j));
             }
         }
-        for (int64_t i = 0; i < colSize; ++i)
+        vector<float> rowBlock;
+        const int64_t blockRows = getBlockRows(rowSize);
+        for (int64_t blockStart = 0; blockStart < colSize; blockStart += blockRows)
         {
-            ciftiIn->getRow(rowScratch, i);
-            for (int64_t j = 0; j < numVoxels; ++j)
+            const int64_t blockEnd = min(blockStart + blockRows, (int64_t)colSize);
+            rowBlock.resize((blockEnd - blockStart) * rowSize);
+            ciftiIn->getRowBlock(rowBlock.data(), blockStart, blockEnd - blockStart);//one large read for many rows
+            for (int64_t i = blockStart; i < blockEnd; ++i)
             {
-                int64_t thisvoxel[3] = { myMap[j].m_ijk[0] - offsetOut[0], myMap[j].m_ijk[1] - offsetOut[1], myMap[j].m_ijk[2] - offsetOut[2] };
-                if (i == 0 && roiOut != NULL)
+                const float* rowScratch = rowBlock.data() + (i - blockStart) * rowSize;
+                for (int64_t j = 0; j < numVoxels; ++j)
                 {
-                    roiOut->setValue(1.0f, thisvoxel);
+                    int64_t thisvoxel[3] = { myMap[j].m_ijk[0] - offsetOut[0], myMap[j].m_ijk[1] - offsetOut[1], myMap[j].m_ijk[2] - offsetOut[2] };
+                    if (i == 0 && roiOut != NULL)
+                    {
+                        roiOut->setValue(1.0f, thisvoxel);
+                    }
+                    volOut->setValue(rowScratch[myMap[j].m_ciftiIndex], thisvoxel, i);
                 }
-                volOut->setValue(rowScratch[myMap[j].m_ciftiIndex], thisvoxel, i);
             }
         }
     }
@@ -576,7 +648,6 @@ AlgorithmCiftiSeparate::AlgorithmCiftiSeparate(ProgressObject* myProgObj, const
     }
     vector<CiftiBrainModelsMap::VolumeMap> myMap = myBrainMap.getFullVolumeMap();
     int64_t numVoxels = (int64_t)myMap.size();
-    CaretArray<float> rowScratch(rowSize);
     if (myDir == CiftiXML::ALONG_COLUMN)
     {
         if (rowSize > 1) newdims.push_back(rowSize);
@@ -596,17 +667,25 @@ AlgorithmCiftiSeparate::AlgorithmCiftiSeparate(ProgressObject* myProgObj, const
                 *(volOut->getMapLabelTable(j)) = *(myLabelsMap.getMapLabelTable(j));
             }
         }
-        for (int64_t i = 0; i < numVoxels; ++i)
+        vector<float> rowBlock;
+        const int64_t blockRows = getBlockRows(rowSize);
+        int64_t blockEnd = 0;
+        for (int64_t blockStart = 0; blockStart < numVoxels; blockStart = blockEnd)
         {
-            int64_t thisvoxel[3] = { myMap[i].m_ijk[0] - offsetOut[0], myMap[i].m_ijk[1] - offsetOut[1], myMap[i].m_ijk[2] - offsetOut[2] };
-            if (roiOut != NULL)
-            {
-                roiOut->setValue(1.0f, thisvoxel);
-            }
-            ciftiIn->getRow(rowScratch, myMap[i].m_ciftiIndex);
-            for (int j = 0; j < rowSize; ++j)
+            int64_t firstRow;
+            blockEnd = readMapRows(ciftiIn, myMap, blockStart, min(blockStart + blockRows, (int64_t)numVoxels), rowBlock, firstRow);
+            for (int64_t i = blockStart; i < blockEnd; ++i)
             {
-                volOut->setValue(rowScratch[j], thisvoxel, j);
+                const float* rowScratch = rowBlock.data() + (myMap[i].m_ciftiIndex - firstRow) * rowSize;
+                int64_t thisvoxel[3] = { myMap[i].m_ijk[0] - offsetOut[0], myMap[i].m_ijk[1] - offsetOut[1], myMap[i].m_ijk[2] - offsetOut[2] };
+                if (roiOut != NULL)
+                {
+                    roiOut->setValue(1.0f, thisvoxel);
+                }
+                for (int j = 0; j < rowSize; ++j)
+                {
+                    volOut->setValue(rowScratch[j], thisvoxel, j);
+                }
             }
         }
     } else {
@@ -627,17 +706,25 @@ AlgorithmCiftiSeparate::AlgorithmCiftiSeparate(ProgressObject* myProgObj, const
                 *(volOut->getMapLabelTable(j)) = *(myLabelsMap.getMapLabelTable(j));
             }
         }
-        for (int64_t i = 0; i < colSize; ++i)
+        vector<float> rowBlock;
+        const int64_t blockRows = getBlockRows(rowSize);
+        for (int64_t blockStart = 0; blockStart < colSize; blockStart += blockRows)
         {
-            ciftiIn->getRow(rowScratch, i);
-            for (int64_t j = 0; j < numVoxels; ++j)
+            const int64_t blockEnd = min(blockStart + blockRows, (int64_t)colSize);
+            rowBlock.resize((blockEnd - blockStart) * rowSize);
+            ciftiIn->getRowBlock(rowBlock.data(), blockStart, blockEnd - blockStart);//one large read for many rows
+            for (int64_t i = blockStart; i < blockEnd; ++i)
             {
-                int64_t thisvoxel[3] = { myMap[j].m_ijk[0] - offsetOut[0], myMap[j].m_ijk[1] - offsetOut[1], myMap[j].m_ijk[2] - offsetOut[2] };
-                if (i == 0 && roiOut != NULL)
+                const float* rowScratch = rowBlock.data() + (i - blockStart) * rowSize;
+                for (int64_t j = 0; j < numVoxels; ++j)
                 {
-                    roiOut->setValue(1.0f, thisvoxel);
+                    int64_t thisvoxel[3] = { myMap[j].m_ijk[0] - offsetOut[0], myMap[j].m_ijk[1] - offsetOut[1], myMap[j].m_ijk[2] - offsetOut[2] };
+                    if (i == 0 && roiOut != NULL)
+                    {
+                        roiOut->setValue(1.0f, thisvoxel);
+                    }
+                    volOut->setValue(rowScratch[myMap[j].m_ciftiIndex], thisvoxel, i);
                 }
-                volOut->setValue(rowScratch[myMap[j].m_ciftiIndex], thisvoxel, i);
             }
         }
     }
@@ -91,23 +91,15 @@ AlgorithmCiftiTranspose::AlgorithmCiftiTranspose(ProgressObject* myProgObj, cons
         if (numCacheRows < 1) numCacheRows = 1;
         if (numCacheRows > colSize) numCacheRows = colSize;
     }
-    vector<vector<float> > cacheRows(numCacheRows, vector<float>(rowSize));
-    vector<float> scratchInRow(colSize);
+    vector<float> cacheRows((int64_t)numCacheRows * rowSize);//input columns are output rows, so a block of columns is a block of output rows
     for (int i = 0; i < colSize; i += numCacheRows)//loop through cache chunks
     {
         int end = i + numCacheRows;
         if (end > colSize) end = colSize;
-        for (int j = 0; j < rowSize; ++j)//loop through all input rows
-        {
-            ciftiIn->getRow(scratchInRow.data(), j);
-            for (int k = i; k < end; ++k)
-            {
-                cacheRows[k - i][j] = scratchInRow[k];
-            }
-        }
+        ciftiIn->getColumnBlock(cacheRows.data(), i, end - i);//one pass over the input, reading only the part of each row we need
         for (int k = i; k < end; ++k)
         {
-            ciftiOut->setRow(cacheRows[k - i].data(), k);
+            ciftiOut->setRow(cacheRows.data() + (int64_t)(k - i) * rowSize, k);
         }
     }
 }
@@ -134,10 +134,11 @@ AlgorithmFiberDotProducts::AlgorithmFiberDotProducts(ProgressObject* myProgObj,
         myDotProdOut->setColumnName(i, "Fiber " + AString::number(i + 1) + " dot products");
         myFSampOut->setColumnName(i, "Fiber " + AString::number(i + 1) + " population mean f");
     }
-    const float* coordData = mySurf->getCoordinateData();
+    vector<int64_t> closestSamples(numNodes);
+    myLocator.closestPoints(mySurf->getCoordinateData(), numNodes, closestSamples.data());//do all searches at once, in parallel
     for (int i = 0; i < numNodes; ++i)
     {
-        int closest = myLocator.closestPoint(coordData + i * 3);
+        int64_t closest = closestSamples[i];
         if (closest != -1)
         {
             myFibers->getRow(rowScratch.data(), coordIndices[closest]);
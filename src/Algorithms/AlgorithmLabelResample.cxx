@@ -70,6 +70,9 @@ OperationParameters* AlgorithmLabelResample::getParameters()
     
     ret->createOptionalParameter(10, "-largest", "use only the label of the vertex with the largest weight");
     
+    OptionalParameter* cacheOpt = ret->createOptionalParameter(11, "-weights-cache", "reuse resampling weights saved by previous runs with the same inputs");
+    cacheOpt->addStringParameter(1, "directory", "the directory to save and load weights files in");
+    
     AString myHelpText =
         AString("Resamples a label file, given two spherical surfaces that are in register.  ") +
         "If ADAP_BARY_AREA is used, exactly one of -area-surfs or -area-metrics must be specified.\n\n" +
@@ -77,6 +80,8 @@ OperationParameters* AlgorithmLabelResample::getParameters()
         "Midthickness surfaces are recommended for the vertex areas for most data.\n\n" +
         "The -largest option results in nearest vertex behavior when used with BARYCENTRIC, as it uses the value of the source vertex that has the largest weight.\n\n" +
         "When -largest is not specified, the vertex weights are summed according to which label they correspond to, and the label with the largest sum is used.\n\n" +
+        "The -weights-cache option saves the resampling weights to a file in the given directory, named by a hash of the spheres, vertex areas, roi and method, " +
+        "and later runs with the same inputs load them from there instead of recomputing them.\n\n" +
         "The <method> argument must be one of the following:\n\n";
     
     vector<SurfaceResamplingMethodEnum::Enum> allEnums;
@@ -157,12 +162,19 @@ void AlgorithmLabelResample::useParameters(OperationParameters* myParams, Progre
         validRoiOut = validRoiOutOpt->getOutputMetric(1);
     }
     bool largest = myParams->getOptionalParameter(10)->m_present;
-    AlgorithmLabelResample(myProgObj, labelIn, curSphere, newSphere, myMethod, labelOut, curAreas, newAreas, currentRoi, validRoiOut, largest);
+    AString weightCacheDirectory;
+    OptionalParameter* cacheOpt = myParams->getOptionalParameter(11);
+    if (cacheOpt->m_present)
+    {
+        weightCacheDirectory = cacheOpt->getString(1);
+    }
+    AlgorithmLabelResample(myProgObj, labelIn, curSphere, newSphere, myMethod, labelOut, curAreas, newAreas, currentRoi, validRoiOut, largest, weightCacheDirectory);
 }
 
 AlgorithmLabelResample::AlgorithmLabelResample(ProgressObject* myProgObj, const LabelFile* labelIn, const SurfaceFile* curSphere, const SurfaceFile* newSphere,
                                                const SurfaceResamplingMethodEnum::Enum& myMethod, LabelFile* labelOut, const MetricFile* curAreas,
-                                               const MetricFile* newAreas, const MetricFile* currentRoi, MetricFile* validRoiOut, const bool& largest) : AbstractAlgorithm(myProgObj)
+                                               const MetricFile* newAreas, const MetricFile* currentRoi, MetricFile* validRoiOut, const bool& largest,
+                                               const AString& weightCacheDirectory) : AbstractAlgorithm(myProgObj)
 {
     LevelProgress myProgress(myProgObj);
     if (labelIn->getNumberOfNodes() != curSphere->getNumberOfNodes()) throw AlgorithmException("input label file has different number of nodes than input sphere");
@@ -186,7 +198,7 @@ AlgorithmLabelResample::AlgorithmLabelResample(ProgressObject* myProgObj, const
     vector<int32_t> colScratch(numNewNodes, unusedLabel);
     const float* roiCol = NULL;
     if (currentRoi != NULL) roiCol = currentRoi->getValuePointerForColumn(0);
-    SurfaceResamplingHelper myHelp(myMethod, curSphere, newSphere, curAreaData, newAreaData, roiCol);
+    SurfaceResamplingHelper myHelp(myMethod, curSphere, newSphere, curAreaData, newAreaData, roiCol, weightCacheDirectory);
     if (validRoiOut != NULL)
     {
         validRoiOut->setNumberOfNodesAndColumns(numNewNodes, 1);
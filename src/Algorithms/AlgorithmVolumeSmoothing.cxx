@@ -126,9 +126,12 @@ AlgorithmVolumeSmoothing::AlgorithmVolumeSmoothing(ProgressObject* myProgObj, co
     const float ORTH_TOLERANCE = 0.001f;//tolerate this much deviation from orthogonal (dot product divided by product of lengths) to use orthogonal assumptions to smooth
     if (abs(ivec.dot(jvec.normal())) / ivec.length() < ORTH_TOLERANCE && abs(jvec.dot(kvec.normal())) / jvec.length() < ORTH_TOLERANCE && abs(kvec.dot(ivec.normal())) / kvec.length() < ORTH_TOLERANCE)
     {//if our axes are orthogonal, optimize by doing three 1-dimensional smoothings for O(voxels * (ki + kj + kk)) instead of O(voxels * (ki * kj * kk))
-        CaretArray<float> scratchFrame2(myDims[0] * myDims[1] * myDims[2]), scratchWeights(myDims[0] * myDims[1] * myDims[2]), scratchWeights2(myDims[0] * myDims[1] * myDims[2]), scratchFrame3;
+        CaretArray<float> scratchFrame2, scratchWeights, scratchWeights2, scratchFrame3;
         if (roiVol != NULL)
         {
+            scratchFrame2 = CaretArray<float> (myDims[0] * myDims[1] * myDims[2]);
+            scratchWeights = CaretArray<float> (myDims[0] * myDims[1] * myDims[2]);
+            scratchWeights2 = CaretArray<float> (myDims[0] * myDims[1] * myDims[2]);
             scratchFrame3 = CaretArray<float> (myDims[0] * myDims[1] * myDims[2]);
         }
         float ispace = ivec.length(), jspace = jvec.length(), kspace = kvec.length();
@@ -157,8 +160,63 @@ AlgorithmVolumeSmoothing::AlgorithmVolumeSmoothing(ProgressObject* myProgObj, co
             float tempf = kspace * (k - krange) / kernel;
             kweights[k] = exp(-tempf * tempf / 2.0f);
         }
-        if (subvol == -1)
-        {
+        if (roiVol == NULL)
+        {//smooth several frames per sweep, the weight sums are shared by all frames unless fixing zeros
+            vector<int64_t> frameMaps, frameComponents;
+            if (subvol == -1)
+            {
+                vector<int64_t> origDims = inVol->getOriginalDimensions();
+                outVol->reinitialize(origDims, volSpace, myDims[4], inVol->getType(), inVol->m_header);
+                for (int s = 0; s < myDims[3]; ++s)
+                {
+                    outVol->setMapName(s, inVol->getMapName(s) + ", smooth " + AString::number(kernel));
+                    for (int c = 0; c < myDims[4]; ++c)
+                    {
+                        frameMaps.push_back(s);
+                        frameComponents.push_back(c);
+                    }
+                }
+            } else {
+                vector<int64_t> origDims = inVol->getOriginalDimensions(), newDims;
+                newDims.resize(3);
+                newDims[0] = origDims[0];
+                newDims[1] = origDims[1];
+                newDims[2] = origDims[2];
+                outVol->reinitialize(newDims, volSpace, myDims[4], inVol->getType(), inVol->m_header);
+                outVol->setMapName(0, inVol->getMapName(subvol) + ", smooth " + AString::number(kernel));
+                for (int c = 0; c < myDims[4]; ++c)
+                {
+                    frameMaps.push_back(subvol);
+                    frameComponents.push_back(c);
+                }
+            }
+            const int64_t frameSize = myDims[0] * myDims[1] * myDims[2];
+            const int64_t numFrames = (int64_t)frameMaps.size();
+            const int64_t blockFrames = min(numFrames, (int64_t)BLOCK_FRAMES);
+            CaretArray<float> weightSums, blockOutput(blockFrames * frameSize);
+            if (!fixZeros)
+            {
+                weightSums = CaretArray<float>(frameSize);
+                computeWeightSums(myDims, weightSums, iweights, jweights, kweights, irange, jrange, krange);
+            }
+            for (int64_t blockStart = 0; blockStart < numFrames; blockStart += blockFrames)
+            {
+                const int64_t blockEnd = min(numFrames, blockStart + blockFrames);
+                vector<const float*> inFrames;
+                vector<float*> outFrames;
+                for (int64_t frame = blockStart; frame < blockEnd; ++frame)
+                {
+                    inFrames.push_back(inVol->getFrame(frameMaps[frame], frameComponents[frame]));
+                    outFrames.push_back(blockOutput + (frame - blockStart) * frameSize);
+                }
+                smoothFrameBlock(inFrames, outFrames, myDims, (fixZeros ? NULL : (const float*)weightSums), iweights, jweights, kweights, irange, jrange, krange, fixZeros);
+                for (int64_t frame = blockStart; frame < blockEnd; ++frame)
+                {
+                    outVol->setFrame(outFrames[frame - blockStart], (subvol == -1) ? frameMaps[frame] : 0, frameComponents[frame]);
+                }
+                myProgress.reportProgress(((float)blockEnd) / numFrames);
+            }
+        } else if (subvol == -1) {
             vector<int64_t> origDims = inVol->getOriginalDimensions();
             outVol->reinitialize(origDims, volSpace, myDims[4], inVol->getType(), inVol->m_header);
             vector<int> lists[3];
@@ -168,12 +226,7 @@ AlgorithmVolumeSmoothing::AlgorithmVolumeSmoothing(ProgressObject* myProgObj, co
                 for (int c = 0; c < myDims[4]; ++c)
                 {
                     const float* inFrame = inVol->getFrame(s, c);
-                    if (roiVol == NULL)
-                    {
-                        smoothFrame(inFrame, myDims, scratchFrame, scratchFrame2, scratchWeights, scratchWeights2, inVol, iweights, jweights, kweights, irange, jrange, krange, fixZeros);
-                    } else {
-                        smoothFrameROI(inFrame, myDims, scratchFrame, scratchFrame2, scratchFrame3, scratchWeights, scratchWeights2, lists, inVol, roiVol, iweights, jweights, kweights, irange, jrange, krange, fixZeros);
-                    }
+                    smoothFrameROI(inFrame, myDims, scratchFrame, scratchFrame2, scratchFrame3, scratchWeights, scratchWeights2, lists, inVol, roiVol, iweights, jweights, kweights, irange, jrange, krange, fixZeros);
                     outVol->setFrame(scratchFrame, s, c);
                 }
             }
@@ -189,12 +242,7 @@ AlgorithmVolumeSmoothing::AlgorithmVolumeSmoothing(ProgressObject* myProgObj, co
             for (int c = 0; c < myDims[4]; ++c)
             {
                 const float* inFrame = inVol->getFrame(subvol, c);
-                if (roiVol == NULL)
-                {
-                    smoothFrame(inFrame, myDims, scratchFrame, scratchFrame2, scratchWeights, scratchWeights2, inVol, iweights, jweights, kweights, irange, jrange, krange, fixZeros);
-                } else {
-                    smoothFrameROI(inFrame, myDims, scratchFrame, scratchFrame2, scratchFrame3, scratchWeights, scratchWeights2, lists, inVol, roiVol, iweights, jweights, kweights, irange, jrange, krange, fixZeros);
-                }
+                smoothFrameROI(inFrame, myDims, scratchFrame, scratchFrame2, scratchFrame3, scratchWeights, scratchWeights2, lists, inVol, roiVol, iweights, jweights, kweights, irange, jrange, krange, fixZeros);
                 outVol->setFrame(scratchFrame, 0, c);
             }
         }
@@ -273,88 +321,206 @@ AlgorithmVolumeSmoothing::AlgorithmVolumeSmoothing(ProgressObject* myProgObj, co
     }
 }
 
-void AlgorithmVolumeSmoothing::smoothFrame(const float* inFrame, vector<int64_t> myDims, CaretArray<float> scratchFrame, CaretArray<float> scratchFrame2, CaretArray<float> scratchWeights, CaretArray<float> scratchWeights2, const VolumeFile* inVol, CaretArray<float> iweights, CaretArray<float> jweights, CaretArray<float> kweights, int irange, int jrange, int krange, const bool& fixZeros)
-{//this function should ONLY get invoked when the volume is orthogonal (axes are perpendicular, not necessarily aligned with x, y, z, and not necessarily equal spacing)
-#pragma omp CARET_PARFOR schedule(dynamic)
-    for (int k = 0; k < myDims[2]; ++k)//smooth along i axis
+namespace
+{
+    //i and j passes of one slice, sums are of weighted values, weights are the sums of the weights of the values used (NULL when they don't depend on the data)
+    void smoothSliceIJ(const float* inSlice, float* sliceSums, float* sliceWeights, float* iSums, float* iWeights, const int64_t dimI, const int64_t dimJ,
+                       const float* iweights, const float* jweights, const int irange, const int jrange, const bool fixZeros)
     {
-        for (int j = 0; j < myDims[1]; ++j)
+        const int64_t sliceSize = dimI * dimJ;
+        for (int64_t index = 0; index < sliceSize; ++index)
         {
-            for (int i = 0; i < myDims[0]; ++i)
+            iSums[index] = 0.0f;
+        }
+        if (sliceWeights != NULL)
+        {
+            for (int64_t index = 0; index < sliceSize; ++index)
+            {
+                iWeights[index] = 0.0f;
+            }
+        }
+        for (int64_t j = 0; j < dimJ; ++j)//along i, one kernel offset at a time so the inner loop runs across neighboring voxels
+        {
+            const float* inRow = inSlice + j * dimI;
+            float* sumRow = iSums + j * dimI;
+            float* weightRow = iWeights + j * dimI;
+            for (int offset = -irange; offset <= irange; ++offset)//ascending offset is the same summation order as looping over the kernel per voxel
             {
-                int imin = i - irange, imax = i + irange + 1;//one-after array size convention
-                if (imin < 0) imin = 0;
-                if (imax > myDims[0]) imax = myDims[0];
-                float sum = 0.0f, weightsum = 0.0f;
-                int64_t baseInd = inVol->getIndex(0, j, k, 0);//extra 0 on a default parameter is to prevent int->pointer vs int->int64 conversion ambiguity
-                int64_t curInd = baseInd + i;
-                for (int ikern = imin; ikern < imax; ++ikern)
+                const float weight = iweights[offset + irange];
+                const int64_t istart = max((int64_t)0, (int64_t)-offset), iend = min(dimI, dimI - offset);
+                const float* shiftedRow = inRow + offset;
+                if (fixZeros)
                 {
-                    int64_t thisIndex = baseInd + ikern;
-                    if ((!fixZeros || inFrame[thisIndex] != 0.0f))
+                    for (int64_t i = istart; i < iend; ++i)
+                    {
+                        const float value = shiftedRow[i];
+                        const float useWeight = (value != 0.0f) ? weight : 0.0f;
+                        weightRow[i] += useWeight;
+                        sumRow[i] += useWeight * value;
+                    }
+                } else {
+                    for (int64_t i = istart; i < iend; ++i)
                     {
-                        float weight = iweights[ikern - i + irange];
-                        weightsum += weight;
-                        sum += weight * inFrame[thisIndex];
+                        sumRow[i] += weight * shiftedRow[i];
                     }
                 }
-                scratchWeights[curInd] = weightsum;
-                scratchFrame[curInd] = sum;//don't divide yet, we will divide later after we gather the weighted sums of the weighted sums of the weight sums (yes, that repetition is right)
             }
         }
-    }
-#pragma omp CARET_PARFOR schedule(dynamic)
-    for (int k = 0; k < myDims[2]; ++k)//now j
-    {
-        for (int i = 0; i < myDims[0]; ++i)
+        for (int64_t j = 0; j < dimJ; ++j)//now j, rows of the slice are still in cache
         {
-            for (int j = 0; j < myDims[1]; ++j)//step along the dimension being smoothed last for best cache coherence
+            float* sumRow = sliceSums + j * dimI;
+            float* weightRow = (sliceWeights != NULL) ? sliceWeights + j * dimI : NULL;
+            for (int64_t i = 0; i < dimI; ++i)
+            {
+                sumRow[i] = 0.0f;
+            }
+            if (weightRow != NULL)
+            {
+                for (int64_t i = 0; i < dimI; ++i)
+                {
+                    weightRow[i] = 0.0f;
+                }
+            }
+            const int64_t jmin = max((int64_t)0, j - jrange), jmax = min(dimJ, j + jrange + 1);//one-after array size convention
+            for (int64_t jkern = jmin; jkern < jmax; ++jkern)
             {
-                int jmin = j - jrange, jmax = j + jrange + 1;//one-after array size convention
-                if (jmin < 0) jmin = 0;
-                if (jmax > myDims[1]) jmax = myDims[1];
-                float sum = 0.0f, weightsum = 0.0f;
-                int64_t baseInd = inVol->getIndex(i, 0, k);
-                int64_t curInd = baseInd + j * myDims[0];
-                for (int jkern = jmin; jkern < jmax; ++jkern)
+                const float weight = jweights[jkern - j + jrange];
+                const float* kernSums = iSums + jkern * dimI;
+                for (int64_t i = 0; i < dimI; ++i)
                 {
-                    int64_t thisIndex = baseInd + jkern * myDims[0];
-                    float weight = jweights[jkern - j + jrange];
-                    weightsum += weight * scratchWeights[thisIndex];
-                    sum += weight * scratchFrame[thisIndex];
+                    sumRow[i] += weight * kernSums[i];
+                }
+                if (weightRow != NULL)
+                {
+                    const float* kernWeights = iWeights + jkern * dimI;
+                    for (int64_t i = 0; i < dimI; ++i)
+                    {
+                        weightRow[i] += weight * kernWeights[i];
+                    }
                 }
-                scratchWeights2[curInd] = weightsum;
-                scratchFrame2[curInd] = sum;//we now have the weighted sum of the weight sums
             }
         }
     }
-//somehow this loop set is helped by collapsing the two outers, while the other two are not helped by it
-//however, we need to upgrade our windows compiler before we can use "collapse"
+}
+
+void AlgorithmVolumeSmoothing::computeWeightSums(const vector<int64_t>& myDims, float* weightSumsOut, const CaretArray<float>& iweights, const CaretArray<float>& jweights, const CaretArray<float>& kweights,
+                                                 const int& irange, const int& jrange, const int& krange)
+{//without -fix-zeros, the weight sums are the same for every frame, so the frame smoothing only needs the weighted sums of the data
+    const int64_t dimI = myDims[0], dimJ = myDims[1], dimK = myDims[2], sliceSize = dimI * dimJ;
+    vector<float> iSums(dimI, 0.0f), ijSums(sliceSize, 0.0f);
+    for (int64_t i = 0; i < dimI; ++i)
+    {
+        const int64_t imin = max((int64_t)0, i - irange), imax = min(dimI, i + irange + 1);
+        for (int64_t ikern = imin; ikern < imax; ++ikern)
+        {
+            iSums[i] += iweights[ikern - i + irange];
+        }
+    }
+    for (int64_t j = 0; j < dimJ; ++j)
+    {
+        const int64_t jmin = max((int64_t)0, j - jrange), jmax = min(dimJ, j + jrange + 1);
+        for (int64_t jkern = jmin; jkern < jmax; ++jkern)
+        {
+            const float weight = jweights[jkern - j + jrange];
+            for (int64_t i = 0; i < dimI; ++i)
+            {
+                ijSums[j * dimI + i] += weight * iSums[i];
+            }
+        }
+    }
 #pragma omp CARET_PARFOR schedule(dynamic)
-    for (int j = 0; j < myDims[1]; ++j)//and finally k
+    for (int64_t k = 0; k < dimK; ++k)
     {
-        for (int i = 0; i < myDims[0]; ++i)
+        float* outSlice = weightSumsOut + k * sliceSize;
+        for (int64_t index = 0; index < sliceSize; ++index)
+        {
+            outSlice[index] = 0.0f;
+        }
+        const int64_t kmin = max((int64_t)0, k - krange), kmax = min(dimK, k + krange + 1);
+        for (int64_t kkern = kmin; kkern < kmax; ++kkern)
         {
-            for (int k = 0; k < myDims[2]; ++k)//ditto
+            const float weight = kweights[kkern - k + krange];
+            for (int64_t index = 0; index < sliceSize; ++index)
             {
-                int64_t baseInd = inVol->getIndex(i, j, 0);
-                int64_t curInd = baseInd + k * myDims[0] * myDims[1];
-                int kmin = k - krange, kmax = k + krange + 1;//one-after array size convention
-                if (kmin < 0) kmin = 0;
-                if (kmax > myDims[2]) kmax = myDims[2];
-                float sum = 0.0f, weightsum = 0.0f;
-                for (int kkern = kmin; kkern < kmax; ++kkern)
+                outSlice[index] += weight * ijSums[index];
+            }
+        }
+    }
+}
+
+void AlgorithmVolumeSmoothing::smoothFrameBlock(const vector<const float*>& inFrames, const vector<float*>& outFrames, const vector<int64_t>& myDims, const float* weightSums,
+                                                const CaretArray<float>& iweights, const CaretArray<float>& jweights, const CaretArray<float>& kweights,
+                                                const int& irange, const int& jrange, const int& krange, const bool& fixZeros)
+{//this function should ONLY get invoked when the volume is orthogonal (axes are perpendicular, not necessarily aligned with x, y, z, and not necessarily equal spacing)
+    //weightSums is from computeWeightSums when not fixing zeros, otherwise NULL and weight sums are computed for each frame
+    CaretAssert(inFrames.size() == outFrames.size());
+    CaretAssert(fixZeros == (weightSums == NULL));
+    const int64_t numFrames = (int64_t)inFrames.size();
+    const int64_t dimI = myDims[0], dimJ = myDims[1], dimK = myDims[2], sliceSize = dimI * dimJ, frameSize = sliceSize * dimK;
+    const bool frameWeights = (weightSums == NULL);
+    CaretArray<float> ijSums(numFrames * frameSize), ijWeights(frameWeights ? numFrames * frameSize : 1);
+#pragma omp CARET_PAR
+    {
+        vector<float> iSums(sliceSize), iWeights(frameWeights ? sliceSize : 1);
+#pragma omp CARET_FOR schedule(dynamic)
+        for (int64_t task = 0; task < numFrames * dimK; ++task)//i and j passes one slice at a time, all frames of the block in one sweep
+        {
+            const int64_t f = task / dimK, k = task % dimK;
+            const int64_t sliceOffset = f * frameSize + k * sliceSize;
+            smoothSliceIJ(inFrames[f] + k * sliceSize, ijSums + sliceOffset, (frameWeights ? ijWeights + sliceOffset : NULL), iSums.data(), iWeights.data(),
+                          dimI, dimJ, iweights, jweights, irange, jrange, fixZeros);
+        }
+    }
+#pragma omp CARET_PAR
+    {
+        vector<float> kWeights(frameWeights ? dimI : 1);
+#pragma omp CARET_FOR schedule(dynamic)
+        for (int64_t task = 0; task < numFrames * dimJ; ++task)//and finally k, a row at a time so the inner loops are contiguous
+        {
+            const int64_t f = task / dimJ, j = task % dimJ;
+            const float* frameSums = ijSums + f * frameSize + j * dimI;
+            const float* frameWeightSums = ijWeights + f * frameSize + j * dimI;
+            for (int64_t k = 0; k < dimK; ++k)
+            {
+                float* outRow = outFrames[f] + k * sliceSize + j * dimI;
+                for (int64_t i = 0; i < dimI; ++i)
                 {
-                    int64_t thisIndex = baseInd + kkern * myDims[0] * myDims[1];
-                    float weight = kweights[kkern - k + krange];
-                    weightsum += weight * scratchWeights2[thisIndex];
-                    sum += weight * scratchFrame2[thisIndex];
+                    outRow[i] = 0.0f;
                 }
-                if (weightsum != 0.0f)
+                if (frameWeights)
                 {
-                    scratchFrame[curInd] = sum / weightsum;//NOW we can divide
-                } else {
-                    scratchFrame[curInd] = 0.0f;
+                    for (int64_t i = 0; i < dimI; ++i)
+                    {
+                        kWeights[i] = 0.0f;
+                    }
+                }
+                const int64_t kmin = max((int64_t)0, k - krange), kmax = min(dimK, k + krange + 1);//one-after array size convention
+                for (int64_t kkern = kmin; kkern < kmax; ++kkern)
+                {
+                    const float weight = kweights[kkern - k + krange];
+                    const float* kernSums = frameSums + kkern * sliceSize;
+                    for (int64_t i = 0; i < dimI; ++i)
+                    {
+                        outRow[i] += weight * kernSums[i];
+                    }
+                    if (frameWeights)
+                    {
+                        const float* kernWeights = frameWeightSums + kkern * sliceSize;
+                        for (int64_t i = 0; i < dimI; ++i)
+                        {
+                            kWeights[i] += weight * kernWeights[i];
+                        }
+                    }
+                }
+                const float* weightRow = frameWeights ? kWeights.data() : weightSums + k * sliceSize + j * dimI;
+                for (int64_t i = 0; i < dimI; ++i)
+                {
+                    if (weightRow[i] != 0.0f)
+                    {
+                        outRow[i] = outRow[i] / weightRow[i];//NOW we can divide
+                    } else {
+                        outRow[i] = 0.0f;
+                    }
                 }
             }
         }
@@ -32,9 +32,12 @@ namespace caret {
     protected:
         static float getSubAlgorithmWeight();
         static float getAlgorithmInternalWeight();
-        void smoothFrame(const float* inFrame, std::vector<int64_t> myDims, CaretArray<float> scratchFrame, CaretArray<float> scratchFrame2, CaretArray<float> scratchWeights,
-                         CaretArray<float> scratchWeights2, const VolumeFile* inVol, CaretArray<float> iweights, CaretArray<float> jweights, CaretArray<float> kweights,
-                         int irange, int jrange, int krange, const bool& fixZeros);
+        static const int BLOCK_FRAMES = 8;//frames smoothed per sweep of the orthogonal engine, limited by the memory for their intermediate sums
+        void computeWeightSums(const std::vector<int64_t>& myDims, float* weightSumsOut, const CaretArray<float>& iweights, const CaretArray<float>& jweights, const CaretArray<float>& kweights,
+                               const int& irange, const int& jrange, const int& krange);
+        void smoothFrameBlock(const std::vector<const float*>& inFrames, const std::vector<float*>& outFrames, const std::vector<int64_t>& myDims, const float* weightSums,
+                              const CaretArray<float>& iweights, const CaretArray<float>& jweights, const CaretArray<float>& kweights,
+                              const int& irange, const int& jrange, const int& krange, const bool& fixZeros);
         void smoothFrameROI(const float* inFrame, std::vector<int64_t> myDims, CaretArray<float> scratchFrame, CaretArray<float> scratchFrame2, CaretArray<float> scratchFrame3,
                                               CaretArray<float> scratchWeights, CaretArray<float> scratchWeights2, std::vector<int> lists[3],
                                               const VolumeFile* inVol, const VolumeFile* roiVol, CaretArray<float> iweights, CaretArray<float> jweights, CaretArray<float> kweights,
@@ -28,8 +28,6 @@ namespace caret {
     class AlgorithmVolumeTFCE : public AbstractAlgorithm
     {
         AlgorithmVolumeTFCE();
-        void processFrame(const VolumeFile* inVol, const int64_t& b, const int64_t& c, float* outData, const float* roiData, const float& param_e, const float& param_h);
-        void tfce(const VolumeFile* inVol, const int64_t& b, const int64_t& c, double* accumData, const float* roiData, const float& param_e, const float& param_h, const bool& negate);
     protected:
         static float getSubAlgorithmWeight();
         static float getAlgorithmInternalWeight();
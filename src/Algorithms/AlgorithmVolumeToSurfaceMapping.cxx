@@ -21,6 +21,7 @@
 #include "AlgorithmVolumeToSurfaceMapping.h"
 #include "AlgorithmException.h"
 
+#include "CaretLogger.h"
 #include "CaretOMP.h"
 #include "FloatMatrix.h"
 #include "MathFunctions.h"
@@ -29,10 +30,14 @@
 #include "TopologyHelper.h"
 #include "Vector3D.h"
 #include "VolumeFile.h"
+#include "WeightsFileHelper.h"
 
 #include "AlgorithmSurfaceToSurface3dDistance.h"
 #include "AlgorithmCreateSignedDistanceVolume.h"
 
+#include <QCryptographicHash>
+
+#include <algorithm>
 #include <cmath>
 #include <fstream>
 
@@ -79,6 +84,8 @@ OperationParameters* AlgorithmVolumeToSurfaceMapping::getParameters()
     ribbonWeights->addVolumeOutputParameter(2, "weights-out", "volume to write the weights to");
     OptionalParameter* ribbonWeightsText = ribbonOpt->createOptionalParameter(6, "-output-weights-text", "write the voxel weights for all vertices to a text file");
     ribbonWeightsText->addStringParameter(1, "text-out", "output - the output text filename");//fake the output formatting
+    OptionalParameter* ribbonCacheOpt = ribbonOpt->createOptionalParameter(9, "-weights-cache", "reuse voxel weights saved by previous runs with the same inputs");
+    ribbonCacheOpt->addStringParameter(1, "directory", "the directory to save and load weights files in");
     
     OptionalParameter* myelinStyleOpt = ret->createOptionalParameter(9, "-myelin-style", "use the method from myelin mapping");
     myelinStyleOpt->addVolumeParameter(1, "ribbon-roi", "an roi volume of the cortical ribbon for this hemisphere");
@@ -100,7 +107,9 @@ OperationParameters* AlgorithmVolumeToSurfaceMapping::getParameters()
         "voxels that don't have a positive value in the mask.  The subdivision number specifies how it approximates the amount of the volume the polyhedron " +
         "intersects, by splitting each voxel into NxNxN pieces, and checking whether the center of each piece is inside the polyhedron.  If you have very large " +
         "voxels, consider increasing this if you get zeros in your output.  " +
-        "The -gaussian option makes it act more like the myelin method, where the distance of a voxel from <surface> is used to downweight the voxel.\n\n" +
+        "The -gaussian option makes it act more like the myelin method, where the distance of a voxel from <surface> is used to downweight the voxel.  " +
+        "The -weights-cache option saves the voxel weights to a file in the given directory, named by a hash of the surfaces, volume space, roi and ribbon options, " +
+        "and later runs with the same inputs load them from there instead of recomputing them.\n\n" +
         "The myelin style method uses part of the caret5 myelin mapping command to do the mapping: for each surface vertex, take all voxels that are in a cylinder " +
         "with radius and height equal to cortical thickness, centered on the vertex and aligned with the surface normal, and that are also within the ribbon ROI, " +
         "and apply a gaussian kernel with the specified sigma to them to get the weights to use.  " +
@@ -224,8 +233,14 @@ void AlgorithmVolumeToSurfaceMapping::useParameters(OperationParameters* myParam
                 weightsOutVertex = (int)ribbonWeights->getInteger(1);
                 weightsOut = ribbonWeights->getOutputVolume(2);
             }
+            AString weightCacheDirectory;
+            OptionalParameter* ribbonCacheOpt = ribbonOpt->getOptionalParameter(9);
+            if (ribbonCacheOpt->m_present)
+            {
+                weightCacheDirectory = ribbonCacheOpt->getString(1);
+            }
             AlgorithmVolumeToSurfaceMapping(myProgObj, myVolume, mySurface, myMetricOut, innerSurf, outerSurf, myRoiVol, subdivisions, thinColumns,
-                                            mySubVol, gaussScale, weightsOutVertex, weightsOut);
+                                            mySubVol, gaussScale, weightsOutVertex, weightsOut, weightCacheDirectory);
             OptionalParameter* ribbonWeightsText = ribbonOpt->getOptionalParameter(6);
             if (ribbonWeightsText->m_present)
             {//do this after the algorithm, to let it do the error condition checking
@@ -363,7 +378,7 @@ AlgorithmVolumeToSurfaceMapping::AlgorithmVolumeToSurfaceMapping(ProgressObject*
 AlgorithmVolumeToSurfaceMapping::AlgorithmVolumeToSurfaceMapping(ProgressObject* myProgObj, const VolumeFile* myVolume, const SurfaceFile* mySurface, MetricFile* myMetricOut,
                                                                  const SurfaceFile* innerSurf, const SurfaceFile* outerSurf, const VolumeFile* roiVol,
                                                                  const int32_t& subdivisions, const bool& thinColumns, const int64_t& mySubVol, const float& gaussScale,
-                                                                 const int& weightsOutVertex, VolumeFile* weightsOut) : AbstractAlgorithm(myProgObj)
+                                                                 const int& weightsOutVertex, VolumeFile* weightsOut, const AString& weightCacheDirectory) : AbstractAlgorithm(myProgObj)
 {
     LevelProgress myProgress(myProgObj);
     vector<int64_t> myVolDims;
@@ -397,93 +412,122 @@ AlgorithmVolumeToSurfaceMapping::AlgorithmVolumeToSurfaceMapping(ProgressObject*
         weightDims.resize(3);
         weightsOut->reinitialize(weightDims, myVolume->getSform());
     }
-    vector<vector<VoxelWeight> > myWeights;
     const float* roiFrame = NULL;
     if (roiVol != NULL) roiFrame = roiVol->getFrame();
-    precomputeWeightsRibbon(myWeights, myVolume->getVolumeSpace(), innerSurf, outerSurf, roiFrame, subdivisions, thinColumns, mySurface, gaussScale);
+    VoxelWeightMatrix myWeights;
+    bool haveWeights = false;
+    AString weightsKey, weightsFileName;
+    if (!weightCacheDirectory.isEmpty())
+    {
+        weightsKey = computeRibbonWeightsKey(myVolume->getVolumeSpace(), innerSurf, outerSurf, roiFrame, subdivisions, thinColumns, mySurface, gaussScale);
+        weightsFileName = WeightsFileHelper::getCacheFileName(weightCacheDirectory, "ribbon_weights_", weightsKey);
+        haveWeights = WeightsFileHelper::loadFromCache(weightsFileName, [&](const AString& name) { return myWeights.readFile(name, weightsKey); }, "ribbon mapping weights");
+        if (haveWeights && myWeights.getNumberOfVertices() != numNodes)
+        {
+            CaretLogWarning("ribbon mapping weights file '" + weightsFileName + "' has the wrong number of vertices, recomputing");
+            haveWeights = false;
+        }
+    }
+    if (!haveWeights)
+    {
+        vector<vector<VoxelWeight> > nestedWeights;
+        precomputeWeightsRibbon(nestedWeights, myVolume->getVolumeSpace(), innerSurf, outerSurf, roiFrame, subdivisions, thinColumns, mySurface, gaussScale);
+        myWeights = VoxelWeightMatrix(nestedWeights, myVolume->getVolumeSpace().getDims());
+        if (!weightCacheDirectory.isEmpty())
+        {
+            WeightsFileHelper::saveToCache(weightsFileName, [&](const AString& name) { myWeights.writeFile(name, weightsKey); }, "ribbon mapping weights");
+        }
+    }
+    CaretAssert(myWeights.getNumberOfVertices() == numNodes);
     if (weightsOut != NULL)
     {
         weightsOut->setValueAllVoxels(0.0f);
-        const vector<VoxelWeight>& vertexWeights = myWeights[weightsOutVertex];
+        vector<VoxelWeight> vertexWeights;
+        myWeights.getVertexWeights(weightsOutVertex, vertexWeights);
         int numWeights = (int)vertexWeights.size();
         for (int i = 0; i < numWeights; ++i)
         {
             weightsOut->setValue(vertexWeights[i].weight, vertexWeights[i].ijk);
         }
     }
-    CaretArray<float> myScratchArray(numNodes);
-    float* myScratch = myScratchArray.getArray();
+    mapWithWeights(myWeights, myVolume, mySubVol, myMetricOut, " ribbon constrained", true);
+}
+
+void AlgorithmVolumeToSurfaceMapping::mapWithWeights(const VoxelWeightMatrix& myWeights, const VolumeFile* myVolume, const int64_t& mySubVol, MetricFile* myMetricOut,
+                                                     const AString& methodLabel, const bool& normalize)
+{
+    vector<int64_t> myVolDims;
+    myVolume->getDimensions(myVolDims);
+    vector<pair<int64_t, int64_t> > columnFrames;//brick and component for each output column
     if (mySubVol == -1)
     {
         for (int64_t i = 0; i < myVolDims[3]; ++i)
         {
             for (int64_t j = 0; j < myVolDims[4]; ++j)
             {
-                int64_t thisCol = i * myVolDims[4] + j;
-                AString metricLabel = myVolume->getMapName(i);
-                if (myVolDims[4] != 1)
-                {
-                    metricLabel += " component " + AString::number(j);
-                }
-                metricLabel += " ribbon constrained";
-                myMetricOut->setColumnName(thisCol, metricLabel);
-#pragma omp CARET_PARFOR schedule(dynamic)
-                for (int64_t node = 0; node < numNodes; ++node)
-                {
-                    myScratch[node] = 0.0f;
-                    float totalWeight = 0.0f;
-                    int numVoxels = (int)myWeights[node].size();
-                    for (int voxel = 0; voxel < numVoxels; ++voxel)
-                    {
-                        float thisWeight = myWeights[node][voxel].weight;
-                        totalWeight += thisWeight;
-                        myScratch[node] += thisWeight * myVolume->getValue(myWeights[node][voxel].ijk, i, j);
-                    }
-                    if (totalWeight != 0.0f)
-                    {
-                        myScratch[node] /= totalWeight;
-                    } else {
-                        myScratch[node] = 0.0f;
-                    }
-                }
-                myMetricOut->setValuesForColumn(thisCol, myScratch);
+                columnFrames.push_back(make_pair(i, j));
             }
         }
     } else {
         for (int64_t j = 0; j < myVolDims[4]; ++j)
         {
-            AString metricLabel = myVolume->getMapName(mySubVol);
+            columnFrames.push_back(make_pair(mySubVol, j));
+        }
+    }
+    int64_t numColumns = (int64_t)columnFrames.size(), numNodes = myWeights.getNumberOfVertices();
+    const int64_t blockFrames = VoxelWeightMatrix::BLOCK_FRAMES;
+    vector<float> myScratch(numNodes * blockFrames);
+    for (int64_t startCol = 0; startCol < numColumns; startCol += blockFrames)
+    {//map a block of frames with one pass over the weights
+        int blockSize = (int)min(blockFrames, numColumns - startCol);
+        const float* frames[VoxelWeightMatrix::BLOCK_FRAMES];
+        float* outputs[VoxelWeightMatrix::BLOCK_FRAMES];
+        for (int f = 0; f < blockSize; ++f)
+        {
+            int64_t thisCol = startCol + f;
+            AString metricLabel = myVolume->getMapName(columnFrames[thisCol].first);
             if (myVolDims[4] != 1)
             {
-                metricLabel += " component " + AString::number(j);
+                metricLabel += " component " + AString::number(columnFrames[thisCol].second);
             }
-            metricLabel += " ribbon constrained";
-            int64_t thisCol = j;
+            metricLabel += methodLabel;
             myMetricOut->setColumnName(thisCol, metricLabel);
-#pragma omp CARET_PARFOR schedule(dynamic)
-            for (int64_t node = 0; node < numNodes; ++node)
-            {
-                    myScratch[node] = 0.0f;
-                    float totalWeight = 0.0f;
-                    int numVoxels = (int)myWeights[node].size();
-                    for (int voxel = 0; voxel < numVoxels; ++voxel)
-                    {
-                        float thisWeight = myWeights[node][voxel].weight;
-                        totalWeight += thisWeight;
-                        myScratch[node] += thisWeight * myVolume->getValue(myWeights[node][voxel].ijk, mySubVol, j);
-                    }
-                    if (totalWeight != 0.0f)
-                    {
-                        myScratch[node] /= totalWeight;
-                    } else {
-                        myScratch[node] = 0.0f;
-                    }
-            }
-            myMetricOut->setValuesForColumn(thisCol, myScratch);
+            frames[f] = myVolume->getFrame(columnFrames[thisCol].first, columnFrames[thisCol].second);
+            outputs[f] = myScratch.data() + f * numNodes;
+        }
+        myWeights.apply(frames, outputs, blockSize, normalize);
+        for (int f = 0; f < blockSize; ++f)
+        {
+            myMetricOut->setValuesForColumn(startCol + f, outputs[f]);
         }
     }
 }
 
+AString AlgorithmVolumeToSurfaceMapping::computeRibbonWeightsKey(const VolumeSpace& volSpace, const SurfaceFile* innerSurf, const SurfaceFile* outerSurf,
+                                                                 const float* roiFrame, const int& subdivisions, const bool& thinColumns, const SurfaceFile* gaussSurf, const float& gaussScale)
+{
+    QCryptographicHash myHash(QCryptographicHash::Sha1);
+    const int32_t KEY_VERSION = 1;//change this if the weight computation changes
+    int32_t options[3] = { KEY_VERSION, subdivisions, (thinColumns ? 1 : 0) };
+    WeightsFileHelper::addToHash(myHash, options, sizeof(options));
+    const int64_t* dims = volSpace.getDims();
+    WeightsFileHelper::addToHash(myHash, dims, 3 * sizeof(int64_t));
+    const vector<vector<float> >& sform = volSpace.getSform();
+    for (int i = 0; i < (int)sform.size(); ++i)
+    {
+        WeightsFileHelper::addToHash(myHash, sform[i].data(), sform[i].size() * sizeof(float));
+    }
+    WeightsFileHelper::addSurfaceToHash(myHash, innerSurf);
+    WeightsFileHelper::addSurfaceToHash(myHash, outerSurf);
+    if (gaussScale > 0.0f)
+    {//the gaussian surface only matters when it is used
+        WeightsFileHelper::addSurfaceToHash(myHash, gaussSurf);
+        WeightsFileHelper::addToHash(myHash, &gaussScale, sizeof(float));
+    }
+    WeightsFileHelper::addRoiToHash(myHash, roiFrame, dims[0] * dims[1] * dims[2]);
+    return WeightsFileHelper::getKey(myHash);
+}
+
 void AlgorithmVolumeToSurfaceMapping::precomputeWeightsRibbon(vector<vector<VoxelWeight> >& myWeights, const VolumeSpace& volSpace,
                                                               const SurfaceFile* innerSurf, const SurfaceFile* outerSurf, const float* roiFrame,
                                                               const int& subdivisions, const bool& thinColumns, const SurfaceFile* gaussSurf, const float& gaussScale)
@@ -542,60 +586,7 @@ AlgorithmVolumeToSurfaceMapping::AlgorithmVolumeToSurfaceMapping(ProgressObject*
     myMetricOut->setStructure(mySurface->getStructure());
     vector<vector<VoxelWeight> > myWeights;
     precomputeWeightsMyelin(myWeights, mySurface, roiVol, thickness, sigma, oldCutoffBug);
-    vector<float> myScratch(numNodes);
-    if (mySubVol == -1)
-    {
-        for (int64_t i = 0; i < myVolDims[3]; ++i)
-        {
-            for (int64_t j = 0; j < myVolDims[4]; ++j)
-            {
-                int64_t thisCol = i * myVolDims[4] + j;
-                AString metricLabel = myVolume->getMapName(i);
-                if (myVolDims[4] != 1)
-                {
-                    metricLabel += " component " + AString::number(j);
-                }
-                metricLabel += " myelin style";
-                myMetricOut->setColumnName(thisCol, metricLabel);
-#pragma omp CARET_PARFOR schedule(dynamic)
-                for (int64_t node = 0; node < numNodes; ++node)
-                {
-                    double accum = 0.0;
-                    int numVoxels = (int)myWeights[node].size();
-                    for (int voxel = 0; voxel < numVoxels; ++voxel)
-                    {
-                        accum += myWeights[node][voxel].weight * myVolume->getValue(myWeights[node][voxel].ijk, i, j);//weights have already been normalized in precompute, for this method
-                    }
-                    myScratch[node] = accum;
-                }
-                myMetricOut->setValuesForColumn(thisCol, myScratch.data());
-            }
-        }
-    } else {
-        for (int64_t j = 0; j < myVolDims[4]; ++j)
-        {
-            AString metricLabel = myVolume->getMapName(mySubVol);
-            if (myVolDims[4] != 1)
-            {
-                metricLabel += " component " + AString::number(j);
-            }
-            metricLabel += " myelin style";
-            int64_t thisCol = j;
-            myMetricOut->setColumnName(thisCol, metricLabel);
-#pragma omp CARET_PARFOR schedule(dynamic)
-            for (int64_t node = 0; node < numNodes; ++node)
-            {
-                double accum = 0.0;
-                int numVoxels = (int)myWeights[node].size();
-                for (int voxel = 0; voxel < numVoxels; ++voxel)
-                {
-                    accum += myWeights[node][voxel].weight * myVolume->getValue(myWeights[node][voxel].ijk, mySubVol, j);//weights have already been normalized in precompute, for this method
-                }
-                myScratch[node] = accum;
-            }
-            myMetricOut->setValuesForColumn(thisCol, myScratch.data());
-        }
-    }
+    mapWithWeights(VoxelWeightMatrix(myWeights, myVolume->getVolumeSpace().getDims()), myVolume, mySubVol, myMetricOut, " myelin style", false);//weights have already been normalized in precompute, for this method
 }
 
 void AlgorithmVolumeToSurfaceMapping::precomputeWeightsMyelin(vector<vector<VoxelWeight> >& myWeights, const SurfaceFile* mySurface, const VolumeFile* roiVol,
@@ -56,6 +56,7 @@
 #include "CiftiParcelSeriesFile.h"
 #include "CiftiParcelScalarFile.h"
 #include "CiftiScalarDataSeriesFile.h"
+#include "DataFileConcurrentReader.h"
 #include "DisplayPropertiesAnnotation.h"
 #include "DisplayPropertiesAnnotationTextSubstitution.h"
 #include "DisplayPropertiesBorders.h"
@@ -1899,20 +1900,7 @@ Brain::addReadOrReloadBorderFile(const FileModeAddReadReload fileMode,
                                         CaretDataFileHelper::createBadAllocExceptionMessage(filename));
             }
 
-            /*
-             * Create a map of structure to number of nodes
-             */
-            std::map<StructureEnum::Enum, int32_t> structureToNodeCountMap;
-            for (std::vector<BrainStructure*>::iterator bsIter = m_brainStructures.begin();
-                 bsIter != m_brainStructures.end();
-                 bsIter++) {
-                const BrainStructure* bs = *bsIter;
-                CaretAssert(bs);
-                structureToNodeCountMap.insert(std::make_pair(bs->getStructure(),
-                                                              bs->getNumberOfNodes()));
-            }
-            
-            bf->updateNumberOfNodesIfSingleStructure(structureToNodeCountMap);
+            updateBorderFileNumberOfNodes(bf);
         }
         catch (DataFileException& dfe) {
             if (caretDataFile != NULL) {
@@ -2125,6 +2113,34 @@ Brain::validateCiftiMappableDataFile(const CiftiMappableDataFile* ciftiMapFile)
     }
 }
 
+/**
+ * If the border file contains a single structure, update its number of
+ * nodes using the brain structure with the same structure.
+ *
+ * @param borderFile
+ *    The border file.
+ */
+void
+Brain::updateBorderFileNumberOfNodes(BorderFile* borderFile) const
+{
+    CaretAssert(borderFile);
+    
+    /*
+     * Create a map of structure to number of nodes
+     */
+    std::map<StructureEnum::Enum, int32_t> structureToNodeCountMap;
+    for (std::vector<BrainStructure*>::const_iterator bsIter = m_brainStructures.begin();
+         bsIter != m_brainStructures.end();
+         bsIter++) {
+        const BrainStructure* bs = *bsIter;
+        CaretAssert(bs);
+        structureToNodeCountMap.insert(std::make_pair(bs->getStructure(),
+                                                      bs->getNumberOfNodes()));
+    }
+    
+    borderFile->updateNumberOfNodesIfSingleStructure(structureToNodeCountMap);
+}
+
 
 /**
  * Read a connectivity matrix dense file.
@@ -5521,7 +5537,8 @@ CaretDataFile*
 Brain::readDataFile(const DataFileTypeEnum::Enum dataFileType,
                     const StructureEnum::Enum structure,
                     const AString& dataFileNameIn,
-                    const bool markDataFileAsModified)
+                    const bool markDataFileAsModified,
+                    DataFileConcurrentReader* concurrentReader)
 {
     AString dataFileName = dataFileNameIn;
     
@@ -5541,6 +5558,20 @@ Brain::readDataFile(const DataFileTypeEnum::Enum dataFileType,
         }
     }
     
+    /*
+     * If the file was read by the concurrent reader, only need to add it
+     */
+    if (concurrentReader != NULL) {
+        CaretDataFile* concurrentlyReadFile = concurrentReader->takeFile(dataFileType,
+                                                                         dataFileName);
+        if (concurrentlyReadFile != NULL) {
+            return addConcurrentlyReadDataFile(concurrentlyReadFile,
+                                               structure,
+                                               dataFileName,
+                                               markDataFileAsModified);
+        }
+    }
+    
     CaretDataFile* caretDataFileRead = addReadOrReloadDataFile(FILE_MODE_READ,
                                                             NULL,
                                                             dataFileType,
@@ -5551,6 +5582,112 @@ Brain::readDataFile(const DataFileTypeEnum::Enum dataFileType,
     return caretDataFileRead;
 }
 
+/**
+ * Add a data file that was read by a concurrent reader.  Performs the
+ * same validation that is performed after a file is read by
+ * addReadOrReloadDataFile() and then adds the file to the brain.
+ *
+ * @param caretDataFile
+ *    File that was read.  If adding fails, the file is deleted.
+ * @param structure
+ *    Structure for the file.
+ * @param dataFileName
+ *    Name of the file.
+ * @param markDataFileAsModified
+ *    If file has been modified, mark it as modified.
+ * @throws DataFileException
+ *    If the file is not valid.
+ * @return
+ *    Pointer to the file that was added.
+ */
+CaretDataFile*
+Brain::addConcurrentlyReadDataFile(CaretDataFile* caretDataFile,
+                                   const StructureEnum::Enum structure,
+                                   const AString& dataFileName,
+                                   const bool markDataFileAsModified)
+{
+    CaretAssert(caretDataFile);
+    
+    const DataFileTypeEnum::Enum dataFileType = caretDataFile->getDataFileType();
+    try {
+        CiftiMappableDataFile* ciftiMapFile = dynamic_cast<CiftiMappableDataFile*>(caretDataFile);
+        if (ciftiMapFile != NULL) {
+            if (dataFileType == DataFileTypeEnum::CONNECTIVITY_DENSE) {
+                ciftiMapFile->clearModified();
+            }
+            validateCiftiMappableDataFile(ciftiMapFile);
+        }
+        
+        BorderFile* borderFile = dynamic_cast<BorderFile*>(caretDataFile);
+        if (borderFile != NULL) {
+            updateBorderFileNumberOfNodes(borderFile);
+        }
+        
+        return addReadOrReloadDataFile(FILE_MODE_ADD,
+                                       caretDataFile,
+                                       dataFileType,
+                                       structure,
+                                       dataFileName,
+                                       markDataFileAsModified);
+    }
+    catch (const DataFileException&) {
+        removeWithoutDeleteDataFile(caretDataFile);
+        delete caretDataFile;
+        throw;
+    }
+    
+    return NULL;
+}
+
+/**
+ * Start concurrent reading of the files selected for loading in a spec
+ * file.  Files are read on worker threads and later added to the brain,
+ * in spec file order, by readDataFile().  Files with a type that
+ * does not support concurrent reading are ignored and are read
+ * by readDataFile().
+ *
+ * @param specFile
+ *    The spec file.
+ * @param specFileEntriesToSkip
+ *    Entries in the spec file that are NOT read (already in memory).
+ * @param concurrentReader
+ *    Reader that reads the files.
+ */
+void
+Brain::startConcurrentReadingOfSpecFileDataFiles(const SpecFile* specFile,
+                                                 const std::map<const SpecFileDataFile*, CaretDataFile*>& specFileEntriesToSkip,
+                                                 DataFileConcurrentReader& concurrentReader)
+{
+    CaretAssert(specFile);
+    
+    const int32_t numFileGroups = specFile->getNumberOfDataFileTypeGroups();
+    for (int32_t ig = 0; ig < numFileGroups; ig++) {
+        const SpecFileDataFileTypeGroup* group = specFile->getDataFileTypeGroupByIndex(ig);
+        const DataFileTypeEnum::Enum dataFileType = group->getDataFileType();
+        const int32_t numFiles = group->getNumberOfFiles();
+        for (int32_t iFile = 0; iFile < numFiles; iFile++) {
+            const SpecFileDataFile* fileInfo = group->getFileInformation(iFile);
+            if (fileInfo->isLoadingSelected()) {
+                if (specFileEntriesToSkip.find(fileInfo) != specFileEntriesToSkip.end()) {
+                    continue;
+                }
+                const AString filename = convertFilePathNameToAbsolutePathName(fileInfo->getFileName());
+                if (DataFileConcurrentReader::isConcurrentReadingSupported(dataFileType,
+                                                                           filename)) {
+                    concurrentReader.startReading(dataFileType,
+                                                  filename);
+                }
+            }
+        }
+    }
+    
+    if (concurrentReader.getNumberOfFilesStarted() > 0) {
+        CaretLogFine("Started concurrent reading of "
+                     + AString::number(concurrentReader.getNumberOfFilesStarted())
+                     + " files.");
+    }
+}
+
 /**
  * Processing performed after adding or removing a data file.
  */
@@ -5628,6 +5765,16 @@ Brain::loadFilesSelectedInSpecFile(EventSpecFileReadDataFiles* readSpecFileDataF
                                        "Starting to read selected files");
     EventManager::get()->sendEvent(progressUpdate.getPointer());
 
+    /*
+     * Files are read on worker threads while the loop below adds them,
+     * in order, to the brain.  If the loop exits early, the reader
+     * waits for the reads in progress and deletes files not added.
+     */
+    DataFileConcurrentReader concurrentReader;
+    startConcurrentReadingOfSpecFileDataFiles(sf,
+                                              std::map<const SpecFileDataFile*, CaretDataFile*>(),
+                                              concurrentReader);
+    
     /*
      * Note: Need to read palette first since some of the individual file
      * reading routines update palette coloring when file is read
@@ -5671,7 +5818,8 @@ Brain::loadFilesSelectedInSpecFile(EventSpecFileReadDataFiles* readSpecFileDataF
                     readDataFile(dataFileType,
                                  structure,
                                  filename,
-                                 false);
+                                 false,
+                                 &concurrentReader);
                 }
                 catch (const DataFileException& e) {
                     if (errorMessage.isEmpty() == false) {
@@ -5886,6 +6034,17 @@ Brain::loadSpecFileFromScene(const SceneAttributes* sceneAttributes,
     }
     m_nonModifiedFilesForRestoringScene.clear();
     
+    /*
+     * Read files on worker threads while the loop below adds them to
+     * the brain.  Not used when the scene is on the network since
+     * names of the files are changed in the loop.
+     */
+    DataFileConcurrentReader concurrentReader;
+    if ( ! sceneFileOnNetwork) {
+        startConcurrentReadingOfSpecFileDataFiles(specFileToLoad,
+                                                  specFilesEntryToNonModifiedFile,
+                                                  concurrentReader);
+    }
     
     /*
      * Load new files and add existing files that were previously loaded.
@@ -5949,7 +6108,8 @@ Brain::loadSpecFileFromScene(const SceneAttributes* sceneAttributes,
                         readDataFile(dataFileType,
                                      structure,
                                      filename,
-                                     false);
+                                     false,
+                                     &concurrentReader);
                     }
                 }
                 catch (const DataFileException& e) {
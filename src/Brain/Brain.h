@@ -68,6 +68,7 @@ namespace caret {
     class CiftiParcelSeriesFile;
     class CiftiParcelScalarFile;
     class CiftiScalarDataSeriesFile;
+    class DataFileConcurrentReader;
     class DisplayProperties;
     class DisplayPropertiesAnnotation;
     class DisplayPropertiesAnnotationTextSubstitution;
@@ -99,6 +100,7 @@ namespace caret {
     class SceneFile;
     class SelectionManager;
     class SpecFile;
+    class SpecFileDataFile;
     class Surface;
     class SurfaceFile;
     class SurfaceProjectedItem;
@@ -505,7 +507,17 @@ namespace caret {
         CaretDataFile* readDataFile(const DataFileTypeEnum::Enum dataFileType,
                           const StructureEnum::Enum structure,
                           const AString& dataFileName,
-                          const bool markDataFileAsModified);
+                          const bool markDataFileAsModified,
+                          DataFileConcurrentReader* concurrentReader = NULL);
+        
+        CaretDataFile* addConcurrentlyReadDataFile(CaretDataFile* caretDataFile,
+                                                   const StructureEnum::Enum structure,
+                                                   const AString& dataFileName,
+                                                   const bool markDataFileAsModified);
+        
+        void startConcurrentReadingOfSpecFileDataFiles(const SpecFile* specFile,
+                                                       const std::map<const SpecFileDataFile*, CaretDataFile*>& specFileEntriesToSkip,
+                                                       DataFileConcurrentReader& concurrentReader);
         
         void createModelChartTwo();
         
@@ -734,6 +746,8 @@ namespace caret {
         
         void validateCiftiMappableDataFile(const CiftiMappableDataFile* ciftiMapFile) const;
         
+        void updateBorderFileNumberOfNodes(BorderFile* borderFile) const;
+        
         int32_t getDuplicateFileNameCounterForFileType(const DataFileTypeEnum::Enum dataFileType);
         
         void resetDuplicateFileNameCounter(const bool preserveSceneFileCounter);
@@ -101,6 +101,7 @@
 #include "GiftiLabel.h"
 #include "GiftiLabelTable.h"
 #include "GraphicsEngineDataOpenGL.h"
+#include "GraphicsOpenGLTriangleMeshBuffers.h"
 #include "GraphicsPrimitiveV3fC4ub.h"
 #include "GraphicsPrimitiveV3f.h"
 #include "GraphicsShape.h"
@@ -2581,16 +2582,34 @@ BrainOpenGLFixedPipeline::drawSurfaceNodes(Surface* surface,
 
 
 /**
- * Draw a surface triangles with vertex arrays.
+ * Draw a surface triangles with vertex arrays.  The coordinates, normal vectors,
+ * triangles, and coloring are kept in the surface's buffer objects so that they
+ * are only loaded after they change.  Client side vertex arrays are used if
+ * buffer objects are not available.
  * @param surface
  *    Surface that is drawn.
  * @param nodeColoringRGBA
- *    RGBA coloring for the nodes.
+ *    RGBA coloring for the nodes, must be coloring that belongs to the surface
+ *    (or NULL to use the background color).
  */
 void 
 BrainOpenGLFixedPipeline::drawSurfaceTrianglesWithVertexArrays(const Surface* surface,
                                                                const float* nodeColoringRGBA)
 {
+    if (nodeColoringRGBA == NULL) {
+        glColor3fv(m_backgroundColorFloat);
+    }
+    
+    GraphicsOpenGLTriangleMeshBuffers* meshBuffers = surface->getGraphicsTriangleMeshBuffers();
+    if (meshBuffers->draw(surface->getCoordinate(0),
+                          surface->getNormalVector(0),
+                          surface->getNumberOfNodes(),
+                          surface->getTriangle(0),
+                          surface->getNumberOfTriangles(),
+                          nodeColoringRGBA)) {
+        return;
+    }
+    
     glEnableClientState(GL_VERTEX_ARRAY);
     if (nodeColoringRGBA != NULL) {
         glEnableClientState(GL_COLOR_ARRAY);
@@ -2606,9 +2625,6 @@ BrainOpenGLFixedPipeline::drawSurfaceTrianglesWithVertexArrays(const Surface* su
                        0,
                        reinterpret_cast<const GLvoid*>(nodeColoringRGBA));
     }
-    else {
-        glColor3fv(m_backgroundColorFloat);
-    }
     glNormalPointer(GL_FLOAT,
                     0, 
                     reinterpret_cast<const GLvoid*>(surface->getNormalVector(0)));
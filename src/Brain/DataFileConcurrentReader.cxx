@@ -0,0 +1,373 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2019 Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#define __DATA_FILE_CONCURRENT_READER_DECLARE__
+#include "DataFileConcurrentReader.h"
+#undef __DATA_FILE_CONCURRENT_READER_DECLARE__
+
+#include <QThread>
+#include <QtConcurrent/QtConcurrent>
+
+#include "BorderFile.h"
+#include "CaretAssert.h"
+#include "CaretDataFileHelper.h"
+#include "CaretLogger.h"
+#include "CiftiBrainordinateDataSeriesFile.h"
+#include "CiftiBrainordinateLabelFile.h"
+#include "CiftiBrainordinateScalarFile.h"
+#include "CiftiConnectivityMatrixDenseFile.h"
+#include "CiftiConnectivityMatrixDenseParcelFile.h"
+#include "CiftiConnectivityMatrixParcelDenseFile.h"
+#include "CiftiConnectivityMatrixParcelFile.h"
+#include "CiftiParcelLabelFile.h"
+#include "CiftiParcelScalarFile.h"
+#include "CiftiParcelSeriesFile.h"
+#include "CiftiScalarDataSeriesFile.h"
+#include "DataFile.h"
+#include "FileInformation.h"
+#include "FociFile.h"
+#include "LabelFile.h"
+#include "MetricFile.h"
+#include "RgbaFile.h"
+#include "Surface.h"
+#include "VolumeFile.h"
+
+using namespace caret;
+
+
+
+/**
+ * \class caret::DataFileConcurrentReader
+ * \brief Reads data files on a pool of worker threads
+ * \ingroup Brain
+ *
+ * Files are created on the calling thread, and only the parsing and
+ * decoding done by readFile() runs on the workers.  The caller takes
+ * each file back, in whatever order it needs, and performs everything
+ * that involves the Brain (adding the file, palettes, events) itself.
+ */
+
+/**
+ * Constructor.
+ */
+DataFileConcurrentReader::DataFileConcurrentReader()
+: CaretObject()
+{
+    m_threadPool.setMaxThreadCount(std::max(1, QThread::idealThreadCount()));
+    m_cancelledFlag.storeRelease(0);
+
+    /*
+     * Normally already done when the session manager was created
+     */
+    CaretDataFileHelper::initializeEnumeratedTypes();
+}
+
+/**
+ * Destructor.  Waits for any reads still in progress and deletes
+ * any files that were not taken.
+ */
+DataFileConcurrentReader::~DataFileConcurrentReader()
+{
+    /*
+     * Reads that have not started yet will return immediately
+     */
+    m_cancelledFlag.storeRelease(1);
+    m_threadPool.waitForDone();
+
+    for (auto& iter : m_items) {
+        delete iter.second->m_caretDataFile;
+    }
+    m_items.clear();
+}
+
+/**
+ * Is concurrent reading supported for the given file?  Only local files
+ * whose reading does not depend upon the state of the Brain and does not
+ * send events are supported.
+ *
+ * @param dataFileType
+ *     Type of the data file.
+ * @param absoluteFileName
+ *     Absolute path of the file.
+ * @return
+ *     True if the file may be read concurrently.
+ */
+bool
+DataFileConcurrentReader::isConcurrentReadingSupported(const DataFileTypeEnum::Enum dataFileType,
+                                                       const AString& absoluteFileName)
+{
+    bool supportedFlag = false;
+    switch (dataFileType) {
+        case DataFileTypeEnum::BORDER:
+        case DataFileTypeEnum::CONNECTIVITY_DENSE:
+        case DataFileTypeEnum::CONNECTIVITY_DENSE_LABEL:
+        case DataFileTypeEnum::CONNECTIVITY_DENSE_PARCEL:
+        case DataFileTypeEnum::CONNECTIVITY_DENSE_SCALAR:
+        case DataFileTypeEnum::CONNECTIVITY_DENSE_TIME_SERIES:
+        case DataFileTypeEnum::CONNECTIVITY_PARCEL:
+        case DataFileTypeEnum::CONNECTIVITY_PARCEL_DENSE:
+        case DataFileTypeEnum::CONNECTIVITY_PARCEL_LABEL:
+        case DataFileTypeEnum::CONNECTIVITY_PARCEL_SCALAR:
+        case DataFileTypeEnum::CONNECTIVITY_PARCEL_SERIES:
+        case DataFileTypeEnum::CONNECTIVITY_SCALAR_DATA_SERIES:
+        case DataFileTypeEnum::FOCI:
+        case DataFileTypeEnum::LABEL:
+        case DataFileTypeEnum::METRIC:
+        case DataFileTypeEnum::RGBA:
+        case DataFileTypeEnum::SURFACE:
+        case DataFileTypeEnum::VOLUME:
+            supportedFlag = true;
+            break;
+        default:
+            /*
+             * Annotation, fiber, image, palette, and scene files
+             * interact with other objects while reading.
+             */
+            break;
+    }
+
+    if ( ! supportedFlag) {
+        return false;
+    }
+
+    /*
+     * Network reading uses the HTTP manager, which must stay on the main thread
+     */
+    if (DataFile::isFileOnNetwork(absoluteFileName)) {
+        return false;
+    }
+
+    /*
+     * Missing files go through normal reading so that the error is the same
+     */
+    FileInformation fileInfo(absoluteFileName);
+    return fileInfo.exists();
+}
+
+/**
+ * Start reading a file on a worker thread.  Nothing is done if the
+ * file is not supported or it is already being read.
+ *
+ * @param dataFileType
+ *     Type of the data file.
+ * @param absoluteFileName
+ *     Absolute path of the file.
+ */
+void
+DataFileConcurrentReader::startReading(const DataFileTypeEnum::Enum dataFileType,
+                                       const AString& absoluteFileName)
+{
+    if ( ! isConcurrentReadingSupported(dataFileType,
+                                        absoluteFileName)) {
+        return;
+    }
+
+    const auto key = std::make_pair(dataFileType,
+                                    absoluteFileName);
+    if (m_items.find(key) != m_items.end()) {
+        return;
+    }
+
+    std::unique_ptr<ReadItem> item(new ReadItem());
+    item->m_caretDataFile = createDataFile(dataFileType);
+    CaretAssert(item->m_caretDataFile);
+    item->m_fileName = absoluteFileName;
+    item->m_future = QtConcurrent::run(&m_threadPool,
+                                       &DataFileConcurrentReader::readItem,
+                                       item.get(),
+                                       &m_cancelledFlag);
+    m_items.insert(std::make_pair(key,
+                                  std::move(item)));
+    ++m_numberOfFilesStarted;
+}
+
+/**
+ * Take a file that was started with startReading(), waiting for it
+ * to finish reading if needed.  The caller owns the returned file.
+ *
+ * @param dataFileType
+ *     Type of the data file.
+ * @param absoluteFileName
+ *     Absolute path of the file.
+ * @return
+ *     The file that was read, or NULL if the file was never started
+ *     or has already been taken.
+ * @throws DataFileException
+ *     If reading the file failed.
+ */
+CaretDataFile*
+DataFileConcurrentReader::takeFile(const DataFileTypeEnum::Enum dataFileType,
+                                   const AString& absoluteFileName)
+{
+    const auto iter = m_items.find(std::make_pair(dataFileType,
+                                                  absoluteFileName));
+    if (iter == m_items.end()) {
+        return NULL;
+    }
+
+    std::unique_ptr<ReadItem> item(std::move(iter->second));
+    m_items.erase(iter);
+    item->m_future.waitForFinished();
+
+    if (item->m_readFailedFlag) {
+        delete item->m_caretDataFile;
+        throw item->m_exception;
+    }
+
+    return item->m_caretDataFile;
+}
+
+/**
+ * @return Number of files that were started reading concurrently.
+ */
+int32_t
+DataFileConcurrentReader::getNumberOfFilesStarted() const
+{
+    return m_numberOfFilesStarted;
+}
+
+/**
+ * Create a file of the same class that Brain creates when it reads
+ * a file of the given type.
+ *
+ * @param dataFileType
+ *     Type of the data file.
+ * @return
+ *     New, empty file.
+ */
+CaretDataFile*
+DataFileConcurrentReader::createDataFile(const DataFileTypeEnum::Enum dataFileType)
+{
+    CaretDataFile* caretDataFile = NULL;
+    switch (dataFileType) {
+        case DataFileTypeEnum::BORDER:
+            caretDataFile = new BorderFile();
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_DENSE:
+            caretDataFile = new CiftiConnectivityMatrixDenseFile();
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_DENSE_LABEL:
+            caretDataFile = new CiftiBrainordinateLabelFile();
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_DENSE_PARCEL:
+            caretDataFile = new CiftiConnectivityMatrixDenseParcelFile();
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_DENSE_SCALAR:
+            caretDataFile = new CiftiBrainordinateScalarFile();
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_DENSE_TIME_SERIES:
+            caretDataFile = new CiftiBrainordinateDataSeriesFile();
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_PARCEL:
+            caretDataFile = new CiftiConnectivityMatrixParcelFile();
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_PARCEL_DENSE:
+            caretDataFile = new CiftiConnectivityMatrixParcelDenseFile();
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_PARCEL_LABEL:
+            caretDataFile = new CiftiParcelLabelFile();
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_PARCEL_SCALAR:
+            caretDataFile = new CiftiParcelScalarFile();
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_PARCEL_SERIES:
+            caretDataFile = new CiftiParcelSeriesFile();
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_SCALAR_DATA_SERIES:
+            caretDataFile = new CiftiScalarDataSeriesFile();
+            break;
+        case DataFileTypeEnum::FOCI:
+            caretDataFile = new FociFile();
+            break;
+        case DataFileTypeEnum::LABEL:
+            caretDataFile = new LabelFile();
+            break;
+        case DataFileTypeEnum::METRIC:
+            caretDataFile = new MetricFile();
+            break;
+        case DataFileTypeEnum::RGBA:
+            caretDataFile = new RgbaFile();
+            break;
+        case DataFileTypeEnum::SURFACE:
+            caretDataFile = new Surface();
+            break;
+        case DataFileTypeEnum::VOLUME:
+            caretDataFile = new VolumeFile();
+            break;
+        default:
+            CaretAssertMessage(0, ("Concurrent reading not supported for "
+                                   + DataFileTypeEnum::toName(dataFileType)));
+            break;
+    }
+
+    return caretDataFile;
+}
+
+/**
+ * Read a file, runs on a worker thread.
+ *
+ * @param item
+ *     The file and name, receives the exception if reading fails.
+ * @param cancelledFlag
+ *     If set, the file is not read.
+ */
+void
+DataFileConcurrentReader::readItem(ReadItem* item,
+                                   const QAtomicInt* cancelledFlag)
+{
+    CaretAssert(item);
+    if (cancelledFlag->loadAcquire() != 0) {
+        item->m_exception = DataFileException(item->m_fileName,
+                                              "Reading was cancelled.");
+        item->m_readFailedFlag = true;
+        return;
+    }
+
+    try {
+        item->m_caretDataFile->readFile(item->m_fileName);
+    }
+    catch (const DataFileException& e) {
+        item->m_exception = e;
+        item->m_readFailedFlag = true;
+    }
+    catch (const CaretException& e) {
+        item->m_exception = DataFileException(e);
+        item->m_readFailedFlag = true;
+    }
+    catch (const std::bad_alloc&) {
+        item->m_exception = DataFileException(item->m_fileName,
+                                              CaretDataFileHelper::createBadAllocExceptionMessage(item->m_fileName));
+        item->m_readFailedFlag = true;
+    }
+    catch (const std::exception& e) {
+        /*
+         * An exception must not escape the worker thread
+         */
+        item->m_exception = DataFileException(item->m_fileName,
+                                              AString("Reading failed: ") + e.what());
+        item->m_readFailedFlag = true;
+    }
+    catch (...) {
+        item->m_exception = DataFileException(item->m_fileName,
+                                              "Reading failed with an unknown exception.");
+        item->m_readFailedFlag = true;
+    }
+}
+
@@ -0,0 +1,104 @@
+#ifndef __DATA_FILE_CONCURRENT_READER_H__
+#define __DATA_FILE_CONCURRENT_READER_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2019 Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <QAtomicInt>
+#include <QFuture>
+#include <QThreadPool>
+
+#include "CaretObject.h"
+#include "DataFileException.h"
+#include "DataFileTypeEnum.h"
+
+namespace caret {
+
+    class CaretDataFile;
+
+    class DataFileConcurrentReader : public CaretObject {
+
+    public:
+        DataFileConcurrentReader();
+
+        virtual ~DataFileConcurrentReader();
+
+        DataFileConcurrentReader(const DataFileConcurrentReader&) = delete;
+
+        DataFileConcurrentReader& operator=(const DataFileConcurrentReader&) = delete;
+
+        static bool isConcurrentReadingSupported(const DataFileTypeEnum::Enum dataFileType,
+                                                 const AString& absoluteFileName);
+
+        void startReading(const DataFileTypeEnum::Enum dataFileType,
+                          const AString& absoluteFileName);
+
+        CaretDataFile* takeFile(const DataFileTypeEnum::Enum dataFileType,
+                                const AString& absoluteFileName);
+
+        int32_t getNumberOfFilesStarted() const;
+
+        // ADD_NEW_METHODS_HERE
+
+    private:
+        /**
+         * A file being read on a worker thread.  The worker only
+         * touches the file and the exception, the main thread
+         * only touches them after the future has finished.
+         */
+        struct ReadItem {
+            CaretDataFile* m_caretDataFile = NULL;
+
+            AString m_fileName;
+
+            DataFileException m_exception;
+
+            bool m_readFailedFlag = false;
+
+            QFuture<void> m_future;
+        };
+
+        static CaretDataFile* createDataFile(const DataFileTypeEnum::Enum dataFileType);
+
+        static void readItem(ReadItem* item,
+                             const QAtomicInt* cancelledFlag);
+
+        QThreadPool m_threadPool;
+
+        QAtomicInt m_cancelledFlag;
+
+        std::map<std::pair<DataFileTypeEnum::Enum, AString>, std::unique_ptr<ReadItem>> m_items;
+
+        int32_t m_numberOfFilesStarted = 0;
+
+        // ADD_NEW_MEMBERS_HERE
+
+    };
+
+#ifdef __DATA_FILE_CONCURRENT_READER_DECLARE__
+#endif // __DATA_FILE_CONCURRENT_READER_DECLARE__
+
+} // namespace
+#endif  //__DATA_FILE_CONCURRENT_READER_H__
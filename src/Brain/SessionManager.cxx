@@ -31,11 +31,13 @@
 #include "BrowserTabContent.h"
 #include "BrowserWindowContent.h"
 #include "CaretAssert.h"
+#include "CaretDataFileHelper.h"
 #include "CaretLogger.h"
 #include "CaretPreferenceDataValue.h"
 #include "CaretPreferences.h"
 #include "CiftiConnectivityMatrixDataFileManager.h"
 #include "CiftiFiberTrajectoryManager.h"
+#include "ConnectivityMatrixRowCache.h"
 #include "DataToolTipsManager.h"
 #include "ElapsedTimer.h"
 #include "EventManager.h"
@@ -83,6 +85,7 @@ SessionManager::SessionManager()
     m_ciftiConnectivityMatrixDataFileManager = new CiftiConnectivityMatrixDataFileManager();
     m_ciftiFiberTrajectoryManager = new CiftiFiberTrajectoryManager();
     m_dataToolTipsManager.reset(new DataToolTipsManager(m_caretPreferences->isShowDataToolTipsEnabled()));
+    ConnectivityMatrixRowCache::getCache()->setByteBudget(static_cast<int64_t>(m_caretPreferences->getConnectivityRowCacheMegabytes()) * 1024 * 1024);
     
     for (int32_t i = 0; i < BrainConstants::MAXIMUM_NUMBER_OF_BROWSER_TABS; i++) {
         m_browserTabs[i] = NULL;
@@ -170,6 +173,11 @@ SessionManager::createSessionManager(const ApplicationTypeEnum::Enum application
      */
     ApplicationInformation::setApplicationType(applicationType);
     
+    /*
+     * Initialize enumerated types before any other threads may use them.
+     */
+    CaretDataFileHelper::initializeEnumeratedTypes();
+    
     /*
      * Create log manager.
      */
@@ -199,6 +207,12 @@ SessionManager::deleteSessionManager()
     delete s_singletonSessionManager;
     s_singletonSessionManager = NULL;
     
+    /*
+     * All connectivity files were deleted with the session
+     * manager, so the row cache can stop its thread.
+     */
+    ConnectivityMatrixRowCache::deleteCache();
+    
     /*
      * Session manager must be deleted before the event
      * manager is deleted.
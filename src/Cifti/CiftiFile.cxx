@@ -21,37 +21,99 @@
 #include "CiftiFile.h"
 
 #include "ByteOrderEnum.h"
+#include "ByteSwapping.h"
 #include "CaretAssert.h"
+#include "CaretBinaryFile.h"
 #include "CaretHttpManager.h"
 #include "CaretLogger.h"
+#include "CaretMutex.h"
 #include "DataFileException.h"
 #include "FileInformation.h"
 #include "MultiDimArray.h"
 #include "MultiDimIterator.h"
 #include "NiftiIO.h"
 
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <list>
+#include <map>
+#include <memory>
+#include <utility>
+
 using namespace std;
 using namespace caret;
 
 //private implementation classes
 namespace
 {
+    struct ColumnTile
+    {//a block of neighboring columns, column-major
+        int64_t m_start, m_numColumns;
+        std::vector<float> m_data;//for sparse tiles, only the nonzero values
+        std::vector<int64_t> m_columnStart;//sparse tiles only, values of column m_start + i are m_data[m_columnStart[i]] to m_data[m_columnStart[i + 1] - 1]
+        std::vector<int32_t> m_rows;//sparse tiles only, the row of each value
+        int64_t getBytes() const
+        {
+            return (int64_t)(m_data.capacity() * sizeof(float) + m_columnStart.capacity() * sizeof(int64_t) + m_rows.capacity() * sizeof(int32_t));
+        }
+    };
+    
+    class ColumnTileCache
+    {//the column tiles of all open files share one byte budget, and the least recently used tiles are dropped first
+        typedef std::pair<int64_t, int64_t> TileKey;//owner, first column of the tile
+        struct Entry
+        {
+            std::shared_ptr<const ColumnTile> m_tile;//readers keep their own reference, so a tile can be dropped while they copy out of it
+            std::list<TileKey>::iterator m_lruPosition;
+        };
+        CaretMutex m_mutex;//only held to look up, add or drop tiles, never while reading a tile or copying out of it
+        std::map<TileKey, Entry> m_tiles;
+        std::list<TileKey> m_lruList;//most recently used first
+        int64_t m_bytesUsed, m_nextOwner;
+        void removeLocked(const std::map<TileKey, Entry>::iterator& iter);
+    public:
+        static const int64_t BYTE_BUDGET;
+        ColumnTileCache() { m_bytesUsed = 0; m_nextOwner = 0; }
+        int64_t newOwner();
+        std::shared_ptr<const ColumnTile> find(const int64_t& owner, const int64_t& column);
+        void add(const int64_t& owner, const std::shared_ptr<const ColumnTile>& tile);
+        void removeOwner(const int64_t& owner);
+    };
+    
+    ColumnTileCache& getColumnTileCache()
+    {//function static, so it exists before any file uses it
+        static ColumnTileCache ret;
+        return ret;
+    }
+    
     class CiftiOnDiskImpl : public CiftiFile::WriteImplInterface
     {
-        mutable NiftiIO m_nifti;//because file objects aren't stateless (current position), so reading "changes" them
+        mutable NiftiIO m_nifti;//reads are positional and safe to do from multiple threads, but NiftiIO's read functions aren't const
         CiftiXML m_xml;//because we need to parse it to set up the dimensions anyway
+        int64_t m_tileOwner;//key of this file's tiles in the column tile cache
+        mutable CaretMutex m_tileReadMutex;//one thread reads a missing tile while others needing it wait, writes take it so a tile being read can't go stale
+        static const int64_t COLUMN_TILE_BYTES;
+        void invalidateTile();
     public:
         CiftiOnDiskImpl(const QString& filename);//read-only
         CiftiOnDiskImpl(const QString& filename, const CiftiXML& xml, const CiftiVersion& version, const bool& swapEndian,
                         const int16_t& datatype, const bool& rescale, const double& minval, const double& maxval);//make new empty file with read/write
         void getRow(float* dataOut, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead) const;
         void getColumn(float* dataOut, const int64_t& index) const;
+        void getColumnBlock(float* dataOut, const int64_t& firstIndex, const int64_t& numColumns, const int64_t& columnLength) const;
+        void getRowBlock(float* dataOut, const int64_t& firstRow, const int64_t& numRows, const int64_t& rowLength) const;
+        const float* getRowPointer(const std::vector<int64_t>& indexSelect) const;
+        bool canReadConcurrently() const { return true; }
         const CiftiXML& getCiftiXML() const { return m_xml; }
         QString getFilename() const { return m_nifti.getFilename(); }
         bool isSwapped() const { return m_nifti.getHeader().isSwapped(); }
         void setRow(const float* dataIn, const std::vector<int64_t>& indexSelect);
         void setColumn(const float* dataIn, const int64_t& index);
+        void setRowBlock(const float* dataIn, const int64_t& firstRow, const int64_t& numRows, const int64_t& rowLength);
         void close();
+        ~CiftiOnDiskImpl();
     };
     
     class CiftiMemoryImpl : public CiftiFile::WriteImplInterface
@@ -61,9 +123,14 @@ namespace
         CiftiMemoryImpl(const CiftiXML& xml);
         void getRow(float* dataOut, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead) const;
         void getColumn(float* dataOut, const int64_t& index) const;
+        void getColumnBlock(float* dataOut, const int64_t& firstIndex, const int64_t& numColumns, const int64_t& columnLength) const;
+        void getRowBlock(float* dataOut, const int64_t& firstRow, const int64_t& numRows, const int64_t& rowLength) const;
         bool isInMemory() const { return true; }
+        bool canReadConcurrently() const { return true; }
+        const float* getRowPointer(const std::vector<int64_t>& indexSelect) const;
         void setRow(const float* dataIn, const std::vector<int64_t>& indexSelect);
         void setColumn(const float* dataIn, const int64_t& index);
+        void setRowBlock(const float* dataIn, const int64_t& firstRow, const int64_t& numRows, const int64_t& rowLength);
     };
     
     class CiftiXnatImpl : public CiftiFile::ReadImplInterface
@@ -81,6 +148,79 @@ namespace
         const CiftiXML& getCiftiXML() const { return m_xml; }
     };
     
+    //sparse format: magic, int64 dims (row length, number of rows), int64 value type, int64 reserved,
+    //int64 file offset of each row plus one for the end of the last row, then the rows, then the XML to the end of the file
+    //each nonempty row is [float scale if quantized], int32 column indices (increasing), then float32 or int16 values, all little endian
+    const char SPARSE_MAGIC[] = "\0\0\0\0csf\0";//8 bytes, differs from wbsparse so they can't be confused
+    const int64_t SPARSE_HEADER_SIZE = 8 + 4 * sizeof(int64_t);
+    const int16_t SPARSE_QUANT_NAN = -32768;//unused by the quantization, which is symmetric
+    enum SparseValueType
+    {
+        SPARSE_FLOAT32 = 0,
+        SPARSE_INT16 = 1
+    };
+    
+    class CiftiSparseImpl : public CiftiFile::ReadImplInterface
+    {
+        mutable CaretBinaryFile m_file;//readAt is positional, so rows can be read from multiple threads
+        CiftiXML m_xml;
+        QString m_fileName;
+        int64_t m_rowLength, m_numRows;
+        SparseValueType m_valueType;
+        std::vector<int64_t> m_rowOffsets;
+        int64_t m_tileOwner;//key of this file's tiles in the column tile cache
+        mutable CaretMutex m_tileReadMutex;//one thread reads a missing tile while others needing it wait, also protects the column counts
+        mutable std::vector<int64_t> m_columnCounts, m_tileBounds;//counted on the first getColumn, tile i is columns m_tileBounds[i] to m_tileBounds[i + 1] - 1
+        static const int64_t COLUMN_TILE_BYTES;
+        int64_t readRow(const int64_t& row, std::vector<char>& buffer, const int32_t*& indicesOut) const;//returns number of entries, values follow indices in buffer
+        float decodeValue(const char* values, const int64_t& which, const float& scale) const;
+        void countColumns() const;
+        std::shared_ptr<const ColumnTile> readColumnTile(const int64_t& index) const;
+    public:
+        static bool isSparseFile(const QString& filename);
+        CiftiSparseImpl(const QString& filename);
+        ~CiftiSparseImpl();
+        void getRow(float* dataOut, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead) const;
+        void getColumn(float* dataOut, const int64_t& index) const;
+        void getColumnBlock(float* dataOut, const int64_t& firstIndex, const int64_t& numColumns, const int64_t& columnLength) const;
+        bool canReadConcurrently() const { return true; }
+        const CiftiXML& getCiftiXML() const { return m_xml; }
+        QString getFilename() const { return m_fileName; }
+    };
+    
+    class CiftiSparseWriteImpl : public CiftiFile::WriteImplInterface
+    {
+        CaretBinaryFile m_file;
+        CiftiXML m_xml;
+        QString m_fileName;
+        int64_t m_rowLength, m_numRows, m_nextRow, m_curPos, m_topK;
+        float m_threshold;
+        bool m_quantize, m_finished;
+        std::vector<int64_t> m_rowOffsets;
+        std::vector<int32_t> m_keepIndices;
+        std::vector<char> m_scratch;
+    public:
+        CiftiSparseWriteImpl(const QString& filename, const CiftiXML& xml, const float& threshold, const int64_t& topK, const bool& quantize);
+        ~CiftiSparseWriteImpl();
+        void getRow(float* dataOut, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead) const;
+        void getColumn(float* dataOut, const int64_t& index) const;
+        QString getFilename() const { return m_fileName; }
+        void setRow(const float* dataIn, const std::vector<int64_t>& indexSelect);
+        void setColumn(const float* dataIn, const int64_t& index);
+        void close();
+    };
+    
+    QString getOnDiskFilename(const CiftiFile::ReadImplInterface* impl)
+    {//empty if the data isn't backed by a local file that a write could clobber
+        const CiftiOnDiskImpl* niftiImpl = dynamic_cast<const CiftiOnDiskImpl*>(impl);
+        if (niftiImpl != NULL) return niftiImpl->getFilename();
+        const CiftiSparseImpl* sparseImpl = dynamic_cast<const CiftiSparseImpl*>(impl);
+        if (sparseImpl != NULL) return sparseImpl->getFilename();
+        const CiftiSparseWriteImpl* sparseWriter = dynamic_cast<const CiftiSparseWriteImpl*>(impl);
+        if (sparseWriter != NULL) return sparseWriter->getFilename();
+        return "";
+    }
+    
     bool shouldSwap(const CiftiFile::ENDIAN& endian)
     {
         if (ByteSwapping::isBigEndian())
@@ -103,10 +243,38 @@ CiftiFile::ReadImplInterface::~ReadImplInterface()
 {
 }
 
+void CiftiFile::ReadImplInterface::getColumnBlock(float* dataOut, const int64_t& firstIndex, const int64_t& numColumns, const int64_t& columnLength) const
+{
+    for (int64_t i = 0; i < numColumns; ++i)
+    {
+        getColumn(dataOut + i * columnLength, firstIndex + i);
+    }
+}
+
+void CiftiFile::ReadImplInterface::getRowBlock(float* dataOut, const int64_t& firstRow, const int64_t& numRows, const int64_t& rowLength) const
+{
+    vector<int64_t> indexSelect(1);
+    for (int64_t i = 0; i < numRows; ++i)
+    {
+        indexSelect[0] = firstRow + i;
+        getRow(dataOut + i * rowLength, indexSelect, false);
+    }
+}
+
 CiftiFile::WriteImplInterface::~WriteImplInterface()
 {
 }
 
+void CiftiFile::WriteImplInterface::setRowBlock(const float* dataIn, const int64_t& firstRow, const int64_t& numRows, const int64_t& rowLength)
+{
+    vector<int64_t> indexSelect(1);
+    for (int64_t i = 0; i < numRows; ++i)
+    {
+        indexSelect[0] = firstRow + i;
+        setRow(dataIn + i * rowLength, indexSelect);
+    }
+}
+
 CiftiFile::CiftiFile(const QString& fileName)
 {
     m_endianPref = NATIVE;
@@ -117,9 +285,17 @@ CiftiFile::CiftiFile(const QString& fileName)
 void CiftiFile::openFile(const QString& fileName)
 {
     close();//to make sure it closes everything first, even if the open throws
-    CaretPointer<CiftiOnDiskImpl> newRead(new CiftiOnDiskImpl(FileInformation(fileName).getAbsoluteFilePath()));//this constructor opens existing file read-only
-    m_readingImpl = newRead;//it should be noted that if the constructor throws (if the file isn't readable), new guarantees the memory allocated for the object will be freed
-    m_xml = newRead->getCiftiXML();
+    QString absPath = FileInformation(fileName).getAbsoluteFilePath();
+    if (CiftiSparseImpl::isSparseFile(absPath))
+    {
+        CaretPointer<CiftiSparseImpl> newRead(new CiftiSparseImpl(absPath));
+        m_readingImpl = newRead;
+        m_xml = newRead->getCiftiXML();
+    } else {
+        CaretPointer<CiftiOnDiskImpl> newRead(new CiftiOnDiskImpl(absPath));//this constructor opens existing file read-only
+        m_readingImpl = newRead;//it should be noted that if the constructor throws (if the file isn't readable), new guarantees the memory allocated for the object will be freed
+        m_xml = newRead->getCiftiXML();
+    }
     m_dims = m_xml.getDimensions();
     m_onDiskVersion = m_xml.getParsedVersion();
     m_fileName = fileName;
@@ -160,6 +336,7 @@ void CiftiFile::setWritingDataTypeNoScaling(const int16_t& type)
     m_doWriteScaling = false;
     m_minScalingVal = -1.0;
     m_maxScalingVal = 1.0;
+    m_writeSparse = false;
     m_writingImpl.grabNew(NULL);//prevent writing to previous writing implementation, let the next set...() set up for writing
 }
 
@@ -169,6 +346,18 @@ void CiftiFile::setWritingDataTypeAndScaling(const int16_t& type, const double&
     m_doWriteScaling = true;
     m_minScalingVal = minval;
     m_maxScalingVal = maxval;
+    m_writeSparse = false;
+    m_writingImpl.grabNew(NULL);//prevent writing to previous writing implementation, let the next set...() set up for writing
+}
+
+void CiftiFile::setWritingSparse(const float& threshold, const int64_t& topK, const bool& quantize)
+{
+    if (threshold < 0.0f) throw DataFileException("sparse cifti threshold must not be negative");
+    if (topK == 0 || topK < -1) throw DataFileException("sparse cifti top-k must be positive, or -1 to keep all values");
+    m_writeSparse = true;
+    m_sparseThreshold = threshold;
+    m_sparseTopK = topK;
+    m_sparseQuantize = quantize;
     m_writingImpl.grabNew(NULL);//prevent writing to previous writing implementation, let the next set...() set up for writing
 }
 
@@ -179,16 +368,35 @@ void CiftiFile::writeFile(const QString& fileName, const CiftiVersion& writingVe
     FileInformation myInfo(fileName);
     QString canonicalFilename = myInfo.getCanonicalFilePath();//NOTE: returns EMPTY STRING for nonexistant file
     const CiftiOnDiskImpl* testImpl = dynamic_cast<CiftiOnDiskImpl*>(m_readingImpl.getPointer());
+    QString currentFilename = getOnDiskFilename(m_readingImpl);
     bool collision = false, hadWriter = (m_writingImpl != NULL);
-    if (testImpl != NULL && canonicalFilename != "" && FileInformation(testImpl->getFilename()).getCanonicalFilePath() == canonicalFilename)
+    if (currentFilename != "" && canonicalFilename != "" && FileInformation(currentFilename).getCanonicalFilePath() == canonicalFilename)
     {//empty string test is so that we don't say collision if both are nonexistant - could happen if file is removed/unlinked while reading on some filesystems
-        if (m_onDiskVersion == writingVersion && !m_xml.mutablesModified() && (dontRewrite(endian) || writeSwapped == testImpl->isSwapped())) return;//don't need to copy to itself
+        if (m_writeSparse)
+        {
+            if (dynamic_cast<CiftiSparseWriteImpl*>(m_readingImpl.getPointer()) != NULL) return;//rows were already written to it, close() finishes the file
+        } else {
+            if (testImpl != NULL && m_onDiskVersion == writingVersion && !m_xml.mutablesModified() && (dontRewrite(endian) || writeSwapped == testImpl->isSwapped())) return;//don't need to copy to itself
+        }
         collision = true;//we need to copy to memory temporarily
         CaretPointer<WriteImplInterface> tempMemory(new CiftiMemoryImpl(m_xml));
         copyImplData(m_readingImpl, tempMemory, m_dims);
         m_readingImpl = tempMemory;//we are about to make the old reading impl very unhappy, replace it so that if we get an error while writing, we hang onto the memory version
         m_writingImpl.grabNew(NULL);//and make it re-magic the writing implementation again if data is set
     }
+    if (m_writeSparse)
+    {
+        if (m_dims.size() != 2) throw DataFileException("sparse cifti writing is only supported for 2D cifti");
+        CaretPointer<WriteImplInterface> tempWrite(new CiftiSparseWriteImpl(myInfo.getAbsoluteFilePath(), m_xml, m_sparseThreshold, m_sparseTopK, m_sparseQuantize));
+        copyImplData(m_readingImpl, tempWrite, m_dims);
+        tempWrite->close();
+        if (collision)//the sparse writer can't be read from, so read the finished file instead of keeping the memory copy
+        {
+            m_readingImpl.grabNew(new CiftiSparseImpl(myInfo.getAbsoluteFilePath()));
+        }
+        m_xml.clearMutablesModified();
+        return;
+    }
     CaretPointer<WriteImplInterface> tempWrite(new CiftiOnDiskImpl(myInfo.getAbsoluteFilePath(), m_xml, writingVersion, writeSwapped,
                                                                    m_writingDataType, m_doWriteScaling, m_minScalingVal, m_maxScalingVal));
     copyImplData(m_readingImpl, tempWrite, m_dims);
@@ -242,6 +450,12 @@ bool CiftiFile::isInMemory() const
     }
 }
 
+bool CiftiFile::canReadConcurrently() const
+{
+    if (m_readingImpl == NULL) return true;//nothing to read yet, and setting it up will be in memory or on local disk
+    return m_readingImpl->canReadConcurrently();
+}
+
 void CiftiFile::getRow(float* dataOut, const vector<int64_t>& indexSelect, const bool& tolerateShortRead) const
 {
     if (m_dims.empty()) throw DataFileException("getRow called on uninitialized CiftiFile");
@@ -257,6 +471,31 @@ void CiftiFile::getColumn(float* dataOut, const int64_t& index) const
     m_readingImpl->getColumn(dataOut, index);
 }
 
+void CiftiFile::getColumnBlock(float* dataOut, const int64_t& firstIndex, const int64_t& numColumns) const
+{
+    if (m_dims.empty()) throw DataFileException("getColumnBlock called on uninitialized CiftiFile");
+    if (m_dims.size() != 2) throw DataFileException("getColumnBlock called on non-2D CiftiFile");
+    if (firstIndex < 0 || numColumns < 0 || firstIndex + numColumns > m_dims[0]) throw DataFileException("getColumnBlock called with invalid column range");
+    if (m_readingImpl == NULL) return;//NOT an error because we are pretending to have a matrix already, while we are waiting for setRow to actually start writing the file
+    m_readingImpl->getColumnBlock(dataOut, firstIndex, numColumns, m_dims[1]);
+}
+
+void CiftiFile::getRowBlock(float* dataOut, const int64_t& firstRow, const int64_t& numRows) const
+{
+    if (m_dims.empty()) throw DataFileException("getRowBlock called on uninitialized CiftiFile");
+    if (m_dims.size() != 2) throw DataFileException("getRowBlock called on non-2D CiftiFile");
+    if (firstRow < 0 || numRows < 0 || firstRow + numRows > m_dims[1]) throw DataFileException("getRowBlock called with invalid row range");
+    if (m_readingImpl == NULL) return;//NOT an error because we are pretending to have a matrix already, while we are waiting for setRow to actually start writing the file
+    m_readingImpl->getRowBlock(dataOut, firstRow, numRows, m_dims[0]);
+}
+
+const float* CiftiFile::getRowPointer(const vector<int64_t>& indexSelect) const
+{
+    if (m_dims.empty()) throw DataFileException("getRowPointer called on uninitialized CiftiFile");
+    if (m_readingImpl == NULL) return NULL;
+    return m_readingImpl->getRowPointer(indexSelect);
+}
+
 void CiftiFile::setCiftiXML(const CiftiXML& xml, const bool useOldMetadata)
 {
     if (xml.getNumberOfDimensions() == 0) throw DataFileException("setCiftiXML called with 0-dimensional CiftiXML");
@@ -321,6 +560,14 @@ void CiftiFile::setColumn(const float* dataIn, const int64_t& index)
     m_writingImpl->setColumn(dataIn, index);
 }
 
+void CiftiFile::setRowBlock(const float* dataIn, const int64_t& firstRow, const int64_t& numRows)
+{
+    verifyWriteImpl();
+    if (m_dims.size() != 2) throw DataFileException("setRowBlock called on non-2D CiftiFile");
+    if (firstRow < 0 || numRows < 0 || firstRow + numRows > m_dims[1]) throw DataFileException("setRowBlock called with invalid row range");
+    m_writingImpl->setRowBlock(dataIn, firstRow, numRows, m_dims[0]);
+}
+
 //compatibility with old interface
 void CiftiFile::getRow(float* dataOut, const int64_t& index, const bool& tolerateShortRead) const
 {
@@ -375,18 +622,24 @@ void CiftiFile::verifyWriteImpl()
     } else {//NOTE: m_onDiskVersion gets set in setWritingFile
         if (m_readingImpl != NULL)
         {
-            CiftiOnDiskImpl* testImpl = dynamic_cast<CiftiOnDiskImpl*>(m_readingImpl.getPointer());
-            if (testImpl != NULL)
+            QString currentFilename = getOnDiskFilename(m_readingImpl);
+            if (currentFilename != "")
             {
-                QString canonicalCurrent = FileInformation(testImpl->getFilename()).getCanonicalFilePath();//returns "" if nonexistant, if unlinked while open
+                QString canonicalCurrent = FileInformation(currentFilename).getCanonicalFilePath();//returns "" if nonexistant, if unlinked while open
                 if (canonicalCurrent != "" && canonicalCurrent == FileInformation(m_writingFile).getCanonicalFilePath())//these were already absolute
                 {
                     convertToInMemory();//save existing data in memory before we clobber file
                 }
             }
         }
-        m_writingImpl.grabNew(new CiftiOnDiskImpl(m_writingFile, m_xml, m_onDiskVersion, shouldSwap(m_endianPref),
-                                                  m_writingDataType, m_doWriteScaling, m_minScalingVal, m_maxScalingVal));//this constructor makes new file for writing
+        if (m_writeSparse)
+        {
+            if (m_dims.size() != 2) throw DataFileException("sparse cifti writing is only supported for 2D cifti");
+            m_writingImpl.grabNew(new CiftiSparseWriteImpl(m_writingFile, m_xml, m_sparseThreshold, m_sparseTopK, m_sparseQuantize));
+        } else {
+            m_writingImpl.grabNew(new CiftiOnDiskImpl(m_writingFile, m_xml, m_onDiskVersion, shouldSwap(m_endianPref),
+                                                      m_writingDataType, m_doWriteScaling, m_minScalingVal, m_maxScalingVal));//this constructor makes new file for writing
+        }
         if (m_readingImpl != NULL)
         {
             copyImplData(m_readingImpl, m_writingImpl, m_dims);
@@ -401,8 +654,14 @@ void CiftiFile::copyImplData(const ReadImplInterface* from, WriteImplInterface*
     vector<float> scratchRow(dims[0]);
     for (MultiDimIterator<int64_t> iter(iterateDims); !iter.atEnd(); ++iter)
     {
-        from->getRow(scratchRow.data(), *iter, false);
-        to->setRow(scratchRow.data(), *iter);
+        const float* mapped = from->getRowPointer(*iter);
+        if (mapped != NULL)
+        {
+            to->setRow(mapped, *iter);
+        } else {
+            from->getRow(scratchRow.data(), *iter, false);
+            to->setRow(scratchRow.data(), *iter);
+        }
     }
 }
 
@@ -422,6 +681,11 @@ void CiftiMemoryImpl::getRow(float* dataOut, const vector<int64_t>& indexSelect,
     }
 }
 
+const float* CiftiMemoryImpl::getRowPointer(const vector<int64_t>& indexSelect) const
+{
+    return m_array.get(1, indexSelect);
+}
+
 void CiftiMemoryImpl::getColumn(float* dataOut, const int64_t& index) const
 {
     CaretAssert(m_array.getDimensions().size() == 2);//otherwise, CiftiFile shouldn't have called this
@@ -435,6 +699,34 @@ void CiftiMemoryImpl::getColumn(float* dataOut, const int64_t& index) const
     }
 }
 
+void CiftiMemoryImpl::getColumnBlock(float* dataOut, const int64_t& firstIndex, const int64_t& numColumns, const int64_t& columnLength) const
+{
+    CaretAssert(m_array.getDimensions().size() == 2);//otherwise, CiftiFile shouldn't have called this
+    const float* ref = m_array.get(2, vector<int64_t>());
+    int64_t rowSize = m_array.getDimensions()[0];
+    CaretAssert(columnLength == m_array.getDimensions()[1]);
+    CaretAssert(firstIndex >= 0 && firstIndex + numColumns <= rowSize);
+    for (int64_t i = 0; i < columnLength; ++i)//walk the rows in order, so the reads are sequential
+    {
+        const float* rowRef = ref + rowSize * i + firstIndex;
+        for (int64_t j = 0; j < numColumns; ++j)
+        {
+            dataOut[j * columnLength + i] = rowRef[j];
+        }
+    }
+}
+
+void CiftiMemoryImpl::getRowBlock(float* dataOut, const int64_t& firstRow, const int64_t& numRows, const int64_t& rowLength) const
+{
+    CaretAssert(m_array.getDimensions().size() == 2);//otherwise, CiftiFile shouldn't have called this
+    CaretAssert(rowLength == m_array.getDimensions()[0]);
+    const float* ref = m_array.get(2, vector<int64_t>()) + firstRow * rowLength;
+    for (int64_t i = 0; i < numRows * rowLength; ++i)
+    {
+        dataOut[i] = ref[i];
+    }
+}
+
 void CiftiMemoryImpl::setRow(const float* dataIn, const vector<int64_t>& indexSelect)
 {
     float* ref = m_array.get(1, indexSelect);
@@ -458,8 +750,20 @@ void CiftiMemoryImpl::setColumn(const float* dataIn, const int64_t& index)
     }
 }
 
+void CiftiMemoryImpl::setRowBlock(const float* dataIn, const int64_t& firstRow, const int64_t& numRows, const int64_t& rowLength)
+{
+    CaretAssert(m_array.getDimensions().size() == 2);//otherwise, CiftiFile shouldn't have called this
+    CaretAssert(rowLength == m_array.getDimensions()[0]);
+    float* ref = m_array.get(2, vector<int64_t>()) + firstRow * rowLength;
+    for (int64_t i = 0; i < numRows * rowLength; ++i)
+    {
+        ref[i] = dataIn[i];
+    }
+}
+
 CiftiOnDiskImpl::CiftiOnDiskImpl(const QString& filename)
 {//opens existing file for reading
+    m_tileOwner = getColumnTileCache().newOwner();
     m_nifti.openRead(filename);//read-only, so we don't need write permission to read a cifti file
     if (m_nifti.getNumComponents() != 1) throw DataFileException("complex or rgb datatype found in file '" + filename + "', these are not supported in cifti");
     const NiftiHeader& myHeader = m_nifti.getHeader();
@@ -613,6 +917,7 @@ namespace
 CiftiOnDiskImpl::CiftiOnDiskImpl(const QString& filename, const CiftiXML& xml, const CiftiVersion& version, const bool& swapEndian,
                                  const int16_t& datatype, const bool& rescale, const double& minval, const double& maxval)
 {//starts writing new file
+    m_tileOwner = getColumnTileCache().newOwner();
     warnForBadExtension(filename, xml);
     NiftiHeader outHeader;
     if (rescale)
@@ -669,31 +974,162 @@ void CiftiOnDiskImpl::getRow(float* dataOut, const vector<int64_t>& indexSelect,
     m_nifti.readData(dataOut, 5, indexSelect, tolerateShortRead);//5 means 4 reserved (space and time) plus the first cifti dimension
 }
 
+const float* CiftiOnDiskImpl::getRowPointer(const vector<int64_t>& indexSelect) const
+{
+    return m_nifti.getMappedFloatData(5, indexSelect);
+}
+
+const int64_t CiftiOnDiskImpl::COLUMN_TILE_BYTES = 1<<26;//64MiB, for a 91k x 91k dconn this is about 180 columns
+
+const int64_t ColumnTileCache::BYTE_BUDGET = 1<<27;//shared by all open files, so a few files can't each hold a tile
+
+int64_t ColumnTileCache::newOwner()
+{
+    CaretMutexLocker locked(&m_mutex);
+    return m_nextOwner++;
+}
+
+shared_ptr<const ColumnTile> ColumnTileCache::find(const int64_t& owner, const int64_t& column)
+{
+    CaretMutexLocker locked(&m_mutex);
+    map<TileKey, Entry>::iterator iter = m_tiles.upper_bound(TileKey(owner, column));
+    if (iter == m_tiles.begin()) return shared_ptr<const ColumnTile>();
+    --iter;//the tile with the last start at or before the column
+    const ColumnTile& tile = *(iter->second.m_tile);
+    if (iter->first.first != owner || column >= tile.m_start + tile.m_numColumns) return shared_ptr<const ColumnTile>();
+    m_lruList.splice(m_lruList.begin(), m_lruList, iter->second.m_lruPosition);
+    return iter->second.m_tile;
+}
+
+void ColumnTileCache::add(const int64_t& owner, const shared_ptr<const ColumnTile>& tile)
+{
+    int64_t tileBytes = tile->getBytes();
+    if (tileBytes > BYTE_BUDGET) return;//the caller still has it to copy from
+    CaretMutexLocker locked(&m_mutex);
+    TileKey key(owner, tile->m_start);
+    map<TileKey, Entry>::iterator iter = m_tiles.find(key);
+    if (iter != m_tiles.end()) removeLocked(iter);
+    while (m_bytesUsed + tileBytes > BYTE_BUDGET && !m_lruList.empty())
+    {
+        removeLocked(m_tiles.find(m_lruList.back()));
+    }
+    m_lruList.push_front(key);
+    Entry& newEntry = m_tiles[key];
+    newEntry.m_tile = tile;
+    newEntry.m_lruPosition = m_lruList.begin();
+    m_bytesUsed += tileBytes;
+}
+
+void ColumnTileCache::removeOwner(const int64_t& owner)
+{
+    CaretMutexLocker locked(&m_mutex);
+    map<TileKey, Entry>::iterator iter = m_tiles.lower_bound(TileKey(owner, 0));
+    while (iter != m_tiles.end() && iter->first.first == owner)
+    {
+        map<TileKey, Entry>::iterator toRemove = iter;
+        ++iter;
+        removeLocked(toRemove);
+    }
+}
+
+void ColumnTileCache::removeLocked(const map<TileKey, Entry>::iterator& iter)
+{
+    CaretAssert(iter != m_tiles.end());
+    m_bytesUsed -= iter->second.m_tile->getBytes();
+    m_lruList.erase(iter->second.m_lruPosition);
+    m_tiles.erase(iter);
+}
+
 void CiftiOnDiskImpl::getColumn(float* dataOut, const int64_t& index) const
 {
     CaretAssert(m_xml.getNumberOfDimensions() == 2);//otherwise this shouldn't be called
-    CaretAssert(index >= 0 && index < m_xml.getDimensionLength(CiftiXML::ALONG_ROW));
-    CaretLogFine("getColumn called on CiftiOnDiskImpl, this will be slow");//generate logging messages at a low priority
-    vector<int64_t> indexSelect(2);
-    indexSelect[0] = index;
+    int64_t rowLength = m_xml.getDimensionLength(CiftiXML::ALONG_ROW);
     int64_t colLength = m_xml.getDimensionLength(CiftiXML::ALONG_COLUMN);
-    for (int64_t i = 0; i < colLength; ++i)//assume if they really want getColumn on disk, they don't want their pagecache obliterated, so read it 1 element at a time
+    CaretAssert(index >= 0 && index < rowLength);
+    ColumnTileCache& tileCache = getColumnTileCache();
+    shared_ptr<const ColumnTile> tile = tileCache.find(m_tileOwner, index);
+    if (tile == NULL)
     {
-        indexSelect[1] = i;
-        m_nifti.readData(dataOut + i, 4, indexSelect);//4 means just the 4 reserved dimensions, so 1 element of the matrix
+        CaretMutexLocker locked(&m_tileReadMutex);
+        tile = tileCache.find(m_tileOwner, index);//another thread may have read it while we waited
+        if (tile == NULL)
+        {//reading a short run of each row touches the same pages as reading one element, so get a whole tile of neighboring columns while we are there
+            CaretLogFine("getColumn called on CiftiOnDiskImpl, reading a block of columns");
+            int64_t tileWidth = COLUMN_TILE_BYTES / (colLength * (int64_t)sizeof(float));
+            if (tileWidth < 1) tileWidth = 1;
+            if (tileWidth > rowLength) tileWidth = rowLength;
+            shared_ptr<ColumnTile> newTile(new ColumnTile());
+            newTile->m_start = (index / tileWidth) * tileWidth;
+            newTile->m_numColumns = min(tileWidth, rowLength - newTile->m_start);
+            newTile->m_data.resize(newTile->m_numColumns * colLength);
+            getColumnBlock(newTile->m_data.data(), newTile->m_start, newTile->m_numColumns, colLength);
+            tile = newTile;
+            tileCache.add(m_tileOwner, tile);
+        }
+    }
+    const float* tileColumn = tile->m_data.data() + (index - tile->m_start) * colLength;
+    for (int64_t i = 0; i < colLength; ++i)
+    {
+        dataOut[i] = tileColumn[i];
     }
 }
 
+void CiftiOnDiskImpl::getColumnBlock(float* dataOut, const int64_t& firstIndex, const int64_t& numColumns, const int64_t& columnLength) const
+{
+    CaretAssert(m_xml.getNumberOfDimensions() == 2);//otherwise this shouldn't be called
+    int64_t rowLength = m_xml.getDimensionLength(CiftiXML::ALONG_ROW);
+    CaretAssert(columnLength == m_xml.getDimensionLength(CiftiXML::ALONG_COLUMN));
+    CaretAssert(firstIndex >= 0 && firstIndex + numColumns <= rowLength);
+    if (numColumns < 1) return;
+    vector<float> rowRange(numColumns);
+    for (int64_t i = 0; i < columnLength; ++i)
+    {//one read per row covers the whole block, and the 4 reserved dimensions are singular, so row i starts at element i * rowLength
+        m_nifti.readDataRange(rowRange.data(), i * rowLength + firstIndex, numColumns);
+        for (int64_t j = 0; j < numColumns; ++j)
+        {
+            dataOut[j * columnLength + i] = rowRange[j];
+        }
+    }
+}
+
+void CiftiOnDiskImpl::getRowBlock(float* dataOut, const int64_t& firstRow, const int64_t& numRows, const int64_t& rowLength) const
+{
+    CaretAssert(m_xml.getNumberOfDimensions() == 2);//otherwise this shouldn't be called
+    CaretAssert(rowLength == m_xml.getDimensionLength(CiftiXML::ALONG_ROW));
+    m_nifti.readDataRange(dataOut, firstRow * rowLength, numRows * rowLength);//the 4 reserved dimensions are singular, so the rows are one contiguous range
+}
+
+void CiftiOnDiskImpl::invalidateTile()
+{
+    CaretMutexLocker locked(&m_tileReadMutex);
+    getColumnTileCache().removeOwner(m_tileOwner);
+}
+
+CiftiOnDiskImpl::~CiftiOnDiskImpl()
+{
+    getColumnTileCache().removeOwner(m_tileOwner);
+}
+
 void CiftiOnDiskImpl::setRow(const float* dataIn, const vector<int64_t>& indexSelect)
 {
+    invalidateTile();
     m_nifti.writeData(dataIn, 5, indexSelect);
 }
 
+void CiftiOnDiskImpl::setRowBlock(const float* dataIn, const int64_t& firstRow, const int64_t& numRows, const int64_t& rowLength)
+{
+    CaretAssert(m_xml.getNumberOfDimensions() == 2);//otherwise this shouldn't be called
+    CaretAssert(rowLength == m_xml.getDimensionLength(CiftiXML::ALONG_ROW));
+    invalidateTile();
+    m_nifti.writeDataRange(dataIn, firstRow * rowLength, numRows * rowLength);
+}
+
 void CiftiOnDiskImpl::setColumn(const float* dataIn, const int64_t& index)
 {
     CaretAssert(m_xml.getNumberOfDimensions() == 2);//otherwise this shouldn't be called
     CaretAssert(index >= 0 && index < m_xml.getDimensionLength(CiftiXML::ALONG_ROW));
     CaretLogFine("setColumn called on CiftiOnDiskImpl, this will be slow");//generate logging messages at a low priority
+    invalidateTile();
     vector<int64_t> indexSelect(2);
     indexSelect[0] = index;
     int64_t colLength = m_xml.getDimensionLength(CiftiXML::ALONG_COLUMN);
@@ -851,3 +1287,460 @@ void CiftiXnatImpl::getColumn(float* dataOut, const int64_t& index) const
     columnRequest.m_queries.push_back(make_pair(AString("column-index"), AString::number(index)));
     getReqAsFloats(dataOut, m_xml.getDimensionLength(CiftiXML::ALONG_COLUMN), columnRequest);
 }
+
+bool CiftiSparseImpl::isSparseFile(const QString& filename)
+{
+    CaretBinaryFile testFile;
+    testFile.open(filename);//throws for nonexistant or unreadable files
+    char buf[8];
+    int64_t numRead = 0;
+    testFile.read(buf, 8, &numRead);
+    if (numRead != 8) return false;
+    for (int i = 0; i < 8; ++i)
+    {
+        if (buf[i] != SPARSE_MAGIC[i]) return false;
+    }
+    return true;
+}
+
+CiftiSparseImpl::CiftiSparseImpl(const QString& filename)
+{
+    m_tileOwner = getColumnTileCache().newOwner();
+    if (filename.endsWith(".gz"))
+    {
+        throw DataFileException("sparse cifti files cannot be read while compressed");
+    }//the row offsets would be meaningless
+    m_fileName = filename;
+    m_file.open(filename);
+    FileInformation fileInfo(filename);
+    int64_t fileSize = fileInfo.size();
+    char buf[8];
+    m_file.read(buf, 8);
+    for (int i = 0; i < 8; ++i)
+    {
+        if (buf[i] != SPARSE_MAGIC[i]) throw DataFileException("file '" + filename + "' has the wrong magic string for sparse cifti");
+    }
+    int64_t header[4];
+    m_file.read(header, 4 * sizeof(int64_t));
+    if (ByteOrderEnum::isSystemBigEndian())
+    {
+        ByteSwapping::swapBytes(header, 4);
+    }
+    m_rowLength = header[0];
+    m_numRows = header[1];
+    if (m_rowLength < 1 || m_numRows < 1) throw DataFileException("both dimensions must be positive in sparse cifti file '" + filename + "'");
+    if (m_rowLength > numeric_limits<int32_t>::max()) throw DataFileException("impossible row length in sparse cifti file '" + filename + "'");
+    if (m_numRows > numeric_limits<int32_t>::max()) throw DataFileException("impossible number of rows in sparse cifti file '" + filename + "'");
+    switch (header[2])
+    {
+        case SPARSE_FLOAT32:
+            m_valueType = SPARSE_FLOAT32;
+            break;
+        case SPARSE_INT16:
+            m_valueType = SPARSE_INT16;
+            break;
+        default:
+            throw DataFileException("unknown value type in sparse cifti file '" + filename + "'");
+    }
+    int64_t dataStart = SPARSE_HEADER_SIZE + (m_numRows + 1) * sizeof(int64_t);
+    if (dataStart > fileSize) throw DataFileException("sparse cifti file '" + filename + "' is truncated");
+    m_rowOffsets.resize(m_numRows + 1);
+    m_file.read(m_rowOffsets.data(), (m_numRows + 1) * sizeof(int64_t));
+    if (ByteOrderEnum::isSystemBigEndian())
+    {
+        ByteSwapping::swapBytes(m_rowOffsets.data(), m_numRows + 1);
+    }
+    int64_t valueSize = (m_valueType == SPARSE_INT16 ? sizeof(int16_t) : sizeof(float));
+    int64_t maxRowBytes = (m_valueType == SPARSE_INT16 ? sizeof(float) : 0) + m_rowLength * (sizeof(int32_t) + valueSize);
+    if (m_rowOffsets[0] != dataStart) throw DataFileException("impossible row offset found in sparse cifti file '" + filename + "'");
+    for (int64_t i = 0; i < m_numRows; ++i)
+    {
+        if (m_rowOffsets[i + 1] < m_rowOffsets[i] || m_rowOffsets[i + 1] - m_rowOffsets[i] > maxRowBytes)
+        {
+            throw DataFileException("impossible row offset found in sparse cifti file '" + filename + "'");
+        }
+    }
+    int64_t xmlOffset = m_rowOffsets[m_numRows];
+    if (xmlOffset >= fileSize) throw DataFileException("sparse cifti file '" + filename + "' is truncated");
+    QByteArray myXMLBytes(fileSize - xmlOffset, '\0');
+    m_file.readAt(myXMLBytes.data(), xmlOffset, myXMLBytes.size());
+    m_xml.readXML(myXMLBytes);
+    if (m_xml.getNumberOfDimensions() != 2 || m_xml.getDimensionLength(CiftiXML::ALONG_ROW) != m_rowLength || m_xml.getDimensionLength(CiftiXML::ALONG_COLUMN) != m_numRows)
+    {
+        throw DataFileException("cifti XML doesn't match dimensions of sparse cifti file '" + filename + "'");
+    }
+}
+
+int64_t CiftiSparseImpl::readRow(const int64_t& row, vector<char>& buffer, const int32_t*& indicesOut) const
+{
+    CaretAssert(row >= 0 && row < m_numRows);
+    int64_t numBytes = m_rowOffsets[row + 1] - m_rowOffsets[row];
+    indicesOut = NULL;
+    if (numBytes == 0) return 0;
+    int64_t headerBytes = 0, valueSize = sizeof(float);
+    if (m_valueType == SPARSE_INT16)
+    {
+        headerBytes = sizeof(float);
+        valueSize = sizeof(int16_t);
+    }
+    int64_t numEntries = (numBytes - headerBytes) / (sizeof(int32_t) + valueSize);
+    if (numEntries < 1 || headerBytes + numEntries * (int64_t)(sizeof(int32_t) + valueSize) != numBytes)
+    {
+        throw DataFileException("corrupt row found in sparse cifti file '" + m_fileName + "'");
+    }
+    if ((int64_t)buffer.size() < numBytes) buffer.resize(numBytes);
+    m_file.readAt(buffer.data(), m_rowOffsets[row], numBytes);
+    int32_t* indices = (int32_t*)(buffer.data() + headerBytes);
+    char* values = buffer.data() + headerBytes + numEntries * sizeof(int32_t);
+    if (ByteOrderEnum::isSystemBigEndian())
+    {
+        if (headerBytes != 0) ByteSwapping::swapBytes((float*)buffer.data(), 1);
+        ByteSwapping::swapBytes(indices, numEntries);
+        if (m_valueType == SPARSE_INT16)
+        {
+            ByteSwapping::swapBytes((int16_t*)values, numEntries);
+        } else {
+            ByteSwapping::swapBytes((float*)values, numEntries);
+        }
+    }
+    int32_t lastIndex = -1;
+    for (int64_t i = 0; i < numEntries; ++i)
+    {
+        if (indices[i] <= lastIndex || indices[i] >= m_rowLength) throw DataFileException("impossible index value found in sparse cifti file '" + m_fileName + "'");
+        lastIndex = indices[i];
+    }
+    indicesOut = indices;
+    return numEntries;
+}
+
+float CiftiSparseImpl::decodeValue(const char* values, const int64_t& which, const float& scale) const
+{
+    if (m_valueType == SPARSE_INT16)
+    {
+        int16_t coded = ((const int16_t*)values)[which];
+        if (coded == SPARSE_QUANT_NAN) return numeric_limits<float>::quiet_NaN();
+        return coded * scale;
+    }
+    return ((const float*)values)[which];
+}
+
+void CiftiSparseImpl::getRow(float* dataOut, const vector<int64_t>& indexSelect, const bool&) const
+{
+    CaretAssert(indexSelect.size() == 1);
+    vector<char> buffer;//local so that rows can be read from multiple threads
+    const int32_t* indices;
+    int64_t numEntries = readRow(indexSelect[0], buffer, indices);
+    for (int64_t i = 0; i < m_rowLength; ++i)
+    {
+        dataOut[i] = 0.0f;
+    }
+    if (numEntries == 0) return;
+    float scale = (m_valueType == SPARSE_INT16 ? *((const float*)buffer.data()) : 1.0f);
+    const char* values = (const char*)(indices + numEntries);
+    for (int64_t i = 0; i < numEntries; ++i)
+    {
+        dataOut[indices[i]] = decodeValue(values, i, scale);
+    }
+}
+
+const int64_t CiftiSparseImpl::COLUMN_TILE_BYTES = 1<<26;//same as for nifti cifti, but in nonzeros, so a sparse dconn usually needs only a few tiles
+
+CiftiSparseImpl::~CiftiSparseImpl()
+{
+    getColumnTileCache().removeOwner(m_tileOwner);
+}
+
+void CiftiSparseImpl::countColumns() const
+{//one pass over the file, then each tile of columns takes one more pass, instead of one pass for every column
+    vector<int64_t> columnCounts(m_rowLength, 0), tileBounds(1, 0);
+    vector<char> buffer;
+    for (int64_t row = 0; row < m_numRows; ++row)
+    {
+        const int32_t* indices;
+        int64_t numEntries = readRow(row, buffer, indices);
+        for (int64_t i = 0; i < numEntries; ++i)
+        {
+            ++columnCounts[indices[i]];
+        }
+    }
+    const int64_t entryBytes = sizeof(float) + sizeof(int32_t);
+    int64_t tileBytes = 0;
+    for (int64_t col = 0; col < m_rowLength; ++col)
+    {
+        int64_t colBytes = columnCounts[col] * entryBytes + (int64_t)sizeof(int64_t);
+        if (tileBytes > 0 && tileBytes + colBytes > COLUMN_TILE_BYTES)
+        {
+            tileBounds.push_back(col);
+            tileBytes = 0;
+        }
+        tileBytes += colBytes;
+    }
+    tileBounds.push_back(m_rowLength);
+    m_columnCounts.swap(columnCounts);//only now, in case reading threw
+    m_tileBounds.swap(tileBounds);
+}
+
+shared_ptr<const ColumnTile> CiftiSparseImpl::readColumnTile(const int64_t& index) const
+{
+    if (m_tileBounds.empty()) countColumns();
+    int64_t whichTile = (upper_bound(m_tileBounds.begin(), m_tileBounds.end(), index) - m_tileBounds.begin()) - 1;
+    CaretAssert(whichTile >= 0 && whichTile + 1 < (int64_t)m_tileBounds.size());
+    shared_ptr<ColumnTile> ret(new ColumnTile());
+    ret->m_start = m_tileBounds[whichTile];
+    ret->m_numColumns = m_tileBounds[whichTile + 1] - ret->m_start;
+    const int64_t tileEnd = ret->m_start + ret->m_numColumns;
+    ret->m_columnStart.resize(ret->m_numColumns + 1);
+    ret->m_columnStart[0] = 0;
+    for (int64_t i = 0; i < ret->m_numColumns; ++i)
+    {
+        ret->m_columnStart[i + 1] = ret->m_columnStart[i] + m_columnCounts[ret->m_start + i];
+    }
+    ret->m_data.resize(ret->m_columnStart.back());
+    ret->m_rows.resize(ret->m_columnStart.back());
+    vector<int64_t> nextEntry(ret->m_columnStart.begin(), ret->m_columnStart.end() - 1);
+    vector<char> buffer;
+    for (int64_t row = 0; row < m_numRows; ++row)
+    {//rows are read in order, so each column's values end up sorted by row
+        const int32_t* indices;
+        int64_t numEntries = readRow(row, buffer, indices);
+        if (numEntries == 0) continue;
+        float scale = (m_valueType == SPARSE_INT16 ? *((const float*)buffer.data()) : 1.0f);
+        const char* values = (const char*)(indices + numEntries);
+        int64_t start = lower_bound(indices, indices + numEntries, (int32_t)ret->m_start) - indices;
+        for (int64_t i = start; i < numEntries && indices[i] < tileEnd; ++i)
+        {
+            int64_t& entry = nextEntry[indices[i] - ret->m_start];
+            if (entry >= ret->m_columnStart[indices[i] - ret->m_start + 1]) throw DataFileException("sparse cifti file '" + m_fileName + "' changed while reading it");
+            ret->m_data[entry] = decodeValue(values, i, scale);
+            ret->m_rows[entry] = (int32_t)row;
+            ++entry;
+        }
+    }
+    return ret;
+}
+
+void CiftiSparseImpl::getColumn(float* dataOut, const int64_t& index) const
+{
+    CaretAssert(index >= 0 && index < m_rowLength);
+    ColumnTileCache& tileCache = getColumnTileCache();
+    shared_ptr<const ColumnTile> tile = tileCache.find(m_tileOwner, index);
+    if (tile == NULL)
+    {
+        CaretMutexLocker locked(&m_tileReadMutex);
+        tile = tileCache.find(m_tileOwner, index);//another thread may have read it while we waited
+        if (tile == NULL)
+        {
+            tile = readColumnTile(index);
+            tileCache.add(m_tileOwner, tile);
+        }
+    }
+    for (int64_t i = 0; i < m_numRows; ++i)
+    {
+        dataOut[i] = 0.0f;
+    }
+    const int64_t column = index - tile->m_start;
+    for (int64_t i = tile->m_columnStart[column]; i < tile->m_columnStart[column + 1]; ++i)
+    {
+        dataOut[tile->m_rows[i]] = tile->m_data[i];
+    }
+}
+
+void CiftiSparseImpl::getColumnBlock(float* dataOut, const int64_t& firstIndex, const int64_t& numColumns, const int64_t& columnLength) const
+{
+    CaretAssert(firstIndex >= 0 && numColumns > 0 && firstIndex + numColumns <= m_rowLength);
+    CaretAssert(columnLength == m_numRows);
+    for (int64_t i = 0; i < numColumns * columnLength; ++i)
+    {
+        dataOut[i] = 0.0f;
+    }
+    vector<char> buffer;
+    for (int64_t row = 0; row < m_numRows; ++row)
+    {//one pass over the file, the indices are sorted so we can skip to the requested columns
+        const int32_t* indices;
+        int64_t numEntries = readRow(row, buffer, indices);
+        if (numEntries == 0) continue;
+        float scale = (m_valueType == SPARSE_INT16 ? *((const float*)buffer.data()) : 1.0f);
+        const char* values = (const char*)(indices + numEntries);
+        int64_t start = lower_bound(indices, indices + numEntries, (int32_t)firstIndex) - indices;
+        for (int64_t i = start; i < numEntries && indices[i] < firstIndex + numColumns; ++i)
+        {
+            dataOut[(indices[i] - firstIndex) * columnLength + row] = decodeValue(values, i, scale);
+        }
+    }
+}
+
+CiftiSparseWriteImpl::CiftiSparseWriteImpl(const QString& filename, const CiftiXML& xml, const float& threshold, const int64_t& topK, const bool& quantize)
+{
+    if (xml.getNumberOfDimensions() != 2) throw DataFileException("sparse cifti writing is only supported for 2D cifti");
+    if (filename.endsWith(".gz"))
+    {
+        throw DataFileException("sparse cifti files cannot be written compressed");
+    }//because after we finish writing the data, we have to come back and write the row offsets
+    if (!filename.endsWith(".csf"))
+    {
+        CaretLogWarning("sparse cifti file '" + filename + "' should be saved ending in .csf (for example, .dconn.csf), because it is not a nifti file");
+    }
+    m_xml = xml;
+    m_fileName = filename;
+    m_rowLength = xml.getDimensionLength(CiftiXML::ALONG_ROW);
+    m_numRows = xml.getDimensionLength(CiftiXML::ALONG_COLUMN);
+    if (m_rowLength > numeric_limits<int32_t>::max()) throw DataFileException("row length is too large for sparse cifti");
+    m_threshold = threshold;
+    m_topK = topK;
+    m_quantize = quantize;
+    m_finished = false;
+    m_nextRow = 0;
+    m_file.open(filename, CaretBinaryFile::WRITE_TRUNCATE);
+    m_file.write(SPARSE_MAGIC, 8);
+    int64_t header[4] = { m_rowLength, m_numRows, (quantize ? SPARSE_INT16 : SPARSE_FLOAT32), 0 };
+    if (ByteOrderEnum::isSystemBigEndian())
+    {
+        ByteSwapping::swapBytes(header, 4);
+    }
+    m_file.write(header, 4 * sizeof(int64_t));
+    m_rowOffsets.resize(m_numRows + 1, 0);//initialize the memory so that valgrind won't complain
+    m_file.write(m_rowOffsets.data(), (m_numRows + 1) * sizeof(int64_t));//write it to get the file to the correct length
+    m_curPos = SPARSE_HEADER_SIZE + (m_numRows + 1) * sizeof(int64_t);
+}
+
+CiftiSparseWriteImpl::~CiftiSparseWriteImpl()
+{
+    try
+    {
+        close();//CiftiFile normally does this before releasing us, this is just so an exception elsewhere doesn't leave a file without its row offsets
+    } catch (CaretException& e) {
+        CaretLogSevere("error finishing sparse cifti file '" + m_fileName + "': " + e.whatString());
+    }
+}
+
+void CiftiSparseWriteImpl::getRow(float*, const vector<int64_t>&, const bool&) const
+{
+    throw DataFileException("sparse cifti file '" + m_fileName + "' cannot be read until it has been closed");
+}
+
+void CiftiSparseWriteImpl::getColumn(float*, const int64_t&) const
+{
+    throw DataFileException("sparse cifti file '" + m_fileName + "' cannot be read until it has been closed");
+}
+
+void CiftiSparseWriteImpl::setColumn(const float*, const int64_t&)
+{
+    throw DataFileException("sparse cifti files can only be written by rows");
+}
+
+void CiftiSparseWriteImpl::setRow(const float* dataIn, const vector<int64_t>& indexSelect)
+{
+    CaretAssert(indexSelect.size() == 1);
+    int64_t row = indexSelect[0];
+    CaretAssert(row >= 0 && row < m_numRows);
+    if (m_finished || row < m_nextRow) throw DataFileException("sparse cifti files must be written in row order, with each row set only once");
+    while (m_nextRow <= row)//skipped rows are empty
+    {
+        m_rowOffsets[m_nextRow] = m_curPos;
+        ++m_nextRow;
+    }
+    m_keepIndices.clear();
+    for (int64_t i = 0; i < m_rowLength; ++i)
+    {
+        float value = dataIn[i];
+        if (value != 0.0f && !(abs(value) < m_threshold))//keep NaNs, dropping them would turn them into zeros
+        {
+            m_keepIndices.push_back((int32_t)i);
+        }
+    }
+    if (m_topK > 0 && (int64_t)m_keepIndices.size() > m_topK)
+    {
+        vector<pair<float, int32_t> > ranked(m_keepIndices.size());
+        for (size_t i = 0; i < m_keepIndices.size(); ++i)
+        {
+            float value = dataIn[m_keepIndices[i]];
+            ranked[i] = pair<float, int32_t>((value != value ? -1.0f : abs(value)), m_keepIndices[i]);//NaN ranks below everything, so it can't break the ordering
+        }
+        nth_element(ranked.begin(), ranked.begin() + m_topK, ranked.end(), greater<pair<float, int32_t> >());
+        m_keepIndices.resize(m_topK);
+        for (int64_t i = 0; i < m_topK; ++i)
+        {
+            m_keepIndices[i] = ranked[i].second;
+        }
+        sort(m_keepIndices.begin(), m_keepIndices.end());
+    }
+    int64_t numEntries = (int64_t)m_keepIndices.size();
+    if (numEntries == 0) return;
+    int64_t headerBytes = (m_quantize ? sizeof(float) : 0);
+    int64_t numBytes = headerBytes + numEntries * (sizeof(int32_t) + (m_quantize ? sizeof(int16_t) : sizeof(float)));
+    m_scratch.resize(numBytes);
+    int32_t* indices = (int32_t*)(m_scratch.data() + headerBytes);
+    char* values = m_scratch.data() + headerBytes + numEntries * sizeof(int32_t);
+    for (int64_t i = 0; i < numEntries; ++i)
+    {
+        indices[i] = m_keepIndices[i];
+    }
+    if (m_quantize)
+    {
+        float maxAbs = 0.0f;
+        for (int64_t i = 0; i < numEntries; ++i)
+        {
+            float value = abs(dataIn[indices[i]]);
+            if (value > maxAbs && value <= numeric_limits<float>::max()) maxAbs = value;//infinities saturate instead of setting the scale
+        }
+        float scale = maxAbs / 32767.0f;
+        int16_t* coded = (int16_t*)values;
+        for (int64_t i = 0; i < numEntries; ++i)
+        {
+            float value = dataIn[indices[i]];
+            if (value != value)
+            {
+                coded[i] = SPARSE_QUANT_NAN;
+            } else if (scale == 0.0f) {//only infinities in this row
+                coded[i] = (value > 0.0f ? 32767 : -32767);
+            } else {
+                float scaled = floor(value / scale + 0.5f);
+                if (scaled > 32767.0f) scaled = 32767.0f;
+                if (scaled < -32767.0f) scaled = -32767.0f;
+                coded[i] = (int16_t)scaled;
+            }
+        }
+        *((float*)m_scratch.data()) = scale;
+        if (ByteOrderEnum::isSystemBigEndian())
+        {
+            ByteSwapping::swapBytes((float*)m_scratch.data(), 1);
+            ByteSwapping::swapBytes(coded, numEntries);
+        }
+    } else {
+        float* floatVals = (float*)values;
+        for (int64_t i = 0; i < numEntries; ++i)
+        {
+            floatVals[i] = dataIn[indices[i]];
+        }
+        if (ByteOrderEnum::isSystemBigEndian())
+        {
+            ByteSwapping::swapBytes(floatVals, numEntries);
+        }
+    }
+    if (ByteOrderEnum::isSystemBigEndian())
+    {
+        ByteSwapping::swapBytes(indices, numEntries);
+    }
+    m_file.write(m_scratch.data(), numBytes);
+    m_curPos += numBytes;
+}
+
+void CiftiSparseWriteImpl::close()
+{
+    if (m_finished) return;
+    m_finished = true;
+    while (m_nextRow <= m_numRows)//also sets the end of the last row, which is where the XML starts
+    {
+        m_rowOffsets[m_nextRow] = m_curPos;
+        ++m_nextRow;
+    }
+    QByteArray myXMLBytes = m_xml.writeXMLToQByteArray();
+    m_file.write(myXMLBytes.constData(), myXMLBytes.size());
+    if (ByteOrderEnum::isSystemBigEndian())
+    {
+        ByteSwapping::swapBytes(m_rowOffsets.data(), m_rowOffsets.size());
+    }
+    m_file.seek(SPARSE_HEADER_SIZE);
+    m_file.write(m_rowOffsets.data(), m_rowOffsets.size() * sizeof(int64_t));
+    m_file.close();
+}
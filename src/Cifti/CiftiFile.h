@@ -62,22 +62,31 @@ namespace caret
         QString getFileName() const { return m_fileName; }
         
         bool isInMemory() const;
+        bool canReadConcurrently() const;//whether getRow and getRowPointer can be called from multiple threads at once
         void getRow(float* dataOut, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead = false) const;//tolerateShortRead is useful for on-disk writing when it is easiest to do RMW multiple times on a new file
         const std::vector<int64_t>& getDimensions() const { return m_dims; }
         MultiDimIterator<int64_t> getIteratorOverRows() const
         {
             return MultiDimIterator<int64_t>(std::vector<int64_t>(m_dims.begin() + 1, m_dims.end()));
         }
-        void getColumn(float* dataOut, const int64_t& index) const;//for 2D only, will be slow if on disk!
+        void getColumn(float* dataOut, const int64_t& index) const;//for 2D only, on disk this reads a block of columns at a time and caches it
+        void getColumnBlock(float* dataOut, const int64_t& firstIndex, const int64_t& numColumns) const;//for 2D only, output is numColumns contiguous columns, on disk this is one pass over the rows
+        const float* getRowPointer(const std::vector<int64_t>& indexSelect) const;//NULL unless the data is in memory or memory mapped float32, valid until the file is modified or closed
+        void getRowBlock(float* dataOut, const int64_t& firstRow, const int64_t& numRows) const;//for 2D only, output is numRows contiguous rows, on disk this is one read
         
         void setCiftiXML(const CiftiXML& xml, const bool useOldMetadata = true);
         void setCiftiXML(const CiftiXMLOld &xml, const bool useOldMetadata = true);//set xml from old implementation
         void setRow(const float* dataIn, const std::vector<int64_t>& indexSelect);
         void setColumn(const float* dataIn, const int64_t& index);//for 2D only, will be slow if on disk!
+        void setRowBlock(const float* dataIn, const int64_t& firstRow, const int64_t& numRows);//for 2D only, input is numRows contiguous rows, on disk this is one write
         
-        ///data type and scaling options - should be set before setRow, etc, to avoid rewriting of file
+        ///data type and scaling options - should be set before setRow, etc, to avoid rewriting of file, these also switch back to nifti output
         void setWritingDataTypeNoScaling(const int16_t& type = NIFTI_TYPE_FLOAT32);
         void setWritingDataTypeAndScaling(const int16_t& type, const double& minval, const double& maxval);
+        ///store 2D output in the row-indexed sparse format instead of nifti, dropping values smaller in magnitude than threshold, and keeping at most topK per row (-1 for all)
+        ///it may be called before or after setCiftiXML and setWritingFile, it applies to the next writeFile, or with setWritingFile, to the file started by the next setRow, so call it before setting any rows
+        ///quantize stores values as 16-bit integers with a per-row scale, with setWritingFile the rows must be set in order, each only once, and the file can't be read back until it is closed
+        void setWritingSparse(const float& threshold = 0.0f, const int64_t& topK = -1, const bool& quantize = false);
         
         void getRow(float* dataOut, const int64_t& index, const bool& tolerateShortRead) const;//backwards compatibility for old CiftiFile/CiftiInterface
         void getRow(float* dataOut, const int64_t& index) const;
@@ -91,7 +100,11 @@ namespace caret
         public:
             virtual void getRow(float* dataOut, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead) const = 0;
             virtual void getColumn(float* dataOut, const int64_t& index) const = 0;
+            virtual void getColumnBlock(float* dataOut, const int64_t& firstIndex, const int64_t& numColumns, const int64_t& columnLength) const;//default calls getColumn for each column
+            virtual void getRowBlock(float* dataOut, const int64_t& firstRow, const int64_t& numRows, const int64_t& rowLength) const;//default calls getRow for each row
             virtual bool isInMemory() const { return false; }
+            virtual bool canReadConcurrently() const { return false; }
+            virtual const float* getRowPointer(const std::vector<int64_t>&) const { return NULL; }
             virtual ~ReadImplInterface();
         };
         //assume if you can write to it, you can also read from it
@@ -100,6 +113,7 @@ namespace caret
         public:
             virtual void setRow(const float* dataIn, const std::vector<int64_t>& indexSelect) = 0;
             virtual void setColumn(const float* dataIn, const int64_t& index) = 0;
+            virtual void setRowBlock(const float* dataIn, const int64_t& firstRow, const int64_t& numRows, const int64_t& rowLength);//default calls setRow for each row
             virtual void close() {}
             virtual ~WriteImplInterface();
         };
@@ -114,6 +128,9 @@ namespace caret
         bool m_doWriteScaling;
         int16_t m_writingDataType;
         double m_minScalingVal, m_maxScalingVal;
+        bool m_writeSparse, m_sparseQuantize;
+        float m_sparseThreshold;
+        int64_t m_sparseTopK;
         
         void verifyWriteImpl();
         static void copyImplData(const ReadImplInterface* from, WriteImplInterface* to, const std::vector<int64_t>& dims);
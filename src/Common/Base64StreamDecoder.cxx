@@ -0,0 +1,393 @@
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2019  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "Base64StreamDecoder.h"
+
+#include "CaretAssert.h"
+#include "CaretException.h"
+
+#include <algorithm>
+
+using namespace caret;
+
+namespace
+{
+    ///marks a character that is not in the base64 alphabet (includes padding and whitespace)
+    const uint32_t INVALID_CHARACTER = 0xFF000000;
+
+    /*
+     * For each position in a quartet, the 6 bits of each character already
+     * shifted into place, so a quartet decodes with four lookups and ORs and
+     * any character that needs special handling shows up in the high byte.
+     */
+    struct DecodeTables
+    {
+        uint32_t m_position[4][256];
+
+        DecodeTables()
+        {
+            const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+            for (int32_t pos = 0; pos < 4; ++pos)
+            {
+                for (int32_t i = 0; i < 256; ++i)
+                {
+                    m_position[pos][i] = INVALID_CHARACTER;
+                }
+                for (uint32_t value = 0; value < 64; ++value)
+                {
+                    m_position[pos][(unsigned char)alphabet[value]] = value << (18 - 6 * pos);
+                }
+            }
+        }
+    };
+
+    const DecodeTables& getDecodeTables()
+    {
+        static const DecodeTables theTables;
+        return theTables;
+    }
+
+    inline bool isWhitespace(const unsigned char c)
+    {
+        return ((c == ' ') || (c == '\n') || (c == '\r') || (c == '\t'));
+    }
+}
+
+/**
+ * \class caret::Base64StreamDecoder
+ * \brief Decodes base64 text that arrives in pieces
+ * \ingroup Common
+ *
+ * Runs of complete quartets are decoded four at a time with table lookups
+ * and without per-character branches, characters that need special
+ * handling (whitespace, padding, a quartet split between pieces) fall
+ * back to decoding one character at a time.
+ */
+
+/**
+ * Constructor.
+ */
+Base64StreamDecoder::Base64StreamDecoder()
+: CaretObject()
+{
+    getDecodeTables();
+    reset();
+}
+
+/**
+ * Destructor.
+ */
+Base64StreamDecoder::~Base64StreamDecoder()
+{
+}
+
+/**
+ * Discard any decoded data and prepare for decoding new text.
+ *
+ * @param expectedDecodedSize
+ *    If known, the number of bytes the text decodes to, so that the
+ *    output is allocated only once.
+ */
+void
+Base64StreamDecoder::reset(const int64_t expectedDecodedSize)
+{
+    m_decodedData.clear();
+    if (expectedDecodedSize > 0) {
+        m_decodedData.resize(expectedDecodedSize);
+    }
+    m_decodedCount = 0;
+    m_pendingBits  = 0;
+    m_pendingCount = 0;
+    m_paddingFoundFlag = false;
+}
+
+/**
+ * Decode the next piece of the text.
+ *
+ * @param input
+ *    The base64 characters.
+ * @param inputLength
+ *    Number of characters in input.
+ * @throws CaretException
+ *    If the text contains characters that are not base64.
+ */
+void
+Base64StreamDecoder::decode(const char* input,
+                            const int64_t inputLength)
+{
+    const unsigned char* ptr = reinterpret_cast<const unsigned char*>(input);
+    const unsigned char* end = ptr + inputLength;
+    while (ptr < end) {
+        if ((m_pendingCount == 0)
+            && ( ! m_paddingFoundFlag)) {
+            decodeCompleteQuartets(ptr, end);
+            if (ptr >= end) {
+                break;
+            }
+        }
+        decodeCharacter(*ptr);
+        ++ptr;
+    }
+}
+
+/**
+ * Decode complete quartets that contain only base64 characters, stops
+ * at the first quartet that does not.
+ *
+ * @param inputPointer
+ *    Start of input, updated past the quartets that were decoded.
+ * @param inputEnd
+ *    End of input.
+ */
+void
+Base64StreamDecoder::decodeCompleteQuartets(const unsigned char*& inputPointer,
+                                            const unsigned char* inputEnd)
+{
+    int64_t maximumQuartets = (inputEnd - inputPointer) / 4;
+    if (maximumQuartets <= 0) {
+        return;
+    }
+
+    /*
+     * Whitespace and padding are counted in the maximum, so stay within
+     * the allocated output while there is room to avoid reallocating
+     */
+    const int64_t available = static_cast<int64_t>(m_decodedData.size()) - m_decodedCount;
+    if ((available >= 3)
+        && (maximumQuartets * 3 > available)) {
+        maximumQuartets = available / 3;
+    }
+    ensureOutputSpace(maximumQuartets * 3);
+
+    const DecodeTables& tables = getDecodeTables();
+    const uint32_t* t0 = tables.m_position[0];
+    const uint32_t* t1 = tables.m_position[1];
+    const uint32_t* t2 = tables.m_position[2];
+    const uint32_t* t3 = tables.m_position[3];
+
+    uint8_t* out = m_decodedData.data() + m_decodedCount;
+    const unsigned char* ptr = inputPointer;
+
+    /*
+     * Four quartets at a time, one test for all of them
+     */
+    const unsigned char* blockEnd = ptr + (maximumQuartets / 4) * 16;
+    while (ptr < blockEnd) {
+        const uint32_t a = t0[ptr[0]]  | t1[ptr[1]]  | t2[ptr[2]]  | t3[ptr[3]];
+        const uint32_t b = t0[ptr[4]]  | t1[ptr[5]]  | t2[ptr[6]]  | t3[ptr[7]];
+        const uint32_t c = t0[ptr[8]]  | t1[ptr[9]]  | t2[ptr[10]] | t3[ptr[11]];
+        const uint32_t d = t0[ptr[12]] | t1[ptr[13]] | t2[ptr[14]] | t3[ptr[15]];
+        if ((a | b | c | d) & INVALID_CHARACTER) {
+            break;
+        }
+        out[0]  = (uint8_t)(a >> 16); out[1]  = (uint8_t)(a >> 8); out[2]  = (uint8_t)a;
+        out[3]  = (uint8_t)(b >> 16); out[4]  = (uint8_t)(b >> 8); out[5]  = (uint8_t)b;
+        out[6]  = (uint8_t)(c >> 16); out[7]  = (uint8_t)(c >> 8); out[8]  = (uint8_t)c;
+        out[9]  = (uint8_t)(d >> 16); out[10] = (uint8_t)(d >> 8); out[11] = (uint8_t)d;
+        ptr += 16;
+        out += 12;
+    }
+
+    /*
+     * Remaining quartets, or those in the block that stopped the loop above
+     */
+    const unsigned char* quartetEnd = inputPointer + maximumQuartets * 4;
+    while (ptr < quartetEnd) {
+        const uint32_t a = t0[ptr[0]] | t1[ptr[1]] | t2[ptr[2]] | t3[ptr[3]];
+        if (a & INVALID_CHARACTER) {
+            break;
+        }
+        out[0] = (uint8_t)(a >> 16); out[1] = (uint8_t)(a >> 8); out[2] = (uint8_t)a;
+        ptr += 4;
+        out += 3;
+    }
+
+    m_decodedCount = out - m_decodedData.data();
+    inputPointer = ptr;
+}
+
+/**
+ * Decode one character.
+ *
+ * @param c
+ *    The character.
+ * @throws CaretException
+ *    If the character is not base64 or padding is invalid.
+ */
+void
+Base64StreamDecoder::decodeCharacter(const unsigned char c)
+{
+    if (isWhitespace(c)) {
+        return;
+    }
+
+    if (c == '=') {
+        if ( ! m_paddingFoundFlag) {
+            /*
+             * Padding may only follow two or three characters of a quartet
+             */
+            if (m_pendingCount < 2) {
+                throw CaretException("Base64 padding character found after "
+                                     + AString::number(m_pendingCount)
+                                     + " characters of a quartet.");
+            }
+            appendByte((uint8_t)(m_pendingBits >> 16));
+            if (m_pendingCount == 3) {
+                appendByte((uint8_t)(m_pendingBits >> 8));
+            }
+            m_pendingBits  = 0;
+            m_pendingCount = 0;
+            m_paddingFoundFlag = true;
+        }
+        return;
+    }
+
+    const uint32_t value = getDecodeTables().m_position[0][c];
+    if ((value & INVALID_CHARACTER)
+        || m_paddingFoundFlag) {
+        throw CaretException("Invalid character in base64 data (code "
+                             + AString::number((int32_t)c)
+                             + ") after "
+                             + AString::number(getNumberOfDecodedBytes())
+                             + " decoded bytes.");
+    }
+
+    m_pendingBits |= (value >> (6 * m_pendingCount));
+    ++m_pendingCount;
+    if (m_pendingCount == 4) {
+        appendByte((uint8_t)(m_pendingBits >> 16));
+        appendByte((uint8_t)(m_pendingBits >> 8));
+        appendByte((uint8_t)m_pendingBits);
+        m_pendingBits  = 0;
+        m_pendingCount = 0;
+    }
+}
+
+/**
+ * Make room for more decoded bytes after those already decoded.  The
+ * output grows geometrically, and is never shrunk until the data is taken.
+ *
+ * @param numberOfBytes
+ *    Number of bytes that will be added.
+ */
+void
+Base64StreamDecoder::ensureOutputSpace(const int64_t numberOfBytes)
+{
+    const int64_t needed = m_decodedCount + numberOfBytes;
+    const int64_t allocated = m_decodedData.size();
+    if (needed > allocated) {
+        m_decodedData.resize(std::max(needed, allocated * 2));
+    }
+}
+
+/**
+ * Add one decoded byte.
+ *
+ * @param byte
+ *    The byte.
+ */
+void
+Base64StreamDecoder::appendByte(const uint8_t byte)
+{
+    ensureOutputSpace(1);
+    m_decodedData[m_decodedCount] = byte;
+    ++m_decodedCount;
+}
+
+/**
+ * Finish decoding.  Text without padding is accepted, so a final partial
+ * quartet of two or three characters is decoded.
+ *
+ * @throws CaretException
+ *    If the text ends with a single character of a quartet.
+ */
+void
+Base64StreamDecoder::finish()
+{
+    switch (m_pendingCount) {
+        case 0:
+            break;
+        case 1:
+            throw CaretException("Base64 data ends with an incomplete quartet.");
+            break;
+        case 2:
+            appendByte((uint8_t)(m_pendingBits >> 16));
+            break;
+        case 3:
+            appendByte((uint8_t)(m_pendingBits >> 16));
+            appendByte((uint8_t)(m_pendingBits >> 8));
+            break;
+        default:
+            CaretAssert(0);
+            break;
+    }
+    m_pendingBits  = 0;
+    m_pendingCount = 0;
+}
+
+/**
+ * Take the decoded data, the decoder is reset.
+ *
+ * @param decodedDataOut
+ *    Receives the decoded data (swapped, not copied).
+ */
+void
+Base64StreamDecoder::takeDecodedData(std::vector<uint8_t>& decodedDataOut)
+{
+    m_decodedData.resize(m_decodedCount);
+    decodedDataOut.clear();
+    decodedDataOut.swap(m_decodedData);
+    reset();
+}
+
+/**
+ * @return Number of bytes decoded so far.
+ */
+int64_t
+Base64StreamDecoder::getNumberOfDecodedBytes() const
+{
+    return m_decodedCount;
+}
+
+/**
+ * Decode a complete base64 text.
+ *
+ * @param input
+ *    The base64 characters.
+ * @param inputLength
+ *    Number of characters in input.
+ * @param decodedDataOut
+ *    Receives the decoded data.
+ * @throws CaretException
+ *    If the text is not valid base64.
+ */
+void
+Base64StreamDecoder::decode(const char* input,
+                            const int64_t inputLength,
+                            std::vector<uint8_t>& decodedDataOut)
+{
+    Base64StreamDecoder decoder;
+    decoder.reset((inputLength / 4) * 3 + 3);
+    decoder.decode(input,
+                   inputLength);
+    decoder.finish();
+    decoder.takeDecodedData(decodedDataOut);
+}
@@ -0,0 +1,86 @@
+#ifndef __BASE64_STREAM_DECODER_H__
+#define __BASE64_STREAM_DECODER_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2019  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <stdint.h>
+#include <vector>
+
+#include "CaretObject.h"
+
+namespace caret {
+
+    /**
+     * Decodes base64 text that arrives in pieces (such as the characters
+     * delivered by a SAX parser) into one byte buffer, so the whole text
+     * never has to be gathered first.  Whitespace is skipped, and a quartet
+     * may be split across pieces.
+     */
+    class Base64StreamDecoder : public CaretObject {
+    public:
+        Base64StreamDecoder();
+
+        virtual ~Base64StreamDecoder();
+
+        void reset(const int64_t expectedDecodedSize = 0);
+
+        void decode(const char* input,
+                    const int64_t inputLength);
+
+        void finish();
+
+        void takeDecodedData(std::vector<uint8_t>& decodedDataOut);
+
+        int64_t getNumberOfDecodedBytes() const;
+
+        static void decode(const char* input,
+                           const int64_t inputLength,
+                           std::vector<uint8_t>& decodedDataOut);
+
+    private:
+        Base64StreamDecoder(const Base64StreamDecoder&);
+
+        Base64StreamDecoder& operator=(const Base64StreamDecoder&);
+
+        void decodeCompleteQuartets(const unsigned char*& inputPointer,
+                                    const unsigned char* inputEnd);
+
+        void decodeCharacter(const unsigned char c);
+
+        void ensureOutputSpace(const int64_t numberOfBytes);
+
+        void appendByte(const uint8_t byte);
+
+        /** allocated output, only the first m_decodedCount bytes are valid */
+        std::vector<uint8_t> m_decodedData;
+
+        int64_t m_decodedCount;
+
+        uint32_t m_pendingBits;
+
+        int32_t m_pendingCount;
+
+        bool m_paddingFoundFlag;
+    };
+
+} // namespace
+
+#endif // __BASE64_STREAM_DECODER_H__
@@ -28,12 +28,18 @@
 #include "CaretAssert.h"
 #include "CaretBinaryFile.h"
 #include "CaretLogger.h"
+#include "CaretOMP.h"
 #include "DataFileException.h"
 
 #include <QFile>
 #include "zlib.h"
 
 #include <algorithm>
+#include <cstring>
+
+#ifndef CARET_OS_WINDOWS
+#include <unistd.h>
+#endif
 
 using namespace caret;
 using namespace std;
@@ -59,13 +65,94 @@ namespace caret
     };
     
     const int64_t ZFileImpl::CHUNK_SIZE = 1<<26;//64MiB, large enough for good performance, small enough for zlib, must convert to uint32
+    
+    //BGZF is the blocked gzip format from htslib/bgzip: a series of independent gzip members of at most 64KiB, each with its compressed size in an extra field
+    //ordinary gzip tools see a multi-member gzip file, but we can find the block containing any offset by reading only the member headers
+    namespace BGZF
+    {
+        const int64_t MAX_BLOCK_SIZE = 65536;
+        const int64_t BLOCK_INPUT = 65280;//largest uncompressed block that is guaranteed to fit even when stored without compression
+        const int64_t HEADER_SIZE = 18;//with only the BC subfield, which is what we write
+        const int64_t FOOTER_SIZE = 8;//crc32 and uncompressed size
+        const unsigned char EOF_MARKER[28] = { 0x1f, 0x8b, 0x08, 0x04, 0, 0, 0, 0, 0, 0xff, 0x06, 0, 0x42, 0x43, 0x02, 0, 0x1b, 0, 0x03, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+        
+        uint32_t getLE32(const unsigned char* bytes)
+        {
+            return ((uint32_t)bytes[0]) | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+        }
+        
+        void putLE16(unsigned char* bytes, const uint32_t& value)
+        {
+            bytes[0] = (unsigned char)(value & 0xff);
+            bytes[1] = (unsigned char)((value >> 8) & 0xff);
+        }
+        
+        void putLE32(unsigned char* bytes, const uint32_t& value)
+        {
+            putLE16(bytes, value & 0xffff);
+            putLE16(bytes + 2, value >> 16);
+        }
+    }
+    
+    //writes BGZF, compressing batches of blocks in parallel, only supports WRITE_TRUNCATE, and only seeking forward
+    class BGZFWriteImpl : public CaretBinaryFile::ImplInterface
+    {
+        QFile m_file;
+        vector<char> m_pending;//uncompressed data that hasn't been made into blocks yet
+        int64_t m_pos;
+        const static int64_t BATCH_SIZE;
+        static bool compressBlock(const char* dataIn, const int64_t& count, vector<char>& blockOut, const int& level);
+        void writeRaw(const char* dataIn, const int64_t& count);
+        void writeBlocks(const bool& final);
+    public:
+        BGZFWriteImpl() { m_pos = 0; }
+        void open(const QString& filename, const CaretBinaryFile::OpenMode& opmode);
+        void close();
+        void seek(const int64_t& position);
+        int64_t pos() { return m_pos; }
+        int64_t size() { return -1; }
+        void read(void* dataOut, const int64_t& count, int64_t* numRead);
+        void write(const void* dataIn, const int64_t& count);
+        ~BGZFWriteImpl();
+    };
+    
+    const int64_t BGZFWriteImpl::BATCH_SIZE = 256 * BGZF::BLOCK_INPUT;//about 16MiB of input per parallel batch
+    
+    //reads BGZF with random access, the block index is built lazily from the member headers as reads need it
+    class BGZFReadImpl : public CaretBinaryFile::ImplInterface
+    {
+        QFile m_file;
+        vector<int64_t> m_blockFileStart;//compressed offset of each block found so far
+        vector<int64_t> m_blockDataStart;//uncompressed offset of each block found so far, plus one extra for the end of the last one
+        int64_t m_scanFilePos;//compressed offset of the first block not yet in the index
+        bool m_indexComplete;
+        int64_t m_loadedBlock;
+        vector<char> m_blockData, m_rawBlock;
+        int64_t m_pos;
+        bool scanNextBlock();//returns false at end of file
+        int64_t findBlock(const int64_t& position);//returns -1 if position is past the end of the data
+        void loadBlock(const int64_t& block);
+        void readRaw(char* dataOut, const int64_t& position, const int64_t& count);
+    public:
+        BGZFReadImpl() { m_scanFilePos = 0; m_indexComplete = false; m_loadedBlock = -1; m_pos = 0; }
+        static bool isBGZF(const QString& filename);
+        void open(const QString& filename, const CaretBinaryFile::OpenMode& opmode);
+        void close();
+        void seek(const int64_t& position);
+        int64_t pos() { return m_pos; }
+        int64_t size();
+        void read(void* dataOut, const int64_t& count, int64_t* numRead);
+        void write(const void* dataIn, const int64_t& count);
+    };
 #endif //ZLIB_VERSION
 
     class QFileImpl : public CaretBinaryFile::ImplInterface
     {
         QFile m_file;
+        bool m_readOnly;//pread bypasses QFile's buffer, so only use it when there can't be unflushed writes
         const static int64_t CHUNK_SIZE;
     public:
+        QFileImpl() { m_readOnly = false; }
         void open(const QString& filename, const CaretBinaryFile::OpenMode& opmode);
         void close();
         void seek(const int64_t& position);
@@ -73,15 +160,50 @@ namespace caret
         int64_t size() { return m_file.size(); }
         void read(void* dataOut, const int64_t& count, int64_t* numRead);
         void write(const void* dataIn, const int64_t& count);
+        void readAt(void* dataOut, const int64_t& position, const int64_t& count, int64_t* numRead);
     };
     
     const int64_t QFileImpl::CHUNK_SIZE = 1<<30;//1GiB, QT4 apparently chokes at more than 2GiB via buffer.read using int32
+    
+    //read-only, maps the entire file so that callers can convert data directly from the page cache without a copy or a seek
+    class MMapFileImpl : public CaretBinaryFile::ImplInterface
+    {
+        QFile m_file;
+        const char* m_map;
+        int64_t m_size, m_pos;
+    public:
+        MMapFileImpl() { m_map = NULL; m_size = 0; m_pos = 0; }
+        bool tryOpen(const QString& filename);//returns false rather than throwing, so the caller can fall back to QFileImpl for error messages
+        void open(const QString& filename, const CaretBinaryFile::OpenMode& opmode);
+        void close();
+        void seek(const int64_t& position);
+        int64_t pos() { return m_pos; }
+        int64_t size() { return m_size; }
+        void read(void* dataOut, const int64_t& count, int64_t* numRead);
+        void write(const void* dataIn, const int64_t& count);
+        void readAt(void* dataOut, const int64_t& position, const int64_t& count, int64_t* numRead);
+        const char* getMemoryMap() const { return m_map; }
+    };
 }
 
 CaretBinaryFile::ImplInterface::~ImplInterface()
 {
 }
 
+void CaretBinaryFile::ImplInterface::readAt(void* dataOut, const int64_t& position, const int64_t& count, int64_t* numRead)
+{
+    CaretMutexLocker locked(&m_positionMutex);
+    seek(position);
+    read(dataOut, count, numRead);
+}
+
+void CaretBinaryFile::ImplInterface::writeAt(const void* dataIn, const int64_t& position, const int64_t& count)
+{
+    CaretMutexLocker locked(&m_positionMutex);
+    seek(position);
+    write(dataIn, count);
+}
+
 CaretBinaryFile::CaretBinaryFile(const QString& filename, const OpenMode& fileMode)
 {
     open(filename, fileMode);
@@ -103,12 +225,12 @@ QString CaretBinaryFile::getFilename() const
 
 bool CaretBinaryFile::getOpenForRead()
 {
-    return (m_curMode | READ) != 0;
+    return (m_curMode & READ) != 0;
 }
 
 bool CaretBinaryFile::getOpenForWrite()
 {
-    return (m_curMode | WRITE) != 0;
+    return (m_curMode & WRITE) != 0;
 }
 
 void CaretBinaryFile::open(const QString& filename, const OpenMode& opmode)
@@ -118,17 +240,40 @@ void CaretBinaryFile::open(const QString& filename, const OpenMode& opmode)
     if (filename.endsWith(".gz"))
     {
 #ifdef ZLIB_VERSION
-        m_impl.grabNew(new ZFileImpl());
+        if (opmode == WRITE_TRUNCATE)
+        {
+            m_impl.grabNew(new BGZFWriteImpl());//still a valid gzip file, but we can read it back with random access
+        } else if (opmode == READ && BGZFReadImpl::isBGZF(filename)) {
+            m_impl.grabNew(new BGZFReadImpl());
+        } else {
+            m_impl.grabNew(new ZFileImpl());
+        }
 #else //ZLIB_VERSION
         throw DataFileException("can't open .gz file '" + filename + "', compiled without zlib support");
 #endif //ZLIB_VERSION
     } else {
+        if (opmode == READ)
+        {
+            CaretPointer<MMapFileImpl> mapImpl(new MMapFileImpl());
+            if (mapImpl->tryOpen(filename))
+            {
+                m_impl = mapImpl;
+                m_curMode = opmode;
+                return;
+            }//mapping fails on empty files, when out of address space (32-bit), or on some filesystems, so fall back to normal reads
+        }
         m_impl.grabNew(new QFileImpl());
     }
     m_impl->open(filename, opmode);
     m_curMode = opmode;
 }
 
+const char* CaretBinaryFile::getMemoryMap() const
+{
+    if (m_impl == NULL) return NULL;
+    return m_impl->getMemoryMap();
+}
+
 void CaretBinaryFile::read(void* dataOut, const int64_t& count, int64_t* numRead)
 {
     CaretAssert(count >= 0);//not sure about allowing 0
@@ -136,6 +281,20 @@ void CaretBinaryFile::read(void* dataOut, const int64_t& count, int64_t* numRead
     m_impl->read(dataOut, count, numRead);
 }
 
+void CaretBinaryFile::readAt(void* dataOut, const int64_t& position, const int64_t& count, int64_t* numRead)
+{
+    CaretAssert(position >= 0 && count >= 0);
+    if (!getOpenForRead()) throw DataFileException("file is not open for reading");
+    m_impl->readAt(dataOut, position, count, numRead);
+}
+
+void CaretBinaryFile::writeAt(const void* dataIn, const int64_t& position, const int64_t& count)
+{
+    CaretAssert(position >= 0 && count >= 0);
+    if (!getOpenForWrite()) throw DataFileException("file is not open for writing");
+    m_impl->writeAt(dataIn, position, count);
+}
+
 void CaretBinaryFile::seek(const int64_t& position)
 {
     CaretAssert(position >= 0);
@@ -280,6 +439,296 @@ ZFileImpl::~ZFileImpl()
         CaretLogSevere("caught unknown exception type while closing a compressed file");
     }
 }
+
+bool BGZFWriteImpl::compressBlock(const char* dataIn, const int64_t& count, vector<char>& blockOut, const int& level)
+{
+    CaretAssert(count <= BGZF::BLOCK_INPUT);
+    blockOut.resize(BGZF::MAX_BLOCK_SIZE);
+    unsigned char* outBytes = (unsigned char*)blockOut.data();
+    z_stream myStream;
+    memset(&myStream, 0, sizeof(myStream));
+    if (deflateInit2(&myStream, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) return false;//negative window bits means raw deflate, we write the gzip wrapper ourselves
+    myStream.next_in = (Bytef*)dataIn;
+    myStream.avail_in = (uInt)count;
+    myStream.next_out = (Bytef*)(outBytes + BGZF::HEADER_SIZE);
+    myStream.avail_out = (uInt)(BGZF::MAX_BLOCK_SIZE - BGZF::HEADER_SIZE - BGZF::FOOTER_SIZE);
+    int ret = deflate(&myStream, Z_FINISH);
+    int64_t compressedSize = myStream.total_out;
+    deflateEnd(&myStream);
+    if (ret != Z_STREAM_END) return false;//didn't fit in a block
+    int64_t blockSize = BGZF::HEADER_SIZE + compressedSize + BGZF::FOOTER_SIZE;
+    memcpy(outBytes, BGZF::EOF_MARKER, BGZF::HEADER_SIZE);//same header as every other block, except for the block size
+    BGZF::putLE16(outBytes + 16, (uint32_t)(blockSize - 1));
+    uint32_t crc = crc32(crc32(0L, Z_NULL, 0), (const Bytef*)dataIn, (uInt)count);
+    BGZF::putLE32(outBytes + blockSize - 8, crc);
+    BGZF::putLE32(outBytes + blockSize - 4, (uint32_t)count);
+    blockOut.resize(blockSize);
+    return true;
+}
+
+void BGZFWriteImpl::open(const QString& filename, const CaretBinaryFile::OpenMode& opmode)
+{
+    close();//don't need to, but just because
+    m_fileName = filename;
+    if (opmode != CaretBinaryFile::WRITE_TRUNCATE) throw DataFileException("compressed file only supports READ and WRITE_TRUNCATE modes");
+    m_file.setFileName(filename);
+    m_file.remove();//attempt to remove file rather than truncating, to improve behavior with file symlinks
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        throw DataFileException("failed to open compressed file '" + filename + "', unable to create file");
+    }
+    m_pos = 0;
+}
+
+void BGZFWriteImpl::close()
+{
+    if (!m_file.isOpen()) return;
+    writeBlocks(true);
+    writeRaw((const char*)BGZF::EOF_MARKER, sizeof(BGZF::EOF_MARKER));
+    m_file.close();
+    if (m_file.error() != QFile::NoError) throw DataFileException("error closing compressed file '" + m_fileName + "'");
+    m_pending.clear();
+    m_pos = 0;
+}
+
+void BGZFWriteImpl::writeRaw(const char* dataIn, const int64_t& count)
+{
+    int64_t total = 0;
+    while (total < count)
+    {
+        int64_t writeret = m_file.write(dataIn + total, count - total);
+        if (writeret < 1) break;//0 or -1 means error
+        total += writeret;
+    }
+    if (total != count) throw DataFileException("failed to write to compressed file '" + m_fileName + "'");
+}
+
+void BGZFWriteImpl::writeBlocks(const bool& final)
+{
+    int64_t numBlocks = m_pending.size() / BGZF::BLOCK_INPUT;
+    if (final && (int64_t)m_pending.size() > numBlocks * BGZF::BLOCK_INPUT) ++numBlocks;//the last block can be short
+    if (numBlocks == 0) return;
+    vector<vector<char> > blocks(numBlocks);
+    int64_t numFailed = 0;//don't throw inside the parallel loop
+#pragma omp CARET_PARFOR schedule(dynamic) reduction(+:numFailed)
+    for (int64_t i = 0; i < numBlocks; ++i)
+    {
+        int64_t start = i * BGZF::BLOCK_INPUT;
+        int64_t count = min(BGZF::BLOCK_INPUT, (int64_t)m_pending.size() - start);
+        if (!compressBlock(m_pending.data() + start, count, blocks[i], Z_DEFAULT_COMPRESSION))
+        {//incompressible data can come out slightly larger than it went in, so store it instead
+            if (!compressBlock(m_pending.data() + start, count, blocks[i], 0)) ++numFailed;
+        }
+    }
+    if (numFailed != 0) throw DataFileException("failed to compress data for file '" + m_fileName + "'");
+    for (int64_t i = 0; i < numBlocks; ++i)
+    {
+        writeRaw(blocks[i].data(), blocks[i].size());
+    }
+    m_pending.erase(m_pending.begin(), m_pending.begin() + min((int64_t)m_pending.size(), numBlocks * BGZF::BLOCK_INPUT));
+}
+
+void BGZFWriteImpl::write(const void* dataIn, const int64_t& count)
+{
+    if (!m_file.isOpen()) throw DataFileException("write called on unopened BGZFWriteImpl");//shouldn't happen
+    int64_t total = 0;
+    while (total < count)
+    {//don't buffer more than a batch, even if given a huge write
+        int64_t iterSize = min(count - total, BATCH_SIZE - (int64_t)m_pending.size());
+        m_pending.insert(m_pending.end(), ((const char*)dataIn) + total, ((const char*)dataIn) + total + iterSize);
+        total += iterSize;
+        if ((int64_t)m_pending.size() >= BATCH_SIZE) writeBlocks(false);
+    }
+    m_pos += count;
+}
+
+void BGZFWriteImpl::seek(const int64_t& position)
+{
+    if (position == m_pos) return;
+    if (position < m_pos) throw DataFileException("can't seek backwards while writing compressed file '" + m_fileName + "'");
+    vector<char> zeros(min(position - m_pos, BGZF::BLOCK_INPUT), 0);//like gzseek, fill the gap with zeros
+    while (m_pos < position)
+    {
+        write(zeros.data(), min(position - m_pos, (int64_t)zeros.size()));
+    }
+}
+
+void BGZFWriteImpl::read(void*, const int64_t&, int64_t*)
+{
+    throw DataFileException("read called on compressed file '" + m_fileName + "' opened for writing");
+}
+
+BGZFWriteImpl::~BGZFWriteImpl()
+{
+    try//throwing from a destructor is a bad idea
+    {
+        close();
+    } catch (CaretException& e) {
+        CaretLogSevere(e.whatString());
+    } catch (exception& e) {
+        CaretLogSevere(e.what());
+    } catch (...) {
+        CaretLogSevere("caught unknown exception type while closing a compressed file");
+    }
+}
+
+bool BGZFReadImpl::isBGZF(const QString& filename)
+{
+    QFile testFile(filename);
+    if (!testFile.open(QIODevice::ReadOnly)) return false;//let ZFileImpl generate the error message
+    unsigned char header[16];
+    if (testFile.read((char*)header, 16) != 16) return false;
+    return header[0] == 0x1f && header[1] == 0x8b && header[2] == 8 && (header[3] & 4) != 0 && header[10] >= 6 &&
+           header[12] == 'B' && header[13] == 'C' && header[14] == 2 && header[15] == 0;//same check as htslib, the first block's first subfield is BC
+}
+
+void BGZFReadImpl::open(const QString& filename, const CaretBinaryFile::OpenMode& opmode)
+{
+    close();
+    m_fileName = filename;
+    if (opmode != CaretBinaryFile::READ) throw DataFileException("compressed file only supports READ and WRITE_TRUNCATE modes");
+    m_file.setFileName(filename);
+    if (!m_file.open(QIODevice::ReadOnly)) throw DataFileException("failed to open compressed file '" + filename + "'");
+    m_blockDataStart.push_back(0);
+}
+
+void BGZFReadImpl::close()
+{
+    m_file.close();
+    m_blockFileStart.clear();
+    m_blockDataStart.clear();
+    m_scanFilePos = 0;
+    m_indexComplete = false;
+    m_loadedBlock = -1;
+    m_pos = 0;
+}
+
+void BGZFReadImpl::readRaw(char* dataOut, const int64_t& position, const int64_t& count)
+{
+    if (!m_file.seek(position) || m_file.read(dataOut, count) != count)
+    {
+        throw DataFileException("error while reading compressed file '" + m_fileName + "'");
+    }
+}
+
+bool BGZFReadImpl::scanNextBlock()
+{
+    if (m_indexComplete) return false;
+    unsigned char header[12];
+    if (!m_file.seek(m_scanFilePos)) throw DataFileException("seek failed in compressed file '" + m_fileName + "'");
+    int64_t numRead = m_file.read((char*)header, 12);
+    if (numRead == 0)
+    {
+        m_indexComplete = true;
+        return false;
+    }
+    if (numRead != 12 || header[0] != 0x1f || header[1] != 0x8b || header[2] != 8 || (header[3] & 4) == 0)
+    {
+        throw DataFileException("compressed file '" + m_fileName + "' is truncated or has a block that isn't BGZF");
+    }
+    int64_t extraLength = header[10] | (header[11] << 8);
+    vector<unsigned char> extra(extraLength);
+    readRaw((char*)extra.data(), m_scanFilePos + 12, extraLength);
+    int64_t blockSize = -1;
+    for (int64_t i = 0; i + 4 <= extraLength; )
+    {//find the BC subfield, it isn't required to be first
+        int64_t subLength = extra[i + 2] | (extra[i + 3] << 8);
+        if (extra[i] == 'B' && extra[i + 1] == 'C' && subLength == 2 && i + 6 <= extraLength)
+        {
+            blockSize = (extra[i + 4] | (extra[i + 5] << 8)) + 1;
+            break;
+        }
+        i += 4 + subLength;
+    }
+    if (blockSize < 12 + extraLength + BGZF::FOOTER_SIZE) throw DataFileException("compressed file '" + m_fileName + "' has a block that isn't BGZF");
+    unsigned char sizeBytes[4];
+    readRaw((char*)sizeBytes, m_scanFilePos + blockSize - 4, 4);//uncompressed size is the last field of the block
+    m_blockFileStart.push_back(m_scanFilePos);
+    m_blockDataStart.push_back(m_blockDataStart.back() + BGZF::getLE32(sizeBytes));
+    m_scanFilePos += blockSize;
+    return true;
+}
+
+int64_t BGZFReadImpl::findBlock(const int64_t& position)
+{
+    while (m_blockDataStart.back() <= position)
+    {
+        if (!scanNextBlock()) return -1;
+    }
+    //first start that is past position, minus one, is the block containing it - this also skips empty blocks
+    return (upper_bound(m_blockDataStart.begin(), m_blockDataStart.end(), position) - m_blockDataStart.begin()) - 1;
+}
+
+void BGZFReadImpl::loadBlock(const int64_t& block)
+{
+    if (block == m_loadedBlock) return;
+    CaretAssertVectorIndex(m_blockFileStart, block);
+    m_loadedBlock = -1;//in case we throw
+    int64_t blockEnd = (block + 1 < (int64_t)m_blockFileStart.size() ? m_blockFileStart[block + 1] : m_scanFilePos);
+    int64_t blockSize = blockEnd - m_blockFileStart[block];
+    m_rawBlock.resize(blockSize);
+    readRaw(m_rawBlock.data(), m_blockFileStart[block], blockSize);
+    const unsigned char* rawBytes = (const unsigned char*)m_rawBlock.data();
+    int64_t headerSize = 12 + (rawBytes[10] | (rawBytes[11] << 8));
+    int64_t dataSize = m_blockDataStart[block + 1] - m_blockDataStart[block];
+    m_blockData.resize(dataSize);
+    z_stream myStream;
+    memset(&myStream, 0, sizeof(myStream));
+    if (inflateInit2(&myStream, -15) != Z_OK) throw DataFileException("failed to initialize zlib for compressed file '" + m_fileName + "'");
+    myStream.next_in = (Bytef*)(rawBytes + headerSize);
+    myStream.avail_in = (uInt)(blockSize - headerSize - BGZF::FOOTER_SIZE);
+    myStream.next_out = (Bytef*)m_blockData.data();
+    myStream.avail_out = (uInt)dataSize;
+    int ret = inflate(&myStream, Z_FINISH);
+    int64_t outSize = myStream.total_out;
+    inflateEnd(&myStream);
+    if (ret != Z_STREAM_END || outSize != dataSize ||
+        crc32(crc32(0L, Z_NULL, 0), (const Bytef*)m_blockData.data(), (uInt)dataSize) != BGZF::getLE32(rawBytes + blockSize - 8))
+    {
+        throw DataFileException("error decompressing block in compressed file '" + m_fileName + "'");
+    }
+    m_loadedBlock = block;
+}
+
+void BGZFReadImpl::seek(const int64_t& position)
+{
+    if (!m_file.isOpen()) throw DataFileException("seek called on unopened BGZFReadImpl");//shouldn't happen
+    m_pos = position;//checked when reading, so that seeking doesn't need to scan the index
+}
+
+int64_t BGZFReadImpl::size()
+{
+    if (!m_indexComplete) return -1;//we could scan the headers, but NiftiIO doesn't need this enough to justify it
+    return m_blockDataStart.back();
+}
+
+void BGZFReadImpl::read(void* dataOut, const int64_t& count, int64_t* numRead)
+{
+    if (!m_file.isOpen()) throw DataFileException("read called on unopened BGZFReadImpl");//shouldn't happen
+    int64_t total = 0;
+    while (total < count)
+    {
+        int64_t block = findBlock(m_pos);
+        if (block < 0) break;//end of file
+        loadBlock(block);
+        int64_t offset = m_pos - m_blockDataStart[block];
+        int64_t iterSize = min(count - total, (int64_t)m_blockData.size() - offset);
+        memcpy(((char*)dataOut) + total, m_blockData.data() + offset, iterSize);
+        total += iterSize;
+        m_pos += iterSize;
+    }
+    if (numRead == NULL)
+    {
+        if (total != count) throw DataFileException("premature end of file in compressed file '" + m_fileName + "'");
+    } else {
+        *numRead = total;
+    }
+}
+
+void BGZFReadImpl::write(const void*, const int64_t&)
+{
+    throw DataFileException("write called on compressed file '" + m_fileName + "' opened for reading");
+}
 #endif //ZLIB_VERSION
 
 void QFileImpl::open(const QString& filename, const CaretBinaryFile::OpenMode& opmode)
@@ -290,6 +739,7 @@ void QFileImpl::open(const QString& filename, const CaretBinaryFile::OpenMode& o
     if (opmode & CaretBinaryFile::READ) mode |= QIODevice::ReadOnly;
     if (opmode & CaretBinaryFile::WRITE) mode |= QIODevice::WriteOnly;
     if (opmode & CaretBinaryFile::TRUNCATE) mode |= QIODevice::Truncate;//expect QFile to recognize silliness like TRUNCATE by itself
+    m_readOnly = (opmode == CaretBinaryFile::READ);
     m_file.setFileName(filename);
     if (mode & QIODevice::Truncate) m_file.remove();//attempt to delete the existing file rather than truncating, to improve behavior with file symlinks
     if (!m_file.open(mode))
@@ -346,6 +796,37 @@ void QFileImpl::read(void* dataOut, const int64_t& count, int64_t* numRead)
     }
 }
 
+void QFileImpl::readAt(void* dataOut, const int64_t& position, const int64_t& count, int64_t* numRead)
+{
+#ifndef CARET_OS_WINDOWS
+    int fd = m_file.handle();
+    if (m_readOnly && fd != -1)
+    {//pread doesn't use or change the file position, so concurrent reads need no lock
+        int64_t total = 0;
+        int64_t readret = -1;
+        while (total < count)
+        {
+            int64_t maxToRead = min(count - total, CHUNK_SIZE);
+            readret = pread(fd, ((char*)dataOut) + total, maxToRead, position + total);
+            if (readret < 1) break;//0 or -1 means error or eof
+            total += readret;
+        }
+        if (numRead == NULL)
+        {
+            if (total != count)
+            {
+                if (readret < 0) throw DataFileException("error while reading file '" + m_fileName + "'");
+                throw DataFileException("premature end of file in '" + m_fileName + "'");
+            }
+        } else {
+            *numRead = total;
+        }
+        return;
+    }
+#endif
+    ImplInterface::readAt(dataOut, position, count, numRead);
+}
+
 void QFileImpl::seek(const int64_t& position)
 {
     if (!m_file.seek(position)) throw DataFileException("seek failed in file '" + m_fileName + "'");
@@ -376,3 +857,80 @@ void QFileImpl::write(const void* dataIn, const int64_t& count)
                          + " bytes.");
     if (total != count) throw DataFileException(msg);
 }
+
+bool MMapFileImpl::tryOpen(const QString& filename)
+{
+    close();
+    m_fileName = filename;
+    m_file.setFileName(filename);
+    if (!m_file.open(QIODevice::ReadOnly)) return false;
+    m_size = m_file.size();
+    if (m_size <= 0)
+    {
+        close();
+        return false;
+    }
+    m_map = (const char*)m_file.map(0, m_size);
+    if (m_map == NULL)
+    {
+        close();
+        return false;
+    }
+    m_pos = 0;
+    return true;
+}
+
+void MMapFileImpl::open(const QString& filename, const CaretBinaryFile::OpenMode& opmode)
+{
+    if (opmode != CaretBinaryFile::READ) throw DataFileException("memory mapped file only supports READ mode");
+    if (!tryOpen(filename)) throw DataFileException("failed to memory map file '" + filename + "'");
+}
+
+void MMapFileImpl::close()
+{
+    m_map = NULL;//QFile unmaps on close
+    m_size = 0;
+    m_pos = 0;
+    m_file.close();
+}
+
+void MMapFileImpl::read(void* dataOut, const int64_t& count, int64_t* numRead)
+{
+    if (m_map == NULL) throw DataFileException("read called on unopened MMapFileImpl");//shouldn't happen
+    int64_t total = min(count, max(m_size - m_pos, (int64_t)0));
+    if (total > 0)
+    {
+        memcpy(dataOut, m_map + m_pos, total);
+        m_pos += total;
+    }
+    if (numRead == NULL)
+    {
+        if (total != count) throw DataFileException("premature end of file in '" + m_fileName + "'");
+    } else {
+        *numRead = total;
+    }
+}
+
+void MMapFileImpl::seek(const int64_t& position)
+{
+    if (m_map == NULL || position < 0) throw DataFileException("seek failed in file '" + m_fileName + "'");
+    m_pos = position;//like QFile, seeking past the end is allowed, reads there will come up short
+}
+
+void MMapFileImpl::readAt(void* dataOut, const int64_t& position, const int64_t& count, int64_t* numRead)
+{
+    if (m_map == NULL) throw DataFileException("readAt called on unopened MMapFileImpl");//shouldn't happen
+    int64_t total = min(count, max(m_size - position, (int64_t)0));
+    if (total > 0) memcpy(dataOut, m_map + position, total);
+    if (numRead == NULL)
+    {
+        if (total != count) throw DataFileException("premature end of file in '" + m_fileName + "'");
+    } else {
+        *numRead = total;
+    }
+}
+
+void MMapFileImpl::write(const void*, const int64_t&)
+{
+    throw DataFileException("write called on read-only memory mapped file '" + m_fileName + "'");
+}
@@ -21,6 +21,7 @@
  */
 /*LICENSE_END*/
 
+#include "CaretMutex.h"
 #include "CaretPointer.h"
 
 #include <QString>
@@ -55,9 +56,14 @@ namespace caret {
         int64_t pos();
         void read(void* dataOut, const int64_t& count, int64_t* numRead = NULL);//throw if numRead is NULL and (error or end of file reached early)
         void write(const void* dataIn, const int64_t& count);//failure to complete write is always an exception
+        //positional versions, safe to call from multiple threads at once (but not mixed with seek/read/write), file position afterwards is unspecified
+        void readAt(void* dataOut, const int64_t& position, const int64_t& count, int64_t* numRead = NULL);
+        void writeAt(const void* dataIn, const int64_t& position, const int64_t& count);
         int64_t size();//may return -1 if size cannot be determined efficiently
+        const char* getMemoryMap() const;//start of the whole file mapped into memory, NULL if not mapped (only READ mode on uncompressed files can be mapped)
         class ImplInterface
         {
+            CaretMutex m_positionMutex;//for the default readAt/writeAt, which need the shared file position
         protected:
             QString m_fileName;//filename is tracked here so error messages can be implementation-specific
         public:
@@ -69,6 +75,9 @@ namespace caret {
             virtual int64_t size() = 0;
             virtual void read(void* dataOut, const int64_t& count, int64_t* numRead) = 0;
             virtual void write(const void* dataIn, const int64_t& count) = 0;
+            virtual void readAt(void* dataOut, const int64_t& position, const int64_t& count, int64_t* numRead);//override if the implementation can avoid the lock
+            virtual void writeAt(const void* dataIn, const int64_t& position, const int64_t& count);
+            virtual const char* getMemoryMap() const { return NULL; }
             virtual ~ImplInterface();
         };
     private:
@@ -28,6 +28,173 @@
 using namespace caret;
 using namespace std;
 
+namespace
+{
+    const int EVAL_BLOCK_SIZE = 256;//elements per register in evaluateRow, small enough that all registers stay in L1
+    
+    double evalFunction(const MathFunctionEnum::Enum& function, const double* args, const int& numArgs)
+    {
+        double ret = 0.0;
+        switch (function)//this could be (partly) moved into MathFunctionEnum, but it wouldn't strictly be an enum class then
+        {
+            case MathFunctionEnum::SIN:
+                CaretAssert(numArgs == 1);
+                ret = sin(args[0]);
+                break;
+            case MathFunctionEnum::COS:
+                CaretAssert(numArgs == 1);
+                ret = cos(args[0]);
+                break;
+            case MathFunctionEnum::TAN:
+                CaretAssert(numArgs == 1);
+                ret = tan(args[0]);
+                break;
+            case MathFunctionEnum::ASIN:
+                CaretAssert(numArgs == 1);
+                ret = asin(args[0]);
+                break;
+            case MathFunctionEnum::ACOS:
+                CaretAssert(numArgs == 1);
+                ret = acos(args[0]);
+                break;
+            case MathFunctionEnum::ATAN:
+                CaretAssert(numArgs == 1);
+                ret = atan(args[0]);
+                break;
+            case MathFunctionEnum::SINH:
+                CaretAssert(numArgs == 1);
+                ret = sinh(args[0]);
+                break;
+            case MathFunctionEnum::COSH:
+                CaretAssert(numArgs == 1);
+                ret = cosh(args[0]);
+                break;
+            case MathFunctionEnum::TANH:
+                CaretAssert(numArgs == 1);
+                ret = tanh(args[0]);
+                break;
+            case MathFunctionEnum::ASINH:
+            {
+                CaretAssert(numArgs == 1);
+                //ret = asinh(args[0]);//will work, and be preferred, when we use c++11, but doesn't work on windows with previous standard
+                double arg = args[0];
+                if (arg > 0)
+                {
+                    ret = log(arg + sqrt(arg * arg + 1));
+                } else {
+                    ret = -log(-arg + sqrt(arg * arg + 1));//special case negative for stability in large negatives
+                }
+                break;
+            }
+            case MathFunctionEnum::ACOSH:
+            {
+                CaretAssert(numArgs == 1);
+                //ret = acosh(args[0]);
+                double arg = args[0];
+                ret = log(arg + sqrt(arg * arg - 1));
+                break;
+            }
+            case MathFunctionEnum::ATANH:
+            {
+                CaretAssert(numArgs == 1);
+                //ret = atanh(args[0]);
+                double arg = args[0];
+                ret = 0.5 * log((1 + arg) / (1 - arg));
+                break;
+            }
+            case MathFunctionEnum::LN:
+                CaretAssert(numArgs == 1);
+                ret = log(args[0]);
+                break;
+            case MathFunctionEnum::EXP:
+                CaretAssert(numArgs == 1);
+                ret = exp(args[0]);
+                break;
+            case MathFunctionEnum::LOG:
+                CaretAssert(numArgs == 1);
+                ret = log10(args[0]);
+                break;
+            case MathFunctionEnum::LOG2:
+                CaretAssert(numArgs == 1);
+                ret = log2(args[0]);
+                break;
+            case MathFunctionEnum::SQRT:
+                CaretAssert(numArgs == 1);
+                ret = sqrt(args[0]);
+                break;
+            case MathFunctionEnum::ABS:
+                CaretAssert(numArgs == 1);
+                ret = abs(args[0]);
+                break;
+            case MathFunctionEnum::FLOOR:
+                CaretAssert(numArgs == 1);
+                ret = floor(args[0]);
+                break;
+            case MathFunctionEnum::ROUND:
+            {
+                CaretAssert(numArgs == 1);
+                double temp = args[0];//windows doesn't use c99 when compiling c++ earlier than c++11, so implement manually
+                if (temp > 0.0)
+                {
+                    ret = floor(temp + 0.5);
+                } else {
+                    ret = ceil(temp - 0.5);
+                }
+                break;
+            }
+            case MathFunctionEnum::CEIL:
+                CaretAssert(numArgs == 1);
+                ret = ceil(args[0]);
+                break;
+            case MathFunctionEnum::ATAN2:
+                CaretAssert(numArgs == 2);
+                ret = atan2(args[0], args[1]);
+                break;
+            case MathFunctionEnum::MIN:
+                CaretAssert(numArgs == 2);
+                ret = args[0];
+                if (ret > args[1]) ret = args[1];
+                break;
+            case MathFunctionEnum::MAX:
+                CaretAssert(numArgs == 2);
+                ret = args[0];
+                if (ret < args[1]) ret = args[1];
+                break;
+            case MathFunctionEnum::MOD:
+            {
+                CaretAssert(numArgs == 2);
+                double second = args[1];
+                if (second == 0.0)
+                {
+                    ret = 0.0;
+                } else {
+                    double first = args[0];
+                    ret = first - second * floor(first / second);
+                }
+                break;
+            }
+            case MathFunctionEnum::CLAMP:
+            {
+                CaretAssert(numArgs == 3);
+                ret = args[0];
+                if (ret < args[1])
+                {
+                    ret = args[1];
+                }
+                if (ret > args[2])
+                {
+                    ret = args[2];
+                }
+                break;
+            }
+            case MathFunctionEnum::INVALID:
+                CaretAssertMessage(0, "MathNode is type FUNC but INVALID function");
+                throw CaretException("parsing problem in CaretMathExpression");
+        }
+        return ret;
+    }
+}
+
 CaretMathExpression::CaretMathExpression(const AString& expression)
 {
     m_input = expression;
@@ -38,6 +205,7 @@ CaretMathExpression::CaretMathExpression(const AString& expression)
     {
         throw CaretException("extra characters on end of expression input: '" + m_input.mid(m_position) + "'");
     }
+    compile();
     CaretLogFiner("parsed '" + expression + "' as '" + toString() + "'");
 }
 
@@ -47,6 +215,259 @@ double CaretMathExpression::evaluate(const vector<float>& variableValues) const
     return m_root->eval(variableValues);
 }
 
+void CaretMathExpression::evaluateRow(const vector<const float*>& variableRows, float* output, const int64_t& count) const
+{
+    CaretAssert(variableRows.size() == m_varNames.size());
+    const int numConsts = (int)m_constants.size();
+    vector<double> registers((m_numTemps + numConsts) * EVAL_BLOCK_SIZE);//local, so that multiple threads can evaluate with the same expression
+    for (int c = 0; c < numConsts; ++c)
+    {
+        double* reg = registers.data() + (m_numTemps + c) * EVAL_BLOCK_SIZE;
+        for (int i = 0; i < EVAL_BLOCK_SIZE; ++i)
+        {
+            reg[i] = m_constants[c];
+        }
+    }
+    const int numInstructions = (int)m_program.size();
+    for (int64_t start = 0; start < count; start += EVAL_BLOCK_SIZE)
+    {
+        const int blockSize = (int)min((int64_t)EVAL_BLOCK_SIZE, count - start);
+        for (int inst = 0; inst < numInstructions; ++inst)
+        {
+            const Instruction& myInst = m_program[inst];
+            double* dest = registers.data() + myInst.m_dest * EVAL_BLOCK_SIZE;
+            if (myInst.m_op == Instruction::LOAD_VAR)
+            {
+                CaretAssertVectorIndex(variableRows, myInst.m_args[0]);
+                const float* varRow = variableRows[myInst.m_args[0]] + start;
+                for (int i = 0; i < blockSize; ++i)
+                {
+                    dest[i] = varRow[i];
+                }
+                continue;
+            }
+            const double* arg = registers.data() + myInst.m_args[0] * EVAL_BLOCK_SIZE;
+            switch (myInst.m_op)//simple loops over the block, so the compiler can vectorize the common operations
+            {
+                case Instruction::LOAD_VAR:
+                    CaretAssert(false);
+                    break;
+                case Instruction::COPY:
+                    for (int i = 0; i < blockSize; ++i) dest[i] = arg[i];
+                    break;
+                case Instruction::OR:
+                    for (int i = 0; i < blockSize; ++i) dest[i] = (dest[i] > 0.0 || arg[i] > 0.0) ? 1.0 : 0.0;
+                    break;
+                case Instruction::AND:
+                    for (int i = 0; i < blockSize; ++i) dest[i] = (dest[i] > 0.0 && arg[i] > 0.0) ? 1.0 : 0.0;
+                    break;
+                case Instruction::EQUAL:
+                case Instruction::NOT_EQUAL:
+                {
+                    const double equalVal = (myInst.m_op == Instruction::EQUAL ? 1.0 : 0.0);
+                    for (int i = 0; i < blockSize; ++i)
+                    {
+                        float adjust = min(abs(dest[i]), abs(arg[i])) / 1000000;//same fudge factor as in eval()
+                        bool equal = (dest[i] >= arg[i] - adjust) && (dest[i] <= arg[i] + adjust);
+                        dest[i] = equal ? equalVal : 1.0 - equalVal;
+                    }
+                    break;
+                }
+                case Instruction::GREATER:
+                    for (int i = 0; i < blockSize; ++i) dest[i] = (dest[i] > arg[i] ? 1.0 : 0.0);
+                    break;
+                case Instruction::LESS:
+                    for (int i = 0; i < blockSize; ++i) dest[i] = (dest[i] < arg[i] ? 1.0 : 0.0);
+                    break;
+                case Instruction::GREATER_EQUAL:
+                    for (int i = 0; i < blockSize; ++i)
+                    {
+                        float adjust = min(abs(dest[i]), abs(arg[i])) / 1000000;
+                        dest[i] = (dest[i] >= arg[i] - adjust ? 1.0 : 0.0);
+                    }
+                    break;
+                case Instruction::LESS_EQUAL:
+                    for (int i = 0; i < blockSize; ++i)
+                    {
+                        float adjust = min(abs(dest[i]), abs(arg[i])) / 1000000;
+                        dest[i] = (dest[i] <= arg[i] + adjust ? 1.0 : 0.0);
+                    }
+                    break;
+                case Instruction::ADD:
+                    for (int i = 0; i < blockSize; ++i) dest[i] += arg[i];
+                    break;
+                case Instruction::SUB:
+                    for (int i = 0; i < blockSize; ++i) dest[i] -= arg[i];
+                    break;
+                case Instruction::MULT:
+                    for (int i = 0; i < blockSize; ++i) dest[i] *= arg[i];
+                    break;
+                case Instruction::DIV:
+                    for (int i = 0; i < blockSize; ++i) dest[i] /= arg[i];
+                    break;
+                case Instruction::NOT:
+                    for (int i = 0; i < blockSize; ++i) dest[i] = (dest[i] > 0.0 ? 0.0 : 1.0);
+                    break;
+                case Instruction::NEGATE:
+                    for (int i = 0; i < blockSize; ++i) dest[i] = -dest[i];
+                    break;
+                case Instruction::POW:
+                    for (int i = 0; i < blockSize; ++i) dest[i] = pow(dest[i], arg[i]);
+                    break;
+                case Instruction::FUNC:
+                {
+                    const double* arg2 = registers.data() + myInst.m_args[1] * EVAL_BLOCK_SIZE;
+                    double args[3];
+                    switch (myInst.m_function)
+                    {
+                        case MathFunctionEnum::ABS:
+                            for (int i = 0; i < blockSize; ++i) dest[i] = abs(dest[i]);
+                            break;
+                        case MathFunctionEnum::SQRT:
+                            for (int i = 0; i < blockSize; ++i) dest[i] = sqrt(dest[i]);
+                            break;
+                        case MathFunctionEnum::MIN:
+                            for (int i = 0; i < blockSize; ++i) if (dest[i] > arg[i]) dest[i] = arg[i];
+                            break;
+                        case MathFunctionEnum::MAX:
+                            for (int i = 0; i < blockSize; ++i) if (dest[i] < arg[i]) dest[i] = arg[i];
+                            break;
+                        default:
+                            for (int i = 0; i < blockSize; ++i)
+                            {
+                                args[0] = dest[i];
+                                args[1] = arg[i];
+                                args[2] = arg2[i];
+                                dest[i] = evalFunction(myInst.m_function, args, myInst.m_numArgs);
+                            }
+                            break;
+                    }
+                    break;
+                }
+            }
+        }
+        const double* result = registers.data() + m_resultReg * EVAL_BLOCK_SIZE;
+        for (int i = 0; i < blockSize; ++i)
+        {
+            output[start + i] = (float)result[i];
+        }
+    }
+}
+
+void CaretMathExpression::compile()
+{
+    m_program.clear();
+    m_constants.clear();
+    m_numTemps = 1;
+    m_resultReg = compileNode(m_root, 0);
+    const int numConsts = (int)m_constants.size();//now that we know how many temporaries there are, put the constants after them
+    for (int i = 0; i < (int)m_program.size(); ++i)
+    {
+        Instruction& myInst = m_program[i];
+        if (myInst.m_op == Instruction::LOAD_VAR) continue;//arg is a variable index, not a register
+        for (int j = 0; j < 2; ++j)
+        {
+            if (myInst.m_args[j] < 0) myInst.m_args[j] = m_numTemps - myInst.m_args[j] - 1;
+            CaretAssert(myInst.m_args[j] < m_numTemps + numConsts);
+        }
+    }
+    if (m_resultReg < 0) m_resultReg = m_numTemps - m_resultReg - 1;
+}
+
+int CaretMathExpression::compileNode(const MathNode* node, const int& dest)
+{//returns the register that holds the result, which is dest unless the node folded to a constant - constants are negative until compile() renumbers them
+    if (!node->usesVariables())
+    {
+        m_constants.push_back(node->eval(vector<float>()));
+        return -(int)m_constants.size();
+    }
+    if (dest >= m_numTemps) m_numTemps = dest + 1;
+    const int numArgs = (int)node->m_arguments.size();
+    switch (node->m_type)
+    {
+        case MathNode::VAR:
+            m_program.push_back(Instruction(Instruction::LOAD_VAR, dest, node->m_varIndex));
+            return dest;
+        case MathNode::OR:
+        case MathNode::AND:
+        case MathNode::EQUAL:
+        case MathNode::GREATERLESS:
+        case MathNode::ADDSUB:
+        case MathNode::MULTDIV:
+        {
+            CaretAssert(numArgs > 1);
+            int first = compileNode(node->m_arguments[0], dest);
+            if (first != dest) m_program.push_back(Instruction(Instruction::COPY, dest, first));
+            for (int i = 1; i < numArgs; ++i)
+            {
+                int argReg = compileNode(node->m_arguments[i], dest + 1);
+                Instruction::OpCode op = Instruction::COPY;
+                switch (node->m_type)
+                {
+                    case MathNode::OR:
+                        op = Instruction::OR;
+                        break;
+                    case MathNode::AND:
+                        op = Instruction::AND;
+                        break;
+                    case MathNode::EQUAL:
+                        op = (node->m_invert[i] ? Instruction::NOT_EQUAL : Instruction::EQUAL);
+                        break;
+                    case MathNode::GREATERLESS:
+                        if (node->m_inclusive[i])
+                        {
+                            op = (node->m_invert[i] ? Instruction::LESS_EQUAL : Instruction::GREATER_EQUAL);
+                        } else {
+                            op = (node->m_invert[i] ? Instruction::LESS : Instruction::GREATER);
+                        }
+                        break;
+                    case MathNode::ADDSUB:
+                        op = (node->m_invert[i] ? Instruction::SUB : Instruction::ADD);
+                        break;
+                    case MathNode::MULTDIV:
+                        op = (node->m_invert[i] ? Instruction::DIV : Instruction::MULT);
+                        break;
+                    default:
+                        CaretAssert(false);
+                }
+                m_program.push_back(Instruction(op, dest, argReg));
+            }
+            return dest;
+        }
+        case MathNode::NOT:
+        case MathNode::NEGATE:
+        {
+            CaretAssert(numArgs == 1);
+            int first = compileNode(node->m_arguments[0], dest);
+            if (first != dest) m_program.push_back(Instruction(Instruction::COPY, dest, first));//can't happen, it would have been folded, but hey
+            m_program.push_back(Instruction(node->m_type == MathNode::NOT ? Instruction::NOT : Instruction::NEGATE, dest));
+            return dest;
+        }
+        case MathNode::POW:
+        case MathNode::FUNC:
+        {
+            CaretAssert(numArgs > 0 && numArgs <= 3);
+            int argRegs[3] = { dest, 0, 0 };
+            int first = compileNode(node->m_arguments[0], dest);
+            if (first != dest) m_program.push_back(Instruction(Instruction::COPY, dest, first));
+            for (int i = 1; i < numArgs; ++i)
+            {
+                argRegs[i] = compileNode(node->m_arguments[i], dest + i);//earlier results are in lower registers, so they are safe
+            }
+            Instruction myInst(node->m_type == MathNode::POW ? Instruction::POW : Instruction::FUNC, dest, argRegs[1], argRegs[2]);
+            myInst.m_function = node->m_function;
+            myInst.m_numArgs = numArgs;
+            m_program.push_back(myInst);
+            return dest;
+        }
+        case MathNode::CONST:
+        case MathNode::INVALID:
+            break;
+    }
+    CaretAssertMessage(0, "parsing left INVALID MathNode");
+    throw CaretException("parsing problem in CaretMathExpression");
+}
+
 vector<AString> CaretMathExpression::getVarNames() const
 {
     vector<AString> ret(m_varNames.size());
@@ -216,170 +637,14 @@ double CaretMathExpression::MathNode::eval(const vector<float>& values) const
         }
         case FUNC:
         {
-            switch (m_function)//this could be (partly) moved into MathFunctionEnum, but it wouldn't strictly be an enum class then
+            int end = (int)m_arguments.size();
+            CaretAssert(end <= 3);
+            double args[3];
+            for (int i = 0; i < end; ++i)
             {
-                case MathFunctionEnum::SIN:
-                    CaretAssert(m_arguments.size() == 1);
-                    ret = sin(m_arguments[0]->eval(values));
-                    break;
-                case MathFunctionEnum::COS:
-                    CaretAssert(m_arguments.size() == 1);
-                    ret = cos(m_arguments[0]->eval(values));
-                    break;
-                case MathFunctionEnum::TAN:
-                    CaretAssert(m_arguments.size() == 1);
-                    ret = tan(m_arguments[0]->eval(values));
-                    break;
-                case MathFunctionEnum::ASIN:
-                    CaretAssert(m_arguments.size() == 1);
-                    ret = asin(m_arguments[0]->eval(values));
-                    break;
-                case MathFunctionEnum::ACOS:
-                    CaretAssert(m_arguments.size() == 1);
-                    ret = acos(m_arguments[0]->eval(values));
-                    break;
-                case MathFunctionEnum::ATAN:
-                    CaretAssert(m_arguments.size() == 1);
-                    ret = atan(m_arguments[0]->eval(values));
-                    break;
-                case MathFunctionEnum::SINH:
-                    CaretAssert(m_arguments.size() == 1);
-                    ret = sinh(m_arguments[0]->eval(values));
-                    break;
-                case MathFunctionEnum::COSH:
-                    CaretAssert(m_arguments.size() == 1);
-                    ret = cosh(m_arguments[0]->eval(values));
-                    break;
-                case MathFunctionEnum::TANH:
-                    CaretAssert(m_arguments.size() == 1);
-                    ret = tanh(m_arguments[0]->eval(values));
-                    break;
-                case MathFunctionEnum::ASINH:
-                {
-                    CaretAssert(m_arguments.size() == 1);
-                    //ret = asinh(m_arguments[0].eval(values));//will work, and be preferred, when we use c++11, but doesn't work on windows with previous standard
-                    double arg = m_arguments[0]->eval(values);
-                    if (arg > 0)
-                    {
-                        ret = log(arg + sqrt(arg * arg + 1));
-                    } else {
-                        ret = -log(-arg + sqrt(arg * arg + 1));//special case negative for stability in large negatives
-                    }
-                    break;
-                }
-                case MathFunctionEnum::ACOSH:
-                {
-                    CaretAssert(m_arguments.size() == 1);
-                    //ret = acosh(m_arguments[0].eval(values));
-                    double arg = m_arguments[0]->eval(values);
-                    ret = log(arg + sqrt(arg * arg - 1));
-                    break;
-                }
-                case MathFunctionEnum::ATANH:
-                {
-                    CaretAssert(m_arguments.size() == 1);
-                    //ret = atanh(m_arguments[0].eval(values));
-                    double arg = m_arguments[0]->eval(values);
-                    ret = 0.5 * log((1 + arg) / (1 - arg));
-                    break;
-                }
-                case MathFunctionEnum::LN:
-                    CaretAssert(m_arguments.size() == 1);
-                    ret = log(m_arguments[0]->eval(values));
-                    break;
-                case MathFunctionEnum::EXP:
-                    CaretAssert(m_arguments.size() == 1);
-                    ret = exp(m_arguments[0]->eval(values));
-                    break;
-                case MathFunctionEnum::LOG:
-                    CaretAssert(m_arguments.size() == 1);
-                    ret = log10(m_arguments[0]->eval(values));
-                    break;
-                case MathFunctionEnum::LOG2:
-                    CaretAssert(m_arguments.size() == 1);
-                    ret = log2(m_arguments[0]->eval(values));
-                    break;
-                case MathFunctionEnum::SQRT:
-                    CaretAssert(m_arguments.size() == 1);
-                    ret = sqrt(m_arguments[0]->eval(values));
-                    break;
-                case MathFunctionEnum::ABS:
-                    CaretAssert(m_arguments.size() == 1);
-                    ret = abs(m_arguments[0]->eval(values));
-                    break;
-                case MathFunctionEnum::FLOOR:
-                    CaretAssert(m_arguments.size() == 1);
-                    ret = floor(m_arguments[0]->eval(values));
-                    break;
-                case MathFunctionEnum::ROUND:
-                {
-                    CaretAssert(m_arguments.size() == 1);
-                    double temp = m_arguments[0]->eval(values);//windows doesn't use c99 when compiling c++ earlier than c++11, so implement manually
-                    if (temp > 0.0)
-                    {
-                        ret = floor(temp + 0.5);
-                    } else {
-                        ret = ceil(temp - 0.5);
-                    }
-                    break;
-                }
-                case MathFunctionEnum::CEIL:
-                    CaretAssert(m_arguments.size() == 1);
-                    ret = ceil(m_arguments[0]->eval(values));
-                    break;
-                case MathFunctionEnum::ATAN2:
-                    CaretAssert(m_arguments.size() == 2);
-                    ret = atan2(m_arguments[0]->eval(values), m_arguments[1]->eval(values));
-                    break;
-                case MathFunctionEnum::MIN:
-                {
-                    CaretAssert(m_arguments.size() == 2);
-                    ret = m_arguments[0]->eval(values);
-                    double other = m_arguments[1]->eval(values);
-                    if (ret > other) ret = other;
-                    break;
-                }
-                case MathFunctionEnum::MAX:
-                {
-                    CaretAssert(m_arguments.size() == 2);
-                    ret = m_arguments[0]->eval(values);
-                    double other = m_arguments[1]->eval(values);
-                    if (ret < other) ret = other;
-                    break;
-                }
-                case MathFunctionEnum::MOD:
-                {
-                    CaretAssert(m_arguments.size() == 2);
-                    double second = m_arguments[1]->eval(values);
-                    if (second == 0.0)
-                    {
-                        ret = 0.0;
-                    } else {
-                        double first = m_arguments[0]->eval(values);
-                        ret = first - second * floor(first / second);
-                    }
-                    break;
-                }
-                case MathFunctionEnum::CLAMP:
-                {
-                    CaretAssert(m_arguments.size() == 3);
-                    ret = m_arguments[0]->eval(values);
-                    double low = m_arguments[1]->eval(values);
-                    double high = m_arguments[2]->eval(values);
-                    if (ret < low)
-                    {
-                        ret = low;
-                    }
-                    if (ret > high)
-                    {
-                        ret = high;
-                    }
-                    break;
-                }
-                case MathFunctionEnum::INVALID:
-                    CaretAssertMessage(0, "MathNode is type FUNC but INVALID function");
-                    throw CaretException("parsing problem in CaretMathExpression");
+                args[i] = m_arguments[i]->eval(values);
             }
+            ret = evalFunction(m_function, args, end);
             break;
         }
         case VAR:
@@ -396,6 +661,16 @@ double CaretMathExpression::MathNode::eval(const vector<float>& values) const
     return ret;
 }
 
+bool CaretMathExpression::MathNode::usesVariables() const
+{
+    if (m_type == VAR) return true;
+    for (int i = 0; i < (int)m_arguments.size(); ++i)
+    {
+        if (m_arguments[i]->usesVariables()) return true;
+    }
+    return false;
+}
+
 AString CaretMathExpression::MathNode::toString(const std::vector<AString>& varNames) const
 {
     AString ret = "";
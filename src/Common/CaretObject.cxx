@@ -25,10 +25,23 @@
 #include "CaretObject.h"
 #undef __CARET_OBJECT_DECLARE_H__
 
+#include "CaretMutex.h"
 #include "SystemUtilities.h"
 
 using namespace caret;
 
+#ifndef NDEBUG
+namespace
+{
+    ///objects may be created on worker threads (for instance, while files are read concurrently)
+    CaretMutex& getAllocatedObjectsMutex()
+    {
+        static CaretMutex theMutex;
+        return theMutex;
+    }
+}
+#endif
+
 /**
  * Constructor.
  *
@@ -58,7 +71,11 @@ CaretObject::~CaretObject()
      * Erase returns the number of objects deleted.
      * If zero, then the object has already been deleted.
      */
-    uint64_t numDeleted = CaretObject::allocatedObjects.erase(this);
+    uint64_t numDeleted = 0;
+    {
+        CaretMutexLocker locked(&getAllocatedObjectsMutex());
+        numDeleted = CaretObject::allocatedObjects.erase(this);
+    }
     if (numDeleted <= 0) {
         std::cerr << "Destructor for a CaretObject called but the object is not allocated "
                   << "and this implies that the object has already been deleted.";
@@ -81,6 +98,7 @@ CaretObject::initializeMembersCaretObject()
 #ifndef NDEBUG
     SystemBacktrace myBacktrace;
     SystemUtilities::getBackTrace(myBacktrace);
+    CaretMutexLocker locked(&getAllocatedObjectsMutex());
     CaretObject::allocatedObjects.insert(
                std::make_pair(this,
                               myBacktrace));
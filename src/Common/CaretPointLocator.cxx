@@ -19,395 +19,322 @@
 /*LICENSE_END*/
 
 #include "CaretPointLocator.h"
-#include "CaretHeap.h"
+
+#include "CaretOMP.h"
+
+#include <algorithm>
 #include <cmath>
+#include <limits>
 
 using namespace caret;
 using namespace std;
 
-void CaretPointLocator::addPoint(Oct<LeafVector<Point> >* thisOct, const float point[3], const int64_t index, const int32_t pointSet)
+namespace
 {
-    if (thisOct->m_leaf)
+    struct AxisCompare
+    {//orders tree positions by one coordinate while building
+        const float* m_axisCoords;
+        AxisCompare(const float* axisCoords) : m_axisCoords(axisCoords) { }
+        bool operator()(const int64_t& left, const int64_t& right) const { return m_axisCoords[left] < m_axisCoords[right]; }
+    };
+}
+
+CaretPointLocator::CaretPointLocator(const float* coordsIn, const int64_t numCoords)
+{
+    m_nextSetIndex = 1;//next set will be set #1
+    if (numCoords >= 1)
     {
-        thisOct->m_data.m_vector->push_back(Point(point, index, pointSet));
-        int curSize = (int)thisOct->m_data.m_vector->size();
-        if (curSize > NUM_POINTS_SPLIT)
-        {//test that not all points are the same, or that they have some minimum percentage spread, or...
-            vector<Point>& myVecRef = *(thisOct->m_data.m_vector);
-            Vector3D minBox = myVecRef[0].m_point, maxBox = myVecRef[0].m_point, tempvec;
-            tempvec[0] = thisOct->m_bounds[0][2] - thisOct->m_bounds[0][0];
-            tempvec[1] = thisOct->m_bounds[1][2] - thisOct->m_bounds[1][0];
-            tempvec[2] = thisOct->m_bounds[2][2] - thisOct->m_bounds[2][0];
-            float diagonal = tempvec.length();
-            bool safeToSplit = false;
-            for (int i = 1; i < curSize; ++i)
-            {//this will slow down if lots of stuff is continuously put in an Oct that is far too big - use random sampling?
-                if (myVecRef[i].m_point[0] < minBox[0]) minBox[0] = myVecRef[i].m_point[0];
-                if (myVecRef[i].m_point[1] < minBox[1]) minBox[1] = myVecRef[i].m_point[1];
-                if (myVecRef[i].m_point[2] < minBox[2]) minBox[2] = myVecRef[i].m_point[2];
-                if (myVecRef[i].m_point[0] > maxBox[0]) maxBox[0] = myVecRef[i].m_point[0];
-                if (myVecRef[i].m_point[1] > maxBox[1]) maxBox[1] = myVecRef[i].m_point[1];
-                if (myVecRef[i].m_point[2] > maxBox[2]) maxBox[2] = myVecRef[i].m_point[2];
-                tempvec = minBox - maxBox;
-                if (tempvec.length() > 0.01f * diagonal)//make sure points aren't all identical, would go to infinity recursively
-                {
-                    safeToSplit = true;
-                    break;
-                }
-            }
-            if (safeToSplit)
-            {
-                thisOct->makeChildren();
-                for (int i = 0; i < curSize; ++i)
-                {
-                    addPoint(thisOct->containingChild(myVecRef[i].m_point), myVecRef[i].m_point, myVecRef[i].m_index, myVecRef[i].m_mySet);
-                }
-                thisOct->m_data.freeData();
-            }
-        }
-    } else {
-        addPoint(thisOct->containingChild(point), point, index, pointSet);
+        appendPoints(coordsIn, numCoords, 0);//this is set #0
+        buildTree();
     }
 }
 
+CaretPointLocator::CaretPointLocator(const float[3], const float[3])
+{
+    m_nextSetIndex = 0;
+}
+
 int32_t CaretPointLocator::addPointSet(const float* coordsIn, const int64_t numCoords)
 {
     CaretMutexLocker locked(&m_modifyMutex);
     int32_t setNum = newIndex();
     if (numCoords < 1) return setNum;
-    if (m_tree == NULL)
+    appendPoints(coordsIn, numCoords, setNum);
+    buildTree();
+    return setNum;
+}
+
+void CaretPointLocator::removePointSet(int32_t whichSet)
+{
+    CaretMutexLocker locked(&m_modifyMutex);
+    m_unusedIndexes.push_back(whichSet);
+    int64_t numPoints = (int64_t)m_indices.size(), kept = 0;
+    for (int64_t i = 0; i < numPoints; ++i)
     {
-        Vector3D minBox, maxBox;
-        minBox = maxBox = coordsIn;//hack - first triple
-        for (int64_t i = 1; i < numCoords; ++i)
+        if (m_sets[i] != whichSet)
         {
-            int64_t i3 = i * 3;
-            if (coordsIn[i3] < minBox[0]) minBox[0] = coordsIn[i3];
-            if (coordsIn[i3 + 1] < minBox[1]) minBox[1] = coordsIn[i3 + 1];
-            if (coordsIn[i3 + 2] < minBox[2]) minBox[2] = coordsIn[i3 + 2];
-            if (coordsIn[i3] > maxBox[0]) maxBox[0] = coordsIn[i3];
-            if (coordsIn[i3 + 1] > maxBox[1]) maxBox[1] = coordsIn[i3 + 1];
-            if (coordsIn[i3 + 2] > maxBox[2]) maxBox[2] = coordsIn[i3 + 2];
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                m_coords[axis][kept] = m_coords[axis][i];
+            }
+            m_indices[kept] = m_indices[i];
+            m_sets[kept] = m_sets[i];
+            ++kept;
         }
-        m_tree = new Oct<LeafVector<Point> >(minBox, maxBox);
     }
-    for (int64_t i = 0; i < numCoords; ++i)
+    if (kept == numPoints) return;//nothing removed, tree is still valid
+    for (int axis = 0; axis < 3; ++axis)
     {
-        int64_t i3 = i * 3;
-        m_tree = m_tree->makeContains(coordsIn + i3);//make new root if needed
-        addPoint(m_tree, coordsIn + i3, i, setNum);//and add the point
+        m_coords[axis].resize(kept);
     }
-    return setNum;
+    m_indices.resize(kept);
+    m_sets.resize(kept);
+    buildTree();
 }
 
-CaretPointLocator::CaretPointLocator(const float* coordsIn, const int64_t numCoords)
+void CaretPointLocator::appendPoints(const float* coordsIn, const int64_t numCoords, const int32_t pointSet)
 {
-    m_nextSetIndex = 1;//next set will be set #1
-    m_tree = NULL;
-    if (numCoords >= 1)
+    int64_t oldSize = (int64_t)m_indices.size();
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        m_coords[axis].resize(oldSize + numCoords);
+    }
+    m_indices.resize(oldSize + numCoords);
+    m_sets.resize(oldSize + numCoords, pointSet);
+    for (int64_t i = 0; i < numCoords; ++i)
     {
-        Vector3D minBox, maxBox;
-        minBox = maxBox = coordsIn;//hack - first triple
-        for (int64_t i = 1; i < numCoords; ++i)
+        for (int axis = 0; axis < 3; ++axis)
         {
-            int64_t i3 = i * 3;
-            if (coordsIn[i3] < minBox[0]) minBox[0] = coordsIn[i3];
-            if (coordsIn[i3 + 1] < minBox[1]) minBox[1] = coordsIn[i3 + 1];
-            if (coordsIn[i3 + 2] < minBox[2]) minBox[2] = coordsIn[i3 + 2];
-            if (coordsIn[i3] > maxBox[0]) maxBox[0] = coordsIn[i3];
-            if (coordsIn[i3 + 1] > maxBox[1]) maxBox[1] = coordsIn[i3 + 1];
-            if (coordsIn[i3 + 2] > maxBox[2]) maxBox[2] = coordsIn[i3 + 2];
+            m_coords[axis][oldSize + i] = coordsIn[i * 3 + axis];
         }
-        m_tree = new Oct<LeafVector<Point> >(minBox, maxBox);
-        for (int64_t i = 0; i < numCoords; ++i)
+        m_indices[oldSize + i] = i;
+    }
+}
+
+void CaretPointLocator::buildTree()
+{//find the tree order of the current points, then put all arrays in that order
+    int64_t numPoints = (int64_t)m_indices.size();
+    vector<int64_t> order(numPoints);
+    for (int64_t i = 0; i < numPoints; ++i)
+    {
+        order[i] = i;
+    }
+    m_splitAxes.assign(numPoints, 0);
+    buildRange(order, 0, numPoints);
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        vector<float> temp(numPoints);
+        for (int64_t i = 0; i < numPoints; ++i)
         {
-            int64_t i3 = i * 3;
-            addPoint(m_tree, coordsIn + i3, i, 0);//this is set #0
+            temp[i] = m_coords[axis][order[i]];
         }
+        m_coords[axis].swap(temp);
+    }
+    vector<int64_t> tempIndices(numPoints);
+    vector<int32_t> tempSets(numPoints);
+    for (int64_t i = 0; i < numPoints; ++i)
+    {
+        tempIndices[i] = m_indices[order[i]];
+        tempSets[i] = m_sets[order[i]];
     }
+    m_indices.swap(tempIndices);
+    m_sets.swap(tempSets);
 }
 
-CaretPointLocator::CaretPointLocator(const float minBounds[3], const float maxBounds[3])
+void CaretPointLocator::buildRange(vector<int64_t>& order, const int64_t start, const int64_t end)
+{//order holds original positions, split each range along the axis where it is widest
+    if (end - start <= LEAF_SIZE) return;
+    float minBox[3], maxBox[3];
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        minBox[axis] = maxBox[axis] = m_coords[axis][order[start]];
+    }
+    for (int64_t i = start + 1; i < end; ++i)
+    {
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            float value = m_coords[axis][order[i]];
+            if (value < minBox[axis]) minBox[axis] = value;
+            if (value > maxBox[axis]) maxBox[axis] = value;
+        }
+    }
+    int splitAxis = 0;
+    for (int axis = 1; axis < 3; ++axis)
+    {
+        if (maxBox[axis] - minBox[axis] > maxBox[splitAxis] - minBox[splitAxis]) splitAxis = axis;
+    }
+    int64_t mid = (start + end) / 2;
+    nth_element(order.begin() + start, order.begin() + mid, order.begin() + end, AxisCompare(m_coords[splitAxis].data()));
+    m_splitAxes[mid] = (int8_t)splitAxis;
+    buildRange(order, start, mid);
+    buildRange(order, mid + 1, end);
+}
+
+float CaretPointLocator::distSquared(const int64_t position, const float target[3]) const
 {
-    m_nextSetIndex = 0;
-    m_tree = new Oct<LeafVector<Point> >(minBounds, maxBounds);
+    float dx = m_coords[0][position] - target[0];
+    float dy = m_coords[1][position] - target[1];
+    float dz = m_coords[2][position] - target[2];
+    return dx * dx + dy * dy + dz * dz;
 }
 
-int64_t CaretPointLocator::closestPoint(const float target[3], LocatorInfo* infoOut) const
+void CaretPointLocator::closestHelper(const int64_t start, const int64_t end, const float target[3], float& bestDist2, int64_t& bestPosition) const
 {
-    if (m_tree == NULL) return -1;
-    CaretSimpleMinHeap<Oct<LeafVector<Point> >*, float> myHeap;
-    bool first = true;
-    float bestDist2 = -1.0f, bestDist = -1.0f, tempf, curDist = m_tree->distToPoint(target);
-    Vector3D bestPoint;
-    int64_t bestIndex = -1;
-    int32_t bestSet = -1;
-    myHeap.push(m_tree, curDist);
-    while (curDist < bestDist || first)
+    if (end - start <= LEAF_SIZE)
     {
-        Oct<LeafVector<Point> >* thisOct = myHeap.pop();
-        if (thisOct->m_leaf)
+        for (int64_t i = start; i < end; ++i)
         {
-            vector<Point>& myVecRef = *(thisOct->m_data.m_vector);
-            int curSize = (int)myVecRef.size();
-            for (int i = 0; i < curSize; ++i)
+            float tempf = distSquared(i, target);
+            if (tempf < bestDist2)
             {
-                tempf = MathFunctions::distanceSquared3D(myVecRef[i].m_point, target);
-                if (tempf < bestDist2 || first)
-                {
-                    first = false;
-                    bestDist2 = tempf;
-                    bestPoint = myVecRef[i].m_point;
-                    bestSet = myVecRef[i].m_mySet;
-                    bestIndex = myVecRef[i].m_index;
-                }
-            }
-            bestDist = sqrt(bestDist2);
-        } else {
-            for (int ii = 0; ii < 2; ++ii)
-            {
-                for (int ij = 0; ij < 2; ++ij)
-                {
-                    for (int ik = 0; ik < 2; ++ik)
-                    {
-                        tempf = thisOct->m_children[ii][ij][ik]->distToPoint(target);
-                        if (tempf < bestDist || first)
-                        {
-                            myHeap.push(thisOct->m_children[ii][ij][ik], tempf);
-                        }
-                    }
-                }
+                bestDist2 = tempf;
+                bestPosition = i;
             }
         }
-        if (myHeap.isEmpty())
+        return;
+    }
+    int64_t mid = (start + end) / 2;
+    int axis = m_splitAxes[mid];
+    float tempf = distSquared(mid, target);
+    if (tempf < bestDist2)
+    {
+        bestDist2 = tempf;
+        bestPosition = mid;
+    }
+    float diff = target[axis] - m_coords[axis][mid];
+    if (diff < 0.0f)//search the side the target is on first, the other side only if the split plane is closer than the best so far
+    {
+        closestHelper(start, mid, target, bestDist2, bestPosition);
+        if (diff * diff < bestDist2) closestHelper(mid + 1, end, target, bestDist2, bestPosition);
+    } else {
+        closestHelper(mid + 1, end, target, bestDist2, bestPosition);
+        if (diff * diff < bestDist2) closestHelper(start, mid, target, bestDist2, bestPosition);
+    }
+}
+
+int64_t CaretPointLocator::findClosest(const float target[3], const float& maxDist, LocatorInfo* infoOut) const
+{//negative maxDist means unlimited
+    float bestDist2 = numeric_limits<float>::infinity();
+    if (maxDist >= 0.0f)
+    {
+        bestDist2 = nextafter(maxDist * maxDist, bestDist2);//so that a point exactly at maxDist is accepted by the strict comparisons
+    }
+    int64_t bestPosition = -1;
+    closestHelper(0, (int64_t)m_indices.size(), target, bestDist2, bestPosition);
+    if (bestPosition == -1)
+    {
+        if (infoOut != NULL)
         {
-            break;//allows us to use top() without violating an assertion
+            infoOut->whichSet = -1;
+            infoOut->index = -1;
         }
-        myHeap.top(&curDist);//get the key for the next item
+        return -1;
     }
     if (infoOut != NULL)
     {
-        infoOut->whichSet = bestSet;
-        infoOut->coords = bestPoint;
-        infoOut->index = bestIndex;
+        infoOut->whichSet = m_sets[bestPosition];
+        infoOut->index = m_indices[bestPosition];
+        infoOut->coords = Vector3D(m_coords[0][bestPosition], m_coords[1][bestPosition], m_coords[2][bestPosition]);
     }
-    return bestIndex;
+    return m_indices[bestPosition];
+}
+
+int64_t CaretPointLocator::closestPoint(const float target[3], LocatorInfo* infoOut) const
+{
+    return findClosest(target, -1.0f, infoOut);
 }
 
 int64_t CaretPointLocator::closestPointLimited(const float target[3], const float& maxDist, LocatorInfo* infoOut) const
 {
-    if (infoOut != NULL)
+    if (maxDist < 0.0f)
     {
-        infoOut->whichSet = -1;
-        infoOut->index = -1;
+        if (infoOut != NULL)
+        {
+            infoOut->whichSet = -1;
+            infoOut->index = -1;
+        }
+        return -1;
     }
-    if (m_tree == NULL) return -1;
-    float curDist2 = m_tree->distSquaredToPoint(target), maxDist2 = maxDist * maxDist;
-    if (curDist2 > maxDist2)
+    return findClosest(target, maxDist, infoOut);
+}
+
+void CaretPointLocator::closestPoints(const float* targets, const int64_t numTargets, int64_t* indicesOut, LocatorInfo* infoOut, const float& maxDist) const
+{
+#pragma omp CARET_PARFOR schedule(dynamic, 256)
+    for (int64_t i = 0; i < numTargets; ++i)
     {
-        return -1;
+        indicesOut[i] = findClosest(targets + i * 3, maxDist, (infoOut != NULL) ? infoOut + i : NULL);
     }
-    CaretSimpleMinHeap<Oct<LeafVector<Point> >*, float> myHeap;
-    bool first = true;
-    float bestDist2 = -1.0f, tempf;
-    Vector3D bestPoint;
-    int64_t bestIndex = -1;
-    int32_t bestSet = -1;
-    myHeap.push(m_tree, curDist2);
-    while (curDist2 < bestDist2 || first)
+}
+
+void CaretPointLocator::rangeHelper(const int64_t start, const int64_t end, const float target[3], const float& maxDist2, vector<LocatorInfo>& pointsOut) const
+{
+    if (end - start <= LEAF_SIZE)
     {
-        Oct<LeafVector<Point> >* thisOct = myHeap.pop();
-        if (thisOct->m_leaf)
+        for (int64_t i = start; i < end; ++i)
         {
-            vector<Point>& myVecRef = *(thisOct->m_data.m_vector);
-            int curSize = (int)myVecRef.size();
-            for (int i = 0; i < curSize; ++i)
+            if (distSquared(i, target) <= maxDist2)
             {
-                tempf = MathFunctions::distanceSquared3D(myVecRef[i].m_point, target);
-                if (tempf < bestDist2 || (first && tempf <= maxDist2))
-                {
-                    first = false;
-                    bestDist2 = tempf;
-                    bestPoint = myVecRef[i].m_point;
-                    bestSet = myVecRef[i].m_mySet;
-                    bestIndex = myVecRef[i].m_index;
-                }
+                pointsOut.push_back(LocatorInfo(m_indices[i], m_sets[i], Vector3D(m_coords[0][i], m_coords[1][i], m_coords[2][i])));
             }
-        } else {
-            for (int ii = 0; ii < 2; ++ii)
-            {
-                for (int ij = 0; ij < 2; ++ij)
-                {
-                    for (int ik = 0; ik < 2; ++ik)
-                    {
-                        tempf = thisOct->m_children[ii][ij][ik]->distSquaredToPoint(target);
-                        if (tempf < bestDist2 || (first && tempf <= maxDist2))
-                        {
-                            myHeap.push(thisOct->m_children[ii][ij][ik], tempf);
-                        }
-                    }
-                }
-            }
-        }
-        if (myHeap.isEmpty())
-        {
-            break;//allows us to use top() without violating an assertion
         }
-        myHeap.top(&curDist2);//get the key for the next item
+        return;
     }
-    if (infoOut != NULL)
+    int64_t mid = (start + end) / 2;
+    int axis = m_splitAxes[mid];
+    if (distSquared(mid, target) <= maxDist2)
     {
-        infoOut->whichSet = bestSet;
-        infoOut->coords = bestPoint;
-        infoOut->index = bestIndex;
+        pointsOut.push_back(LocatorInfo(m_indices[mid], m_sets[mid], Vector3D(m_coords[0][mid], m_coords[1][mid], m_coords[2][mid])));
     }
-    return bestIndex;
+    float diff = target[axis] - m_coords[axis][mid];
+    if (diff <= 0.0f || diff * diff <= maxDist2) rangeHelper(start, mid, target, maxDist2, pointsOut);
+    if (diff >= 0.0f || diff * diff <= maxDist2) rangeHelper(mid + 1, end, target, maxDist2, pointsOut);
 }
 
 vector<LocatorInfo> CaretPointLocator::pointsInRange(const float target[3], const float& maxDist) const
-{//each point occurs in only once in the tree, so we can use a vector
+{//each point occurs only once in the tree, so we can use a vector
     vector<LocatorInfo> ret;
-    if (m_tree == NULL) return ret;
-    float curDist2 = m_tree->distSquaredToPoint(target), maxDist2 = maxDist * maxDist;
-    if (curDist2 > maxDist2) return ret;
-    vector<Oct<LeafVector<Point> >*> myStack;//since we don't need the points sorted by distance
-    myStack.push_back(m_tree);
-    while (!myStack.empty())
-    {
-        Oct<LeafVector<Point> >* thisOct = myStack.back();
-        myStack.pop_back();
-        if (thisOct->m_leaf)
-        {
-            vector<Point>& myVecRef = *(thisOct->m_data.m_vector);
-            int curSize = (int)myVecRef.size();
-            for (int i = 0; i < curSize; ++i)
-            {
-                float tempf = MathFunctions::distanceSquared3D(myVecRef[i].m_point, target);
-                if (tempf <= maxDist2)
-                {
-                    ret.push_back(LocatorInfo(myVecRef[i].m_index, myVecRef[i].m_mySet, myVecRef[i].m_point));
-                }
-            }
-        } else {
-            for (int ii = 0; ii < 2; ++ii)
-            {
-                for (int ij = 0; ij < 2; ++ij)
-                {
-                    for (int ik = 0; ik < 2; ++ik)
-                    {
-                        float tempf = thisOct->m_children[ii][ij][ik]->distSquaredToPoint(target);
-                        if (tempf <= maxDist2)
-                        {
-                            myStack.push_back(thisOct->m_children[ii][ij][ik]);
-                        }
-                    }
-                }
-            }
-        }
-    }
+    rangeHelper(0, (int64_t)m_indices.size(), target, maxDist * maxDist, ret);
     return ret;
 }
 
-bool CaretPointLocator::anyInRange(const float target[3], const float& maxDist) const
+bool CaretPointLocator::anyHelper(const int64_t start, const int64_t end, const float target[3], const float& maxDist2) const
 {
-    if (m_tree == NULL) return false;
-    float curDist2 = m_tree->distSquaredToPoint(target), maxDist2 = maxDist * maxDist, tempf;
-    if (curDist2 > maxDist2) return false;
-    CaretSimpleMinHeap<Oct<LeafVector<Point> >*, float> myHeap;//closer octs are more likely to contain a close enough point
-    myHeap.push(m_tree, curDist2);
-    while (!myHeap.isEmpty())
+    if (end - start <= LEAF_SIZE)
     {
-        Oct<LeafVector<Point> >* thisOct = myHeap.pop(&curDist2);
-        if (thisOct->m_leaf)
+        for (int64_t i = start; i < end; ++i)
         {
-            vector<Point>& myVecRef = *(thisOct->m_data.m_vector);
-            int curSize = (int)myVecRef.size();
-            for (int i = 0; i < curSize; ++i)
-            {
-                tempf = MathFunctions::distanceSquared3D(myVecRef[i].m_point, target);
-                if (tempf < maxDist2)
-                {
-                    return true;
-                }
-            }
-        } else {
-            for (int ii = 0; ii < 2; ++ii)
-            {
-                for (int ij = 0; ij < 2; ++ij)
-                {
-                    for (int ik = 0; ik < 2; ++ik)
-                    {
-                        tempf = thisOct->m_children[ii][ij][ik]->distSquaredToPoint(target);
-                        if (tempf <= maxDist2)
-                        {
-                            myHeap.push(thisOct->m_children[ii][ij][ik], tempf);
-                        }
-                    }
-                }
-            }
+            if (distSquared(i, target) < maxDist2) return true;
         }
+        return false;
     }
-    return false;
-}
-
-int32_t CaretPointLocator::newIndex()
-{
-    if (m_unusedIndexes.empty())
+    int64_t mid = (start + end) / 2;
+    int axis = m_splitAxes[mid];
+    if (distSquared(mid, target) < maxDist2) return true;
+    float diff = target[axis] - m_coords[axis][mid];
+    if (diff < 0.0f)//closer side first, as it is more likely to contain a close enough point
     {
-        return m_nextSetIndex++;
+        if (anyHelper(start, mid, target, maxDist2)) return true;
+        return (diff * diff < maxDist2) && anyHelper(mid + 1, end, target, maxDist2);
     } else {
-        int32_t ret = m_unusedIndexes[m_unusedIndexes.size() - 1];
-        m_unusedIndexes.pop_back();
-        return ret;
+        if (anyHelper(mid + 1, end, target, maxDist2)) return true;
+        return (diff * diff < maxDist2) && anyHelper(start, mid, target, maxDist2);
     }
 }
 
-void CaretPointLocator::removePointSet(int32_t whichSet)
+bool CaretPointLocator::anyInRange(const float target[3], const float& maxDist) const
 {
-    CaretMutexLocker locked(&m_modifyMutex);
-    m_unusedIndexes.push_back(whichSet);
-    removeSetHelper(m_tree, whichSet);
+    return anyHelper(0, (int64_t)m_indices.size(), target, maxDist * maxDist);
 }
 
-void CaretPointLocator::removeSetHelper(Oct<LeafVector<CaretPointLocator::Point> >* thisOct, int32_t thisSet)
+int32_t CaretPointLocator::newIndex()
 {
-    if (thisOct == NULL) return;
-    if (thisOct->m_leaf)
+    if (m_unusedIndexes.empty())
     {
-        vector<Point>& myVecRef = *(thisOct->m_data.m_vector);
-        int curSize = (int)myVecRef.size();
-        bool match = false;
-        for (int i = 0; i < curSize; ++i)//make sure something gets removed, so we don't have to do an allocation if it isn't needed
-        {
-            if (myVecRef[i].m_mySet == thisSet)
-            {
-                match = true;
-                break;
-            }
-        }
-        if (match)
-        {
-            vector<Point> tempvec;
-            tempvec.reserve(curSize - 1);//because at least one is getting removed
-            for (int i = 0; i < curSize; ++i)
-            {
-                if (myVecRef[i].m_mySet != thisSet)
-                {
-                    tempvec.push_back(myVecRef[i]);
-                }
-            }
-            myVecRef = tempvec;
-        }
+        return m_nextSetIndex++;
     } else {
-        for (int ii = 0; ii < 2; ++ii)
-        {
-            for (int ij = 0; ij < 2; ++ij)
-            {
-                for (int ik = 0; ik < 2; ++ik)
-                {
-                    removeSetHelper(thisOct->m_children[ii][ij][ik], thisSet);
-                }
-            }
-        }
+        int32_t ret = m_unusedIndexes[m_unusedIndexes.size() - 1];
+        m_unusedIndexes.pop_back();
+        return ret;
     }
 }
@@ -23,7 +23,6 @@
 /*LICENSE_END*/
 
 #include "CaretMutex.h"
-#include "OctTree.h"
 #include "Vector3D.h"
 
 #include <set>
@@ -52,31 +51,30 @@ namespace caret {
     
     class CaretPointLocator
     {
-        struct Point
-        {
-            Vector3D m_point;
-            int64_t m_index;
-            int32_t m_mySet;
-            Point(const float point[3], const int64_t index, const int32_t mySet)
-            {
-                m_point = point;
-                m_index = index;
-                m_mySet = mySet;
-            }
-        };
         CaretMutex m_modifyMutex;//thread safety, don't let multiple threads modify the point sets at once
-        Oct<LeafVector<Point> >* m_tree;
+        //all point sets are in one flat k-d tree, which is rebuilt when a point set is added or removed
+        //the layout is implicit: the range [start, end) is split at the point at (start + end) / 2, the halves on either side are its children
+        std::vector<float> m_coords[3];//one array per axis, in tree order
+        std::vector<int64_t> m_indices;
+        std::vector<int32_t> m_sets;
+        std::vector<int8_t> m_splitAxes;//axis of the split, only meaningful at the middle of a range larger than LEAF_SIZE
         int32_t m_nextSetIndex;
         std::vector<int32_t> m_unusedIndexes;
-        void addPoint(Oct<LeafVector<Point> >* thisOct, const float point[3], const int64_t index, const int32_t pointSet);
+        static const int64_t LEAF_SIZE = 8;//ranges this small are scanned instead of split
         int32_t newIndex();
-        static const int NUM_POINTS_SPLIT = 100;
-        void removeSetHelper(Oct<LeafVector<Point> >* thisOct, const int32_t thisSet);
+        void appendPoints(const float* coordsIn, const int64_t numCoords, const int32_t pointSet);
+        void buildTree();
+        void buildRange(std::vector<int64_t>& order, const int64_t start, const int64_t end);
+        float distSquared(const int64_t position, const float target[3]) const;
+        void closestHelper(const int64_t start, const int64_t end, const float target[3], float& bestDist2, int64_t& bestPosition) const;
+        void rangeHelper(const int64_t start, const int64_t end, const float target[3], const float& maxDist2, std::vector<LocatorInfo>& pointsOut) const;
+        bool anyHelper(const int64_t start, const int64_t end, const float target[3], const float& maxDist2) const;
+        int64_t findClosest(const float target[3], const float& maxDist, LocatorInfo* infoOut) const;
         CaretPointLocator();
     public:
-        ///make an empty point locator with given bounding box (bounding box can expand later, but may be less efficient
+        ///make an empty point locator, the bounds are not needed (kept for compatibility)
         CaretPointLocator(const float minBounds[3], const float maxBounds[3]);
-        ///make a point locator with the bounding box of this point set, and use this point set as set #0
+        ///make a point locator containing this point set as set #0
         CaretPointLocator(const float* coordsIn, const int64_t numCoords);
         ///convenience constructor for vectors
         CaretPointLocator(const std::vector<float> coordsIn) : CaretPointLocator(coordsIn.data(), coordsIn.size() / 3) { }
@@ -88,6 +86,8 @@ namespace caret {
         ///returns the index of the closest point, and optionally which point set and the coords
         int64_t closestPoint(const float target[3], LocatorInfo* infoOut = NULL) const;
         int64_t closestPointLimited(const float target[3], const float& maxDist, LocatorInfo* infoOut = NULL) const;
+        ///closest point for each of numTargets xyz triples, in parallel - indices are -1 where nothing is within maxDist (if not negative), infoOut is optional
+        void closestPoints(const float* targets, const int64_t numTargets, int64_t* indicesOut, LocatorInfo* infoOut = NULL, const float& maxDist = -1.0f) const;
         std::vector<LocatorInfo> pointsInRange(const float target[3], const float& maxDist) const;
         bool anyInRange(const float target[3], const float& maxDist) const;
     };
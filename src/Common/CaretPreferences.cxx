@@ -1118,6 +1118,34 @@ CaretPreferences::setDynamicConnectivityDefaultedOn(const bool defaultedOn)
                      defaultedOn);
 }
 
+/**
+ * @return Size, in megabytes, of the cache for rows loaded
+ * from connectivity matrix files.
+ */
+int32_t
+CaretPreferences::getConnectivityRowCacheMegabytes() const
+{
+    return this->connectivityRowCacheMegabytes;
+}
+
+/**
+ * Set the size of the cache for rows loaded from connectivity matrix files.
+ *
+ * @param megabytes
+ *     New size in megabytes, zero disables the cache.
+ */
+void
+CaretPreferences::setConnectivityRowCacheMegabytes(const int32_t megabytes)
+{
+    if (this->connectivityRowCacheMegabytes == megabytes) {
+        return;
+    }
+    
+    this->connectivityRowCacheMegabytes = megabytes;
+    this->setInteger(NAME_CONNECTIVITY_ROW_CACHE_MEGABYTES,
+                     megabytes);
+}
+
 
 /**
  * @return The image capture method.
@@ -1818,6 +1846,9 @@ CaretPreferences::readPreferences()
     this->dynamicConnectivityDefaultedOn = this->getBoolean(CaretPreferences::NAME_DYNAMIC_CONNECTIVITY_ON,
                                                             true);
     
+    this->connectivityRowCacheMegabytes = this->getInteger(CaretPreferences::NAME_CONNECTIVITY_ROW_CACHE_MEGABYTES,
+                                                           256);
+    
     this->remoteFileUserName = this->getString(NAME_REMOTE_FILE_USER_NAME);
     this->remoteFilePassword = this->getString(NAME_REMOTE_FILE_PASSWORD);
     this->remoteFileLoginSaved = this->getBoolean(NAME_REMOTE_FILE_LOGIN_SAVED,
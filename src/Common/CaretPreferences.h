@@ -206,6 +206,10 @@ namespace caret {
         
         void setDynamicConnectivityDefaultedOn(const bool defaultedOn);
         
+        int32_t getConnectivityRowCacheMegabytes() const;
+        
+        void setConnectivityRowCacheMegabytes(const int32_t megabytes);
+        
         WuQMacroGroup* getMacros();
         
         const WuQMacroGroup* getMacros() const;
@@ -319,6 +323,8 @@ namespace caret {
         
         bool dynamicConnectivityDefaultedOn;
         
+        int32_t connectivityRowCacheMegabytes;
+        
         bool yokingDefaultedOn;
         
         bool dataToolTipsEnabled;
@@ -354,6 +360,7 @@ namespace caret {
         static const AString NAME_COLOR_FOREGROUND_VOLUME;
         static const AString NAME_COLOR_CHART_MATRIX_GRID_LINES;
         static const AString NAME_COLOR_CHART_HISTOGRAM_THRESHOLD;
+        static const AString NAME_CONNECTIVITY_ROW_CACHE_MEGABYTES;
         static const AString NAME_DEVELOP_MENU;
         static const AString NAME_DATA_TOOL_TIPS;
         static const AString NAME_DYNAMIC_CONNECTIVITY_ON;
@@ -401,6 +408,7 @@ namespace caret {
     const AString CaretPreferences::NAME_COLOR_FOREGROUND_VOLUME     = "colorForegroundVolume";
     const AString CaretPreferences::NAME_COLOR_CHART_MATRIX_GRID_LINES = "colorChartMatrixGridLines";
     const AString CaretPreferences::NAME_COLOR_CHART_HISTOGRAM_THRESHOLD = "colorChartHistogramThreshold";
+    const AString CaretPreferences::NAME_CONNECTIVITY_ROW_CACHE_MEGABYTES = "connectivityRowCacheMegabytes";
     const AString CaretPreferences::NAME_DEVELOP_MENU     = "developMenu";
     const AString CaretPreferences::NAME_DATA_TOOL_TIPS = "dataToolTips";
     const AString CaretPreferences::NAME_DYNAMIC_CONNECTIVITY_ON = "dynamicConnectivityDefaultedOn";
@@ -0,0 +1,99 @@
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2019  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "DataBlockSource.h"
+#include "CaretAssert.h"
+#include "CaretOMP.h"
+
+#include <exception>
+
+using namespace caret;
+using namespace std;
+
+DataBlockSource::DataBlockSource(const BlockReader& reader, const int64_t& numBlocks)
+: m_reader(reader), m_numBlocks(numBlocks)
+{
+    CaretAssert(numBlocks >= 0);
+}
+
+int DataBlockSource::getMaxThreads()
+{
+#ifdef CARET_OMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+void DataBlockSource::processBlocks(const BlockProcessor& processor) const
+{
+    const int maxThreads = getMaxThreads();
+    int64_t nextBlock = 0;
+    exception_ptr firstError;
+    bool failed = false;
+#pragma omp CARET_PAR num_threads(maxThreads)
+    {
+#ifdef CARET_OMP
+        const int thread = omp_get_thread_num();
+#else
+        const int thread = 0;
+#endif
+        vector<float> block;//one block per thread, so reading the next block can overlap processing
+#pragma omp CARET_FOR schedule(dynamic)
+        for (int64_t i = 0; i < m_numBlocks; ++i)
+        {
+            bool haveBlock = false;
+#pragma omp critical(DataBlockSourceRead)
+            {
+                if (!failed)
+                {
+                    try
+                    {
+                        m_reader(nextBlock, block);//hand out blocks in order, so reads stay sequential on disk
+                        haveBlock = true;
+                    } catch (...) {
+                        firstError = current_exception();
+                        failed = true;
+                    }
+                    ++nextBlock;
+                }
+            }
+            if (!haveBlock) continue;//can't break out of an omp for, so skip the rest quickly
+            try
+            {
+                processor(thread, block.data(), (int64_t)block.size());
+            } catch (...) {
+#pragma omp critical(DataBlockSourceRead)
+                {
+                    if (!failed)
+                    {
+                        firstError = current_exception();
+                        failed = true;
+                    }
+                }
+            }
+        }
+    }
+    if (failed)
+    {
+        rethrow_exception(firstError);
+    }
+}
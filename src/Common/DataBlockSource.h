@@ -0,0 +1,58 @@
+#ifndef __DATA_BLOCK_SOURCE_H__
+#define __DATA_BLOCK_SOURCE_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2019  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <functional>
+#include <vector>
+#include "stdint.h"
+
+namespace caret
+{
+    
+    ///supplies data in blocks, for statistics on data that is too large to copy into one array (for instance, blocks of rows from a file)
+    class DataBlockSource
+    {
+    public:
+        ///must replace the contents of dataOut with the values of the block, blocks are requested in order and never from more than one thread at a time
+        typedef std::function<void(const int64_t& blockIndex, std::vector<float>& dataOut)> BlockReader;
+        
+        ///the thread argument is in [0, getMaxThreads()), and no two calls with the same thread run at the same time, so it can index per-thread partial results
+        typedef std::function<void(const int& thread, const float* data, const int64_t& dataCount)> BlockProcessor;
+        
+        DataBlockSource(const BlockReader& reader, const int64_t& numBlocks);
+        
+        int64_t getNumberOfBlocks() const { return m_numBlocks; }
+        
+        ///read every block in order, and process the blocks in parallel, an exception from the reader or processor stops the remaining blocks and is rethrown after all threads finish
+        void processBlocks(const BlockProcessor& processor) const;
+        
+        ///number of per-thread partial results needed by a processor
+        static int getMaxThreads();
+        
+    private:
+        BlockReader m_reader;
+        int64_t m_numBlocks;
+    };
+    
+}
+
+#endif //__DATA_BLOCK_SOURCE_H__
@@ -146,7 +146,8 @@ DataFileTypeEnum::initialize()
                                         "CIFTI - Dense",
                                         "CONNECTIVITY",
                                         false,
-                                        "dconn.nii"));
+                                        "dconn.nii",
+                                        "dconn.csf"));
     
     enumData.push_back(DataFileTypeEnum(CONNECTIVITY_DENSE_DYNAMIC,
                                         "CONNECTIVITY_DENSE_DYNAMIC",
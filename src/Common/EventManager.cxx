@@ -18,12 +18,19 @@
  */
 /*LICENSE_END*/
 
+#include <QElapsedTimer>
+#include <QMutexLocker>
 #include <QThread>
 
 #include <algorithm>
+#include <cstdlib>
 #include <iostream>
 #include <typeinfo>
 
+#ifdef __GNUC__
+#include <cxxabi.h>
+#endif
+
 #define __EVENT_MANAGER_MAIN__
 #include "Event.h"
 #include "EventManager.h"
@@ -37,6 +44,42 @@
 #include "SystemUtilities.h"
 
 using namespace caret;
+
+namespace {
+    /**
+     * @return Readable name of a class, type_info::name() is
+     * mangled with GCC and Clang.
+     *
+     * @param typeIndex
+     *    Type of the class.
+     */
+    AString
+    getReadableClassName(const std::type_index& typeIndex)
+    {
+        AString name(typeIndex.name());
+#ifdef __GNUC__
+        int status = -1;
+        char* demangled = abi::__cxa_demangle(typeIndex.name(), NULL, NULL, &status);
+        if (demangled != NULL) {
+            if (status == 0) {
+                name = demangled;
+            }
+            std::free(demangled);
+        }
+#endif
+        if (name.startsWith("class ")) {
+            name = name.mid(6);
+        }
+        else if (name.startsWith("struct ")) {
+            name = name.mid(7);
+        }
+        if (name.startsWith("caret::")) {
+            name = name.mid(7);
+        }
+        return name;
+    }
+}
+
 /**
  * \class  caret::EventManager
  * \brief  The event manager.
@@ -74,6 +117,8 @@ EventManager::EventManager()
 {
     m_eventIssuedCounter = 0;
     m_eventBlockingCounter.resize(EventTypeEnum::EVENT_COUNT, 0);
+    m_profilingEnabledFlag = false;
+    m_eventTypeProfileTiming.resize(EventTypeEnum::EVENT_COUNT);
 }
 
 /**
@@ -136,6 +181,10 @@ EventManager::deleteEventManager()
     CaretAssertMessage((EventManager::s_singletonEventManager != NULL), 
                        "Event manager does not exist, cannot delete it.");
     
+    if (EventManager::s_singletonEventManager->isProfilingEnabled()) {
+        std::cout << qPrintable(EventManager::s_singletonEventManager->getProfilingReport()) << std::endl;
+    }
+    
     delete EventManager::s_singletonEventManager;
     EventManager::s_singletonEventManager = NULL;
 }
@@ -271,22 +320,16 @@ void
 EventManager::sendEvent(Event* event)
 {   
     EventTypeEnum::Enum eventType = event->getEventType();
-    const AString eventNumberString = AString::number(m_eventIssuedCounter);
-    const AString eventMessagePrefix = ("Event "
-                                        + eventNumberString
-                                        + ": "
-                                        + event->toString() 
-                                        + " from thread: " 
-                                        + AString::number((uint64_t)QThread::currentThread())
-                                        + " ");
     
     const int32_t eventTypeIndex = static_cast<int32_t>(eventType);
     CaretAssertVectorIndex(m_eventBlockingCounter, eventTypeIndex);
     if (m_eventBlockingCounter[eventTypeIndex] > 0) {
-        AString msg = (eventMessagePrefix
-                       + " is blocked.  Blocking counter="
-                       + AString::number(m_eventBlockingCounter[eventTypeIndex]));
-        CaretLogFiner(msg);
+        /*
+         * Message is only assembled when FINER logging is active.
+         */
+        CaretLogFiner(getEventMessagePrefix(event)
+                      + " is blocked.  Blocking counter="
+                      + AString::number(m_eventBlockingCounter[eventTypeIndex]));
     }
     else {
         if (eventType == EventTypeEnum::EVENT_ALERT_USER) {
@@ -303,13 +346,18 @@ EventManager::sendEvent(Event* event)
             }
         }
         
+        const bool profilingFlag = m_profilingEnabledFlag;
+        QElapsedTimer eventTimer;
+        if (profilingFlag) {
+            eventTimer.start();
+        }
+        
         /*
-         * Get listeners for event.
+         * Get listeners for event.  A copy is used since
+         * listeners may be added or removed while processing the event.
          */
         EVENT_LISTENER_CONTAINER listeners = m_eventListeners[eventType];
         
-        const AString eventNumberString = AString::number(m_eventIssuedCounter);
-        
         /*
          * Send event to each of the listeners.
          */
@@ -318,10 +366,11 @@ EventManager::sendEvent(Event* event)
              iter++) {
             EventListenerInterface* listener = *iter;
 
-            listener->receiveEvent(event);
+            sendEventToListener(event,
+                                listener);
             
             if (event->isError()) {
-                CaretLogWarning("Event " + eventNumberString + " had error: " + event->toString() + ": " + event->getErrorMessage());
+                CaretLogWarning("Event " + AString::number(m_eventIssuedCounter) + " had error: " + event->toString() + ": " + event->getErrorMessage());
                 break;
             }
         }
@@ -338,10 +387,11 @@ EventManager::sendEvent(Event* event)
                  iter != processedListeners.end();
                  iter++) {
                 EventListenerInterface* listener = *iter;
-                listener->receiveEvent(event);
+                sendEventToListener(event,
+                                    listener);
                 
                 if (event->isError()) {
-                    CaretLogWarning("Event " + eventNumberString + " had error: " + event->toString());
+                    CaretLogWarning("Event " + AString::number(m_eventIssuedCounter) + " had error: " + event->toString());
                     break;
                 }
             }
@@ -349,10 +399,70 @@ EventManager::sendEvent(Event* event)
         else {
         }
 
+        if (profilingFlag) {
+            addProfilingTime(eventType,
+                             NULL,
+                             eventTimer.nsecsElapsed());
+        }
+        
         m_eventIssuedCounter++;
     }
 }
 
+/**
+ * Send an event to a listener, timing the listener if profiling is enabled.
+ *
+ * @param event
+ *    The event.
+ * @param listener
+ *    Listener that receives the event.
+ */
+void
+EventManager::sendEventToListener(Event* event,
+                                  EventListenerInterface* listener)
+{
+    if (m_profilingEnabledFlag) {
+        /*
+         * Get the listener's type and the event's type before sending
+         * the event, as the listener may delete itself or the event
+         * may delete the listener.
+         */
+        const std::type_index listenerType(typeid(*listener));
+        const EventTypeEnum::Enum eventType = event->getEventType();
+        QElapsedTimer listenerTimer;
+        listenerTimer.start();
+        
+        listener->receiveEvent(event);
+        
+        addProfilingTime(eventType,
+                         &listenerType,
+                         listenerTimer.nsecsElapsed());
+    }
+    else {
+        listener->receiveEvent(event);
+    }
+}
+
+/**
+ * @return Prefix for log messages about an event.  As this calls the
+ * event's toString() method, it should only be called when the
+ * message will be logged.
+ *
+ * @param event
+ *    The event.
+ */
+AString
+EventManager::getEventMessagePrefix(const Event* event) const
+{
+    return ("Event "
+            + AString::number(m_eventIssuedCounter)
+            + ": "
+            + event->toString()
+            + " from thread: "
+            + AString::number((uint64_t)QThread::currentThread())
+            + " ");
+}
+
 /**
  * Send a "simple" event.  A simple event is one for which there is no
  * specialized subclass of "Event".  This method try to prevent sending
@@ -504,12 +614,10 @@ EventManager::blockEvent(const EventTypeEnum::Enum eventType,
     const int32_t eventTypeIndex = static_cast<int32_t>(eventType);
     CaretAssertVectorIndex(m_eventBlockingCounter, eventTypeIndex);
     
-    const AString eventName = EventTypeEnum::toName(eventType);
-    
     if (blockStatus) {
         m_eventBlockingCounter[eventTypeIndex]++;
         CaretLogFiner("Blocking event "
-                      + eventName
+                      + EventTypeEnum::toName(eventType)
                       + " blocking counter is now "
                       + AString::number(m_eventBlockingCounter[eventTypeIndex]));
     }
@@ -517,13 +625,13 @@ EventManager::blockEvent(const EventTypeEnum::Enum eventType,
         if (m_eventBlockingCounter[eventTypeIndex] > 0) {
             m_eventBlockingCounter[eventTypeIndex]--;
             CaretLogFiner("Unblocking event "
-                          + eventName
+                          + EventTypeEnum::toName(eventType)
                           + " blocking counter is now "
                           + AString::number(m_eventBlockingCounter[eventTypeIndex]));
         }
         else {
             const AString message("Trying to unblock event "
-                                  + eventName
+                                  + EventTypeEnum::toName(eventType)
                                   + " but it is not blocked");
             CaretAssertMessage(0, message);
             CaretLogWarning(message);
@@ -571,4 +679,142 @@ EventManager::verifyAllListenersRemoved(EventListenerInterface* eventListener)
     }
 }
 
+/**
+ * Enable or disable profiling of event dispatching.  While enabled, the
+ * number of dispatches, the total time, and the maximum time are
+ * recorded for each event type and for each type of listener receiving
+ * each event type.  If profiling is enabled when the event manager is
+ * deleted, the profiling report is printed.
+ *
+ * @param enabled
+ *    New profiling status.
+ */
+void
+EventManager::setProfilingEnabled(const bool enabled)
+{
+    m_profilingEnabledFlag = enabled;
+}
+
+/**
+ * @return True if profiling of event dispatching is enabled.
+ */
+bool
+EventManager::isProfilingEnabled() const
+{
+    return m_profilingEnabledFlag;
+}
+
+/**
+ * Discard all recorded profiling times.
+ */
+void
+EventManager::resetProfiling()
+{
+    QMutexLocker locker(&m_profilingMutex);
+    m_eventTypeProfileTiming.assign(EventTypeEnum::EVENT_COUNT,
+                                    ProfileTiming());
+    m_listenerProfileTiming.clear();
+}
+
+/**
+ * Add a time to the profiling data.
+ *
+ * @param eventType
+ *    Type of event that was dispatched.
+ * @param listenerType
+ *    Type of the listener that received the event or NULL for
+ *    the time to dispatch the event to all of its listeners.
+ * @param nanoseconds
+ *    Time to dispatch the event.
+ */
+void
+EventManager::addProfilingTime(const EventTypeEnum::Enum eventType,
+                               const std::type_index* listenerType,
+                               const int64_t nanoseconds)
+{
+    const int32_t eventTypeIndex = static_cast<int32_t>(eventType);
+    
+    QMutexLocker locker(&m_profilingMutex);
+    if (listenerType != NULL) {
+        const std::pair<int32_t, std::type_index> key(eventTypeIndex,
+                                                      *listenerType);
+        m_listenerProfileTiming[key].add(nanoseconds);
+    }
+    else {
+        CaretAssertVectorIndex(m_eventTypeProfileTiming, eventTypeIndex);
+        m_eventTypeProfileTiming[eventTypeIndex].add(nanoseconds);
+    }
+}
 
+/**
+ * @return Text containing the profiling data sorted by total time.
+ * Event type times include the time of any events sent by the
+ * listeners while processing the event.
+ */
+AString
+EventManager::getProfilingReport() const
+{
+    struct ReportRow {
+        AString m_name;
+        ProfileTiming m_timing;
+        
+        bool operator<(const ReportRow& rhs) const {
+            return (m_timing.m_totalNanoseconds > rhs.m_timing.m_totalNanoseconds);
+        }
+    };
+    
+    std::vector<ReportRow> eventRows;
+    std::vector<ReportRow> listenerRows;
+    {
+        QMutexLocker locker(&m_profilingMutex);
+        for (int32_t i = 0; i < EventTypeEnum::EVENT_COUNT; i++) {
+            const ProfileTiming& timing = m_eventTypeProfileTiming[i];
+            if (timing.m_count > 0) {
+                ReportRow row;
+                row.m_name   = EventTypeEnum::toName(static_cast<EventTypeEnum::Enum>(i));
+                row.m_timing = timing;
+                eventRows.push_back(row);
+            }
+        }
+        for (const auto& iter : m_listenerProfileTiming) {
+            ReportRow row;
+            row.m_name   = (EventTypeEnum::toName(static_cast<EventTypeEnum::Enum>(iter.first.first))
+                            + " -> "
+                            + getReadableClassName(iter.first.second));
+            row.m_timing = iter.second;
+            listenerRows.push_back(row);
+        }
+    }
+    std::sort(eventRows.begin(), eventRows.end());
+    std::sort(listenerRows.begin(), listenerRows.end());
+    
+    const AString header(AString("Count").rightJustified(10)
+                         + AString("Total(ms)").rightJustified(14)
+                         + AString("Mean(ms)").rightJustified(12)
+                         + AString("Max(ms)").rightJustified(12)
+                         + "  Name");
+    
+    AString text;
+    for (int32_t iTable = 0; iTable < 2; iTable++) {
+        const std::vector<ReportRow>& rows = ((iTable == 0) ? eventRows : listenerRows);
+        text.appendWithNewLine((iTable == 0)
+                               ? "Event Types (time includes events sent by listeners)"
+                               : "Listeners");
+        text.appendWithNewLine(header);
+        for (const auto& row : rows) {
+            const ProfileTiming& timing = row.m_timing;
+            const double totalMilliseconds = timing.m_totalNanoseconds / 1.0e6;
+            const double meanMilliseconds  = totalMilliseconds / timing.m_count;
+            const double maxMilliseconds   = timing.m_maximumNanoseconds / 1.0e6;
+            text.appendWithNewLine(AString::number(timing.m_count).rightJustified(10)
+                                   + AString::number(totalMilliseconds, 'f', 3).rightJustified(14)
+                                   + AString::number(meanMilliseconds, 'f', 4).rightJustified(12)
+                                   + AString::number(maxMilliseconds, 'f', 3).rightJustified(12)
+                                   + "  "
+                                   + row.m_name);
+        }
+        text.appendWithNewLine("");
+    }
+    
+    return text;
+}
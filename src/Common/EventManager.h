@@ -23,6 +23,13 @@
 
 #include <stdint.h>
 
+#include <atomic>
+#include <map>
+#include <typeindex>
+#include <vector>
+
+#include <QMutex>
+
 #include "CaretObject.h"
 
 #include "EventTypeEnum.h"
@@ -94,13 +101,50 @@ namespace caret {
         
         int64_t getEventIssuedCounter() const;
         
+        void setProfilingEnabled(const bool enabled);
+        
+        bool isProfilingEnabled() const;
+        
+        void resetProfiling();
+        
+        AString getProfilingReport() const;
+        
     private:
+        /**
+         * Number of dispatches and time spent dispatching, for an
+         * event type or for a type of listener receiving an event type.
+         */
+        struct ProfileTiming {
+            int64_t m_count = 0;
+            
+            int64_t m_totalNanoseconds = 0;
+            
+            int64_t m_maximumNanoseconds = 0;
+            
+            void add(const int64_t nanoseconds) {
+                ++m_count;
+                m_totalNanoseconds += nanoseconds;
+                if (nanoseconds > m_maximumNanoseconds) {
+                    m_maximumNanoseconds = nanoseconds;
+                }
+            }
+        };
+        
         EventManager();
         
         virtual ~EventManager();
         
         void verifyAllListenersRemoved(EventListenerInterface* eventListener);
         
+        AString getEventMessagePrefix(const Event* event) const;
+        
+        void sendEventToListener(Event* event,
+                                 EventListenerInterface* listener);
+        
+        void addProfilingTime(const EventTypeEnum::Enum eventType,
+                              const std::type_index* listenerType,
+                              const int64_t nanoseconds);
+        
         /**
          * Define the container
          */
@@ -137,6 +181,18 @@ namespace caret {
         /** A counter for blocking events of each type */
         std::vector<int64_t> m_eventBlockingCounter;
         
+        /** Times are recorded while profiling is enabled (may be changed while other threads send events) */
+        std::atomic<bool> m_profilingEnabledFlag;
+        
+        /** Dispatch times for each event type (includes events sent by listeners) */
+        std::vector<ProfileTiming> m_eventTypeProfileTiming;
+        
+        /** Dispatch times for each type of listener and the event type it received */
+        std::map<std::pair<int32_t, std::type_index>, ProfileTiming> m_listenerProfileTiming;
+        
+        /** Events may be sent from more than one thread */
+        mutable QMutex m_profilingMutex;
+        
         static EventManager* s_singletonEventManager;
         
         friend EventListenerInterface;
@@ -21,9 +21,11 @@
 
 #include "FastStatistics.h"
 #include "CaretPointer.h"
+#include "DataBlockSource.h"
 
 #include <algorithm>
 #include <cmath>
+#include <iostream>
 #include <limits>
 
 using namespace caret;
@@ -259,6 +261,267 @@ void FastStatistics::update(const float* data, const int64_t& dataCount, const f
     }
 }
 
+void FastStatistics::update(const DataBlockSource& blockSource)
+{
+    reset();
+    m_negPercentHist.startUpdate();
+    m_posPercentHist.startUpdate();
+    m_absPercentHist.startUpdate();
+    const int maxThreads = DataBlockSource::getMaxThreads();
+    vector<FastStatistics> partials(maxThreads);
+    vector<double> partialSums(maxThreads, 0.0);
+    vector<int64_t> partialDataCounts(maxThreads, 0);
+    vector<vector<float> > positives(maxThreads), negatives(maxThreads), absolutes(maxThreads);//per thread, only one block in size
+    blockSource.processBlocks([&](const int& thread, const float* data, const int64_t& dataCount)
+                              {
+                                  partials[thread].updateRangeBlock(data, dataCount, partialSums[thread],
+                                                                    positives[thread], negatives[thread], absolutes[thread]);
+                                  partialDataCounts[thread] += dataCount;
+                              });
+    double sum = 0.0;
+    int64_t dataCount = 0;
+    for (int i = 0; i < maxThreads; ++i)
+    {//the ranges and counts don't depend on which thread processed which blocks, but the sums do, so the mean can differ in the last bits between runs
+        mergeRange(partials[i]);
+        sum += partialSums[i];
+        dataCount += partialDataCounts[i];
+    }
+    int64_t totalGood = (m_negCount + m_zeroCount + m_posCount);
+    m_mean = sum / totalGood;
+    int usebuckets = max((int64_t)1, min(NUM_BUCKETS_PERCENTILE_HIST, dataCount));
+    m_negPercentHist.startBuckets(usebuckets);
+    m_posPercentHist.startBuckets(usebuckets);
+    m_absPercentHist.startBuckets(usebuckets);
+    for (int i = 0; i < maxThreads; ++i)
+    {//copies have the ranges and empty buckets
+        partials[i].m_negPercentHist = m_negPercentHist;
+        partials[i].m_posPercentHist = m_posPercentHist;
+        partials[i].m_absPercentHist = m_absPercentHist;
+        partials[i].m_mean = m_mean;
+        partialSums[i] = 0.0;
+    }
+    blockSource.processBlocks([&](const int& thread, const float* data, const int64_t& dataCount)
+                              {
+                                  partials[thread].updateBucketsBlock(data, dataCount, partialSums[thread],
+                                                                      positives[thread], negatives[thread], absolutes[thread]);
+                              });
+    double sum2 = 0.0;
+    for (int i = 0; i < maxThreads; ++i)
+    {
+        sum2 += partialSums[i];
+        m_negPercentHist.mergeBuckets(partials[i].m_negPercentHist);
+        m_posPercentHist.mergeBuckets(partials[i].m_posPercentHist);
+        m_absPercentHist.mergeBuckets(partials[i].m_absPercentHist);
+    }
+    if (totalGood > 0)
+    {
+        m_stdDevPop = sqrt(sum2 / totalGood);
+        if (totalGood > 1)
+        {
+            m_stdDevSample = sqrt(sum2 / (totalGood - 1));
+        }
+    }
+    m_negPercentHist.finishUpdate();
+    m_posPercentHist.finishUpdate();
+    m_absPercentHist.finishUpdate();
+    
+    if (m_negCount <= 0)
+    {
+        m_leastNeg = 0.0;
+        m_mostNeg  = 0.0;
+    }
+    if (m_posCount <= 0)
+    {
+        m_leastPos = 0.0;
+        m_mostPos  = 0.0;
+    }
+    if (m_absCount <= 0)
+    {
+        m_leastAbs = 0.0;
+        m_mostAbs  = 0.0;
+    }
+}
+
+void FastStatistics::updateRangeBlock(const float* data, const int64_t& dataCount, double& sum,
+                                      vector<float>& positives, vector<float>& negatives, vector<float>& absolutes)
+{//first pass of update() on one block, collecting the block's values for the percentile histograms
+    positives.resize(dataCount);
+    negatives.resize(dataCount);
+    absolutes.resize(dataCount);
+    int64_t posCount = 0, negCount = 0, absCount = 0;
+    bool first = (m_negCount + m_zeroCount + m_posCount == 0);
+    for (int64_t i = 0; i < dataCount; ++i)
+    {
+        if (data[i] != data[i])
+        {
+            ++m_nanCount;
+            continue;//skip NaNs
+        }
+        if (data[i] == 0.0f)
+        {
+            ++m_zeroCount;
+        } else {
+            if (data[i] < 0.0f)
+            {
+                if (data[i] * 2.0f == data[i])
+                {
+                    ++m_negInfCount;
+                    continue;//skip neg infs
+                } else {
+                    negatives[negCount] = data[i];
+                    ++negCount;
+                    if (data[i] > m_leastNeg) m_leastNeg = data[i];
+                    if (data[i] < m_mostNeg) m_mostNeg = data[i];
+                    
+                    absolutes[absCount] = -data[i];
+                    if (absolutes[absCount] > m_mostAbs)  m_mostAbs  = absolutes[absCount];
+                    if (absolutes[absCount] < m_leastAbs) m_leastAbs = absolutes[absCount];
+                    ++absCount;
+                }
+            } else {
+                if (data[i] * 2.0f == data[i])
+                {
+                    ++m_infCount;
+                    continue;//skip infs
+                } else {
+                    positives[posCount] = data[i];
+                    ++posCount;
+                    if (data[i] > m_mostPos) m_mostPos = data[i];
+                    if (data[i] < m_leastPos) m_leastPos = data[i];
+                    
+                    absolutes[absCount] = data[i];
+                    if (absolutes[absCount] > m_mostAbs)  m_mostAbs  = absolutes[absCount];
+                    if (absolutes[absCount] < m_leastAbs) m_leastAbs = absolutes[absCount];
+                    ++absCount;
+                }
+            }
+        }
+        if (data[i] > m_max || first) m_max = data[i];
+        if (data[i] < m_min || first) m_min = data[i];
+        sum += data[i];
+        first = false;
+    }
+    m_posCount += posCount;
+    m_negCount += negCount;
+    m_absCount += absCount;
+    m_negPercentHist.updateRange(negatives.data(), negCount);
+    m_posPercentHist.updateRange(positives.data(), posCount);
+    m_absPercentHist.updateRange(absolutes.data(), absCount);
+}
+
+void FastStatistics::updateBucketsBlock(const float* data, const int64_t& dataCount, double& sum2,
+                                        vector<float>& positives, vector<float>& negatives, vector<float>& absolutes)
+{//second pass of update() on one block, m_mean and the histogram ranges must already be set
+    positives.resize(dataCount);
+    negatives.resize(dataCount);
+    absolutes.resize(dataCount);
+    int64_t posCount = 0, negCount = 0, absCount = 0;
+    float tempf;
+    for (int64_t i = 0; i < dataCount; ++i)
+    {
+        if (data[i] != data[i]) continue;//skip NaNs
+        if (data[i] < -1.0f && (data[i] * 2.0f == data[i])) continue;//exclude -inf
+        if (data[i] > 1.0f && (data[i] * 2.0f == data[i])) continue;//exclude inf
+        tempf = data[i] - m_mean;
+        sum2 += tempf * tempf;
+        if (data[i] < 0.0f)
+        {
+            negatives[negCount] = data[i];
+            ++negCount;
+            absolutes[absCount] = -data[i];
+            ++absCount;
+        } else if (data[i] > 0.0f) {
+            positives[posCount] = data[i];
+            ++posCount;
+            absolutes[absCount] = data[i];
+            ++absCount;
+        }
+    }
+    if (m_negPercentHist.hasBucketRange()) m_negPercentHist.updateBuckets(negatives.data(), negCount);
+    if (m_posPercentHist.hasBucketRange()) m_posPercentHist.updateBuckets(positives.data(), posCount);
+    if (m_absPercentHist.hasBucketRange()) m_absPercentHist.updateBuckets(absolutes.data(), absCount);
+}
+
+void FastStatistics::mergeRange(const FastStatistics& other)
+{
+    if (other.m_negCount + other.m_zeroCount + other.m_posCount > 0)
+    {
+        if (m_negCount + m_zeroCount + m_posCount > 0)
+        {
+            if (other.m_min < m_min) m_min = other.m_min;
+            if (other.m_max > m_max) m_max = other.m_max;
+        } else {
+            m_min = other.m_min;
+            m_max = other.m_max;
+        }
+    }
+    m_posCount += other.m_posCount;
+    m_zeroCount += other.m_zeroCount;
+    m_negCount += other.m_negCount;
+    m_infCount += other.m_infCount;
+    m_negInfCount += other.m_negInfCount;
+    m_nanCount += other.m_nanCount;
+    m_absCount += other.m_absCount;
+    if (other.m_mostPos > m_mostPos) m_mostPos = other.m_mostPos;//the values from reset() lose every comparison
+    if (other.m_leastPos < m_leastPos) m_leastPos = other.m_leastPos;
+    if (other.m_leastNeg > m_leastNeg) m_leastNeg = other.m_leastNeg;
+    if (other.m_mostNeg < m_mostNeg) m_mostNeg = other.m_mostNeg;
+    if (other.m_leastAbs < m_leastAbs) m_leastAbs = other.m_leastAbs;
+    if (other.m_mostAbs > m_mostAbs) m_mostAbs = other.m_mostAbs;
+    m_negPercentHist.mergeRange(other.m_negPercentHist);
+    m_posPercentHist.mergeRange(other.m_posPercentHist);
+    m_absPercentHist.mergeRange(other.m_absPercentHist);
+}
+
+void FastStatistics::writeBinary(ostream& output) const
+{
+    float values[11] = { m_min, m_max, m_mean, m_stdDevPop, m_stdDevSample,
+                         m_mostPos, m_leastPos, m_leastNeg, m_mostNeg, m_leastAbs, m_mostAbs };
+    int64_t counts[7] = { m_posCount, m_zeroCount, m_negCount, m_infCount, m_negInfCount, m_nanCount, m_absCount };
+    output.write((const char*)values, sizeof(values));
+    output.write((const char*)counts, sizeof(counts));
+    m_posPercentHist.writeBinary(output);
+    m_negPercentHist.writeBinary(output);
+    m_absPercentHist.writeBinary(output);
+}
+
+bool FastStatistics::readBinary(istream& input)
+{
+    float values[11];
+    int64_t counts[7];
+    input.read((char*)values, sizeof(values));
+    input.read((char*)counts, sizeof(counts));
+    if (!input) return false;
+    for (int i = 0; i < 7; ++i)
+    {
+        if (counts[i] < 0) return false;
+    }
+    Histogram posHist, negHist, absHist;
+    if (!posHist.readBinary(input) || !negHist.readBinary(input) || !absHist.readBinary(input)) return false;
+    m_min = values[0];
+    m_max = values[1];
+    m_mean = values[2];
+    m_stdDevPop = values[3];
+    m_stdDevSample = values[4];
+    m_mostPos = values[5];
+    m_leastPos = values[6];
+    m_leastNeg = values[7];
+    m_mostNeg = values[8];
+    m_leastAbs = values[9];
+    m_mostAbs = values[10];
+    m_posCount = counts[0];
+    m_zeroCount = counts[1];
+    m_negCount = counts[2];
+    m_infCount = counts[3];
+    m_negInfCount = counts[4];
+    m_nanCount = counts[5];
+    m_absCount = counts[6];
+    m_posPercentHist = posHist;
+    m_negPercentHist = negHist;
+    m_absPercentHist = absHist;
+    return true;
+}
+
 float FastStatistics::getApproxNegativePercentile(const float& percent) const
 {
     float rank = percent / 100.0f * m_negCount;//translate to rank
@@ -26,6 +26,8 @@
 namespace caret
 {
     
+    class DataBlockSource;
+    
     ///this class does statistics that are linear in complexity only, NO SORTING, this means its percentiles are approximate, using interpolation from a histogram
     class FastStatistics
     {
@@ -38,6 +40,14 @@ namespace caret
         void reset();
         
         static float getValuePercentileHelper(const Histogram& histogram, const float numberOfDataValues, const bool negativeDataFlag, const float value);
+        
+        void updateRangeBlock(const float* data, const int64_t& dataCount, double& sum,
+                              std::vector<float>& positives, std::vector<float>& negatives, std::vector<float>& absolutes);
+        
+        void updateBucketsBlock(const float* data, const int64_t& dataCount, double& sum2,
+                                std::vector<float>& positives, std::vector<float>& negatives, std::vector<float>& absolutes);
+        
+        void mergeRange(const FastStatistics& other);
 
     public:
         FastStatistics();
@@ -46,6 +56,9 @@ namespace caret
         
         void update(const float* data, const int64_t& dataCount);
         
+        ///same as above, but reads the data a block at a time (two passes), and processes the blocks in parallel, so only a few blocks are in memory at once
+        void update(const DataBlockSource& blockSource);
+        
         ///statistics and display are really not that related, so for now, only include a continuous clipping range, excluding the middle from data will do weird things to standard deviation
         void update(const float* data, const int64_t& dataCount, const float& minThreshInclusive, const float& maxThreshInclusive);
         
@@ -95,6 +108,12 @@ namespace caret
         
         float getPopulationStdDev() const { return m_stdDevPop; }
         
+        ///for caching statistics in a file on the same machine, values are written in native byte order
+        void writeBinary(std::ostream& output) const;
+        
+        ///returns false if the input does not contain statistics
+        bool readBinary(std::istream& input);
+        
         float getPositiveValuePercentile(const float value) const;
         
         float getNegativeValuePercentile(const float value) const;
@@ -21,7 +21,10 @@
 
 #include "Histogram.h"
 #include "CaretAssert.h"
+#include "DataBlockSource.h"
+
 #include <cmath>
+#include <iostream>
 
 using namespace caret;
 using namespace std;
@@ -86,9 +89,53 @@ void Histogram::update(const int& numBuckets, const float* data, const int64_t&
 
 void Histogram::update(const float* data, const int64_t& dataCount)
 {
-    int numBuckets = (int)m_buckets.size();
+    startUpdate();
+    updateRange(data, dataCount);
+    startBuckets((int)m_buckets.size());
+    if (hasBucketRange())
+    {
+        updateBuckets(data, dataCount);
+    }
+    finishUpdate();
+}
+
+void Histogram::update(const int& numBuckets, const DataBlockSource& blockSource)
+{
+    const int maxThreads = DataBlockSource::getMaxThreads();
+    startUpdate();
+    vector<Histogram> partials(maxThreads, Histogram(1));
+    blockSource.processBlocks([&](const int& thread, const float* data, const int64_t& dataCount)
+                              {
+                                  partials[thread].updateRange(data, dataCount);
+                              });
+    for (int i = 0; i < maxThreads; ++i)
+    {
+        mergeRange(partials[i]);
+    }
+    startBuckets(numBuckets);
+    if (hasBucketRange())
+    {
+        partials.assign(maxThreads, *this);//copies have the range and empty buckets
+        blockSource.processBlocks([&](const int& thread, const float* data, const int64_t& dataCount)
+                                  {
+                                      partials[thread].updateBuckets(data, dataCount);
+                                  });
+        for (int i = 0; i < maxThreads; ++i)
+        {
+            mergeBuckets(partials[i]);
+        }
+    }
+    finishUpdate();
+}
+
+void Histogram::startUpdate()
+{
     reset();
-    bool first = true;
+}
+
+void Histogram::updateRange(const float* data, const int64_t& dataCount)
+{
+    bool first = (m_negCount + m_zeroCount + m_posCount == 0);//the range is only valid once there is a valid value
     for (int64_t i = 0; i < dataCount; ++i)
     {//count value classes
         if (data[i] != data[i])
@@ -133,33 +180,50 @@ void Histogram::update(const float* data, const int64_t& dataCount)
             }
         }
     }
-    if (first)
-    {
-        m_bucketMin = m_bucketMax = 0.0f;
-        return;//our arrays are already zeroed, so just return if no valid data
-    }
-    if (m_bucketMin == m_bucketMax)
+}
+
+void Histogram::mergeRange(const Histogram& other)
+{
+    if (other.m_negCount + other.m_zeroCount + other.m_posCount > 0)
     {
-        int64_t totalValid = m_negCount + m_posCount + m_zeroCount;
-        for (int i = 0; i < numBuckets - 1; ++i)
+        if (m_negCount + m_zeroCount + m_posCount > 0)
         {
-            m_cumulative[i] = (i + 1) * totalValid / numBuckets;//so, its not particularly useful if our range is zero, but split them evenly among buckets just for kicks
-            if (i == 0)
-            {
-                m_buckets[i] = m_cumulative[i];
-            } else {
-                m_buckets[i] = m_cumulative[i] - m_cumulative[i - 1];
-            }
-        }//display is already zeroed, so just return
-        m_cumulative[numBuckets - 1] = totalValid;//make sure the last one has all of them
-        if (numBuckets > 1)
-        {
-            m_buckets[numBuckets - 1] = m_cumulative[numBuckets - 1] - m_cumulative[numBuckets - 2];
+            if (other.m_bucketMin < m_bucketMin) m_bucketMin = other.m_bucketMin;
+            if (other.m_bucketMax > m_bucketMax) m_bucketMax = other.m_bucketMax;
         } else {
-            m_buckets[numBuckets - 1] = m_cumulative[numBuckets - 1];
+            m_bucketMin = other.m_bucketMin;
+            m_bucketMax = other.m_bucketMax;
         }
-        return;
     }
+    m_posCount += other.m_posCount;
+    m_zeroCount += other.m_zeroCount;
+    m_negCount += other.m_negCount;
+    m_infCount += other.m_infCount;
+    m_negInfCount += other.m_negInfCount;
+    m_nanCount += other.m_nanCount;
+}
+
+void Histogram::startBuckets(const int& numBuckets)
+{
+    resize(numBuckets);
+    for (int i = 0; i < numBuckets; ++i)
+    {
+        m_buckets[i] = 0;
+        m_cumulative[i] = 0;
+        m_display[i] = 0.0f;
+    }
+    m_displayHeightMax = 0.0;
+}
+
+bool Histogram::hasBucketRange() const
+{
+    return (m_negCount + m_zeroCount + m_posCount > 0) && (m_bucketMin != m_bucketMax);
+}
+
+void Histogram::updateBuckets(const float* data, const int64_t& dataCount)
+{
+    CaretAssert(hasBucketRange());
+    int numBuckets = (int)m_buckets.size();
     float bucketsize = (m_bucketMax - m_bucketMin) / numBuckets;
     for (int64_t i = 0; i < dataCount; ++i)
     {//determine histogram
@@ -172,6 +236,59 @@ void Histogram::update(const float* data, const int64_t& dataCount)
         CaretAssertVectorIndex(m_buckets, bucket);
         ++m_buckets[bucket];
     }
+}
+
+void Histogram::mergeBuckets(const Histogram& other)
+{
+    int numBuckets = (int)m_buckets.size();
+    CaretAssert((int)other.m_buckets.size() == numBuckets);
+    for (int i = 0; i < numBuckets; ++i)
+    {
+        m_buckets[i] += other.m_buckets[i];
+    }
+}
+
+void Histogram::finishUpdate()
+{
+    if (m_negCount + m_zeroCount + m_posCount == 0)
+    {
+        m_bucketMin = m_bucketMax = 0.0f;
+        return;//our arrays are already zeroed, so just return if no valid data
+    }
+    if (m_bucketMin == m_bucketMax)
+    {
+        splitEvenly(m_negCount + m_posCount + m_zeroCount);
+        return;
+    }
+    finishBuckets();
+}
+
+void Histogram::splitEvenly(const int64_t& count)
+{
+    int numBuckets = (int)m_buckets.size();
+    for (int i = 0; i < numBuckets - 1; ++i)
+    {
+        m_cumulative[i] = (i + 1) * count / numBuckets;//so, its not particularly useful if our range is zero, but split them evenly among buckets just for kicks
+        if (i == 0)
+        {
+            m_buckets[i] = m_cumulative[i];
+        } else {
+            m_buckets[i] = m_cumulative[i] - m_cumulative[i - 1];
+        }
+    }//display is already zeroed, so just return
+    m_cumulative[numBuckets - 1] = count;//make sure the last one has all of them
+    if (numBuckets > 1)
+    {
+        m_buckets[numBuckets - 1] = m_cumulative[numBuckets - 1] - m_cumulative[numBuckets - 2];
+    } else {
+        m_buckets[numBuckets - 1] = m_cumulative[numBuckets - 1];
+    }
+}
+
+void Histogram::finishBuckets()
+{
+    int numBuckets = (int)m_buckets.size();
+    float bucketsize = (m_bucketMax - m_bucketMin) / numBuckets;
     computeCumulative();
     m_displayHeightMax = 0.0;
     for (int i = 0; i < numBuckets; ++i)
@@ -198,8 +315,66 @@ void Histogram::update(const float* data, const int64_t& dataCount, float mostPo
                        float leastPositiveValueInclusive, float leastNegativeValueInclusive,
                        float mostNegativeValueInclusive, const bool& includeZeroValues)
 {
-    int numBuckets = (int)m_buckets.size();
     reset();
+    if (!setLimitedRange(mostPositiveValueInclusive, leastPositiveValueInclusive,
+                         leastNegativeValueInclusive, mostNegativeValueInclusive, includeZeroValues))
+    {//bad input ranges, so collect counts, make a mock histogram if equal, and return (display values will be zeros)
+        int64_t equalCount = 0;
+        updateLimitedBadRange(data, dataCount, equalCount);
+        finishLimitedBadRange(equalCount);
+        return;
+    }
+    updateLimited(data, dataCount, mostPositiveValueInclusive,
+                  leastPositiveValueInclusive, leastNegativeValueInclusive,
+                  mostNegativeValueInclusive, includeZeroValues);
+    finishBuckets();
+}
+
+void Histogram::update(const int32_t& numBuckets,
+                       const DataBlockSource& blockSource, float mostPositiveValueInclusive,
+                       float leastPositiveValueInclusive, float leastNegativeValueInclusive,
+                       float mostNegativeValueInclusive, const bool& includeZeroValues)
+{
+    resize(numBuckets);
+    reset();
+    const int maxThreads = DataBlockSource::getMaxThreads();
+    const bool goodRange = setLimitedRange(mostPositiveValueInclusive, leastPositiveValueInclusive,
+                                           leastNegativeValueInclusive, mostNegativeValueInclusive, includeZeroValues);
+    vector<Histogram> partials(maxThreads, *this);//copies have the range, which the bad range counting also uses, and empty buckets
+    if (!goodRange)
+    {
+        vector<int64_t> equalCounts(maxThreads, 0);
+        blockSource.processBlocks([&](const int& thread, const float* data, const int64_t& dataCount)
+                                  {
+                                      partials[thread].updateLimitedBadRange(data, dataCount, equalCounts[thread]);
+                                  });
+        int64_t equalCount = 0;
+        for (int i = 0; i < maxThreads; ++i)
+        {
+            mergeRange(partials[i]);//only counts, the range is already set
+            equalCount += equalCounts[i];
+        }
+        finishLimitedBadRange(equalCount);
+        return;
+    }
+    blockSource.processBlocks([&](const int& thread, const float* data, const int64_t& dataCount)
+                              {
+                                  partials[thread].updateLimited(data, dataCount, mostPositiveValueInclusive,
+                                                                 leastPositiveValueInclusive, leastNegativeValueInclusive,
+                                                                 mostNegativeValueInclusive, includeZeroValues);
+                              });
+    for (int i = 0; i < maxThreads; ++i)
+    {
+        mergeRange(partials[i]);
+        mergeBuckets(partials[i]);
+    }
+    finishBuckets();
+}
+
+bool Histogram::setLimitedRange(float& mostPositiveValueInclusive, float& leastPositiveValueInclusive,
+                                float& leastNegativeValueInclusive, float& mostNegativeValueInclusive,
+                                const bool& includeZeroValues)
+{
     if (mostNegativeValueInclusive > 0.0f) mostNegativeValueInclusive = 0.0f;//sanity check the inputs without asserting
     if (mostPositiveValueInclusive < 0.0f) mostPositiveValueInclusive = 0.0f;
     if (leastNegativeValueInclusive > 0.0f) leastNegativeValueInclusive = 0.0f;
@@ -217,64 +392,59 @@ void Histogram::update(const float* data, const int64_t& dataCount, float mostPo
         m_bucketMin = leastPositiveValueInclusive;
     }
     float sanity = m_bucketMax + m_bucketMin;
-    if (m_bucketMax <= m_bucketMin || sanity != sanity)
-    {//bad input ranges, so collect counts, make a mock histogram if equal, and return (display values will be zeros)
-        int64_t equalCount = 0;
-        for (int64_t i = 0; i < dataCount; ++i)
+    return !(m_bucketMax <= m_bucketMin || sanity != sanity);
+}
+
+void Histogram::updateLimitedBadRange(const float* data, const int64_t& dataCount, int64_t& equalCount)
+{
+    for (int64_t i = 0; i < dataCount; ++i)
+    {
+        if (data[i] != data[i])
         {
-            if (data[i] != data[i])
-            {
-                ++m_nanCount;
-                continue;
-            }
-            if (data[i] < -1.0f && (data[i] * 2.0f == data[i]))
-            {
-                ++m_negInfCount;
-                continue;
-            }
-            if (data[i] > 1.0f && (data[i] * 2.0f == data[i]))
-            {
-                ++m_infCount;
-                continue;
-            }
-            if (data[i] == m_bucketMax)
-            {
-                ++equalCount;
-            }
+            ++m_nanCount;
+            continue;
         }
-        if (m_bucketMax == m_bucketMin)
+        if (data[i] < -1.0f && (data[i] * 2.0f == data[i]))
         {
-            if (m_bucketMax == 0.0f)
-            {
-                m_zeroCount = equalCount;
-            } else {
-                if (m_bucketMax < 0.0f)
-                {
-                    m_negCount = equalCount;
-                } else {
-                    m_posCount = equalCount;
-                }
-            }
-            for (int i = 0; i < numBuckets - 1; ++i)
-            {
-                m_cumulative[i] = (i + 1) * equalCount / numBuckets;//so, its not particularly useful if our range is zero, but split them evenly among buckets just for kicks
-                if (i == 0)
-                {
-                    m_buckets[i] = m_cumulative[i];
-                } else {
-                    m_buckets[i] = m_cumulative[i] - m_cumulative[i - 1];
-                }
-            }//display is already zeroed, so just return
-            m_cumulative[numBuckets - 1] = equalCount;//make sure the last one has all of them
-            if (numBuckets > 1)
+            ++m_negInfCount;
+            continue;
+        }
+        if (data[i] > 1.0f && (data[i] * 2.0f == data[i]))
+        {
+            ++m_infCount;
+            continue;
+        }
+        if (data[i] == m_bucketMax)
+        {
+            ++equalCount;
+        }
+    }
+}
+
+void Histogram::finishLimitedBadRange(const int64_t& equalCount)
+{
+    if (m_bucketMax == m_bucketMin)
+    {
+        if (m_bucketMax == 0.0f)
+        {
+            m_zeroCount = equalCount;
+        } else {
+            if (m_bucketMax < 0.0f)
             {
-                m_buckets[numBuckets - 1] = m_cumulative[numBuckets - 1] - m_cumulative[numBuckets - 2];
+                m_negCount = equalCount;
             } else {
-                m_buckets[numBuckets - 1] = m_cumulative[numBuckets - 1];
+                m_posCount = equalCount;
             }
         }
-        return;
+        splitEvenly(equalCount);
     }
+}
+
+void Histogram::updateLimited(const float* data, const int64_t& dataCount, const float& mostPositiveValueInclusive,
+                              const float& leastPositiveValueInclusive, const float& leastNegativeValueInclusive,
+                              const float& mostNegativeValueInclusive, const bool& includeZeroValues)
+{
+    int numBuckets = (int)m_buckets.size();
     float bucketsize = (m_bucketMax - m_bucketMin) / numBuckets;
     for (int64_t i = 0; i < dataCount; ++i)//do the histogram
     {//count value classes
@@ -315,15 +485,59 @@ void Histogram::update(const float* data, const int64_t& dataCount, float mostPo
         CaretAssertVectorIndex(m_buckets, bucket);
         ++m_buckets[bucket];
     }
-    computeCumulative();
-    m_displayHeightMax = 0.0;
-    for (int i = 0; i < numBuckets; ++i)
-    {//compute display values by normalizing by bucket size
-        m_display[i] = m_buckets[i] / bucketsize;
-        if (m_display[i] > m_displayHeightMax) {
-            m_displayHeightMax = m_display[i];
-        }
+}
+
+void Histogram::writeBinary(ostream& output) const
+{
+    int32_t numBuckets = (int32_t)m_buckets.size();
+    int64_t counts[6] = { m_posCount, m_zeroCount, m_negCount, m_infCount, m_negInfCount, m_nanCount };
+    output.write((const char*)&numBuckets, sizeof(numBuckets));
+    output.write((const char*)counts, sizeof(counts));
+    output.write((const char*)&m_bucketMin, sizeof(m_bucketMin));
+    output.write((const char*)&m_bucketMax, sizeof(m_bucketMax));
+    output.write((const char*)m_buckets.data(), numBuckets * sizeof(int64_t));//cumulative and display are recomputed on reading
+}
+
+bool Histogram::readBinary(istream& input)
+{
+    int32_t numBuckets = 0;
+    int64_t counts[6];
+    input.read((char*)&numBuckets, sizeof(numBuckets));
+    if (!input || numBuckets < 1 || numBuckets > (1 << 24)) return false;
+    input.read((char*)counts, sizeof(counts));
+    float bucketMin = 0.0f, bucketMax = 0.0f;
+    input.read((char*)&bucketMin, sizeof(bucketMin));
+    input.read((char*)&bucketMax, sizeof(bucketMax));
+    vector<int64_t> buckets(numBuckets);
+    input.read((char*)buckets.data(), numBuckets * sizeof(int64_t));
+    if (!input) return false;
+    if (!(bucketMin <= bucketMax)) return false;//also rejects NaN
+    for (int i = 0; i < 6; ++i)
+    {
+        if (counts[i] < 0) return false;
+    }
+    for (int32_t i = 0; i < numBuckets; ++i)
+    {
+        if (buckets[i] < 0) return false;
+    }
+    resize(numBuckets);
+    reset();
+    m_posCount = counts[0];
+    m_zeroCount = counts[1];
+    m_negCount = counts[2];
+    m_infCount = counts[3];
+    m_negInfCount = counts[4];
+    m_nanCount = counts[5];
+    m_buckets = buckets;
+    m_bucketMin = bucketMin;
+    m_bucketMax = bucketMax;
+    if (m_bucketMax > m_bucketMin)
+    {
+        finishBuckets();
+    } else {
+        computeCumulative();//zero range histograms have zero display values
     }
+    return true;
 }
 
 void Histogram::computeCumulative()
@@ -21,12 +21,15 @@
  */
 /*LICENSE_END*/
 
+#include <iosfwd>
 #include <vector>
 #include "stdint.h"
 
 namespace caret
 {
     
+    class DataBlockSource;
+    
     class Histogram
     {
         std::vector<int64_t> m_buckets, m_cumulative;
@@ -43,6 +46,28 @@ namespace caret
         
         void computeCumulative();
         
+        void splitEvenly(const int64_t& count);
+        
+        void finishBuckets();
+        
+        bool setLimitedRange(float& mostPositiveValueInclusive,
+                             float& leastPositiveValueInclusive,
+                             float& leastNegativeValueInclusive,
+                             float& mostNegativeValueInclusive,
+                             const bool& includeZeroValues);
+        
+        void updateLimited(const float* data,
+                           const int64_t& dataCount,
+                           const float& mostPositiveValueInclusive,
+                           const float& leastPositiveValueInclusive,
+                           const float& leastNegativeValueInclusive,
+                           const float& mostNegativeValueInclusive,
+                           const bool& includeZeroValues);
+        
+        void updateLimitedBadRange(const float* data, const int64_t& dataCount, int64_t& equalCount);
+        
+        void finishLimitedBadRange(const int64_t& equalCount);
+        
         void update(const float* data,
                     const int64_t& dataCount,
                     float mostPositiveValueInclusive,
@@ -71,6 +96,43 @@ namespace caret
                     float mostNegativeValueInclusive,
                     const bool& includeZeroValues);
         
+        ///same as above, but reads the data a block at a time, and processes the blocks in parallel
+        void update(const int& numBuckets, const DataBlockSource& blockSource);
+        
+        void update(const int32_t& numBuckets,
+                    const DataBlockSource& blockSource,
+                    float mostPositiveValueInclusive,
+                    float leastPositiveValueInclusive,
+                    float leastNegativeValueInclusive,
+                    float mostNegativeValueInclusive,
+                    const bool& includeZeroValues);
+        
+        ///the steps of update() without limits, for data that isn't in one array: startUpdate(), updateRange() on all data,
+        ///startBuckets(), updateBuckets() on all data if hasBucketRange(), finishUpdate()
+        ///partial results can be computed separately (in parallel): merge range pieces with mergeRange(), and for the bucket
+        ///pass, start each piece as a copy of this histogram after startBuckets(), and merge them with mergeBuckets()
+        void startUpdate();
+        
+        void updateRange(const float* data, const int64_t& dataCount);
+        
+        void mergeRange(const Histogram& other);
+        
+        void startBuckets(const int& numBuckets);
+        
+        bool hasBucketRange() const;
+        
+        void updateBuckets(const float* data, const int64_t& dataCount);
+        
+        void mergeBuckets(const Histogram& other);
+        
+        void finishUpdate();
+        
+        ///for caching a histogram in a file on the same machine, values are written in native byte order
+        void writeBinary(std::ostream& output) const;
+        
+        ///returns false if the input does not contain a histogram
+        bool readBinary(std::istream& input);
+        
         ///get raw counts (useful mathematically)
         const std::vector<int64_t>& getHistogramCounts() const { return m_buckets; }
         
@@ -0,0 +1,277 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2019  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "TFCEHelper.h"
+#include "CaretAssert.h"
+#include "CaretOMP.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace caret;
+using namespace std;
+
+namespace
+{
+    bool orderCompare(const pair<float, int64_t>& left, const pair<float, int64_t>& right)
+    {//descending by value, ties by index so the order doesn't depend on the sort implementation
+        if (left.first != right.first) return left.first > right.first;
+        return left.second < right.second;
+    }
+}
+
+TFCEHelper::TFCEHelper(const vector<int64_t>& neighborStart, const vector<int32_t>& neighbors, const vector<float>& sizes, const float* roiData)
+{
+    m_numElements = (int64_t)sizes.size();
+    CaretAssert((int64_t)neighborStart.size() == m_numElements + 1);
+    CaretAssert(neighborStart.back() == (int64_t)neighbors.size());
+    m_neighborStart = neighborStart;
+    m_neighbors = neighbors;
+    m_sizes = sizes;
+    m_dims[0] = 0;
+    m_dims[1] = 0;
+    m_dims[2] = 0;
+    m_voxelSize = 0.0f;
+    m_volumeMode = false;
+    m_included.resize(m_numElements, 1);
+    if (roiData != NULL)
+    {
+        for (int64_t i = 0; i < m_numElements; ++i)
+        {
+            m_included[i] = (roiData[i] > 0.0f ? 1 : 0);
+        }
+    }
+}
+
+TFCEHelper::TFCEHelper(const int64_t dims[3], const float& voxelSize, const float* roiData)
+{
+    m_numElements = dims[0] * dims[1] * dims[2];
+    m_dims[0] = dims[0];
+    m_dims[1] = dims[1];
+    m_dims[2] = dims[2];
+    m_voxelSize = voxelSize;
+    m_volumeMode = true;
+    m_included.resize(m_numElements, 1);
+    if (roiData != NULL)
+    {
+        for (int64_t i = 0; i < m_numElements; ++i)
+        {
+            m_included[i] = (roiData[i] > 0.0f ? 1 : 0);
+        }
+    }
+}
+
+void TFCEHelper::Scratch::resize(const int64_t& numElements)
+{
+    m_order.reserve(numElements);
+    m_parent.resize(numElements);
+    m_count.resize(numElements);
+    m_offset.resize(numElements);
+    m_accum.resize(numElements);
+    m_size.resize(numElements);
+    m_lastPow.resize(numElements);
+    m_lastVal.resize(numElements);
+}
+
+int64_t TFCEHelper::Scratch::getBytesPerElement()
+{
+    return sizeof(pair<float, int64_t>) + 2 * sizeof(int64_t) + 4 * sizeof(double) + sizeof(float) + sizeof(double);
+}
+
+int64_t TFCEHelper::findRoot(const int64_t& element, Scratch& scratch) const
+{
+    int64_t root = element;
+    scratch.m_path.clear();
+    while (scratch.m_parent[root] != root)
+    {
+        scratch.m_path.push_back(root);
+        root = scratch.m_parent[root];
+    }
+    double offsetToRoot = 0.0;
+    for (int64_t i = (int64_t)scratch.m_path.size() - 1; i >= 0; --i)
+    {//compress the path, each offset becomes the total offset to the root (the root's own offset is always zero)
+        int64_t node = scratch.m_path[i];
+        offsetToRoot += scratch.m_offset[node];
+        scratch.m_offset[node] = offsetToRoot;
+        scratch.m_parent[node] = root;
+    }
+    return root;
+}
+
+void TFCEHelper::addRoot(const int64_t& neighbor, Scratch& scratch) const
+{
+    if (scratch.m_parent[neighbor] == -1) return;//not in a cluster yet
+    int64_t root = findRoot(neighbor, scratch);
+    if (find(scratch.m_roots.begin(), scratch.m_roots.end(), root) == scratch.m_roots.end())
+    {
+        scratch.m_roots.push_back(root);
+    }
+}
+
+void TFCEHelper::tfceOneSign(const float* data, const bool& negate, double* accumData, Scratch& scratch, const float& param_e, const float& param_h) const
+{
+    const double integrated_h = param_h + 1.0f;//integral(x^h) = (x^(h + 1))/(h + 1) + C
+    scratch.m_order.clear();
+    for (int64_t i = 0; i < m_numElements; ++i)
+    {
+        scratch.m_parent[i] = -1;
+        if (!m_included[i]) continue;
+        float value = (negate ? -data[i] : data[i]);
+        if (value > 0.0f)
+        {
+            scratch.m_order.push_back(make_pair(value, i));
+        }
+    }
+    sort(scratch.m_order.begin(), scratch.m_order.end(), orderCompare);
+    int64_t numOrdered = (int64_t)scratch.m_order.size();
+    for (int64_t o = 0; o < numOrdered; ++o)
+    {
+        const float value = scratch.m_order[o].first;
+        const int64_t element = scratch.m_order[o].second;
+        const double valuePow = pow((double)value, integrated_h);
+        const double elementSize = (m_volumeMode ? m_voxelSize : m_sizes[element]);
+        scratch.m_roots.clear();
+        if (m_volumeMode)
+        {
+            const int64_t i = element % m_dims[0], j = (element / m_dims[0]) % m_dims[1], k = element / (m_dims[0] * m_dims[1]);
+            const int64_t jStride = m_dims[0], kStride = m_dims[0] * m_dims[1];
+            if (k > 0) addRoot(element - kStride, scratch);
+            if (j > 0) addRoot(element - jStride, scratch);
+            if (i > 0) addRoot(element - 1, scratch);
+            if (i < m_dims[0] - 1) addRoot(element + 1, scratch);
+            if (j < m_dims[1] - 1) addRoot(element + jStride, scratch);
+            if (k < m_dims[2] - 1) addRoot(element + kStride, scratch);
+        } else {
+            for (int64_t n = m_neighborStart[element]; n < m_neighborStart[element + 1]; ++n)
+            {
+                addRoot(m_neighbors[n], scratch);
+            }
+        }
+        if (scratch.m_roots.empty())
+        {//make new cluster, the root of a cluster is always the element that started it
+            scratch.m_parent[element] = element;
+            scratch.m_count[element] = 1;
+            scratch.m_offset[element] = 0.0;
+            scratch.m_accum[element] = 0.0;
+            scratch.m_size[element] = elementSize;
+            scratch.m_lastVal[element] = value;
+            scratch.m_lastPow[element] = valuePow;
+            continue;
+        }
+        int64_t merged = -1;
+        for (int64_t r = 0; r < (int64_t)scratch.m_roots.size(); ++r)
+        {
+            int64_t root = scratch.m_roots[r];
+            if (scratch.m_lastVal[root] != value)//skip computing if there is no difference
+            {//add the slice between the previous value and this one, to align cluster bottoms
+                CaretAssert(value < scratch.m_lastVal[root]);
+                scratch.m_accum[root] += pow(scratch.m_size[root], (double)param_e) * (scratch.m_lastPow[root] - valuePow) / integrated_h;
+                scratch.m_lastVal[root] = value;
+                scratch.m_lastPow[root] = valuePow;//computing in double precision, with float for inputs, puts the smallest difference between values far greater than the instability of the computation
+            }
+            if (merged == -1 || scratch.m_count[root] > scratch.m_count[merged]) merged = root;//union by size keeps the trees shallow
+        }
+        for (int64_t r = 0; r < (int64_t)scratch.m_roots.size(); ++r)
+        {
+            int64_t root = scratch.m_roots[r];
+            if (root == merged) continue;
+            scratch.m_parent[root] = merged;
+            scratch.m_offset[root] = scratch.m_accum[root] - scratch.m_accum[merged];//the correction for the whole side cluster, applied lazily through the tree instead of to every member
+            scratch.m_count[merged] += scratch.m_count[root];
+            scratch.m_size[merged] += scratch.m_size[root];
+        }
+        scratch.m_parent[element] = merged;
+        scratch.m_offset[element] = -scratch.m_accum[merged];//the element they join or merge on must not get the peak value of the cluster, so record its difference from peak
+        scratch.m_count[merged] += 1;
+        scratch.m_size[merged] += elementSize;
+    }
+    for (int64_t o = 0; o < numOrdered; ++o)
+    {//final cleanup: add the to-zero slice to each cluster, then give every element its cluster's value plus its offset
+        const int64_t element = scratch.m_order[o].second;
+        if (scratch.m_parent[element] == element)
+        {
+            scratch.m_accum[element] += pow(scratch.m_size[element], (double)param_e) * scratch.m_lastPow[element] / integrated_h;
+        }
+    }
+    for (int64_t o = 0; o < numOrdered; ++o)
+    {
+        const int64_t element = scratch.m_order[o].second;
+        int64_t root = findRoot(element, scratch);
+        if (root == element)
+        {
+            accumData[element] += scratch.m_accum[root];
+        } else {
+            accumData[element] += scratch.m_accum[root] + scratch.m_offset[element];
+        }
+    }
+}
+
+void TFCEHelper::computeColumn(const float* data, float* outData, vector<double>& accum, Scratch& scratch, const float& param_e, const float& param_h) const
+{
+    accum.assign(m_numElements, 0.0);
+    tfceOneSign(data, false, accum.data(), scratch, param_e, param_h);
+    tfceOneSign(data, true, accum.data(), scratch, param_e, param_h);//negatives and positives don't overlap, so reuse the accum array
+    for (int64_t i = 0; i < m_numElements; ++i)
+    {
+        if (m_included[i])
+        {
+            if (data[i] < 0.0f)
+            {
+                outData[i] = (float)-accum[i];
+            } else {
+                outData[i] = (float)accum[i];
+            }
+        } else {
+            outData[i] = 0.0f;
+        }
+    }
+}
+
+void TFCEHelper::compute(const float* data, float* outData, const float& param_e, const float& param_h) const
+{
+    vector<double> accum;
+    Scratch scratch;
+    scratch.resize(m_numElements);
+    computeColumn(data, outData, accum, scratch, param_e, param_h);
+}
+
+void TFCEHelper::computeColumns(const vector<const float*>& data, const vector<float*>& outData, const float& param_e, const float& param_h) const
+{
+    CaretAssert(data.size() == outData.size());
+    int64_t numColumns = (int64_t)data.size();
+    const int64_t SCRATCH_BUDGET = ((int64_t)1) << 31;//all threads together, large volumes would otherwise need gigabytes per thread
+    int64_t numThreads = 1;
+#ifdef CARET_OMP
+    numThreads = omp_get_max_threads();
+#endif
+    numThreads = min(numThreads, SCRATCH_BUDGET / max((int64_t)1, m_numElements * Scratch::getBytesPerElement()));
+    numThreads = max((int64_t)1, min(numThreads, numColumns));//no point in scratch for threads that won't get a column
+#pragma omp CARET_PAR num_threads(numThreads)
+    {
+        vector<double> accum;
+        Scratch scratch;//allocated once per thread, not per column
+        scratch.resize(m_numElements);
+#pragma omp CARET_FOR schedule(dynamic)
+        for (int64_t col = 0; col < numColumns; ++col)
+        {
+            computeColumn(data[col], outData[col], accum, scratch, param_e, param_h);
+        }
+    }
+}
@@ -0,0 +1,81 @@
+#ifndef __TFCE_HELPER_H__
+#define __TFCE_HELPER_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2019  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+#include "stdint.h"
+
+namespace caret
+{
+    
+    ///threshold-free cluster enhancement on any set of elements with neighbors (surface vertices, voxels), the neighborhoods are set up once so many columns
+    ///(for instance, permutations) can be processed without redoing any setup, clusters are tracked with union-find, so merging clusters takes near-constant time
+    class TFCEHelper
+    {
+        std::vector<int64_t> m_neighborStart;//neighbors of element i are m_neighbors[m_neighborStart[i]] to m_neighbors[m_neighborStart[i + 1] - 1]
+        std::vector<int32_t> m_neighbors;//surface topology uses int32 vertex indices
+        std::vector<float> m_sizes;
+        std::vector<char> m_included;
+        int64_t m_numElements;
+        int64_t m_dims[3];//for voxels, the face neighbors are computed from the index, instead of being stored
+        float m_voxelSize;
+        bool m_volumeMode;
+        
+        struct Scratch
+        {
+            std::vector<std::pair<float, int64_t> > m_order;
+            std::vector<int64_t> m_parent, m_count, m_roots, m_path;//parent is -1 until the element is reached by the threshold
+            std::vector<double> m_offset, m_accum, m_size, m_lastPow;//per-element offset from its cluster's accumulated value, applies to the element's whole subtree
+            std::vector<float> m_lastVal;
+            void resize(const int64_t& numElements);
+            static int64_t getBytesPerElement();//including the accumulation array that goes with each scratch
+        };
+        
+        int64_t findRoot(const int64_t& element, Scratch& scratch) const;
+        
+        void addRoot(const int64_t& neighbor, Scratch& scratch) const;
+        
+        ///adds the integral for one sign of the data to accumData, elements of the other sign are not modified
+        void tfceOneSign(const float* data, const bool& negate, double* accumData, Scratch& scratch, const float& param_e, const float& param_h) const;
+        
+        void computeColumn(const float* data, float* outData, std::vector<double>& accum, Scratch& scratch, const float& param_e, const float& param_h) const;
+    public:
+        ///neighborStart has numElements + 1 entries, sizes are the areas of the elements, elements with roi values not greater than zero are excluded (and output zero)
+        TFCEHelper(const std::vector<int64_t>& neighborStart, const std::vector<int32_t>& neighbors, const std::vector<float>& sizes, const float* roiData = NULL);
+        
+        ///voxels of a volume frame with the given dimensions, with i varying fastest, neighbors are the 6 voxels that share a face
+        TFCEHelper(const int64_t dims[3], const float& voxelSize, const float* roiData = NULL);
+        
+        int64_t getNumberOfElements() const { return m_numElements; }
+        
+        ///enhance positive and negative values separately, output has the same sign as the input
+        void compute(const float* data, float* outData, const float& param_e, const float& param_h) const;
+        
+        ///same as compute() on many columns, processed in parallel
+        void computeColumns(const std::vector<const float*>& data, const std::vector<float*>& outData, const float& param_e, const float& param_h) const;
+    };
+    
+}
+
+#endif //__TFCE_HELPER_H__
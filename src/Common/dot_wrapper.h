@@ -23,6 +23,12 @@ inline double dsdot (const float *a, const float *b, int n)
     sum += a[k] * b[k];
   return sum;
 }  // dsdot()
+inline void dsdot_tile (const float *const *a, int na, const float *const *b, int nb, int n, double *c, int ldc)
+{
+  for (int i = 0; i < na; i++)
+    for (int j = 0; j < nb; j++)
+      c[i * ldc + j] = dsdot(a[i], b[j], n);
+}  // dsdot_tile()
 //copy enum from dot.h
 //renamed to dot_flags in both files for less conflict chance
 typedef enum {
@@ -720,6 +720,10 @@ void printHelp(const AString& progName)
     << "    -help" << endl
     << "        display this usage text" << endl
     << endl
+    << "    -event-profiling" << endl
+    << "        Record the time spent processing each type of event and" << endl
+    << "        by each event listener and print the times on exit." << endl
+    << endl
     << "    -graphics-size  <X Y>" << endl
     << "        Set the size of the graphics region." << endl
     << "        If this option is used you WILL NOT be able" << endl
@@ -804,6 +808,8 @@ void parseCommandLine(const AString& progName, ProgramParameters* myParams, Prog
                 } else if (thisParam == "-help") {
                     printHelp(progName);
                     exit(0);
+                } else if (thisParam == "-event-profiling") {
+                    EventManager::get()->setProfilingEnabled(true);
                 } else if (thisParam == "-logging") {
                     if (myParams->hasNext()) {
                         const AString logLevelName = myParams->nextString("Logging Level").toUpper();
@@ -25,35 +25,95 @@
 
 #include "AnnotationFile.h"
 #include "AnnotationTextSubstitutionFile.h"
+#include "ApplicationTypeEnum.h"
+#include "BackgroundAndForegroundColorsModeEnum.h"
 #include "BorderFile.h"
+#include "ByteOrderEnum.h"
 #include "CaretAssert.h"
+#include "CaretColorEnum.h"
 #include "CaretLogger.h"
+#include "CaretUnitsTypeEnum.h"
 #include "CiftiBrainordinateDataSeriesFile.h"
 #include "CiftiBrainordinateLabelFile.h"
 #include "CiftiBrainordinateScalarFile.h"
-#include "CiftiConnectivityMatrixDenseFile.h"
 #include "CiftiConnectivityMatrixDenseDynamicFile.h"
+#include "CiftiConnectivityMatrixDenseFile.h"
 #include "CiftiConnectivityMatrixDenseParcelFile.h"
 #include "CiftiConnectivityMatrixParcelDenseFile.h"
 #include "CiftiConnectivityMatrixParcelFile.h"
+#include "CiftiFiberOrientationFile.h"
+#include "CiftiFiberTrajectoryFile.h"
 #include "CiftiFile.h"
+#include "CiftiParcelColoringModeEnum.h"
 #include "CiftiParcelLabelFile.h"
 #include "CiftiParcelScalarFile.h"
 #include "CiftiParcelSeriesFile.h"
-#include "CiftiFiberOrientationFile.h"
-#include "CiftiFiberTrajectoryFile.h"
 #include "CiftiScalarDataSeriesFile.h"
+#include "DataFileTypeEnum.h"
+#include "DeveloperFlagsEnum.h"
+#include "DisplayGroupEnum.h"
+#include "EventTypeEnum.h"
+#include "FiberOrientationColoringTypeEnum.h"
+#include "FiberTrajectoryDisplayModeEnum.h"
 #include "FileInformation.h"
 #include "FociFile.h"
+#include "GiftiArrayIndexingOrderEnum.h"
+#include "GiftiEncodingEnum.h"
+#include "GiftiEndianEnum.h"
+#include "GroupAndNameCheckStateEnum.h"
+#include "ImageCaptureDimensionsModeEnum.h"
+#include "ImageCaptureMethodEnum.h"
 #include "ImageFile.h"
+#include "ImageResolutionUnitsEnum.h"
+#include "ImageSpatialUnitsEnum.h"
+#include "LabelDrawingTypeEnum.h"
 #include "LabelFile.h"
+#include "LogLevelEnum.h"
+#include "MapYokingGroupEnum.h"
+#include "MathFunctionEnum.h"
 #include "MetricFile.h"
+#include "NiftiEnums.h"
+#include "NumericFormatModeEnum.h"
+#include "OpenGLDrawingMethodEnum.h"
+#include "PaletteColorBarValuesModeEnum.h"
+#include "PaletteEnums.h"
 #include "PaletteFile.h"
+#include "PaletteHistogramRangeModeEnum.h"
+#include "PaletteInvertModeEnum.h"
+#include "PaletteModifiedStatusEnum.h"
+#include "PaletteNormalizationModeEnum.h"
+#include "PaletteThresholdOutlineDrawingModeEnum.h"
+#include "PaletteThresholdRangeModeEnum.h"
+#include "ReductionEnum.h"
 #include "RgbaFile.h"
 #include "SceneFile.h"
 #include "SpecFile.h"
+#include "SpecFileDialogViewFilesTypeEnum.h"
+#include "SpeciesEnum.h"
+#include "StereotaxicSpaceEnum.h"
+#include "StructureEnum.h"
 #include "SurfaceFile.h"
+#include "SurfaceResamplingMethodEnum.h"
+#include "SurfaceTypeEnum.h"
+#include "TileTabsConfigurationLayoutTypeEnum.h"
+#include "TileTabsGridModeEnum.h"
+#include "TileTabsGridRowColumnContentTypeEnum.h"
+#include "TileTabsGridRowColumnStretchTypeEnum.h"
+#include "TriStateSelectionStatusEnum.h"
+#include "VolumeEditingModeEnum.h"
 #include "VolumeFile.h"
+#include "VolumeSliceProjectionTypeEnum.h"
+#include "VolumeSliceViewAllPlanesLayoutEnum.h"
+#include "VolumeSliceViewPlaneEnum.h"
+#include "WorkbenchSpecialVersionEnum.h"
+#include "WuQMacroCommandTypeEnum.h"
+#include "WuQMacroDataValueTypeEnum.h"
+#include "WuQMacroModeEnum.h"
+#include "WuQMacroMouseEventTypeEnum.h"
+#include "WuQMacroShortCutKeyEnum.h"
+#include "WuQMacroStandardItemTypeEnum.h"
+#include "WuQMacroWidgetTypeEnum.h"
+#include "YokingGroupEnum.h"
 
 #include "nifti2.h"
 
@@ -483,4 +543,93 @@ CaretDataFileHelper::getDataFileTypeFromFileContent(const AString& filename)
     return dataFileType;
 }
 
-
+/**
+ * Initialize the enumerated types of the libraries that file reading uses
+ * (Common, Gifti, Palette, FilesBase, and Files).  Each enumerated type
+ * builds its table the first time it is used, which is not safe when that
+ * first use happens on several threads at once, as it can when files are
+ * read concurrently or an algorithm runs in parallel.  Call this on the
+ * main thread before starting other threads; it is called when the session
+ * manager is created.  New enumerated types in those libraries must be
+ * added here.
+ */
+void
+CaretDataFileHelper::initializeEnumeratedTypes()
+{
+    static bool initializedFlag = false;
+    if (initializedFlag) {
+        return;
+    }
+    initializedFlag = true;
+    
+    const AString name("");
+    bool validFlag = false;
+    ApplicationTypeEnum::fromName(name, &validFlag);
+    BackgroundAndForegroundColorsModeEnum::fromName(name, &validFlag);
+    ByteOrderEnum::fromName(name, &validFlag);
+    CaretColorEnum::fromName(name, &validFlag);
+    CaretUnitsTypeEnum::fromName(name, &validFlag);
+    CiftiParcelColoringModeEnum::fromName(name, &validFlag);
+    DataFileTypeEnum::fromName(name, &validFlag);
+    DeveloperFlagsEnum::fromName(name, &validFlag);
+    DisplayGroupEnum::fromName(name, &validFlag);
+    EventTypeEnum::fromName(name, &validFlag);
+    FiberOrientationColoringTypeEnum::fromName(name, &validFlag);
+    FiberTrajectoryDisplayModeEnum::fromName(name, &validFlag);
+    GiftiArrayIndexingOrderEnum::fromName(name, &validFlag);
+    GiftiEncodingEnum::fromName(name, &validFlag);
+    GiftiEndianEnum::fromName(name, &validFlag);
+    GroupAndNameCheckStateEnum::fromName(name, &validFlag);
+    ImageCaptureDimensionsModeEnum::fromName(name, &validFlag);
+    ImageCaptureMethodEnum::fromName(name, &validFlag);
+    ImageResolutionUnitsEnum::fromName(name, &validFlag);
+    ImageSpatialUnitsEnum::fromName(name, &validFlag);
+    LabelDrawingTypeEnum::fromName(name, &validFlag);
+    LogLevelEnum::fromName(name, &validFlag);
+    MapYokingGroupEnum::fromName(name, &validFlag);
+    MathFunctionEnum::fromName(name, &validFlag);
+    NiftiDataTypeEnum::fromName(name, &validFlag);
+    NiftiIntentEnum::fromName(name, &validFlag);
+    NiftiSpacingUnitsEnum::fromName(name, &validFlag);
+    NiftiTimeUnitsEnum::fromName(name, &validFlag);
+    NiftiTransformEnum::fromName(name, &validFlag);
+    NiftiVersionEnum::fromName(name, &validFlag);
+    NumericFormatModeEnum::fromName(name, &validFlag);
+    OpenGLDrawingMethodEnum::fromName(name, &validFlag);
+    PaletteColorBarValuesModeEnum::fromName(name, &validFlag);
+    PaletteHistogramRangeModeEnum::fromName(name, &validFlag);
+    PaletteInvertModeEnum::fromName(name, &validFlag);
+    PaletteModifiedStatusEnum::fromName(name, &validFlag);
+    PaletteNormalizationModeEnum::fromName(name, &validFlag);
+    PaletteScaleModeEnum::fromName(name, &validFlag);
+    PaletteThresholdOutlineDrawingModeEnum::fromName(name, &validFlag);
+    PaletteThresholdRangeModeEnum::fromName(name, &validFlag);
+    PaletteThresholdTestEnum::fromName(name, &validFlag);
+    PaletteThresholdTypeEnum::fromName(name, &validFlag);
+    ReductionEnum::fromName(name, &validFlag);
+    SecondarySurfaceTypeEnum::fromName(name, &validFlag);
+    SpecFileDialogViewFilesTypeEnum::fromName(name, &validFlag);
+    SpeciesEnum::fromName(name, &validFlag);
+    StereotaxicSpaceEnum::fromName(name, &validFlag);
+    StructureEnum::fromName(name, &validFlag);
+    SurfaceResamplingMethodEnum::fromName(name, &validFlag);
+    SurfaceTypeEnum::fromName(name, &validFlag);
+    TileTabsConfigurationLayoutTypeEnum::fromName(name, &validFlag);
+    TileTabsGridModeEnum::fromName(name, &validFlag);
+    TileTabsGridRowColumnContentTypeEnum::fromName(name, &validFlag);
+    TileTabsGridRowColumnStretchTypeEnum::fromName(name, &validFlag);
+    TriStateSelectionStatusEnum::fromName(name, &validFlag);
+    VolumeEditingModeEnum::fromName(name, &validFlag);
+    VolumeSliceProjectionTypeEnum::fromName(name, &validFlag);
+    VolumeSliceViewAllPlanesLayoutEnum::fromName(name, &validFlag);
+    VolumeSliceViewPlaneEnum::fromName(name, &validFlag);
+    WorkbenchSpecialVersionEnum::fromName(name, &validFlag);
+    WuQMacroCommandTypeEnum::fromName(name, &validFlag);
+    WuQMacroDataValueTypeEnum::fromName(name, &validFlag);
+    WuQMacroModeEnum::fromName(name, &validFlag);
+    WuQMacroMouseEventTypeEnum::fromName(name, &validFlag);
+    WuQMacroShortCutKeyEnum::fromName(name, &validFlag);
+    WuQMacroStandardItemTypeEnum::fromName(name, &validFlag);
+    WuQMacroWidgetTypeEnum::fromName(name, &validFlag);
+    YokingGroupEnum::fromName(name, &validFlag);
+}
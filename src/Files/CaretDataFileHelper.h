@@ -39,6 +39,8 @@ namespace caret {
         
         static CaretDataFile* createCaretDataFileForFileType(const DataFileTypeEnum::Enum dataFileType);
         
+        static void initializeEnumeratedTypes();
+        
     private:
         CaretDataFileHelper();
         
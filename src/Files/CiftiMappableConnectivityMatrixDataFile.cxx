@@ -28,6 +28,7 @@
 #include "CaretLogger.h"
 #include "ChartableMatrixParcelInterface.h"
 #include "ConnectivityDataLoaded.h"
+#include "ConnectivityMatrixRowCache.h"
 #include "DataFileException.h"
 #include "ElapsedTimer.h"
 #include "EventManager.h"
@@ -52,6 +53,7 @@ CiftiMappableConnectivityMatrixDataFile::CiftiMappableConnectivityMatrixDataFile
 : CiftiMappableDataFile(dataFileType)
 {
     m_connectivityDataLoaded = new ConnectivityDataLoaded();
+    m_rowCacheFileKey = -1;
     
     /*
      * This method initializes some members
@@ -83,6 +85,12 @@ CiftiMappableConnectivityMatrixDataFile::~CiftiMappableConnectivityMatrixDataFil
 void
 CiftiMappableConnectivityMatrixDataFile::clear()
 {
+    /*
+     * Cached rows must be released before the parent class
+     * closes the CIFTI file that they may be read from.
+     */
+    releaseRowCache();
+    
     CiftiMappableDataFile::clear();
     clearPrivate();
 }
@@ -94,6 +102,7 @@ CiftiMappableConnectivityMatrixDataFile::clear()
 void
 CiftiMappableConnectivityMatrixDataFile::clearPrivate()
 {
+    releaseRowCache();
     m_loadedRowData.clear();
     m_rowLoadedTextForMapName = "";
     m_rowLoadedText = "";
@@ -598,8 +607,9 @@ CiftiMappableConnectivityMatrixDataFile::getDataForColumn(float* dataOut, const
 void
 CiftiMappableConnectivityMatrixDataFile::getDataForRow(float* dataOut, const int64_t& index) const
 {
-    m_ciftiFile->getRow(dataOut,
-                        index);
+    readRowUsingCache(dataOut,
+                      index,
+                      false);
 }
 
 /**
@@ -632,8 +642,85 @@ CiftiMappableConnectivityMatrixDataFile::getProcessedDataForColumn(float* dataOu
 void
 CiftiMappableConnectivityMatrixDataFile::getProcessedDataForRow(float* dataOut, const int64_t& index) const
 {
-    m_ciftiFile->getRow(dataOut,
-                        index);
+    readRowUsingCache(dataOut,
+                      index,
+                      true);
+}
+
+/**
+ * Read a row using the row cache that is shared by all connectivity
+ * matrix files.  Files whose data is in memory or on the network
+ * read the row directly.
+ *
+ * @param dataOut
+ *     Output with data.
+ * @param index 
+ *     Index of the row.
+ * @param prefetchNeighborsFlag
+ *     If true, the rows nearest this row are read into the cache
+ *     in the background.
+ */
+void
+CiftiMappableConnectivityMatrixDataFile::readRowUsingCache(float* dataOut,
+                                                           const int64_t& index,
+                                                           const bool prefetchNeighborsFlag) const
+{
+    CaretAssert(m_ciftiFile);
+    if (m_ciftiFile->isInMemory()
+        || DataFile::isFileOnNetwork(getFileName())) {
+        m_ciftiFile->getRow(dataOut,
+                            index);
+        return;
+    }
+    
+    ConnectivityMatrixRowCache* rowCache = ConnectivityMatrixRowCache::getCache();
+    if (m_rowCacheFileKey < 0) {
+        m_rowCacheFileKey = rowCache->newFileKey();
+    }
+    
+    const int64_t rowLength = m_ciftiFile->getNumberOfColumns();
+    if ( ! rowCache->getRow(m_rowCacheFileKey,
+                            index,
+                            dataOut,
+                            rowLength)) {
+        m_ciftiFile->getRow(dataOut,
+                            index);
+        rowCache->addRow(m_rowCacheFileKey,
+                         index,
+                         dataOut,
+                         rowLength);
+    }
+    
+    if (prefetchNeighborsFlag) {
+        /*
+         * Rows are in brainordinate order, so rows with nearby indices
+         * are usually nearby vertices or voxels in the same structure.
+         * Nearest rows are queued first.
+         */
+        const int64_t prefetchRadius = 8;
+        std::vector<int64_t> neighborRows;
+        for (int64_t offset = 1; offset <= prefetchRadius; offset++) {
+            neighborRows.push_back(index + offset);
+            neighborRows.push_back(index - offset);
+        }
+        rowCache->prefetchRows(m_rowCacheFileKey,
+                               m_ciftiFile,
+                               neighborRows);
+    }
+}
+
+/**
+ * Remove this file's rows from the row cache and stop any
+ * background reading of them.  Must be called before the
+ * CIFTI file is closed or replaced.
+ */
+void
+CiftiMappableConnectivityMatrixDataFile::releaseRowCache()
+{
+    if (m_rowCacheFileKey >= 0) {
+        ConnectivityMatrixRowCache::getCache()->removeFile(m_rowCacheFileKey);
+        m_rowCacheFileKey = -1;
+    }
 }
 
 /**
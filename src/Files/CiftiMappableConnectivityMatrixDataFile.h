@@ -139,6 +139,12 @@ namespace caret {
         
         void clearPrivate();
         
+        void readRowUsingCache(float* dataOut,
+                               const int64_t& index,
+                               const bool prefetchNeighborsFlag) const;
+        
+        void releaseRowCache();
+        
         void getRowColumnIndexForNodeWhenLoading(const StructureEnum::Enum structure,
                                                  const int64_t surfaceNumberOfNodes,
                                                  const int64_t nodeIndex,
@@ -185,6 +191,9 @@ namespace caret {
         
         ConnectivityDataLoaded* m_connectivityDataLoaded;
         
+        /** key of this file's rows in the ConnectivityMatrixRowCache, -1 if none */
+        mutable int64_t m_rowCacheFileKey;
+        
         /*
          * This is really a member of parcel file since it the parcel
          * file is the only file that can load by row or column.
@@ -18,7 +18,18 @@
  */
 /*LICENSE_END*/
 
+#include <algorithm>
 #include <set>
+#include <sstream>
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#if QT_VERSION >= 0x050000
+#include <QSaveFile>
+#include <QStandardPaths>
+#endif
 
 #define __CIFTI_MAPPABLE_DATA_FILE_DECLARE__
 #include "CiftiMappableDataFile.h"
@@ -45,6 +56,7 @@
 #include "CaretTemporaryFile.h"
 #include "CiftiXML.h"
 #include "ConnectivityDataLoaded.h"
+#include "DataBlockSource.h"
 #include "DataFileContentInformation.h"
 #include "EventManager.h"
 #include "EventCaretPreferencesGet.h"
@@ -61,9 +73,15 @@
 #include "NodeAndVoxelColoring.h"
 #include "PaletteColorMapping.h"
 #include "SparseVolumeIndexer.h"
+#include "SystemUtilities.h"
 
 using namespace caret;
 
+namespace {
+    /** First line of a file containing cached file statistics, changes if the format changes */
+    const char* FILE_STATISTICS_CACHE_IDENTIFIER = "Workbench File Statistics Cache Version 2";
+}
+
 
     
 /**
@@ -114,6 +132,7 @@ CiftiMappableDataFile::CiftiMappableDataFile(const DataFileTypeEnum::Enum dataFi
     m_fileFastStatistics.grabNew(NULL);
     m_fileHistogram.grabNew(NULL);
     m_fileHistorgramLimitedValues.grabNew(NULL);
+    m_fileStatisticsCacheAllowedFlag = false;
     
     /*
      * Note: The first palette normalization mode is assumed to
@@ -474,6 +493,8 @@ CiftiMappableDataFile::clearPrivate()
     
     m_brainordinateMapping.reset();
     m_brainordinateMappingCachedFlag = false;
+    
+    m_fileStatisticsCacheAllowedFlag = false;
 }
 
 /**
@@ -720,6 +741,8 @@ CiftiMappableDataFile::readFile(const AString& ciftiMapFileName)
     
     setFileName(ciftiMapFileName);
     clearModified();
+    
+    m_fileStatisticsCacheAllowedFlag = ( ! DataFile::isFileOnNetwork(ciftiMapFileName));
 }
 
 /**
@@ -1438,6 +1461,11 @@ CiftiMappableDataFile::setMapData(const int32_t mapIndex,
     m_forceUpdateOfGroupAndNameHierarchy = true;
     
     m_mapContent[mapIndex]->updateForChangeInMapData();
+    
+    m_fileFastStatistics.grabNew(NULL);
+    m_fileHistogram.grabNew(NULL);
+    m_fileHistorgramLimitedValues.grabNew(NULL);
+    m_fileStatisticsCacheAllowedFlag = false;
 }
 
 /**
@@ -1511,6 +1539,236 @@ CiftiMappableDataFile::getFileData(std::vector<float>& data) const
     }
 }
 
+/**
+ * @return A source of the file's data in blocks of rows for computing
+ * statistics without copying all of the file's data.
+ */
+DataBlockSource
+CiftiMappableDataFile::getFileDataBlockSource() const
+{
+    CaretAssert(m_ciftiFile);
+    const CiftiFile* ciftiFile = m_ciftiFile;
+    const int64_t numRows = ciftiFile->getNumberOfRows();
+    const int64_t numCols = ciftiFile->getNumberOfColumns();
+    
+    /*
+     * About four megabytes of rows in each block
+     */
+    const int64_t blockValues = 1024 * 1024;
+    const int64_t rowsPerBlock = std::max(static_cast<int64_t>(1),
+                                          blockValues / std::max(numCols, static_cast<int64_t>(1)));
+    const int64_t numBlocks = (numRows + rowsPerBlock - 1) / rowsPerBlock;
+    
+    return DataBlockSource([=](const int64_t& blockIndex,
+                               std::vector<float>& dataOut) {
+        const int64_t firstRow = blockIndex * rowsPerBlock;
+        const int64_t numBlockRows = std::min(rowsPerBlock,
+                                              numRows - firstRow);
+        dataOut.resize(numBlockRows * numCols);
+        ciftiFile->getRowBlock(dataOut.data(),
+                               firstRow,
+                               numBlockRows);
+    },
+                           numBlocks);
+}
+
+/**
+ * @return Key that identifies the content of the file on disk (name,
+ * size, modification time, and dimensions) for validating cached
+ * file statistics.  Empty if statistics may not be cached.
+ */
+AString
+CiftiMappableDataFile::getFileFastStatisticsCacheKey() const
+{
+    if ( ! m_fileStatisticsCacheAllowedFlag) {
+        return "";
+    }
+    
+    CaretAssert(m_ciftiFile);
+    QFileInfo fileInfo(getFileName());
+    if ( ! fileInfo.exists()) {
+        return "";
+    }
+    
+    return (fileInfo.absoluteFilePath()
+            + "|" + AString::number(fileInfo.size())
+            + "|" + AString::number(fileInfo.lastModified().toMSecsSinceEpoch())
+            + "|" + AString::number(m_ciftiFile->getNumberOfRows())
+            + "|" + AString::number(m_ciftiFile->getNumberOfColumns()));
+}
+
+/**
+ * @return Name of the file containing cached statistics for all data
+ * in this file.  The cache is in the user's cache directory so that it
+ * is not shared with other users and no file is written next to the
+ * user's data.
+ */
+AString
+CiftiMappableDataFile::getFileFastStatisticsCacheFileName() const
+{
+#if QT_VERSION >= 0x050000
+    AString cacheDirectory = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+#else
+    AString cacheDirectory = QDir(QDir::homePath()).filePath(".cache");
+#endif
+    if (cacheDirectory.isEmpty()) {
+        return "";
+    }
+    cacheDirectory = QDir(cacheDirectory).filePath("file_statistics");
+    
+    const QByteArray nameHash = QCryptographicHash::hash(QFileInfo(getFileName()).absoluteFilePath().toUtf8(),
+                                                         QCryptographicHash::Md5).toHex();
+    return FileInformation::assembleFileComponents(cacheDirectory,
+                                                   ("wb_file_statistics_"
+                                                    + AString(nameHash)
+                                                    + ".dat"));
+}
+
+/**
+ * Read the statistics for all data in the file from the cache.
+ * The cache file contains an identifier, the key of the file's
+ * content, a checksum of the statistics, and the statistics.
+ *
+ * @return
+ *     The statistics or NULL if there are no valid cached statistics
+ *     for the current content of the file.
+ */
+FastStatistics*
+CiftiMappableDataFile::readFileFastStatisticsCache() const
+{
+    const AString cacheKey = getFileFastStatisticsCacheKey();
+    if (cacheKey.isEmpty()) {
+        return NULL;
+    }
+    const AString cacheFileName = getFileFastStatisticsCacheFileName();
+    if (cacheFileName.isEmpty()) {
+        return NULL;
+    }
+    
+    QFile file(cacheFileName);
+    if ( ! file.open(QFile::ReadOnly)) {
+        return NULL;
+    }
+    const QByteArray bytes = file.readAll();
+    file.close();
+    
+    std::istringstream stream(std::string(bytes.constData(),
+                                          bytes.size()));
+    std::string line;
+    std::getline(stream, line);
+    if (line != FILE_STATISTICS_CACHE_IDENTIFIER) {
+        return NULL;
+    }
+    std::getline(stream, line);
+    if (AString::fromStdString(line) != cacheKey) {
+        return NULL;
+    }
+    std::string checksum;
+    std::getline(stream, checksum);
+    if ( ! stream) {
+        return NULL;
+    }
+    
+    /*
+     * A file that was truncated or damaged must not be used
+     */
+    const int64_t statisticsOffset = static_cast<int64_t>(stream.tellg());
+    const QByteArray statisticsChecksum = QCryptographicHash::hash(bytes.mid(statisticsOffset),
+                                                                   QCryptographicHash::Md5).toHex();
+    if (checksum != statisticsChecksum.constData()) {
+        CaretLogFine("Ignoring damaged cached statistics file "
+                     + cacheFileName);
+        return NULL;
+    }
+    
+    FastStatistics* fastStatistics = new FastStatistics();
+    if (( ! fastStatistics->readBinary(stream))
+        || (stream.peek() != std::char_traits<char>::eof())) {
+        CaretLogFine("Ignoring invalid cached statistics file "
+                     + cacheFileName);
+        delete fastStatistics;
+        return NULL;
+    }
+    
+    CaretLogFine("Read cached statistics for "
+                 + getFileNameNoPath());
+    return fastStatistics;
+}
+
+/**
+ * Write the statistics for all data in the file to the cache.  Failure
+ * to write the cache is not an error, the statistics are computed
+ * again the next time the file is read.  The file is replaced at once,
+ * so another instance of Workbench never reads a partially written file.
+ *
+ * @param fastStatistics
+ *     Statistics for all data in the file.
+ */
+void
+CiftiMappableDataFile::writeFileFastStatisticsCache(const FastStatistics* fastStatistics) const
+{
+    CaretAssert(fastStatistics);
+    const AString cacheKey = getFileFastStatisticsCacheKey();
+    if (cacheKey.isEmpty()) {
+        return;
+    }
+    const AString cacheFileName = getFileFastStatisticsCacheFileName();
+    if (cacheFileName.isEmpty()) {
+        return;
+    }
+    if ( ! QDir().mkpath(QFileInfo(cacheFileName).absolutePath())) {
+        CaretLogFine("Unable to create directory for cached statistics file "
+                     + cacheFileName);
+        return;
+    }
+    
+    std::ostringstream statisticsStream;
+    fastStatistics->writeBinary(statisticsStream);
+    const std::string statisticsBytes = statisticsStream.str();
+    const QByteArray statisticsChecksum = QCryptographicHash::hash(QByteArray(statisticsBytes.data(),
+                                                                              statisticsBytes.size()),
+                                                                   QCryptographicHash::Md5).toHex();
+    
+    std::ostringstream stream;
+    stream << FILE_STATISTICS_CACHE_IDENTIFIER << "\n";
+    stream << cacheKey.toStdString() << "\n";
+    stream << statisticsChecksum.constData() << "\n";
+    stream << statisticsBytes;
+    const std::string bytes = stream.str();
+    
+#if QT_VERSION >= 0x050000
+    QSaveFile file(cacheFileName);
+    if (( ! file.open(QFile::WriteOnly))
+        || (file.write(bytes.data(), bytes.size()) != static_cast<qint64>(bytes.size()))
+        || ( ! file.commit())) {
+        CaretLogFine("Unable to write cached statistics file "
+                     + cacheFileName);
+    }
+#else
+    /*
+     * Write to a temporary file and rename it
+     */
+    QFile file(cacheFileName
+               + "."
+               + SystemUtilities::createUniqueID()
+               + ".tmp");
+    bool successFlag = false;
+    if (file.open(QFile::WriteOnly)) {
+        successFlag = (file.write(bytes.data(), bytes.size()) == static_cast<qint64>(bytes.size()));
+        file.close();
+        if (successFlag) {
+            QFile::remove(cacheFileName);
+            successFlag = file.rename(cacheFileName);
+        }
+    }
+    if ( ! successFlag) {
+        file.remove();
+        CaretLogFine("Unable to write cached statistics file "
+                     + cacheFileName);
+    }
+#endif
+}
+
 /**
  * Get the RGBA mapped version of the file's data matrix.
  *
@@ -2158,12 +2416,19 @@ const FastStatistics*
 CiftiMappableDataFile::getFileFastStatistics()
 {
     if (m_fileFastStatistics == NULL) {
-        std::vector<float> fileData;
-        getFileData(fileData);
-        if ( ! fileData.empty()) {
-            m_fileFastStatistics.grabNew(new FastStatistics());
-            m_fileFastStatistics->update(&fileData[0],
-                                         fileData.size());
+        CaretAssert(m_ciftiFile);
+        if ((m_ciftiFile->getNumberOfRows() > 0)
+            && (m_ciftiFile->getNumberOfColumns() > 0)) {
+            m_fileFastStatistics.grabNew(readFileFastStatisticsCache());
+            if (m_fileFastStatistics == NULL) {
+                /*
+                 * Blocks of rows are read and processed in parallel so
+                 * that the file's data is never copied in its entirety
+                 */
+                m_fileFastStatistics.grabNew(new FastStatistics());
+                m_fileFastStatistics->update(getFileDataBlockSource());
+                writeFileFastStatisticsCache(m_fileFastStatistics);
+            }
         }
     }
     
@@ -2193,16 +2458,14 @@ CiftiMappableDataFile::getFileHistogram()
         updateHistogramFlag = true;
     }
     if (updateHistogramFlag) {
-        std::vector<float> fileData;
-        getFileData(fileData);
-        
-        if ( ! fileData.empty()) {
+        CaretAssert(m_ciftiFile);
+        if ((m_ciftiFile->getNumberOfRows() > 0)
+            && (m_ciftiFile->getNumberOfColumns() > 0)) {
             if (m_fileHistogram == NULL) {
                 m_fileHistogram.grabNew(new Histogram(numberOfBuckets));
             }
             m_fileHistogram->update(numberOfBuckets,
-                                    &fileData[0],
-                                    fileData.size());
+                                    getFileDataBlockSource());
             m_fileHistogramNumberOfBuckets = numberOfBuckets;
         }
     }
@@ -2252,15 +2515,14 @@ CiftiMappableDataFile::getFileHistogram(const float mostPositiveValueInclusive,
     }
     
     if (updateHistogramFlag) {
-        std::vector<float> fileData;
-        getFileData(fileData);
-        if ( ! fileData.empty()) {
+        CaretAssert(m_ciftiFile);
+        if ((m_ciftiFile->getNumberOfRows() > 0)
+            && (m_ciftiFile->getNumberOfColumns() > 0)) {
             if (m_fileHistorgramLimitedValues == NULL) {
                 m_fileHistorgramLimitedValues.grabNew(new Histogram());
             }
             m_fileHistorgramLimitedValues->update(numberOfBuckets,
-                                                  &fileData[0],
-                                                  fileData.size(),
+                                                  getFileDataBlockSource(),
                                                   mostPositiveValueInclusive,
                                                   leastPositiveValueInclusive,
                                                   leastNegativeValueInclusive,
@@ -41,6 +41,7 @@ namespace caret {
     class CiftiFile;
     class CiftiParcelsMap;
     class CiftiXML;
+    class DataBlockSource;
     class FastStatistics;
     class GraphicsPrimitiveV3fC4f;
     class GroupAndNameHierarchyModel;
@@ -683,6 +684,16 @@ namespace caret {
         
         void clearPrivate();
         
+        DataBlockSource getFileDataBlockSource() const;
+        
+        AString getFileFastStatisticsCacheFileName() const;
+        
+        AString getFileFastStatisticsCacheKey() const;
+        
+        FastStatistics* readFileFastStatisticsCache() const;
+        
+        void writeFileFastStatisticsCache(const FastStatistics* fastStatistics) const;
+        
     protected:
         void initializeAfterReading(const AString& filename);
         
@@ -826,6 +837,9 @@ namespace caret {
         /** Controls lazy initialization of m_brainordinateMapping */
         mutable bool m_brainordinateMappingCachedFlag = false;
         
+        /** True if the data is unchanged since it was read from a local file so the file statistics may be cached */
+        bool m_fileStatisticsCacheAllowedFlag = false;
+        
         // ADD_NEW_MEMBERS_HERE
         
     };
@@ -0,0 +1,517 @@
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#define __CONNECTIVITY_MATRIX_ROW_CACHE_DECLARE__
+#include "ConnectivityMatrixRowCache.h"
+#undef __CONNECTIVITY_MATRIX_ROW_CACHE_DECLARE__
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+
+#include <QThread>
+
+#include "CaretAssert.h"
+#include "CaretException.h"
+#include "CaretLogger.h"
+#include "CiftiFile.h"
+
+using namespace caret;
+
+namespace {
+    /** protects creation and deletion of the singleton, files use it from the GUI and from file reading threads */
+    QMutex s_singletonMutex;
+}
+
+    
+/**
+ * \class caret::ConnectivityMatrixRowCache
+ * \brief Size-bounded LRU cache of rows read from connectivity matrix files.
+ * \ingroup Files
+ *
+ * Rows are shared by all connectivity matrix files (dconn, dpconn, pdconn, etc)
+ * and are keyed by a file key that each file obtains from newFileKey() and
+ * releases with removeFile() before its CiftiFile is closed.  Rows near the
+ * most recently loaded row can be read in a background thread so that
+ * moving the mouse across a surface finds them already in memory.
+ */
+
+namespace caret {
+    /**
+     * Reads queued rows in the background.  Only one of these exists,
+     * owned by the cache, so rows of a file are never read concurrently
+     * by the cache itself.
+     */
+    class ConnectivityMatrixRowCacheThread : public QThread
+    {
+    public:
+        ConnectivityMatrixRowCacheThread(ConnectivityMatrixRowCache* cache) {
+            m_cache = cache;
+        }
+        
+        void run() {
+            ConnectivityMatrixRowCache::PrefetchJob job;
+            std::vector<float> rowData;
+            while (m_cache->takePrefetchJob(job)) {
+                const int64_t rowLength = job.m_ciftiFile->getNumberOfColumns();
+                rowData.resize(rowLength);
+                bool validFlag = true;
+                try {
+                    job.m_ciftiFile->getRow(&rowData[0],
+                                            job.m_rowIndex);
+                }
+                catch (const CaretException& e) {
+                    CaretLogFine("Prefetch of connectivity row failed: " + e.whatString());
+                    validFlag = false;
+                }
+                catch (const std::exception& e) {
+                    CaretLogFine("Prefetch of connectivity row failed: " + AString(e.what()));
+                    validFlag = false;
+                }
+                catch (...) {
+                    CaretLogFine("Prefetch of connectivity row failed with an unknown exception");
+                    validFlag = false;
+                }
+                m_cache->finishPrefetchJob(job,
+                                           (validFlag ? &rowData[0] : NULL),
+                                           rowLength);
+            }
+        }
+        
+    private:
+        ConnectivityMatrixRowCache* m_cache;
+    };
+}
+
+/**
+ * @return The one and only row cache, created if needed.
+ */
+ConnectivityMatrixRowCache*
+ConnectivityMatrixRowCache::getCache()
+{
+    QMutexLocker locker(&s_singletonMutex);
+    if (s_singleton == NULL) {
+        s_singleton = new ConnectivityMatrixRowCache();
+    }
+    return s_singleton;
+}
+
+/**
+ * Delete the row cache, stopping the prefetch thread.
+ * All files using the cache must have been destroyed.
+ */
+void
+ConnectivityMatrixRowCache::deleteCache()
+{
+    QMutexLocker locker(&s_singletonMutex);
+    if (s_singleton != NULL) {
+        delete s_singleton;
+        s_singleton = NULL;
+    }
+}
+
+/**
+ * Constructor.
+ */
+ConnectivityMatrixRowCache::ConnectivityMatrixRowCache()
+{
+    m_prefetchThread = NULL;
+    m_activeFileKey  = -1;
+    m_nextFileKey    = 0;
+    m_bytesUsed      = 0;
+    m_byteBudget     = static_cast<int64_t>(256) * 1024 * 1024;
+    m_stopPrefetchThread = false;
+}
+
+/**
+ * Destructor.
+ */
+ConnectivityMatrixRowCache::~ConnectivityMatrixRowCache()
+{
+    if (m_prefetchThread != NULL) {
+        {
+            QMutexLocker locker(&m_mutex);
+            m_prefetchQueue.clear();
+            m_stopPrefetchThread = true;
+            m_workCondition.wakeAll();
+        }
+        m_prefetchThread->wait();
+        delete m_prefetchThread;
+        m_prefetchThread = NULL;
+    }
+}
+
+/**
+ * @return A key, never used before, for a file to store its rows under.
+ */
+int64_t
+ConnectivityMatrixRowCache::newFileKey()
+{
+    QMutexLocker locker(&m_mutex);
+    return m_nextFileKey++;
+}
+
+/**
+ * Remove all rows for a file and cancel its prefetching.  Waits for
+ * the prefetch thread if it is reading a row of the file, so after
+ * this returns the file's CiftiFile may be closed.
+ *
+ * @param fileKey
+ *     Key of the file, negative keys are ignored.
+ */
+void
+ConnectivityMatrixRowCache::removeFile(const int64_t fileKey)
+{
+    if (fileKey < 0) {
+        return;
+    }
+    
+    QMutexLocker locker(&m_mutex);
+    
+    for (std::deque<PrefetchJob>::iterator iter = m_prefetchQueue.begin();
+         iter != m_prefetchQueue.end(); ) {
+        if (iter->m_fileKey == fileKey) {
+            iter = m_prefetchQueue.erase(iter);
+        }
+        else {
+            ++iter;
+        }
+    }
+    while (m_activeFileKey == fileKey) {
+        m_jobFinishedCondition.wait(&m_mutex);
+    }
+    
+    std::map<RowKey, CachedRow>::iterator first = m_rows.lower_bound(RowKey(fileKey, 0));
+    std::map<RowKey, CachedRow>::iterator last  = m_rows.lower_bound(RowKey(fileKey + 1, 0));
+    for (std::map<RowKey, CachedRow>::iterator iter = first; iter != last; ++iter) {
+        m_bytesUsed -= iter->second.m_data.size() * sizeof(float);
+        m_lruList.erase(iter->second.m_lruPosition);
+    }
+    m_rows.erase(first, last);
+}
+
+/**
+ * Get a row if it is in the cache.
+ *
+ * @param fileKey
+ *     Key of the file.
+ * @param rowIndex
+ *     Index of the row.
+ * @param dataOut
+ *     Output containing the row's data.
+ * @param rowLength
+ *     Number of elements in the row.
+ * @return
+ *     True if the row was in the cache and copied to dataOut.
+ */
+bool
+ConnectivityMatrixRowCache::getRow(const int64_t fileKey,
+                                   const int64_t rowIndex,
+                                   float* dataOut,
+                                   const int64_t rowLength)
+{
+    QMutexLocker locker(&m_mutex);
+    
+    std::map<RowKey, CachedRow>::iterator iter = m_rows.find(RowKey(fileKey, rowIndex));
+    if (iter == m_rows.end()) {
+        return false;
+    }
+    CachedRow& cachedRow = iter->second;
+    if (static_cast<int64_t>(cachedRow.m_data.size()) != rowLength) {
+        CaretAssertMessage(0, "Cached connectivity row has wrong length");
+        return false;
+    }
+    m_lruList.splice(m_lruList.begin(),
+                     m_lruList,
+                     cachedRow.m_lruPosition);
+    std::memcpy(dataOut,
+                &cachedRow.m_data[0],
+                rowLength * sizeof(float));
+    return true;
+}
+
+/**
+ * Add a row to the cache, removing the least recently used rows
+ * if the cache exceeds its byte budget.
+ *
+ * @param fileKey
+ *     Key of the file.
+ * @param rowIndex
+ *     Index of the row.
+ * @param data
+ *     The row's data.
+ * @param rowLength
+ *     Number of elements in the row.
+ */
+void
+ConnectivityMatrixRowCache::addRow(const int64_t fileKey,
+                                   const int64_t rowIndex,
+                                   const float* data,
+                                   const int64_t rowLength)
+{
+    QMutexLocker locker(&m_mutex);
+    addRowLocked(RowKey(fileKey, rowIndex),
+                 data,
+                 rowLength,
+                 true);
+}
+
+/**
+ * Add a row, the mutex must be locked.  Rows are removed to make room
+ * before the row is added, so the new row is never the one removed.
+ *
+ * @param mostRecentFlag
+ *     True if the row was viewed, so it becomes the most recently used
+ *     even if it is already in the cache.  False for a prefetched row,
+ *     which is added ahead of the rows that have not been used for the
+ *     longest time, but does not move a row that is already cached.
+ */
+void
+ConnectivityMatrixRowCache::addRowLocked(const RowKey& key,
+                                         const float* data,
+                                         const int64_t rowLength,
+                                         const bool mostRecentFlag)
+{
+    if (rowLength <= 0) {
+        return;
+    }
+    const int64_t rowBytes = rowLength * sizeof(float);
+    if (rowBytes > m_byteBudget) {
+        return;
+    }
+    
+    std::map<RowKey, CachedRow>::iterator iter = m_rows.find(key);
+    if (iter != m_rows.end()) {
+        if (mostRecentFlag) {
+            m_lruList.splice(m_lruList.begin(),
+                             m_lruList,
+                             iter->second.m_lruPosition);
+        }
+        return;
+    }
+    
+    evictToBudgetLocked(rowBytes);
+    
+    CachedRow& cachedRow = m_rows[key];
+    cachedRow.m_data.assign(data,
+                            data + rowLength);
+    m_lruList.push_front(key);
+    cachedRow.m_lruPosition = m_lruList.begin();
+    m_bytesUsed += rowBytes;
+}
+
+/**
+ * Remove least recently used rows until within the byte budget, the mutex must be locked.
+ *
+ * @param bytesNeeded
+ *     Number of bytes that must also fit within the budget.
+ */
+void
+ConnectivityMatrixRowCache::evictToBudgetLocked(const int64_t bytesNeeded)
+{
+    while ((m_bytesUsed + bytesNeeded > m_byteBudget)
+           && ( ! m_lruList.empty())) {
+        std::map<RowKey, CachedRow>::iterator iter = m_rows.find(m_lruList.back());
+        CaretAssert(iter != m_rows.end());
+        m_bytesUsed -= iter->second.m_data.size() * sizeof(float);
+        m_rows.erase(iter);
+        m_lruList.pop_back();
+    }
+}
+
+/**
+ * Read rows in the background and add them to the cache.  Any rows
+ * still queued from an earlier request for the file are dropped, as
+ * they are now less likely to be needed.
+ *
+ * The CiftiFile must support reading rows from another thread, and
+ * removeFile() must be called before it is closed.
+ *
+ * @param fileKey
+ *     Key of the file.
+ * @param ciftiFile
+ *     The file's CIFTI data.
+ * @param rowIndices
+ *     Indices of rows to read, in order of priority.
+ */
+void
+ConnectivityMatrixRowCache::prefetchRows(const int64_t fileKey,
+                                         const CiftiFile* ciftiFile,
+                                         const std::vector<int64_t>& rowIndices)
+{
+    CaretAssert(ciftiFile);
+    
+    QMutexLocker locker(&m_mutex);
+    
+    if (m_byteBudget < static_cast<int64_t>(rowIndices.size() + 1) * ciftiFile->getNumberOfColumns() * static_cast<int64_t>(sizeof(float))) {
+        return; /* prefetched rows would push the row being viewed out of the cache */
+    }
+    
+    for (std::deque<PrefetchJob>::iterator iter = m_prefetchQueue.begin();
+         iter != m_prefetchQueue.end(); ) {
+        if (iter->m_fileKey == fileKey) {
+            iter = m_prefetchQueue.erase(iter);
+        }
+        else {
+            ++iter;
+        }
+    }
+    
+    const int64_t numRows = ciftiFile->getNumberOfRows();
+    for (std::vector<int64_t>::const_iterator iter = rowIndices.begin();
+         iter != rowIndices.end();
+         iter++) {
+        const int64_t rowIndex = *iter;
+        if ((rowIndex < 0)
+            || (rowIndex >= numRows)) {
+            continue;
+        }
+        if (m_rows.find(RowKey(fileKey, rowIndex)) != m_rows.end()) {
+            continue;
+        }
+        PrefetchJob job;
+        job.m_fileKey   = fileKey;
+        job.m_ciftiFile = ciftiFile;
+        job.m_rowIndex  = rowIndex;
+        m_prefetchQueue.push_back(job);
+    }
+    
+    if (m_prefetchQueue.empty()) {
+        return;
+    }
+    
+    if (m_prefetchThread == NULL) {
+        m_prefetchThread = new ConnectivityMatrixRowCacheThread(this);
+        m_prefetchThread->start(QThread::LowPriority);
+    }
+    m_workCondition.wakeAll();
+}
+
+/**
+ * Called by the prefetch thread to wait for the next row to read.
+ *
+ * @param jobOut
+ *     The row to read.
+ * @return
+ *     False if the thread should exit.
+ */
+bool
+ConnectivityMatrixRowCache::takePrefetchJob(PrefetchJob& jobOut)
+{
+    QMutexLocker locker(&m_mutex);
+    
+    while ( ! m_stopPrefetchThread) {
+        if (m_prefetchQueue.empty()) {
+            m_jobFinishedCondition.wakeAll(); /* for waitForPrefetch() */
+            m_workCondition.wait(&m_mutex);
+            continue;
+        }
+        jobOut = m_prefetchQueue.front();
+        m_prefetchQueue.pop_front();
+        if (m_rows.find(RowKey(jobOut.m_fileKey, jobOut.m_rowIndex)) != m_rows.end()) {
+            continue; /* loaded by the user since it was queued */
+        }
+        m_activeFileKey = jobOut.m_fileKey;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Called by the prefetch thread after reading a row.
+ *
+ * @param job
+ *     The row that was read.
+ * @param data
+ *     The row's data, NULL if reading failed.
+ * @param rowLength
+ *     Number of elements in the row.
+ */
+void
+ConnectivityMatrixRowCache::finishPrefetchJob(const PrefetchJob& job,
+                                              const float* data,
+                                              const int64_t rowLength)
+{
+    QMutexLocker locker(&m_mutex);
+    
+    if (data != NULL) {
+        /*
+         * Prefetched rows are likely to be viewed soon, so they are
+         * added ahead of the least recently used rows.  prefetchRows()
+         * only queues as many rows as fit with the row being viewed.
+         */
+        addRowLocked(RowKey(job.m_fileKey, job.m_rowIndex),
+                     data,
+                     rowLength,
+                     false);
+    }
+    m_activeFileKey = -1;
+    m_jobFinishedCondition.wakeAll();
+}
+
+/**
+ * Wait until the prefetch thread has finished all queued rows.
+ */
+void
+ConnectivityMatrixRowCache::waitForPrefetch()
+{
+    QMutexLocker locker(&m_mutex);
+    
+    while (( ! m_prefetchQueue.empty())
+           || (m_activeFileKey != -1)) {
+        m_jobFinishedCondition.wait(&m_mutex);
+    }
+}
+
+/**
+ * @return The maximum number of bytes of row data kept in the cache.
+ */
+int64_t
+ConnectivityMatrixRowCache::getByteBudget() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_byteBudget;
+}
+
+/**
+ * Set the maximum number of bytes of row data kept in the cache.
+ *
+ * @param byteBudget
+ *     New budget, zero disables caching.
+ */
+void
+ConnectivityMatrixRowCache::setByteBudget(const int64_t byteBudget)
+{
+    QMutexLocker locker(&m_mutex);
+    m_byteBudget = std::max(byteBudget, static_cast<int64_t>(0));
+    evictToBudgetLocked(0);
+}
+
+/**
+ * @return Number of bytes of row data in the cache.
+ */
+int64_t
+ConnectivityMatrixRowCache::getBytesUsed() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_bytesUsed;
+}
+
@@ -0,0 +1,147 @@
+#ifndef __CONNECTIVITY_MATRIX_ROW_CACHE_H__
+#define __CONNECTIVITY_MATRIX_ROW_CACHE_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <deque>
+#include <list>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include <QMutex>
+#include <QWaitCondition>
+
+#include <stdint.h>
+
+namespace caret {
+
+    class CiftiFile;
+    class ConnectivityMatrixRowCacheThread;
+    
+    class ConnectivityMatrixRowCache {
+        
+    public:
+        static ConnectivityMatrixRowCache* getCache();
+        
+        static void deleteCache();
+        
+        int64_t newFileKey();
+        
+        void removeFile(const int64_t fileKey);
+        
+        bool getRow(const int64_t fileKey,
+                    const int64_t rowIndex,
+                    float* dataOut,
+                    const int64_t rowLength);
+        
+        void addRow(const int64_t fileKey,
+                    const int64_t rowIndex,
+                    const float* data,
+                    const int64_t rowLength);
+        
+        void prefetchRows(const int64_t fileKey,
+                          const CiftiFile* ciftiFile,
+                          const std::vector<int64_t>& rowIndices);
+        
+        void waitForPrefetch();
+        
+        int64_t getByteBudget() const;
+        
+        void setByteBudget(const int64_t byteBudget);
+        
+        int64_t getBytesUsed() const;
+        
+    private:
+        ConnectivityMatrixRowCache();
+        
+        ~ConnectivityMatrixRowCache();
+        
+        ConnectivityMatrixRowCache(const ConnectivityMatrixRowCache&);
+
+        ConnectivityMatrixRowCache& operator=(const ConnectivityMatrixRowCache&);
+        
+        typedef std::pair<int64_t, int64_t> RowKey;//file key, row index
+        
+        struct CachedRow {
+            std::vector<float> m_data;
+            std::list<RowKey>::iterator m_lruPosition;
+        };
+        
+        struct PrefetchJob {
+            int64_t m_fileKey;
+            const CiftiFile* m_ciftiFile;
+            int64_t m_rowIndex;
+        };
+        
+        void addRowLocked(const RowKey& key,
+                          const float* data,
+                          const int64_t rowLength,
+                          const bool mostRecentFlag);
+        
+        void evictToBudgetLocked(const int64_t bytesNeeded);
+        
+        bool takePrefetchJob(PrefetchJob& jobOut);
+        
+        void finishPrefetchJob(const PrefetchJob& job,
+                               const float* data,
+                               const int64_t rowLength);
+        
+        mutable QMutex m_mutex;
+        
+        /** signaled when the prefetch thread finishes a row or runs out of rows, so removeFile() and waitForPrefetch() can wait for it */
+        QWaitCondition m_jobFinishedCondition;
+        
+        /** signaled when prefetch work is queued or the thread should stop */
+        QWaitCondition m_workCondition;
+        
+        /** cached rows, ordered by file so that all rows of a file can be removed together */
+        std::map<RowKey, CachedRow> m_rows;
+        
+        /** most recently used row is at the front */
+        std::list<RowKey> m_lruList;
+        
+        std::deque<PrefetchJob> m_prefetchQueue;
+        
+        ConnectivityMatrixRowCacheThread* m_prefetchThread;
+        
+        /** file key of the row the prefetch thread is reading, -1 if idle */
+        int64_t m_activeFileKey;
+        
+        int64_t m_nextFileKey;
+        
+        int64_t m_bytesUsed;
+        
+        int64_t m_byteBudget;
+        
+        bool m_stopPrefetchThread;
+        
+        static ConnectivityMatrixRowCache* s_singleton;
+        
+        friend class ConnectivityMatrixRowCacheThread;
+    };
+    
+#ifdef __CONNECTIVITY_MATRIX_ROW_CACHE_DECLARE__
+    ConnectivityMatrixRowCache* ConnectivityMatrixRowCache::s_singleton = NULL;
+#endif // __CONNECTIVITY_MATRIX_ROW_CACHE_DECLARE__
+
+} // namespace
+#endif  //__CONNECTIVITY_MATRIX_ROW_CACHE_H__
@@ -164,6 +164,53 @@ GeodesicHelperBase::GeodesicHelperBase(const SurfaceFile* surfaceIn, const float
     }
 }
 
+const GeodesicHelperBase::EdgeGraph& GeodesicHelperBase::getEdgeGraph(const bool smooth) const
+{//only full surface searches use the flattened graphs, so don't spend the memory on them until one does
+    CaretMutexLocker locked(&m_graphMutex);
+    EdgeGraph& myGraph = smooth ? m_smoothGraph : m_naiveGraph;
+    if (!myGraph.m_built)
+    {
+        buildEdgeGraph(smooth, myGraph);
+        myGraph.m_built = true;
+    }
+    return myGraph;
+}
+
+void GeodesicHelperBase::buildEdgeGraph(const bool smooth, EdgeGraph& graphOut) const
+{
+    graphOut.m_start.resize(numNodes + 1);
+    graphOut.m_start[0] = 0;
+    for (int32_t i = 0; i < numNodes; ++i)
+    {
+        graphOut.m_start[i + 1] = graphOut.m_start[i] + (int64_t)nodeNeighbors[i].size() + (smooth ? (int64_t)nodeNeighbors2[i].size() : 0);
+    }
+    graphOut.m_nodes.resize(graphOut.m_start[numNodes]);
+    graphOut.m_dists.resize(graphOut.m_start[numNodes]);
+    float minDist = -1.0f, maxDist = 0.0f;
+    for (int32_t i = 0; i < numNodes; ++i)
+    {
+        int64_t index = graphOut.m_start[i];
+        for (int32_t pass = 0; pass < (smooth ? 2 : 1); ++pass)//first ring then second ring, the same order the heap searches use
+        {
+            const vector<int32_t>& neighbors = (pass == 0) ? nodeNeighbors[i] : nodeNeighbors2[i];
+            const vector<float>& dists = (pass == 0) ? distances[i] : distances2[i];
+            for (size_t j = 0; j < neighbors.size(); ++j)
+            {
+                graphOut.m_nodes[index] = neighbors[j];
+                graphOut.m_dists[index] = dists[j];
+                ++index;
+                if (minDist < 0.0f || dists[j] < minDist) minDist = dists[j];
+                if (dists[j] > maxDist) maxDist = dists[j];
+            }
+        }
+    }
+    const int64_t MAX_BUCKETS = 4096;//a narrower bucket only needs to be rescanned when a node in it improves another node in it, so don't let tiny edges explode the bucket count
+    graphOut.m_bucketWidth = minDist;
+    if (!(graphOut.m_bucketWidth > maxDist / MAX_BUCKETS)) graphOut.m_bucketWidth = maxDist / MAX_BUCKETS;
+    if (!(graphOut.m_bucketWidth > 0.0f)) graphOut.m_bucketWidth = 1.0f;//no edges, or all zero length
+    graphOut.m_numBuckets = (int64_t)(maxDist / graphOut.m_bucketWidth) + 3;//pending distances span at most one bucket plus the longest edge, plus one for rounding
+}
+
 GeodesicHelper::GeodesicHelper(const CaretPointer<const GeodesicHelperBase>& baseIn)
 {
     m_myBase = baseIn;//copy the pointer so it doesn't get changed or deleted while we get its members
@@ -186,6 +233,7 @@ GeodesicHelper::GeodesicHelper(const CaretPointer<const GeodesicHelperBase>& bas
     parentStore.resize(numNodes);
     parent = parentStore.data();//ditto for parents
     heurVal.resize(numNodes);
+    m_queuedBucket.resize(numNodes, -1);
 }
 
 void GeodesicHelper::getNodesToGeoDist(const int32_t node, const float maxdist, std::vector<int32_t>& nodesOut, std::vector<float>& distsOut, const bool smoothflag)
@@ -357,6 +405,61 @@ void GeodesicHelper::dijkstra(const int32_t root, bool smooth)
     }
 }
 
+void GeodesicHelper::dijkstraBuckets(const int32_t root, bool smooth)
+{//full surface, buckets of distance instead of a heap - a node is final when its bucket is finished, nodes in the current bucket are relaxed until none improve
+    //every distance is still the smallest float sum along a path from the root, so this gives the same distances as dijkstra(root, smooth)
+    const GeodesicHelperBase::EdgeGraph& myGraph = m_myBase->getEdgeGraph(smooth);
+    const int64_t* edgeStart = myGraph.m_start.data();
+    const int32_t* edgeNodes = myGraph.m_nodes.data();
+    const float* edgeDists = myGraph.m_dists.data();
+    const float bucketWidth = myGraph.m_bucketWidth;
+    const int64_t numBuckets = myGraph.m_numBuckets;
+    if ((int64_t)m_buckets.size() < numBuckets) m_buckets.resize(numBuckets);
+    for (int32_t i = 0; i < numNodes; ++i)
+    {
+        output[i] = -1.0f;//unreachable nodes stay -1
+    }
+    output[root] = 0.0f;
+    m_queuedBucket[root] = 0;
+    m_buckets[0].push_back(root);
+    int64_t numQueued = 1;//includes stale entries left behind when a node moves to an earlier bucket
+    for (int64_t curBucket = 0; numQueued > 0; ++curBucket)
+    {
+        vector<int32_t>& thisBucket = m_buckets[curBucket % numBuckets];
+        while (!thisBucket.empty())
+        {
+            m_bucketScratch.swap(thisBucket);//relaxing can add to this bucket, so take the current contents
+            numQueued -= (int64_t)m_bucketScratch.size();
+            for (size_t i = 0; i < m_bucketScratch.size(); ++i)
+            {
+                const int32_t whichnode = m_bucketScratch[i];
+                if (m_queuedBucket[whichnode] != curBucket) continue;//stale, it was already processed in an earlier bucket
+                m_queuedBucket[whichnode] = -1;
+                const float nodeDist = output[whichnode];
+                const int64_t edgeEnd = edgeStart[whichnode + 1];
+                for (int64_t edge = edgeStart[whichnode]; edge < edgeEnd; ++edge)
+                {
+                    const int32_t whichneigh = edgeNodes[edge];
+                    const float tempf = nodeDist + edgeDists[edge];
+                    if (output[whichneigh] < 0.0f || tempf < output[whichneigh])
+                    {
+                        output[whichneigh] = tempf;
+                        const int64_t neighBucket = (int64_t)(tempf / bucketWidth);
+                        if (m_queuedBucket[whichneigh] != neighBucket)
+                        {
+                            CaretAssert(neighBucket >= curBucket && neighBucket < curBucket + numBuckets);
+                            m_queuedBucket[whichneigh] = neighBucket;
+                            m_buckets[neighBucket % numBuckets].push_back(whichneigh);
+                            ++numQueued;
+                        }
+                    }
+                }
+            }
+            m_bucketScratch.clear();
+        }
+    }
+}
+
 void GeodesicHelper::getGeoFromNode(const int32_t node, float* valuesOut, const bool smoothflag)
 {
     CaretAssert(node >= 0 && node < numNodes && valuesOut != NULL);
@@ -367,7 +470,7 @@ void GeodesicHelper::getGeoFromNode(const int32_t node, float* valuesOut, const
     CaretMutexLocker locked(&inUse);//don't screw with member variables while in use
     float* temp = output;//swap out the output pointer to avoid allocation
     output = valuesOut;
-    dijkstra(node, smoothflag);
+    dijkstraBuckets(node, smoothflag);
     output = temp;//restore the pointer to the original memory
 }
 
@@ -400,7 +503,7 @@ void GeodesicHelper::getGeoFromNode(const int32_t node, std::vector<float>& valu
     float* temp = output;//swap the output pointer to avoid copy
     valuesOut.resize(numNodes);
     output = valuesOut.data();
-    dijkstra(node, smoothflag);
+    dijkstraBuckets(node, smoothflag);
     output = temp;//restore
 }
 
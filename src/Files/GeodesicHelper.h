@@ -56,6 +56,20 @@ namespace caret {
         int32_t numNodes;
         float m_avgNodeSpacing;//to use for balancing line following penalty
         float m_corrAreaSmallestFactor;//so that heuristics can be consistent despite corrected areas
+        struct EdgeGraph
+        {//all edges used by a search, flattened so that each node's edges are one contiguous range
+            std::vector<int64_t> m_start;//numNodes + 1 elements, edges of node i are [m_start[i], m_start[i + 1])
+            std::vector<int32_t> m_nodes;
+            std::vector<float> m_dists;
+            float m_bucketWidth;//for the bucket queue, no wider than the shortest edge unless that would need too many buckets
+            int64_t m_numBuckets;//enough buckets to cover the longest edge, used cyclically
+            bool m_built;
+            EdgeGraph() : m_bucketWidth(0.0f), m_numBuckets(0), m_built(false) { }
+        };
+        mutable EdgeGraph m_naiveGraph, m_smoothGraph;//smooth includes the second ring (crawled) edges after the first ring of each node, each is built the first time it is needed
+        mutable CaretMutex m_graphMutex;//helpers on several threads can share one base
+        void buildEdgeGraph(const bool smooth, EdgeGraph& graphOut) const;
+        const EdgeGraph& getEdgeGraph(const bool smooth) const;
     public:
         explicit GeodesicHelperBase(const SurfaceFile* surfaceIn, const float* correctedAreas = NULL);//NOTE: this is only an APPROXIMATE correction, use the real surface whenever possible
         friend class GeodesicHelper;//let it grab the private variables it needs
@@ -76,6 +90,9 @@ namespace caret {
         std::vector<float> heurVal;
         std::vector<int32_t> marked, changed, parentStore;
         std::vector<int64_t> m_heapIdent;
+        std::vector<std::vector<int32_t> > m_buckets;
+        std::vector<int32_t> m_bucketScratch;
+        std::vector<int64_t> m_queuedBucket;
         int32_t numNodes;
         float m_avgNodeSpacing;
         float m_corrAreaSmallestFactor;
@@ -84,6 +101,7 @@ namespace caret {
         GeodesicHelper(const GeodesicHelper&);//can't use copy constructor
         void dijkstra(const int32_t root, const float maxdist, std::vector<int32_t>& nodes, std::vector<float>& dists, bool smooth);//geodesic distance restricted
         void dijkstra(const int32_t root, bool smooth);//full surface
+        void dijkstraBuckets(const int32_t root, bool smooth);//full surface, bucket queue instead of heap, no parents
         void dijkstra(const int32_t root, const std::vector<int32_t>& interested, bool smooth);//partial surface
         int32_t dijkstra(const std::vector<int32_t>& startList, const std::vector<int32_t>& endList, const float& maxDist, bool smooth);//one path that connects lists
         int32_t closest(const int32_t& root, const char* roi, const float& maxdist, float& distOut, bool smooth);//just closest node
@@ -46,7 +46,8 @@ void MetricSmoothingObject::smoothColumn(const MetricFile* metricIn, const int&
 {
     CaretAssert(metricIn != NULL);
     CaretAssert(columnOut != NULL);
-    if (metricIn->getNumberOfNodes() != (int32_t)m_weightLists.size())
+    int32_t numNodes = m_weightMatrix.getNumberOfNodes();
+    if (metricIn->getNumberOfNodes() != numNodes)
     {
         throw CaretException("metric does not match surface number of nodes");
     }
@@ -54,14 +55,14 @@ void MetricSmoothingObject::smoothColumn(const MetricFile* metricIn, const int&
     {
         throw CaretException("invalid column number");
     }
-    if (columnOut->getNumberOfNodes() != (int32_t)m_weightLists.size() || columnOut->getNumberOfColumns() != 1)
+    if (columnOut->getNumberOfNodes() != numNodes || columnOut->getNumberOfColumns() != 1)
     {
-        columnOut->setNumberOfNodesAndColumns(m_weightLists.size(), 1);
+        columnOut->setNumberOfNodesAndColumns(numNodes, 1);
     }
     vector<float> scratch(metricIn->getNumberOfNodes());
     if (roi != NULL)
     {
-        if (roi->getNumberOfNodes() != (int32_t)m_weightLists.size())
+        if (roi->getNumberOfNodes() != numNodes)
         {
             throw CaretException("roi does not match surface number of nodes");
         }
@@ -75,15 +76,16 @@ void MetricSmoothingObject::smoothColumn(const MetricFile* metricIn, const int&
 {
     CaretAssert(metricIn != NULL);
     CaretAssert(metricOut != NULL);
-    if (metricIn->getNumberOfNodes() != (int32_t)m_weightLists.size())
+    int32_t numNodes = m_weightMatrix.getNumberOfNodes();
+    if (metricIn->getNumberOfNodes() != numNodes)
     {
         throw CaretException("metric does not match surface number of nodes");
     }
-    if (metricOut->getNumberOfNodes() != (int32_t)m_weightLists.size())
+    if (metricOut->getNumberOfNodes() != numNodes)
     {
         throw CaretException("output metric does not match surface number of nodes");
     }
-    if (roi != NULL && (roi->getNumberOfNodes() != (int32_t)m_weightLists.size()))
+    if (roi != NULL && (roi->getNumberOfNodes() != numNodes))
     {
         throw CaretException("roi does not match surface number of nodes");
     }
@@ -113,29 +115,123 @@ void MetricSmoothingObject::smoothMetric(const MetricFile* metricIn, MetricFile*
     CaretAssert(metricIn != NULL);
     CaretAssert(metricOut != NULL);
     int32_t numCols = metricIn->getNumberOfColumns();
-    if (metricIn->getNumberOfNodes() != (int32_t)m_weightLists.size())
+    int32_t numNodes = m_weightMatrix.getNumberOfNodes();
+    if (metricIn->getNumberOfNodes() != numNodes)
     {
         throw CaretException("metric does not match surface number of nodes");
     }
-    if (metricOut->getNumberOfNodes() != (int32_t)m_weightLists.size() || metricOut->getNumberOfColumns() != numCols)
+    if (metricOut->getNumberOfNodes() != numNodes || metricOut->getNumberOfColumns() != numCols)
     {
-        metricOut->setNumberOfNodesAndColumns(m_weightLists.size(), numCols);
+        metricOut->setNumberOfNodesAndColumns(numNodes, numCols);
     }
-    vector<float> scratch(metricIn->getNumberOfNodes());
+    const float* roiColumn = NULL;
     if (roi != NULL)
     {
-        if (roi->getNumberOfNodes() != (int32_t)m_weightLists.size())
+        if (roi->getNumberOfNodes() != numNodes)
         {
             throw CaretException("roi does not match surface number of nodes");
         }
-        for (int32_t i = 0; i < numCols; ++i)
+        roiColumn = roi->getValuePointerForColumn(0);
+    }
+    if (numCols == 1)
+    {
+        vector<float> scratch(numNodes);
+        if (roi != NULL)
         {
-            smoothColumnInternal(scratch.data(), metricIn, i, metricOut, i, roi, 0, fixZeros);
+            smoothColumnInternal(scratch.data(), metricIn, 0, metricOut, 0, roi, 0, fixZeros);
+        } else {
+            smoothColumnInternal(scratch.data(), metricIn, 0, metricOut, 0, fixZeros);
         }
-    } else {
-        for (int32_t i = 0; i < numCols; ++i)
+        return;
+    }
+    //smooth BLOCK_COLUMNS columns per pass over the weights, with the columns interleaved so each weight is loaded once and applied to all of them
+    vector<float> blockIn((int64_t)numNodes * BLOCK_COLUMNS, 0.0f), blockOut((int64_t)numNodes * BLOCK_COLUMNS), scratch(numNodes);
+    for (int32_t startCol = 0; startCol < numCols; startCol += BLOCK_COLUMNS)
+    {
+        int32_t blockWidth = numCols - startCol;
+        if (blockWidth > BLOCK_COLUMNS) blockWidth = BLOCK_COLUMNS;
+        for (int32_t c = 0; c < blockWidth; ++c)
         {
-            smoothColumnInternal(scratch.data(), metricIn, i, metricOut, i, fixZeros);
+            const float* inColumn = metricIn->getValuePointerForColumn(startCol + c);
+            for (int32_t i = 0; i < numNodes; ++i)
+            {
+                blockIn[(int64_t)i * BLOCK_COLUMNS + c] = inColumn[i];
+            }
+        }//unused columns of the last block are left over from the previous block, they are smoothed but never written out
+        smoothColumnBlockInternal(blockIn.data(), blockOut.data(), roiColumn, fixZeros);
+        for (int32_t c = 0; c < blockWidth; ++c)
+        {
+            for (int32_t i = 0; i < numNodes; ++i)
+            {
+                scratch[i] = blockOut[(int64_t)i * BLOCK_COLUMNS + c];
+            }
+            metricOut->setValuesForColumn(startCol + c, scratch.data());
+        }
+    }
+}
+
+void MetricSmoothingObject::smoothColumnBlockInternal(const float* blockIn, float* blockOut, const float* roiColumn, const bool& fixZeros) const
+{//adds up neighbors in the same order as smoothColumnInternal, so the results are identical to smoothing one column at a time
+    CaretAssert(blockIn != NULL);
+    CaretAssert(blockOut != NULL);
+    int32_t numNodes = m_weightMatrix.getNumberOfNodes();
+    const int64_t* rowStart = m_weightMatrix.m_rowStart.data();
+    const int32_t* nodes = m_weightMatrix.m_nodes.data();
+    const float* weights = m_weightMatrix.m_weights.data();
+    const float* weightSums = m_weightMatrix.m_weightSums.data();
+#pragma omp CARET_PARFOR schedule(dynamic, 64)
+    for (int32_t i = 0; i < numNodes; ++i)
+    {
+        float* outRow = blockOut + (int64_t)i * BLOCK_COLUMNS;
+        if (weightSums[i] == 0.0f || (roiColumn != NULL && !(roiColumn[i] > 0.0f)))
+        {
+            for (int32_t c = 0; c < BLOCK_COLUMNS; ++c)
+            {
+                outRow[c] = 0.0f;
+            }
+            continue;
+        }
+        float sum[BLOCK_COLUMNS], weightsum[BLOCK_COLUMNS];
+        for (int32_t c = 0; c < BLOCK_COLUMNS; ++c)
+        {
+            sum[c] = 0.0f;
+            weightsum[c] = 0.0f;
+        }
+        float roiWeightSum = 0.0f;//with an roi but without fixZeros, the used weights are the same for all columns
+        int64_t rowEnd = rowStart[i + 1];
+        for (int64_t j = rowStart[i]; j < rowEnd; ++j)
+        {
+            int32_t neighbor = nodes[j];
+            if (roiColumn != NULL && !(roiColumn[neighbor] > 0.0f)) continue;
+            float weight = weights[j];
+            const float* inRow = blockIn + (int64_t)neighbor * BLOCK_COLUMNS;
+            if (fixZeros)
+            {
+                for (int32_t c = 0; c < BLOCK_COLUMNS; ++c)
+                {//weight * 0 adds nothing, so only the weight sum needs the test
+                    sum[c] += weight * inRow[c];
+                    weightsum[c] += (inRow[c] != 0.0f) ? weight : 0.0f;
+                }
+            } else {
+                for (int32_t c = 0; c < BLOCK_COLUMNS; ++c)
+                {
+                    sum[c] += weight * inRow[c];
+                }
+                roiWeightSum += weight;
+            }
+        }
+        if (fixZeros)
+        {
+            for (int32_t c = 0; c < BLOCK_COLUMNS; ++c)
+            {
+                outRow[c] = (weightsum[c] != 0.0f) ? sum[c] / weightsum[c] : 0.0f;
+            }
+        } else {
+            float divisor = (roiColumn != NULL) ? roiWeightSum : weightSums[i];
+            for (int32_t c = 0; c < BLOCK_COLUMNS; ++c)
+            {
+                outRow[c] = (divisor != 0.0f) ? sum[c] / divisor : 0.0f;
+            }
         }
     }
 }
@@ -149,22 +245,25 @@ void MetricSmoothingObject::smoothColumnInternal(float* scratch, const MetricFil
     CaretAssert(whichOutColumn >= 0 && whichOutColumn < metricOut->getNumberOfColumns());
     const float* myColumn = metricIn->getValuePointerForColumn(whichColumn);
     int32_t numNodes = metricIn->getNumberOfNodes();
+    const int64_t* rowStart = m_weightMatrix.m_rowStart.data();
+    const int32_t* nodes = m_weightMatrix.m_nodes.data();
+    const float* weights = m_weightMatrix.m_weights.data();
+    const float* weightSums = m_weightMatrix.m_weightSums.data();
     if (fixZeros)//special case early to keep branching down
     {
 #pragma omp CARET_PARFOR schedule(dynamic)
         for (int32_t i = 0; i < numNodes; ++i)
         {
-            const WeightList& myWeightRef = m_weightLists[i];
-            if (myWeightRef.m_weightSum != 0.0f)//skip nodes with no neighbors quickly
+            if (weightSums[i] != 0.0f)//skip nodes with no neighbors quickly
             {
                 float sum = 0.0f, weightsum = 0.0f;
-                int32_t numWeights = myWeightRef.m_nodes.size();
-                for (int32_t j = 0; j < numWeights; ++j)
+                int64_t rowEnd = rowStart[i + 1];
+                for (int64_t j = rowStart[i]; j < rowEnd; ++j)
                 {
-                    float value = myColumn[myWeightRef.m_nodes[j]];
+                    float value = myColumn[nodes[j]];
                     if (value != 0.0f)
                     {
-                        float weight = myWeightRef.m_weights[j];
+                        float weight = weights[j];
                         sum += weight * value;
                         weightsum += weight;
                     }
@@ -183,16 +282,15 @@ void MetricSmoothingObject::smoothColumnInternal(float* scratch, const MetricFil
 #pragma omp CARET_PARFOR schedule(dynamic)
         for (int32_t i = 0; i < numNodes; ++i)
         {
-            const WeightList& myWeightRef = m_weightLists[i];
-            if (myWeightRef.m_weightSum != 0.0f)
+            if (weightSums[i] != 0.0f)
             {
                 float sum = 0.0f;
-                int32_t numWeights = myWeightRef.m_nodes.size();
-                for (int32_t j = 0; j < numWeights; ++j)
+                int64_t rowEnd = rowStart[i + 1];
+                for (int64_t j = rowStart[i]; j < rowEnd; ++j)
                 {
-                    sum += myWeightRef.m_weights[j] * myColumn[myWeightRef.m_nodes[j]];
+                    sum += weights[j] * myColumn[nodes[j]];
                 }
-                scratch[i] = sum / myWeightRef.m_weightSum;
+                scratch[i] = sum / weightSums[i];
             } else {
                 scratch[i] = 0.0f;
             }
@@ -213,23 +311,26 @@ void MetricSmoothingObject::smoothColumnInternal(float* scratch, const MetricFil
     const float* myColumn = metricIn->getValuePointerForColumn(whichColumn);
     const float* roiColumn = roi->getValuePointerForColumn(whichRoiColumn);
     int32_t numNodes = metricIn->getNumberOfNodes();
+    const int64_t* rowStart = m_weightMatrix.m_rowStart.data();
+    const int32_t* nodes = m_weightMatrix.m_nodes.data();
+    const float* weights = m_weightMatrix.m_weights.data();
+    const float* weightSums = m_weightMatrix.m_weightSums.data();
     if (fixZeros)//special case early to keep branching down
     {
 #pragma omp CARET_PARFOR schedule(dynamic)
         for (int32_t i = 0; i < numNodes; ++i)
         {
-            const WeightList& myWeightRef = m_weightLists[i];
-            if (roiColumn[i] > 0.0f && myWeightRef.m_weightSum != 0.0f)//skip nodes with no neighbors quickly
+            if (roiColumn[i] > 0.0f && weightSums[i] != 0.0f)//skip nodes with no neighbors quickly
             {
                 float sum = 0.0f, weightsum = 0.0f;
-                int32_t numWeights = myWeightRef.m_nodes.size();
-                for (int32_t j = 0; j < numWeights; ++j)
+                int64_t rowEnd = rowStart[i + 1];
+                for (int64_t j = rowStart[i]; j < rowEnd; ++j)
                 {
-                    int32_t neighbor = myWeightRef.m_nodes[j];
+                    int32_t neighbor = nodes[j];
                     float value = myColumn[neighbor];
                     if (roiColumn[neighbor] > 0.0f && value != 0.0f)
                     {
-                        float weight = myWeightRef.m_weights[j];
+                        float weight = weights[j];
                         sum += weight * value;
                         weightsum += weight;
                     }
@@ -248,17 +349,16 @@ void MetricSmoothingObject::smoothColumnInternal(float* scratch, const MetricFil
 #pragma omp CARET_PARFOR schedule(dynamic)
         for (int32_t i = 0; i < numNodes; ++i)
         {
-            const WeightList& myWeightRef = m_weightLists[i];
-            if (roiColumn[i] > 0.0f && myWeightRef.m_weightSum != 0.0f)
+            if (roiColumn[i] > 0.0f && weightSums[i] != 0.0f)
             {
                 float sum = 0.0f, weightsum = 0.0f;
-                int32_t numWeights = myWeightRef.m_nodes.size();
-                for (int32_t j = 0; j < numWeights; ++j)
+                int64_t rowEnd = rowStart[i + 1];
+                for (int64_t j = rowStart[i]; j < rowEnd; ++j)
                 {
-                    int32_t neighbor = myWeightRef.m_nodes[j];
+                    int32_t neighbor = nodes[j];
                     if (roiColumn[neighbor] > 0.0f)
                     {
-                        float weight = myWeightRef.m_weights[j];
+                        float weight = weights[j];
                         sum += weight * myColumn[neighbor];
                         weightsum += weight;
                     }
@@ -277,12 +377,12 @@ void MetricSmoothingObject::smoothColumnInternal(float* scratch, const MetricFil
     metricOut->setValuesForColumn(whichOutColumn, scratch);
 }
 
-void MetricSmoothingObject::precomputeWeightsGeoGauss(const SurfaceFile* mySurf, float myKernel, const float* nodeAreas)
+void MetricSmoothingObject::precomputeWeightsGeoGauss(const SurfaceFile* mySurf, float myKernel, const float* nodeAreas, vector<WeightList>& weightListsOut)
 {
     int32_t numNodes = mySurf->getNumberOfNodes();
     float myGeoDist = myKernel * 3.0f;
     float gaussianDenom = -0.5f / myKernel / myKernel;
-    m_weightLists.resize(numNodes);
+    weightListsOut.resize(numNodes);
     CaretPointer<GeodesicHelperBase> myGeoBase(new GeodesicHelperBase(mySurf, nodeAreas));//NOTE: if these are equal to the surface's areas, then it does some extra operations, but gets the same answer
 #pragma omp CARET_PAR
     {
@@ -292,32 +392,32 @@ void MetricSmoothingObject::precomputeWeightsGeoGauss(const SurfaceFile* mySurf,
 #pragma omp CARET_FOR schedule(dynamic)
         for (int32_t i = 0; i < numNodes; ++i)
         {
-            myGeoHelp->getNodesToGeoDist(i, myGeoDist, m_weightLists[i].m_nodes, distances, true);
+            myGeoHelp->getNodesToGeoDist(i, myGeoDist, weightListsOut[i].m_nodes, distances, true);
             if (distances.size() < 7)
             {
-                m_weightLists[i].m_nodes = myTopoHelp->getNodeNeighbors(i);
-                m_weightLists[i].m_nodes.push_back(i);
-                myGeoHelp->getGeoToTheseNodes(i, m_weightLists[i].m_nodes, distances, true);
+                weightListsOut[i].m_nodes = myTopoHelp->getNodeNeighbors(i);
+                weightListsOut[i].m_nodes.push_back(i);
+                myGeoHelp->getGeoToTheseNodes(i, weightListsOut[i].m_nodes, distances, true);
             }
             int32_t numNeigh = (int32_t)distances.size();
-            m_weightLists[i].m_weights.resize(numNeigh);
-            m_weightLists[i].m_weightSum = 0.0f;
+            weightListsOut[i].m_weights.resize(numNeigh);
+            weightListsOut[i].m_weightSum = 0.0f;
             for (int32_t j = 0; j < numNeigh; ++j)
             {
                 float weight = exp(distances[j] * distances[j] * gaussianDenom);//exp(- dist ^ 2 / (2 * sigma ^ 2))
-                m_weightLists[i].m_weights[j] = weight;
-                m_weightLists[i].m_weightSum += weight;
+                weightListsOut[i].m_weights[j] = weight;
+                weightListsOut[i].m_weightSum += weight;
             }
         }
     }
 }
 
-void MetricSmoothingObject::precomputeWeightsROIGeoGauss(const SurfaceFile* mySurf, float myKernel, const MetricFile* theRoi, const float* nodeAreas)
+void MetricSmoothingObject::precomputeWeightsROIGeoGauss(const SurfaceFile* mySurf, float myKernel, const MetricFile* theRoi, const float* nodeAreas, vector<WeightList>& weightListsOut)
 {
     int32_t numNodes = mySurf->getNumberOfNodes();
     float myGeoDist = myKernel * 3.0f;
     float gaussianDenom = -0.5f / myKernel / myKernel;
-    m_weightLists.resize(numNodes);
+    weightListsOut.resize(numNodes);
     const float* myRoiColumn = theRoi->getValuePointerForColumn(0);
     CaretPointer<GeodesicHelperBase> myGeoBase(new GeodesicHelperBase(mySurf, nodeAreas));//NOTE: if these are equal to the surface's areas, then it does some extra operations, but gets the same answer
 #pragma omp CARET_PAR
@@ -339,17 +439,17 @@ void MetricSmoothingObject::precomputeWeightsROIGeoGauss(const SurfaceFile* mySu
                     myGeoHelp->getGeoToTheseNodes(i, nodes, distances, true);
                 }
                 int32_t numNeigh = (int32_t)distances.size();
-                m_weightLists[i].m_weights.reserve(numNeigh);
-                m_weightLists[i].m_nodes.reserve(numNeigh);
-                m_weightLists[i].m_weightSum = 0.0f;
+                weightListsOut[i].m_weights.reserve(numNeigh);
+                weightListsOut[i].m_nodes.reserve(numNeigh);
+                weightListsOut[i].m_weightSum = 0.0f;
                 for (int32_t j = 0; j < numNeigh; ++j)
                 {
                     if (myRoiColumn[nodes[j]] > 0.0f)
                     {
                         float weight = exp(distances[j] * distances[j] * gaussianDenom);//exp(- dist ^ 2 / (2 * sigma ^ 2))
-                        m_weightLists[i].m_weights.push_back(weight);
-                        m_weightLists[i].m_nodes.push_back(nodes[j]);
-                        m_weightLists[i].m_weightSum += weight;
+                        weightListsOut[i].m_weights.push_back(weight);
+                        weightListsOut[i].m_nodes.push_back(nodes[j]);
+                        weightListsOut[i].m_weightSum += weight;
                     }
                 }
             }
@@ -357,7 +457,7 @@ void MetricSmoothingObject::precomputeWeightsROIGeoGauss(const SurfaceFile* mySu
     }
 }
 
-void MetricSmoothingObject::precomputeWeightsGeoGaussArea(const SurfaceFile* mySurf, float myKernel, const float* nodeAreas)
+void MetricSmoothingObject::precomputeWeightsGeoGaussArea(const SurfaceFile* mySurf, float myKernel, const float* nodeAreas, vector<WeightList>& weightListsOut)
 {//this method is normalized in two ways to provide evenly diffusing smoothing with equivalent sum of areas * values as input
     int32_t numNodes = mySurf->getNumberOfNodes();
     float myGeoDist = myKernel * 3.0f;
@@ -398,13 +498,13 @@ void MetricSmoothingObject::precomputeWeightsGeoGaussArea(const SurfaceFile* myS
             tempList[i].m_weightSum = nodeAreas[i];
         }
     }
-    m_weightLists.resize(numNodes);//now convert it to gathering kernels
+    weightListsOut.resize(numNodes);//now convert it to gathering kernels
     for (int32_t i = 0; i < numNodes; ++i)//sadly, this is VERY hard to parallelize in a manner that is efficient, since it needs random access modification
     {
-        m_weightLists[i].m_weightSum = 0.0f;//memory initialization may not go much faster in parallel
+        weightListsOut[i].m_weightSum = 0.0f;//memory initialization may not go much faster in parallel
         size_t neighborCount = tempList[i].m_nodes.size();
-        m_weightLists[i].m_nodes.reserve(neighborCount);//also preallocate the expected number of nodes (geodesic distance should be symmetric except for rounding errors, so it should usually be exact)
-        m_weightLists[i].m_weights.reserve(neighborCount);
+        weightListsOut[i].m_nodes.reserve(neighborCount);//also preallocate the expected number of nodes (geodesic distance should be symmetric except for rounding errors, so it should usually be exact)
+        weightListsOut[i].m_weights.reserve(neighborCount);
     }
     for (int32_t i = 0; i < numNodes; ++i)//and this needs to push onto random vectors in the weight list
     {
@@ -413,14 +513,14 @@ void MetricSmoothingObject::precomputeWeightsGeoGaussArea(const SurfaceFile* myS
         {
             int32_t node = tempList[i].m_nodes[j];
             float weight = tempList[i].m_weights[j];
-            m_weightLists[node].m_nodes.push_back(i);
-            m_weightLists[node].m_weights.push_back(weight);
-            m_weightLists[node].m_weightSum += weight;
+            weightListsOut[node].m_nodes.push_back(i);
+            weightListsOut[node].m_weights.push_back(weight);
+            weightListsOut[node].m_weightSum += weight;
         }
     }
 }
 
-void MetricSmoothingObject::precomputeWeightsROIGeoGaussArea(const SurfaceFile* mySurf, float myKernel, const MetricFile* theRoi, const float* nodeAreas)
+void MetricSmoothingObject::precomputeWeightsROIGeoGaussArea(const SurfaceFile* mySurf, float myKernel, const MetricFile* theRoi, const float* nodeAreas, vector<WeightList>& weightListsOut)
 {
     int32_t numNodes = mySurf->getNumberOfNodes();
     float myGeoDist = myKernel * 3.0f;
@@ -470,13 +570,13 @@ void MetricSmoothingObject::precomputeWeightsROIGeoGaussArea(const SurfaceFile*
             }
         }
     }
-    m_weightLists.resize(numNodes);//now convert it to gathering kernels
+    weightListsOut.resize(numNodes);//now convert it to gathering kernels
     for (int32_t i = 0; i < numNodes; ++i)//sadly, this is VERY hard to parallelize in a manner that is efficient, since it needs random access modification
     {
-        m_weightLists[i].m_weightSum = 0.0f;//memory initialization may not go much faster in parallel
+        weightListsOut[i].m_weightSum = 0.0f;//memory initialization may not go much faster in parallel
         size_t neighborCount = tempList[i].m_nodes.size();
-        m_weightLists[i].m_nodes.reserve(neighborCount);//also preallocate the expected number of nodes, again, should be exact except for rounding errors in geodesic distance
-        m_weightLists[i].m_weights.reserve(neighborCount);
+        weightListsOut[i].m_nodes.reserve(neighborCount);//also preallocate the expected number of nodes, again, should be exact except for rounding errors in geodesic distance
+        weightListsOut[i].m_weights.reserve(neighborCount);
     }
     for (int32_t i = 0; i < numNodes; ++i)//and this needs to push onto random vectors in the weight list
     {
@@ -485,14 +585,14 @@ void MetricSmoothingObject::precomputeWeightsROIGeoGaussArea(const SurfaceFile*
         {
             int32_t node = tempList[i].m_nodes[j];
             float weight = tempList[i].m_weights[j];
-            m_weightLists[node].m_nodes.push_back(i);
-            m_weightLists[node].m_weights.push_back(weight);
-            m_weightLists[node].m_weightSum += weight;
+            weightListsOut[node].m_nodes.push_back(i);
+            weightListsOut[node].m_weights.push_back(weight);
+            weightListsOut[node].m_weightSum += weight;
         }
     }
 }
 
-void MetricSmoothingObject::precomputeWeightsGeoGaussEqual(const SurfaceFile* mySurf, float myKernel, const float* nodeAreas)
+void MetricSmoothingObject::precomputeWeightsGeoGaussEqual(const SurfaceFile* mySurf, float myKernel, const float* nodeAreas, vector<WeightList>& weightListsOut)
 {//this method is normalized in two ways to provide evenly diffusing smoothing with equivalent sum of values as input - this special purpose smoothing is for things that should not be integrated across the surface
     int32_t numNodes = mySurf->getNumberOfNodes();
     float myGeoDist = myKernel * 3.0f;
@@ -533,13 +633,13 @@ void MetricSmoothingObject::precomputeWeightsGeoGaussEqual(const SurfaceFile* my
             tempList[i].m_weightSum = 1.0f;
         }
     }
-    m_weightLists.resize(numNodes);//now convert it to gathering kernels
+    weightListsOut.resize(numNodes);//now convert it to gathering kernels
     for (int32_t i = 0; i < numNodes; ++i)//sadly, this is VERY hard to parallelize in a manner that is efficient, since it needs random access modification
     {
-        m_weightLists[i].m_weightSum = 0.0f;//memory initialization may not go much faster in parallel
+        weightListsOut[i].m_weightSum = 0.0f;//memory initialization may not go much faster in parallel
         size_t neighborCount = tempList[i].m_nodes.size();
-        m_weightLists[i].m_nodes.reserve(neighborCount);//also preallocate the expected number of nodes (geodesic distance should be symmetric except for rounding errors, so it should usually be exact)
-        m_weightLists[i].m_weights.reserve(neighborCount);
+        weightListsOut[i].m_nodes.reserve(neighborCount);//also preallocate the expected number of nodes (geodesic distance should be symmetric except for rounding errors, so it should usually be exact)
+        weightListsOut[i].m_weights.reserve(neighborCount);
     }
     for (int32_t i = 0; i < numNodes; ++i)//and this needs to push onto random vectors in the weight list
     {
@@ -548,14 +648,14 @@ void MetricSmoothingObject::precomputeWeightsGeoGaussEqual(const SurfaceFile* my
         {
             int32_t node = tempList[i].m_nodes[j];
             float weight = tempList[i].m_weights[j];
-            m_weightLists[node].m_nodes.push_back(i);
-            m_weightLists[node].m_weights.push_back(weight);
-            m_weightLists[node].m_weightSum += weight;
+            weightListsOut[node].m_nodes.push_back(i);
+            weightListsOut[node].m_weights.push_back(weight);
+            weightListsOut[node].m_weightSum += weight;
         }
     }
 }
 
-void MetricSmoothingObject::precomputeWeightsROIGeoGaussEqual(const SurfaceFile* mySurf, float myKernel, const MetricFile* theRoi, const float* nodeAreas)
+void MetricSmoothingObject::precomputeWeightsROIGeoGaussEqual(const SurfaceFile* mySurf, float myKernel, const MetricFile* theRoi, const float* nodeAreas, vector<WeightList>& weightListsOut)
 {
     int32_t numNodes = mySurf->getNumberOfNodes();
     float myGeoDist = myKernel * 3.0f;
@@ -605,13 +705,13 @@ void MetricSmoothingObject::precomputeWeightsROIGeoGaussEqual(const SurfaceFile*
             }
         }
     }
-    m_weightLists.resize(numNodes);//now convert it to gathering kernels
+    weightListsOut.resize(numNodes);//now convert it to gathering kernels
     for (int32_t i = 0; i < numNodes; ++i)//sadly, this is VERY hard to parallelize in a manner that is efficient, since it needs random access modification
     {
-        m_weightLists[i].m_weightSum = 0.0f;//memory initialization may not go much faster in parallel
+        weightListsOut[i].m_weightSum = 0.0f;//memory initialization may not go much faster in parallel
         size_t neighborCount = tempList[i].m_nodes.size();
-        m_weightLists[i].m_nodes.reserve(neighborCount);//also preallocate the expected number of nodes, again, should be exact except for rounding errors in geodesic distance
-        m_weightLists[i].m_weights.reserve(neighborCount);
+        weightListsOut[i].m_nodes.reserve(neighborCount);//also preallocate the expected number of nodes, again, should be exact except for rounding errors in geodesic distance
+        weightListsOut[i].m_weights.reserve(neighborCount);
     }
     for (int32_t i = 0; i < numNodes; ++i)//and this needs to push onto random vectors in the weight list
     {
@@ -620,9 +720,9 @@ void MetricSmoothingObject::precomputeWeightsROIGeoGaussEqual(const SurfaceFile*
         {
             int32_t node = tempList[i].m_nodes[j];
             float weight = tempList[i].m_weights[j];
-            m_weightLists[node].m_nodes.push_back(i);
-            m_weightLists[node].m_weights.push_back(weight);
-            m_weightLists[node].m_weightSum += weight;
+            weightListsOut[node].m_nodes.push_back(i);
+            weightListsOut[node].m_weights.push_back(weight);
+            weightListsOut[node].m_weightSum += weight;
         }
     }
 }
@@ -636,18 +736,19 @@ void MetricSmoothingObject::precomputeWeights(const SurfaceFile* mySurf, float m
         mySurf->computeNodeAreas(areasTemp);
         passAreas = areasTemp.data();
     }
+    vector<WeightList> weightLists;
     if (theRoi != NULL)
     {
         switch (myMethod)
         {
             case GEO_GAUSS_AREA:
-                precomputeWeightsROIGeoGaussArea(mySurf, myKernel, theRoi, passAreas);
+                precomputeWeightsROIGeoGaussArea(mySurf, myKernel, theRoi, passAreas, weightLists);
                 break;
             case GEO_GAUSS_EQUAL:
-                precomputeWeightsROIGeoGaussEqual(mySurf, myKernel, theRoi, passAreas);
+                precomputeWeightsROIGeoGaussEqual(mySurf, myKernel, theRoi, passAreas, weightLists);
                 break;
             case GEO_GAUSS:
-                precomputeWeightsROIGeoGauss(mySurf, myKernel, theRoi, passAreas);
+                precomputeWeightsROIGeoGauss(mySurf, myKernel, theRoi, passAreas, weightLists);
                 break;
             default:
                 throw CaretException("unknown smoothing method specified");
@@ -656,16 +757,46 @@ void MetricSmoothingObject::precomputeWeights(const SurfaceFile* mySurf, float m
         switch (myMethod)
         {
             case GEO_GAUSS_AREA:
-                precomputeWeightsGeoGaussArea(mySurf, myKernel, passAreas);
+                precomputeWeightsGeoGaussArea(mySurf, myKernel, passAreas, weightLists);
                 break;
             case GEO_GAUSS_EQUAL:
-                precomputeWeightsGeoGaussEqual(mySurf, myKernel, passAreas);
+                precomputeWeightsGeoGaussEqual(mySurf, myKernel, passAreas, weightLists);
                 break;
             case GEO_GAUSS:
-                precomputeWeightsGeoGauss(mySurf, myKernel, passAreas);
+                precomputeWeightsGeoGauss(mySurf, myKernel, passAreas, weightLists);
                 break;
             default:
                 throw CaretException("unknown smoothing method specified");
         };
     }
+    setWeightMatrix(weightLists);
+}
+
+void MetricSmoothingObject::setWeightMatrix(const vector<WeightList>& weightLists)
+{//one contiguous allocation per array instead of two per node, so the smoothing loops only stream through memory
+    int32_t numNodes = (int32_t)weightLists.size();
+    m_weightMatrix.m_rowStart.resize(numNodes + 1);
+    m_weightMatrix.m_weightSums.resize(numNodes);
+    int64_t total = 0;
+    for (int32_t i = 0; i < numNodes; ++i)
+    {
+        m_weightMatrix.m_rowStart[i] = total;
+        total += weightLists[i].m_nodes.size();
+        m_weightMatrix.m_weightSums[i] = weightLists[i].m_weightSum;
+    }
+    m_weightMatrix.m_rowStart[numNodes] = total;
+    m_weightMatrix.m_nodes.resize(total);
+    m_weightMatrix.m_weights.resize(total);
+#pragma omp CARET_PARFOR schedule(dynamic, 1024)
+    for (int32_t i = 0; i < numNodes; ++i)
+    {
+        CaretAssert(weightLists[i].m_nodes.size() == weightLists[i].m_weights.size());
+        int64_t start = m_weightMatrix.m_rowStart[i];
+        int32_t numWeights = (int32_t)weightLists[i].m_nodes.size();
+        for (int32_t j = 0; j < numWeights; ++j)
+        {
+            m_weightMatrix.m_nodes[start + j] = weightLists[i].m_nodes[j];
+            m_weightMatrix.m_weights[start + j] = weightLists[i].m_weights[j];
+        }
+    }
 }
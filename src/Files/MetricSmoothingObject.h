@@ -54,21 +54,33 @@ namespace caret {
         void smoothMetric(const MetricFile* metricIn, MetricFile* metricOut, const MetricFile* roi = NULL, const bool& fixZeros = false) const;
     private:
         struct WeightList
-        {
+        {//only used while computing the weights, they are then stored as m_weightMatrix
             std::vector<int32_t> m_nodes;
             std::vector<float> m_weights;
             float m_weightSum;
         };
-        std::vector<WeightList> m_weightLists;
+        struct WeightMatrix
+        {//gathering kernels in compressed sparse row form: row i uses m_nodes and m_weights from m_rowStart[i] to m_rowStart[i + 1]
+            std::vector<int64_t> m_rowStart;
+            std::vector<int32_t> m_nodes;
+            std::vector<float> m_weights;
+            std::vector<float> m_weightSums;
+            int32_t getNumberOfNodes() const { return (int32_t)m_weightSums.size(); }
+        };
+        WeightMatrix m_weightMatrix;
+        ///number of columns smoothed together by smoothMetric, the inner loop is over these columns
+        static const int32_t BLOCK_COLUMNS = 16;
+        void setWeightMatrix(const std::vector<WeightList>& weightLists);
         void smoothColumnInternal(float* scratch, const MetricFile* metricIn, const int& whichColumn, MetricFile* metricOut, const int& whichOutColumn, const bool& fixZeros) const;
         void smoothColumnInternal(float* scratch, const MetricFile* metricIn, const int& whichColumn, MetricFile* metricOut, const int& whichOutColumn, const MetricFile* roi, const int& whichRoiColumn, const bool& fixZeros) const;
+        void smoothColumnBlockInternal(const float* blockIn, float* blockOut, const float* roiColumn, const bool& fixZeros) const;
         void precomputeWeights(const SurfaceFile* mySurf, float myKernel, const MetricFile* theRoi, Method myMethod, const float* nodeAreas);
-        void precomputeWeightsGeoGauss(const SurfaceFile* mySurf, float myKernel, const float* nodeAreas);
-        void precomputeWeightsROIGeoGauss(const SurfaceFile* mySurf, float myKernel, const MetricFile* theRoi, const float* nodeAreas);
-        void precomputeWeightsGeoGaussArea(const SurfaceFile* mySurf, float myKernel, const float* nodeAreas);
-        void precomputeWeightsROIGeoGaussArea(const SurfaceFile* mySurf, float myKernel, const MetricFile* theRoi, const float* nodeAreas);
-        void precomputeWeightsGeoGaussEqual(const SurfaceFile* mySurf, float myKernel, const float* nodeAreas);
-        void precomputeWeightsROIGeoGaussEqual(const SurfaceFile* mySurf, float myKernel, const MetricFile* theRoi, const float* nodeAreas);
+        void precomputeWeightsGeoGauss(const SurfaceFile* mySurf, float myKernel, const float* nodeAreas, std::vector<WeightList>& weightListsOut);
+        void precomputeWeightsROIGeoGauss(const SurfaceFile* mySurf, float myKernel, const MetricFile* theRoi, const float* nodeAreas, std::vector<WeightList>& weightListsOut);
+        void precomputeWeightsGeoGaussArea(const SurfaceFile* mySurf, float myKernel, const float* nodeAreas, std::vector<WeightList>& weightListsOut);
+        void precomputeWeightsROIGeoGaussArea(const SurfaceFile* mySurf, float myKernel, const MetricFile* theRoi, const float* nodeAreas, std::vector<WeightList>& weightListsOut);
+        void precomputeWeightsGeoGaussEqual(const SurfaceFile* mySurf, float myKernel, const float* nodeAreas, std::vector<WeightList>& weightListsOut);
+        void precomputeWeightsROIGeoGaussEqual(const SurfaceFile* mySurf, float myKernel, const MetricFile* theRoi, const float* nodeAreas, std::vector<WeightList>& weightListsOut);
         MetricSmoothingObject();
     };
     
@@ -38,6 +38,7 @@
 #include "GroupAndNameHierarchyItem.h"
 #include "Palette.h"
 #include "PaletteColorMapping.h"
+#include "PaletteLookupTable.h"
 #include "MathFunctions.h"
 
 using namespace caret;
@@ -183,19 +184,10 @@ NodeAndVoxelColoring::colorScalarsWithPalettePrivate(const FastStatistics* stati
                                                           numberOfScalars);
     
     /*
-     * Get color for normalized values of -1.0 and 1.0.
-     * Since there may be a large number of values that are -1.0 or 1.0
-     * we can compute the color only once for these values and save time.
+     * Lookup table avoids searching the palette for each scalar
      */
-    float rgbaPositiveOne[4], rgbaNegativeOne[4];
-    palette->getPaletteColor(1.0,
-                             interpolateFlag,
-                             rgbaPositiveOne);
-    const bool rgbaPositiveOneValid = (rgbaPositiveOne[3] > 0.0);
-    palette->getPaletteColor(-1.0,
-                             interpolateFlag,
-                             rgbaNegativeOne);
-    const bool rgbaNegativeOneValid = (rgbaNegativeOne[3] > 0.0);
+    const std::shared_ptr<const PaletteLookupTable> paletteLookupTable = PaletteLookupTable::getLookupTable(palette,
+                                                                                                           interpolateFlag);
     
     /*
      * Color all scalars.
@@ -268,41 +260,17 @@ NodeAndVoxelColoring::colorScalarsWithPalettePrivate(const FastStatistics* stati
              0.0
         };
         
-        const float normalValue = normalizedValues[i];
-        
         /*
-         * RGBA colors have been mapped for extreme values
+         * Color scalar using palette
          */
-        if (normalValue >= 1.0) {
-            if (rgbaPositiveOneValid) {
-                rgbaOut[0] = rgbaPositiveOne[0];
-                rgbaOut[1] = rgbaPositiveOne[1];
-                rgbaOut[2] = rgbaPositiveOne[2];
-                rgbaOut[3] = rgbaPositiveOne[3];
-            }
-        }
-        else if (normalValue <= -1.0) {
-            if (rgbaNegativeOneValid) {
-                rgbaOut[0] = rgbaNegativeOne[0];
-                rgbaOut[1] = rgbaNegativeOne[1];
-                rgbaOut[2] = rgbaNegativeOne[2];
-                rgbaOut[3] = rgbaNegativeOne[3];
-            }
-        }
-        else {
-            /*
-             * Color scalar using palette
-             */
-            float rgba[4];
-            palette->getPaletteColor(normalValue,
-                                     interpolateFlag,
-                                     rgba);
-            if (rgba[3] > 0.0f) {
-                rgbaOut[0] = rgba[0];
-                rgbaOut[1] = rgba[1];
-                rgbaOut[2] = rgba[2];
-                rgbaOut[3] = rgba[3];
-            }
+        float rgba[4];
+        paletteLookupTable->getPaletteColor(normalizedValues[i],
+                                            rgba);
+        if (rgba[3] > 0.0f) {
+            rgbaOut[0] = rgba[0];
+            rgbaOut[1] = rgba[1];
+            rgbaOut[2] = rgba[2];
+            rgbaOut[3] = rgba[3];
         }
         
         /*
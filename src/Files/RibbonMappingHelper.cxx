@@ -47,14 +47,21 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SO
 
 #include "RibbonMappingHelper.h"
 
+#include "CaretAssert.h"
+#include "CaretBinaryFile.h"
 #include "CaretException.h"
+#include "CaretOMP.h"
+#include "DataFileException.h"
 #include "FloatMatrix.h"
 #include "MathFunctions.h"
 #include "SurfaceFile.h"
 #include "TopologyHelper.h"
 #include "VolumeSpace.h"
+#include "WeightsFileHelper.h"
 
+#include <algorithm>
 #include <cmath>
+#include <limits>
 
 using namespace caret;
 using namespace std;
@@ -355,3 +362,188 @@ void RibbonMappingHelper::computeWeightsRibbon(vector<vector<VoxelWeight> >& myW
         }
     }
 }
+
+namespace
+{
+    const char WEIGHTS_FILE_MAGIC[8] = { 'W', 'B', 'V', 'X', 'W', 'G', 'H', 'T' };
+    const int32_t WEIGHTS_FILE_VERSION = 1;
+}
+
+VoxelWeightMatrix::VoxelWeightMatrix()
+{
+    m_dims[0] = 0;
+    m_dims[1] = 0;
+    m_dims[2] = 0;
+    m_rowStart.push_back(0);//zero vertices
+}
+
+VoxelWeightMatrix::VoxelWeightMatrix(const vector<vector<VoxelWeight> >& weights, const int64_t* dims)
+{
+    m_dims[0] = dims[0];
+    m_dims[1] = dims[1];
+    m_dims[2] = dims[2];
+    int64_t numVertices = (int64_t)weights.size();
+    m_rowStart.resize(numVertices + 1);
+    int64_t numEntries = 0;
+    for (int64_t i = 0; i < numVertices; ++i)
+    {
+        m_rowStart[i] = numEntries;
+        numEntries += weights[i].size();
+    }
+    m_rowStart[numVertices] = numEntries;
+    vector<int64_t> entryOffsets(numEntries);
+    m_entryWeight.resize(numEntries);
+    for (int64_t i = 0; i < numVertices; ++i)
+    {
+        int64_t rowStart = m_rowStart[i];
+        for (int64_t j = 0; j < (int64_t)weights[i].size(); ++j)
+        {
+            const int64_t* ijk = weights[i][j].ijk;
+            CaretAssert(ijk[0] >= 0 && ijk[0] < dims[0] && ijk[1] >= 0 && ijk[1] < dims[1] && ijk[2] >= 0 && ijk[2] < dims[2]);
+            entryOffsets[rowStart + j] = ijk[0] + dims[0] * (ijk[1] + dims[1] * ijk[2]);//same as VolumeSpace::getIndex
+            m_entryWeight[rowStart + j] = weights[i][j].weight;
+        }
+    }
+    m_usedVoxels = entryOffsets;//sorted, so gathering them reads each frame in order
+    sort(m_usedVoxels.begin(), m_usedVoxels.end());
+    m_usedVoxels.erase(unique(m_usedVoxels.begin(), m_usedVoxels.end()), m_usedVoxels.end());
+    if (m_usedVoxels.size() > (size_t)numeric_limits<int32_t>::max()) throw CaretException("too many voxels used by mapping weights");
+    m_entryVoxel.resize(numEntries);
+#pragma omp CARET_PARFOR schedule(static, 4096)
+    for (int64_t j = 0; j < numEntries; ++j)
+    {
+        m_entryVoxel[j] = (int32_t)(lower_bound(m_usedVoxels.begin(), m_usedVoxels.end(), entryOffsets[j]) - m_usedVoxels.begin());
+    }
+}
+
+void VoxelWeightMatrix::getVertexWeights(const int64_t& vertex, vector<VoxelWeight>& weightsOut) const
+{
+    CaretAssert(vertex >= 0 && vertex < getNumberOfVertices());
+    weightsOut.clear();
+    for (int64_t j = m_rowStart[vertex]; j < m_rowStart[vertex + 1]; ++j)
+    {
+        int64_t offset = m_usedVoxels[m_entryVoxel[j]];
+        int64_t ijk[3];
+        ijk[0] = offset % m_dims[0];
+        ijk[1] = (offset / m_dims[0]) % m_dims[1];
+        ijk[2] = offset / (m_dims[0] * m_dims[1]);
+        weightsOut.push_back(VoxelWeight(m_entryWeight[j], ijk));
+    }
+}
+
+void VoxelWeightMatrix::apply(const float* const* frames, float* const* outputs, const int& numFrames, const bool& normalize) const
+{
+    CaretAssert(numFrames > 0 && numFrames <= BLOCK_FRAMES);
+    int64_t numUsed = (int64_t)m_usedVoxels.size(), numVertices = getNumberOfVertices();
+    vector<float> block(numUsed * BLOCK_FRAMES, 0.0f);//frames interleaved, so each weight is loaded once and applied to all frames
+#pragma omp CARET_PARFOR schedule(static, 4096)
+    for (int64_t u = 0; u < numUsed; ++u)
+    {
+        int64_t offset = m_usedVoxels[u];
+        float* blockRow = block.data() + u * BLOCK_FRAMES;
+        for (int f = 0; f < numFrames; ++f)
+        {
+            blockRow[f] = frames[f][offset];
+        }
+    }
+    const float* blockData = block.data();
+#pragma omp CARET_PARFOR schedule(dynamic, 64)
+    for (int64_t i = 0; i < numVertices; ++i)
+    {
+        int64_t rowEnd = m_rowStart[i + 1];
+        if (normalize)
+        {//same arithmetic as summing with the nested weights one frame at a time
+            float accum[BLOCK_FRAMES], totalWeight = 0.0f;
+            for (int f = 0; f < BLOCK_FRAMES; ++f) accum[f] = 0.0f;
+            for (int64_t j = m_rowStart[i]; j < rowEnd; ++j)
+            {
+                float weight = m_entryWeight[j];
+                const float* blockRow = blockData + (int64_t)m_entryVoxel[j] * BLOCK_FRAMES;
+                totalWeight += weight;
+                for (int f = 0; f < BLOCK_FRAMES; ++f)
+                {
+                    accum[f] += weight * blockRow[f];
+                }
+            }
+            for (int f = 0; f < numFrames; ++f)
+            {
+                outputs[f][i] = (totalWeight != 0.0f) ? accum[f] / totalWeight : 0.0f;
+            }
+        } else {//weights are already normalized, accumulate in double like the myelin style code always has
+            double accum[BLOCK_FRAMES];
+            for (int f = 0; f < BLOCK_FRAMES; ++f) accum[f] = 0.0;
+            for (int64_t j = m_rowStart[i]; j < rowEnd; ++j)
+            {
+                float weight = m_entryWeight[j];
+                const float* blockRow = blockData + (int64_t)m_entryVoxel[j] * BLOCK_FRAMES;
+                for (int f = 0; f < BLOCK_FRAMES; ++f)
+                {
+                    accum[f] += weight * blockRow[f];
+                }
+            }
+            for (int f = 0; f < numFrames; ++f)
+            {
+                outputs[f][i] = accum[f];
+            }
+        }
+    }
+}
+
+void VoxelWeightMatrix::writeFile(const AString& fileName, const AString& key) const
+{
+    int64_t sizes[3] = { getNumberOfVertices(), (int64_t)m_usedVoxels.size(), (int64_t)m_entryWeight.size() };
+    CaretBinaryFile myFile(fileName, CaretBinaryFile::WRITE_TRUNCATE);
+    WeightsFileHelper::writeHeader(myFile, WEIGHTS_FILE_MAGIC, WEIGHTS_FILE_VERSION, key);
+    myFile.write(m_dims, 3 * sizeof(int64_t));
+    myFile.write(sizes, 3 * sizeof(int64_t));
+    myFile.write(m_rowStart.data(), m_rowStart.size() * sizeof(int64_t));
+    myFile.write(m_usedVoxels.data(), m_usedVoxels.size() * sizeof(int64_t));
+    myFile.write(m_entryVoxel.data(), m_entryVoxel.size() * sizeof(int32_t));
+    myFile.write(m_entryWeight.data(), m_entryWeight.size() * sizeof(float));
+    myFile.close();
+}
+
+bool VoxelWeightMatrix::readFile(const AString& fileName, const AString& key)
+{
+    CaretBinaryFile myFile(fileName, CaretBinaryFile::READ);
+    if (!WeightsFileHelper::readHeader(myFile, WEIGHTS_FILE_MAGIC, WEIGHTS_FILE_VERSION, key, "volume mapping weights")) return false;
+    int64_t dims[3], sizes[3];
+    myFile.read(dims, 3 * sizeof(int64_t));
+    myFile.read(sizes, 3 * sizeof(int64_t));
+    if (dims[0] < 1 || dims[1] < 1 || dims[2] < 1 || sizes[0] < 0 || sizes[1] < 0 || sizes[1] > numeric_limits<int32_t>::max() || sizes[2] < 0)
+    {
+        throw DataFileException(fileName, "invalid sizes in volume mapping weights file");
+    }
+    int64_t arrayCounts[4] = { sizes[0] + 1, sizes[1], sizes[2], sizes[2] };
+    int64_t elementSizes[4] = { sizeof(int64_t), sizeof(int64_t), sizeof(int32_t), sizeof(float) };
+    WeightsFileHelper::checkArraysFit(myFile, arrayCounts, elementSizes, 4, "volume mapping weights");
+    vector<int64_t> rowStart(sizes[0] + 1), usedVoxels(sizes[1]);
+    vector<int32_t> entryVoxel(sizes[2]);
+    vector<float> entryWeight(sizes[2]);
+    myFile.read(rowStart.data(), rowStart.size() * sizeof(int64_t));
+    myFile.read(usedVoxels.data(), usedVoxels.size() * sizeof(int64_t));
+    myFile.read(entryVoxel.data(), entryVoxel.size() * sizeof(int32_t));
+    myFile.read(entryWeight.data(), entryWeight.size() * sizeof(float));
+    if (rowStart[0] != 0 || rowStart[sizes[0]] != sizes[2]) throw DataFileException(fileName, "invalid vertex offsets in volume mapping weights file");
+    for (int64_t i = 0; i < sizes[0]; ++i)
+    {
+        if (rowStart[i + 1] < rowStart[i]) throw DataFileException(fileName, "invalid vertex offsets in volume mapping weights file");
+    }
+    int64_t frameSize = dims[0] * dims[1] * dims[2];
+    for (int64_t u = 0; u < sizes[1]; ++u)
+    {
+        if (usedVoxels[u] < 0 || usedVoxels[u] >= frameSize) throw DataFileException(fileName, "invalid voxel in volume mapping weights file");
+    }
+    for (int64_t j = 0; j < sizes[2]; ++j)
+    {
+        if (entryVoxel[j] < 0 || entryVoxel[j] >= sizes[1]) throw DataFileException(fileName, "invalid voxel in volume mapping weights file");
+    }
+    m_dims[0] = dims[0];//only replace the existing weights once everything is read and checked
+    m_dims[1] = dims[1];
+    m_dims[2] = dims[2];
+    m_rowStart.swap(rowStart);
+    m_usedVoxels.swap(usedVoxels);
+    m_entryVoxel.swap(entryVoxel);
+    m_entryWeight.swap(entryWeight);
+    return true;
+}
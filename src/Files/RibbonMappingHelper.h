@@ -25,6 +25,8 @@
 #include <cstddef>
 #include <vector>
 
+#include "AString.h"
+
 namespace caret
 {
     
@@ -45,6 +47,30 @@ namespace caret
         }
     };
     
+    class VoxelWeightMatrix
+    {//flattened voxel weights for all vertices, with voxels as offsets into a compacted list of the voxels any vertex uses
+        int64_t m_dims[3];
+        std::vector<int64_t> m_rowStart;//vertex i uses entries m_rowStart[i] to m_rowStart[i + 1]
+        std::vector<int32_t> m_entryVoxel;//index into m_usedVoxels
+        std::vector<float> m_entryWeight;
+        std::vector<int64_t> m_usedVoxels;//offset of the voxel within a frame
+    public:
+        ///number of frames that apply() works on per pass over the weights
+        static const int BLOCK_FRAMES = 16;
+        VoxelWeightMatrix();
+        VoxelWeightMatrix(const std::vector<std::vector<VoxelWeight> >& weights, const int64_t* dims);
+        int64_t getNumberOfVertices() const { return (int64_t)m_rowStart.size() - 1; }
+        const int64_t* getDimensions() const { return m_dims; }
+        ///get the weights of one vertex in the nested form
+        void getVertexWeights(const int64_t& vertex, std::vector<VoxelWeight>& weightsOut) const;
+        ///map up to BLOCK_FRAMES frames at once, outputs[f] receives the values for frames[f] - if normalize is true, divide by the sum of each vertex's weights
+        void apply(const float* const* frames, float* const* outputs, const int& numFrames, const bool& normalize) const;
+        ///save in a compact binary file, along with a key describing what the weights were computed from
+        void writeFile(const AString& fileName, const AString& key) const;
+        ///load a file saved by writeFile, returns false without changing anything if the file is for a different key
+        bool readFile(const AString& fileName, const AString& key);
+    };
+    
     class RibbonMappingHelper
     {
     public:
@@ -39,6 +39,7 @@
 
 #include "GiftiFile.h"
 #include "GiftiMetaDataXmlElements.h"
+#include "GraphicsOpenGLTriangleMeshBuffers.h"
 #include "MathFunctions.h"
 #include "Matrix4x4.h"
 #include "Vector3D.h"
@@ -538,6 +539,7 @@ SurfaceFile::initializeMembersSurfaceFile()
 void 
 SurfaceFile::copyHelperSurfaceFile(const SurfaceFile& /*sf*/)
 {
+    m_graphicsTriangleMeshBuffers.reset();
     this->validateDataArraysAfterReading();
 }
 
@@ -586,7 +588,25 @@ void
 SurfaceFile::invalidateNormals()
 {
     m_normalsComputed = false;
+    if (m_graphicsTriangleMeshBuffers != NULL) {
+        m_graphicsTriangleMeshBuffers->invalidateMesh();
+    }
+}
+
+/**
+ * @return The buffer objects for drawing this surface's triangles.  They
+ * are invalidated when the coordinates, normal vectors, triangles, or
+ * coloring of the surface change.
+ */
+GraphicsOpenGLTriangleMeshBuffers*
+SurfaceFile::getGraphicsTriangleMeshBuffers() const
+{
+    if (m_graphicsTriangleMeshBuffers == NULL) {
+        m_graphicsTriangleMeshBuffers.reset(new GraphicsOpenGLTriangleMeshBuffers());
+    }
+    return m_graphicsTriangleMeshBuffers.get();
 }
+
 /**
  * Compute surface normals.
  */
@@ -598,6 +618,9 @@ SurfaceFile::computeNormals()
         return;
     }
     m_normalsComputed = true;
+    if (m_graphicsTriangleMeshBuffers != NULL) {
+        m_graphicsTriangleMeshBuffers->invalidateMesh();
+    }
     int32_t numCoords = this->getNumberOfNodes();
     if (numCoords > 0) {
         this->normalVectors.resize(numCoords * 3);
@@ -879,6 +902,9 @@ CaretPointer<SignedDistanceHelper> SurfaceFile::getSignedDistanceHelper() const
 
 void SurfaceFile::invalidateHelpers()
 {
+    if (m_graphicsTriangleMeshBuffers != NULL) {
+        m_graphicsTriangleMeshBuffers->invalidateMesh();
+    }
     if (m_geoBase != NULL)
     {
         CaretMutexLocker myLock(&m_geoHelperMutex);//make this function threadsafe
@@ -1373,6 +1399,9 @@ SurfaceFile::setModified()
         delete this->boundingBox;
         this->boundingBox = NULL;
     }
+    if (m_graphicsTriangleMeshBuffers != NULL) {
+        m_graphicsTriangleMeshBuffers->invalidateMesh();
+    }
     
     GiftiTypeFile::setModified();
 }
@@ -1563,6 +1592,24 @@ SurfaceFile::invalidateNodeColoringForBrowserTabs()
         this->surfaceMontageNodeColoringForBrowserTabs[i].clear();
         this->wholeBrainNodeColoringForBrowserTabs[i].clear();
     }    
+    if (m_graphicsTriangleMeshBuffers != NULL) {
+        m_graphicsTriangleMeshBuffers->invalidateAllColors();
+    }
+}
+
+/**
+ * Invalidate the graphics buffer containing the given coloring
+ * before the coloring is changed.
+ * @param rgba
+ *    Coloring for a browser tab.
+ */
+void
+SurfaceFile::invalidateNodeColoringGraphicsBuffer(const std::vector<float>& rgba)
+{
+    if ((m_graphicsTriangleMeshBuffers != NULL)
+        && ( ! rgba.empty())) {
+        m_graphicsTriangleMeshBuffers->invalidateColors(&rgba[0]);
+    }
 }
 
 /**
@@ -1684,6 +1731,7 @@ SurfaceFile::setSurfaceNodeColoringRgbaForBrowserTab(const int32_t browserTabInd
                           BrainConstants::MAXIMUM_NUMBER_OF_BROWSER_TABS, 
                           browserTabIndex);
     
+    this->invalidateNodeColoringGraphicsBuffer(this->surfaceNodeColoringForBrowserTabs[browserTabIndex]);
     this->allocateSurfaceNodeColoringForBrowserTab(browserTabIndex, 
                                             false);
     const int numberOfComponentsRGBA = this->getNumberOfNodes() * 4;
@@ -1731,6 +1779,7 @@ SurfaceFile::setSurfaceMontageNodeColoringRgbaForBrowserTab(const int32_t browse
                           BrainConstants::MAXIMUM_NUMBER_OF_BROWSER_TABS, 
                           browserTabIndex);
     
+    this->invalidateNodeColoringGraphicsBuffer(this->surfaceMontageNodeColoringForBrowserTabs[browserTabIndex]);
     this->allocateSurfaceMontageNodeColoringForBrowserTab(browserTabIndex, 
                                                    false);
     const int numberOfComponentsRGBA = this->getNumberOfNodes() * 4;
@@ -1778,6 +1827,7 @@ SurfaceFile::setWholeBrainNodeColoringRgbaForBrowserTab(const int32_t browserTab
                           BrainConstants::MAXIMUM_NUMBER_OF_BROWSER_TABS, 
                           browserTabIndex);
     
+    this->invalidateNodeColoringGraphicsBuffer(this->wholeBrainNodeColoringForBrowserTabs[browserTabIndex]);
     this->allocateWholeBrainNodeColoringForBrowserTab(browserTabIndex, 
                                                    false);
     const int numberOfComponentsRGBA = this->getNumberOfNodes() * 4;
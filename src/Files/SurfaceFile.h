@@ -22,6 +22,7 @@
  */
 /*LICENSE_END*/
 
+#include <memory>
 #include <vector>
 #include <stdint.h>
 
@@ -42,6 +43,7 @@ namespace caret {
     class GeodesicHelper;
     class GeodesicHelperBase;
     class GiftiDataArray;
+    class GraphicsOpenGLTriangleMeshBuffers;
     class Matrix4x4;
     class PlainTextStringBuilder;
     class SignedDistanceHelper;
@@ -186,6 +188,8 @@ namespace caret {
 
         void invalidateNormals();
         
+        GraphicsOpenGLTriangleMeshBuffers* getGraphicsTriangleMeshBuffers() const;
+        
         void translateToCenterOfMass();
         
         void flipNormals();
@@ -220,6 +224,8 @@ namespace caret {
     private:
         void invalidateNodeColoringForBrowserTabs();
         
+        void invalidateNodeColoringGraphicsBuffer(const std::vector<float>& rgba);
+        
         void allocateSurfaceNodeColoringForBrowserTab(const int32_t browserTabIndex,
                                                       const bool zeroizeColorsFlag);
         
@@ -310,6 +316,9 @@ namespace caret {
         
         mutable BoundingBox* boundingBox;
         
+        /** Buffer objects for drawing the triangles, created when first drawn */
+        mutable std::unique_ptr<GraphicsOpenGLTriangleMeshBuffers> m_graphicsTriangleMeshBuffers;
+        
         mutable CaretMutex m_topoHelperMutex, m_geoHelperMutex, m_locatorMutex, m_distHelperMutex;
     };
 
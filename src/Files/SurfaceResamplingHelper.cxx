@@ -26,24 +26,56 @@
 #include "SurfaceResamplingHelper.h"
 
 #include "CaretAssert.h"
+#include "CaretBinaryFile.h"
 #include "CaretException.h"
+#include "CaretLogger.h"
 #include "CaretOMP.h"
+#include "DataFileException.h"
 #include "GeodesicHelper.h"
 #include "SignedDistanceHelper.h"
 #include "SurfaceFile.h"
 #include "TopologyHelper.h"
 #include "Vector3D.h"
+#include "WeightsFileHelper.h"
 
+#include <QCryptographicHash>
+
+#include <limits>
 #include <set>
 #include <map>
 
 using namespace std;
 using namespace caret;
 
+namespace
+{
+    const char WEIGHTS_FILE_MAGIC[8] = { 'W', 'B', 'R', 'S', 'W', 'G', 'H', 'T' };
+    const int32_t WEIGHTS_FILE_VERSION = 1;
+}
+
 SurfaceResamplingHelper::SurfaceResamplingHelper(const SurfaceResamplingMethodEnum::Enum& myMethod, const SurfaceFile* currentSphere, const SurfaceFile* newSphere,
-                                                 const float* currentAreas, const float* newAreas, const float* currentRoi)
+                                                 const float* currentAreas, const float* newAreas, const float* currentRoi, const AString& weightCacheDirectory)
 {
     if (!checkSphere(currentSphere) || !checkSphere(newSphere)) throw CaretException("input surfaces to SurfaceResamplingHelper must be spheres");
+    if (weightCacheDirectory.isEmpty())
+    {
+        computeWeights(myMethod, currentSphere, newSphere, currentAreas, newAreas, currentRoi);
+        return;
+    }
+    AString key = computeWeightsKey(myMethod, currentSphere, newSphere, currentAreas, newAreas, currentRoi);
+    AString fileName = WeightsFileHelper::getCacheFileName(weightCacheDirectory, "resample_weights_", key);
+    if (WeightsFileHelper::loadFromCache(fileName, [&](const AString& name) { return readWeights(name, key); }, "resampling weights"))
+    {
+        if ((int)m_weights.size() - 1 == newSphere->getNumberOfNodes()) return;
+        CaretLogWarning("resampling weights file '" + fileName + "' has the wrong number of vertices, recomputing");
+    }
+    computeWeights(myMethod, currentSphere, newSphere, currentAreas, newAreas, currentRoi);
+    WeightsFileHelper::saveToCache(fileName, [&](const AString& name) { writeWeights(name, key); }, "resampling weights");
+}
+
+void SurfaceResamplingHelper::computeWeights(const SurfaceResamplingMethodEnum::Enum& myMethod, const SurfaceFile* currentSphere, const SurfaceFile* newSphere,
+                                             const float* currentAreas, const float* newAreas, const float* currentRoi)
+{
     SurfaceFile currentSphereMod, newSphereMod;
     changeRadius(100.0f, currentSphere, &currentSphereMod);
     changeRadius(100.0f, newSphere, &newSphereMod);
@@ -60,6 +92,80 @@ SurfaceResamplingHelper::SurfaceResamplingHelper(const SurfaceResamplingMethodEn
     }
 }
 
+AString SurfaceResamplingHelper::computeWeightsKey(const SurfaceResamplingMethodEnum::Enum& myMethod, const SurfaceFile* currentSphere, const SurfaceFile* newSphere,
+                                                   const float* currentAreas, const float* newAreas, const float* currentRoi)
+{
+    QCryptographicHash myHash(QCryptographicHash::Sha1);
+    int32_t header[2] = { WEIGHTS_FILE_VERSION, SurfaceResamplingMethodEnum::toIntegerCode(myMethod) };
+    WeightsFileHelper::addToHash(myHash, header, sizeof(header));
+    WeightsFileHelper::addSurfaceToHash(myHash, currentSphere);
+    WeightsFileHelper::addSurfaceToHash(myHash, newSphere);
+    switch (myMethod)
+    {
+        case SurfaceResamplingMethodEnum::ADAP_BARY_AREA:
+            if (currentAreas == NULL || newAreas == NULL) throw CaretException("ADAP_BARY_AREA method requires area surfaces");
+            WeightsFileHelper::addToHash(myHash, currentAreas, currentSphere->getNumberOfNodes() * sizeof(float));
+            WeightsFileHelper::addToHash(myHash, newAreas, newSphere->getNumberOfNodes() * sizeof(float));
+            break;
+        case SurfaceResamplingMethodEnum::BARYCENTRIC://doesn't use areas
+            break;
+    }
+    WeightsFileHelper::addRoiToHash(myHash, currentRoi, currentSphere->getNumberOfNodes());
+    return WeightsFileHelper::getKey(myHash);
+}
+
+void SurfaceResamplingHelper::writeWeights(const AString& fileName, const AString& key) const
+{
+    if (m_weights.size() == 0) throw CaretException("no resampling weights have been computed");
+    int64_t numNodes = (int64_t)m_weights.size() - 1;
+    int64_t numWeights = m_weights[numNodes] - m_weights[0];
+    vector<int32_t> counts(numNodes);
+    for (int64_t i = 0; i < numNodes; ++i)
+    {
+        counts[i] = (int32_t)(m_weights[i + 1] - m_weights[i]);
+    }
+    CaretBinaryFile myFile(fileName, CaretBinaryFile::WRITE_TRUNCATE);
+    WeightsFileHelper::writeHeader(myFile, WEIGHTS_FILE_MAGIC, WEIGHTS_FILE_VERSION, key);
+    myFile.write(&numNodes, sizeof(int64_t));
+    myFile.write(&numWeights, sizeof(int64_t));
+    myFile.write(counts.data(), numNodes * sizeof(int32_t));
+    myFile.write(m_weights[0], numWeights * sizeof(WeightElem));
+    myFile.close();
+}
+
+bool SurfaceResamplingHelper::readWeights(const AString& fileName, const AString& key)
+{
+    CaretBinaryFile myFile(fileName, CaretBinaryFile::READ);
+    if (!WeightsFileHelper::readHeader(myFile, WEIGHTS_FILE_MAGIC, WEIGHTS_FILE_VERSION, key, "resampling weights")) return false;
+    int64_t numNodes = 0, numWeights = 0;
+    myFile.read(&numNodes, sizeof(int64_t));
+    myFile.read(&numWeights, sizeof(int64_t));
+    if (numNodes < 1 || numNodes > numeric_limits<int32_t>::max() || numWeights < 0) throw DataFileException(fileName, "invalid sizes in resampling weights file");
+    int64_t arrayCounts[2] = { numNodes, numWeights }, elementSizes[2] = { sizeof(int32_t), sizeof(WeightElem) };
+    WeightsFileHelper::checkArraysFit(myFile, arrayCounts, elementSizes, 2, "resampling weights");
+    vector<int32_t> counts(numNodes);
+    myFile.read(counts.data(), numNodes * sizeof(int32_t));
+    CaretArray<WeightElem> storage(numWeights);
+    CaretArray<WeightElem*> weights(numNodes + 1);
+    int64_t curpos = 0;
+    for (int64_t i = 0; i < numNodes; ++i)
+    {
+        if (counts[i] < 0 || curpos + counts[i] > numWeights) throw DataFileException(fileName, "invalid weight counts in resampling weights file");
+        weights[i] = storage + curpos;
+        curpos += counts[i];
+    }
+    if (curpos != numWeights) throw DataFileException(fileName, "invalid weight counts in resampling weights file");
+    weights[numNodes] = storage + numWeights;
+    myFile.read(storage.getArray(), numWeights * sizeof(WeightElem));
+    for (int64_t i = 0; i < numWeights; ++i)
+    {
+        if (storage[i].node < 0) throw DataFileException(fileName, "invalid vertex in resampling weights file");
+    }
+    m_storagechunk = storage;//only replace the existing weights once everything is read
+    m_weights = weights;
+    return true;
+}
+
 void SurfaceResamplingHelper::resampleNormal(const float* input, float* output, const float& invalidVal) const
 {
     int numNodes = (int)m_weights.size() - 1;
@@ -21,6 +21,7 @@
  */
 /*LICENSE_END*/
 
+#include "AString.h"
 #include "CaretPointer.h"
 #include "SurfaceResamplingMethodEnum.h"
 
@@ -48,10 +49,21 @@ namespace caret {
         void computeWeightsBarycentric(const SurfaceFile* currentSphere, const SurfaceFile* newSphere, const float* currentRoi);
         static void makeBarycentricWeights(const SurfaceFile* from, const SurfaceFile* to, std::vector<std::map<int, float> >& weights, const float* currentRoi);
         void compactWeights(const std::vector<std::map<int, float> >& weights);
+        void computeWeights(const SurfaceResamplingMethodEnum::Enum& myMethod, const SurfaceFile* currentSphere, const SurfaceFile* newSphere,
+                            const float* currentAreas, const float* newAreas, const float* currentRoi);
     public:
         SurfaceResamplingHelper() { }
+        ///if weightCacheDirectory is not empty, weights are loaded from a file in it named by computeWeightsKey() when possible, and saved there when not
         SurfaceResamplingHelper(const SurfaceResamplingMethodEnum::Enum& myMethod, const SurfaceFile* currentSphere, const SurfaceFile* newSphere,
-                                const float* currentAreas = NULL, const float* newAreas = NULL, const float* currentRoi = NULL);
+                                const float* currentAreas = NULL, const float* newAreas = NULL, const float* currentRoi = NULL,
+                                const AString& weightCacheDirectory = AString());
+        ///hash of everything the weights depend on, as hex, to name and check saved weight files
+        static AString computeWeightsKey(const SurfaceResamplingMethodEnum::Enum& myMethod, const SurfaceFile* currentSphere, const SurfaceFile* newSphere,
+                                         const float* currentAreas = NULL, const float* newAreas = NULL, const float* currentRoi = NULL);
+        ///save the weights in a compact binary file, along with the key they were computed from
+        void writeWeights(const AString& fileName, const AString& key) const;
+        ///load weights saved by writeWeights, returns false without changing anything if the file is for a different key
+        bool readWeights(const AString& fileName, const AString& key);
         ///resample real-valued data by means of weights
         void resampleNormal(const float* input, float* output, const float& invalidVal = 0.0f) const;
         ///resample 3D coordinate data by means of weights
@@ -0,0 +1,165 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2015  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "WeightsFileHelper.h"
+
+#include "CaretAssert.h"
+#include "CaretBinaryFile.h"
+#include "CaretLogger.h"
+#include "DataFileException.h"
+#include "SurfaceFile.h"
+#include "SystemUtilities.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+namespace
+{
+    const int MAGIC_LENGTH = 8;
+    const int32_t BYTE_ORDER_MARK = 0x01020304;//written natively, a file from a machine with the other byte order just doesn't match
+}
+
+void WeightsFileHelper::addToHash(QCryptographicHash& myHash, const void* data, const int64_t& numBytes)
+{
+    const char* charData = (const char*)data;
+    const int64_t CHUNK = 1 << 30;
+    for (int64_t start = 0; start < numBytes; start += CHUNK)
+    {
+        myHash.addData(charData + start, (int)min(CHUNK, numBytes - start));
+    }
+}
+
+void WeightsFileHelper::addSurfaceToHash(QCryptographicHash& myHash, const SurfaceFile* surface)
+{
+    int32_t numNodes = surface->getNumberOfNodes(), numTris = surface->getNumberOfTriangles();
+    addToHash(myHash, &numNodes, sizeof(int32_t));
+    addToHash(myHash, &numTris, sizeof(int32_t));
+    addToHash(myHash, surface->getCoordinateData(), numNodes * 3 * sizeof(float));
+    if (numTris > 0) addToHash(myHash, surface->getTriangle(0), numTris * 3 * sizeof(int32_t));
+}
+
+void WeightsFileHelper::addRoiToHash(QCryptographicHash& myHash, const float* roi, const int64_t& count)
+{
+    if (roi == NULL)
+    {
+        addToHash(myHash, "noroi", 5);
+        return;
+    }
+    vector<char> roiMask(count);
+    for (int64_t i = 0; i < count; ++i)
+    {
+        roiMask[i] = (roi[i] > 0.0f ? 1 : 0);
+    }
+    addToHash(myHash, roiMask.data(), count);
+}
+
+AString WeightsFileHelper::getKey(QCryptographicHash& myHash)
+{
+    AString ret(myHash.result().toHex());
+    CaretAssert(ret.size() == KEY_LENGTH);
+    return ret;
+}
+
+AString WeightsFileHelper::getCacheFileName(const AString& cacheDirectory, const AString& prefix, const AString& key)
+{
+    return QDir(cacheDirectory).filePath(prefix + key + ".bin");
+}
+
+void WeightsFileHelper::writeHeader(CaretBinaryFile& myFile, const char* magic, const int32_t& version, const AString& key)
+{
+    QByteArray keyBytes = key.toLatin1();
+    if (keyBytes.size() != KEY_LENGTH) throw CaretException("invalid weights key '" + key + "'");
+    myFile.write(magic, MAGIC_LENGTH);
+    myFile.write(&version, sizeof(int32_t));
+    myFile.write(&BYTE_ORDER_MARK, sizeof(int32_t));
+    myFile.write(keyBytes.constData(), KEY_LENGTH);
+}
+
+bool WeightsFileHelper::readHeader(CaretBinaryFile& myFile, const char* magic, const int32_t& version, const AString& key, const AString& description)
+{
+    const AString fileName = myFile.getFilename();
+    char fileMagic[MAGIC_LENGTH];
+    int32_t fileVersion = 0, byteOrder = 0;
+    myFile.read(fileMagic, MAGIC_LENGTH);
+    if (memcmp(fileMagic, magic, MAGIC_LENGTH) != 0) throw DataFileException(fileName, "file is not a " + description + " file");
+    myFile.read(&fileVersion, sizeof(int32_t));
+    myFile.read(&byteOrder, sizeof(int32_t));
+    if (byteOrder != BYTE_ORDER_MARK)
+    {
+        CaretLogInfo(description + " file '" + fileName + "' was made on a machine with different byte order");
+        return false;
+    }
+    if (fileVersion != version) throw DataFileException(fileName, "unsupported " + description + " file version: " + AString::number(fileVersion));
+    char keyBytes[KEY_LENGTH];
+    myFile.read(keyBytes, KEY_LENGTH);
+    return (QByteArray(keyBytes, KEY_LENGTH) == key.toLatin1());
+}
+
+void WeightsFileHelper::checkArraysFit(CaretBinaryFile& myFile, const int64_t* counts, const int64_t* elementSizes, const int& numArrays, const AString& description)
+{
+    int64_t fileSize = myFile.size();
+    if (fileSize < 0) return;//can't tell, let the reads fail instead
+    int64_t remaining = fileSize - myFile.pos();
+    for (int i = 0; i < numArrays; ++i)
+    {//divide instead of multiplying, so garbage counts can't overflow
+        if (counts[i] < 0 || counts[i] > remaining / elementSizes[i])
+        {
+            throw DataFileException(myFile.getFilename(), description + " file is truncated or has invalid sizes");
+        }
+        remaining -= counts[i] * elementSizes[i];
+    }
+}
+
+bool WeightsFileHelper::loadFromCache(const AString& fileName, const function<bool (const AString&)>& reader, const AString& description)
+{
+    if (!QFile::exists(fileName)) return false;
+    try
+    {
+        return reader(fileName);
+    } catch (CaretException& e) {
+        CaretLogWarning("failed to read " + description + " file '" + fileName + "', recomputing: " + e.whatString());
+    }
+    return false;
+}
+
+void WeightsFileHelper::saveToCache(const AString& fileName, const function<void (const AString&)>& writer, const AString& description)
+{
+    AString tempName = fileName + "." + SystemUtilities::createUniqueID() + ".tmp";
+    try
+    {
+        AString directory = QFileInfo(fileName).absolutePath();
+        if (!QDir().mkpath(directory)) throw DataFileException("failed to create directory '" + directory + "'");
+        writer(tempName);
+        QFile::remove(fileName);//QFile::rename won't replace an existing file, another process may have saved the same weights meanwhile
+        if (!QFile::rename(tempName, fileName)) throw DataFileException("failed to rename '" + tempName + "' to '" + fileName + "'");
+    } catch (CaretException& e) {
+        QFile::remove(tempName);
+        CaretLogWarning("failed to save " + description + " file: " + e.whatString());
+    }
+}
@@ -0,0 +1,74 @@
+#ifndef __WEIGHTS_FILE_HELPER_H__
+#define __WEIGHTS_FILE_HELPER_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "AString.h"
+
+#include <functional>
+#include <stdint.h>
+
+class QCryptographicHash;
+
+namespace caret
+{
+    
+    class CaretBinaryFile;
+    class SurfaceFile;
+    
+    ///file handling shared by the saved weight files (surface resampling, ribbon mapping)
+    ///each file starts with an 8 character magic string, a version, a byte order marker, and a key that is a hash of everything the weights depend on
+    class WeightsFileHelper
+    {
+        WeightsFileHelper();
+    public:
+        ///length of a key, the hex of a sha1 hash
+        static const int KEY_LENGTH = 40;
+        
+        ///QCryptographicHash::addData takes an int, this takes any size
+        static void addToHash(QCryptographicHash& myHash, const void* data, const int64_t& numBytes);
+        ///hash the coordinates and topology of a surface
+        static void addSurfaceToHash(QCryptographicHash& myHash, const SurfaceFile* surface);
+        ///hash only whether each roi value is greater than zero, so roi files with other nonzero values can share weights - roi may be NULL
+        static void addRoiToHash(QCryptographicHash& myHash, const float* roi, const int64_t& count);
+        ///the key for a finished hash
+        static AString getKey(QCryptographicHash& myHash);
+        
+        ///name of the file for a key in a cache directory
+        static AString getCacheFileName(const AString& cacheDirectory, const AString& prefix, const AString& key);
+        
+        ///write the magic, version, byte order and key
+        static void writeHeader(CaretBinaryFile& myFile, const char* magic, const int32_t& version, const AString& key);
+        ///read and check what writeHeader wrote, returns false if the file has the other byte order or a different key, throws if it isn't a current file of this kind
+        static bool readHeader(CaretBinaryFile& myFile, const char* magic, const int32_t& version, const AString& key, const AString& description);
+        ///throw unless arrays with these element counts and sizes fit in the rest of the file, to check sizes read from the file before allocating
+        static void checkArraysFit(CaretBinaryFile& myFile, const int64_t* counts, const int64_t* elementSizes, const int& numArrays, const AString& description);
+        
+        ///if the file exists, call reader on it - false if it didn't exist, the reader returned false, or reading failed (which is logged)
+        static bool loadFromCache(const AString& fileName, const std::function<bool (const AString&)>& reader, const AString& description);
+        ///call writer with a temporary name in the same directory and then rename it, so other processes using the directory never see a partial file
+        ///failure is logged and not thrown, because the weights are already computed
+        static void saveToCache(const AString& fileName, const std::function<void (const AString&)>& writer, const AString& description);
+    };
+    
+}
+
+#endif //__WEIGHTS_FILE_HELPER_H__
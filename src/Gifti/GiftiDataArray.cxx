@@ -25,6 +25,7 @@
 #include <sstream>
 
 #include "Base64.h"
+#include "Base64StreamDecoder.h"
 #include "ByteOrderEnum.h"
 #include "ByteSwapping.h"
 #include "CaretAssert.h"
@@ -589,15 +590,11 @@ GiftiDataArray::readFromText(const AString text,
                              const int64_t externalFileOffsetForReading,
                              const bool isReadOnlyMetaData)
 {
-   const NiftiDataTypeEnum::Enum requiredDataType = dataType;
-   dataType = dataTypeForReading;
-   encoding = encodingForReading;
-   endian   = dataEndianForReading;
-   arraySubscriptingOrder = arraySubscriptingOrderForReading;
-   setDimensions(dimensionsForReading);
-   if (dimensionsForReading.size() == 0) {
-      throw GiftiException("Data array has no dimensions.");
-   }
+   const NiftiDataTypeEnum::Enum requiredDataType = prepareForReading(dataEndianForReading,
+                                                                      arraySubscriptingOrderForReading,
+                                                                      dataTypeForReading,
+                                                                      dimensionsForReading,
+                                                                      encodingForReading);
    //setExternalFileInformation(externalFileNameForReading,
    //                           externalFileOffsetForReading);//TSC: don't set the external filename on the array, because that is what it uses when writing the array
                               
@@ -651,78 +648,20 @@ GiftiDataArray::readFromText(const AString text,
             }
             break;
           case GiftiEncodingEnum::BASE64_BINARY:
-            {
-               //
-               // Decode the Base64 data using VTK's algorithm
-               //
-               const uint64_t numDecoded =
-                     Base64::decode((const unsigned char*)(text.toStdString().c_str()),
-                                                data.size(),
-                                                &data[0]);
-               if (numDecoded != data.size()) {
-                  std::ostringstream str;
-                  str << "Decoding of Base64 Binary data failed.\n"
-                   << "Decoded " << AString::number(numDecoded).toStdString() << " bytes but should be "
-                      << AString::number(static_cast<int>(data.size())).toStdString() << " bytes.";
-                  throw GiftiException(AString::fromStdString(str.str()));
-               }
-               
-               //
-               // Is byte swapping needed ?
-               //
-               if (endian != getSystemEndian()) {
-                  byteSwapData(getSystemEndian());
-               }
-            }
-            break;
           case GiftiEncodingEnum::GZIP_BASE64_BINARY:
             {
-               //
-               // Decode the Base64 data using VTK's algorithm
-               //
-               unsigned char* dataBuffer = new unsigned char[data.size()];
-               //const char* textChars = text.toLatin1().constData();
-               const uint64_t numDecoded =
-                     Base64::decode((unsigned char*)text.toStdString().c_str(),
-                                                data.size(),
-                                                dataBuffer);
-               if (numDecoded == 0) {
-                   std::ostringstream str;
-                   str << "Decoding of GZip Base64 Binary data failed."
-                   << "Decoded " << AString::number(numDecoded).toStdString() << " bytes but should be "
-                   << AString::number(static_cast<int>(data.size())).toStdString() << " bytes.";
-                   throw GiftiException(AString::fromStdString(str.str()));
-               }
-               
-               
-               //
-               // Uncompress the data using VTK's algorithm
-               // 
-                DataCompressZLib compressor;
-                const uint64_t uncompressedDataLength = 
-                                   compressor.uncompressData(dataBuffer,
-                                                          numDecoded,
-                                                          (unsigned char*)&data[0],
-                                                          data.size());
-               if (uncompressedDataLength != data.size()) {
-                  std::ostringstream str;
-                  str << "Decompression of Binary data failed.\n"
-                   << "Uncompressed " << AString::number(uncompressedDataLength).toStdString() << " bytes but should be "
-                   << AString::number(static_cast<uint64_t>(data.size())).toStdString() << " bytes.";
-                  throw GiftiException(AString::fromStdString(str.str()));
+               const std::string textString = text.toStdString();
+               std::vector<uint8_t> decodedData;
+               try {
+                   Base64StreamDecoder::decode(textString.c_str(),
+                                               textString.length(),
+                                               decodedData);
                }
-               
-               //
-               // Free memory
-               //
-               delete[] dataBuffer;
-               
-               //
-               // Is byte swapping needed ? 
-               //
-               if (endian != getSystemEndian()) {
-                  byteSwapData(getSystemEndian());
+               catch (const CaretException& e) {
+                   throw GiftiException("Decoding of Base64 Binary data failed.\n"
+                                        + e.whatString());
                }
+               setDataFromDecodedBase64(decodedData);
             }
             break;
           case GiftiEncodingEnum::EXTERNAL_FILE_BINARY:
@@ -797,26 +736,162 @@ GiftiDataArray::readFromText(const AString text,
             break;
       }
    
-      //
-      // Check if data type needs to be converted
-      //
-      if (requiredDataType != dataType) {
-          if (intent != NiftiIntentEnum::NIFTI_INTENT_POINTSET) {
-            convertToDataType(requiredDataType);
-         }
-      }
-      
-       //
-       // Are array indices in opposite order
-       //
-       if (arraySubscriptingOrderForReading == GiftiArrayIndexingOrderEnum::COLUMN_MAJOR_ORDER) {
-           convertArrayIndexingOrder();
-       }
+      finishReading(requiredDataType,
+                    arraySubscriptingOrderForReading);
    } // If NOT metadata only
    
    setModified();
 }
 
+/**
+ * read a GIFTI data array from base64 (or gzip base64) data that was
+ * decoded while the file was parsed.  Arrays do not share anything
+ * while this runs so several arrays may be read at the same time.
+ *
+ * @param decodedData
+ *    The decoded data.  Its content is taken (it is used as the
+ *    data of this array when it is not compressed).
+ */
+void
+GiftiDataArray::readFromDecodedBase64(std::vector<uint8_t>& decodedData,
+                                      const GiftiEndianEnum::Enum dataEndianForReading,
+                                      const GiftiArrayIndexingOrderEnum::Enum arraySubscriptingOrderForReading,
+                                      const NiftiDataTypeEnum::Enum dataTypeForReading,
+                                      const std::vector<int64_t>& dimensionsForReading,
+                                      const GiftiEncodingEnum::Enum encodingForReading)
+{
+   CaretAssert((encodingForReading == GiftiEncodingEnum::BASE64_BINARY)
+               || (encodingForReading == GiftiEncodingEnum::GZIP_BASE64_BINARY));
+   const NiftiDataTypeEnum::Enum requiredDataType = prepareForReading(dataEndianForReading,
+                                                                      arraySubscriptingOrderForReading,
+                                                                      dataTypeForReading,
+                                                                      dimensionsForReading,
+                                                                      encodingForReading);
+   setDataFromDecodedBase64(decodedData);
+   finishReading(requiredDataType,
+                 arraySubscriptingOrderForReading);
+   
+   setModified();
+}
+
+/**
+ * Set the encoding, dimensions, etc. of the data being read and
+ * allocate the data.
+ *
+ * @return
+ *    The data type of the array before reading, data is converted
+ *    to this type by finishReading().
+ */
+NiftiDataTypeEnum::Enum
+GiftiDataArray::prepareForReading(const GiftiEndianEnum::Enum dataEndianForReading,
+                                  const GiftiArrayIndexingOrderEnum::Enum arraySubscriptingOrderForReading,
+                                  const NiftiDataTypeEnum::Enum dataTypeForReading,
+                                  const std::vector<int64_t>& dimensionsForReading,
+                                  const GiftiEncodingEnum::Enum encodingForReading)
+{
+   const NiftiDataTypeEnum::Enum requiredDataType = dataType;
+   dataType = dataTypeForReading;
+   encoding = encodingForReading;
+   endian   = dataEndianForReading;
+   arraySubscriptingOrder = arraySubscriptingOrderForReading;
+   setDimensions(dimensionsForReading);
+   if (dimensionsForReading.size() == 0) {
+      throw GiftiException("Data array has no dimensions.");
+   }
+   
+   return requiredDataType;
+}
+
+/**
+ * Convert the data that was read to the required data type
+ * and to row major order.
+ */
+void
+GiftiDataArray::finishReading(const NiftiDataTypeEnum::Enum requiredDataType,
+                              const GiftiArrayIndexingOrderEnum::Enum arraySubscriptingOrderForReading)
+{
+   //
+   // Check if data type needs to be converted
+   //
+   if (requiredDataType != dataType) {
+       if (intent != NiftiIntentEnum::NIFTI_INTENT_POINTSET) {
+         convertToDataType(requiredDataType);
+      }
+   }
+   
+    //
+    // Are array indices in opposite order
+    //
+    if (arraySubscriptingOrderForReading == GiftiArrayIndexingOrderEnum::COLUMN_MAJOR_ORDER) {
+        convertArrayIndexingOrder();
+    }
+}
+
+/**
+ * Set the data from decoded base64 data.  Uncompressed data is swapped
+ * into the array, compressed data is uncompressed directly into the array.
+ * Data must have been allocated by prepareForReading().
+ *
+ * @param decodedData
+ *    The decoded data, content is taken.
+ */
+void
+GiftiDataArray::setDataFromDecodedBase64(std::vector<uint8_t>& decodedData)
+{
+   switch (encoding) {
+       case GiftiEncodingEnum::BASE64_BINARY:
+       {
+           if (decodedData.size() != data.size()) {
+              std::ostringstream str;
+              str << "Decoding of Base64 Binary data failed.\n"
+               << "Decoded " << AString::number(static_cast<int64_t>(decodedData.size())).toStdString() << " bytes but should be "
+                  << AString::number(static_cast<int64_t>(data.size())).toStdString() << " bytes.";
+              throw GiftiException(AString::fromStdString(str.str()));
+           }
+           data.swap(decodedData);
+           updateDataPointers();
+       }
+           break;
+       case GiftiEncodingEnum::GZIP_BASE64_BINARY:
+       {
+           if (decodedData.empty()) {
+               throw GiftiException("Decoding of GZip Base64 Binary data failed, no data was decoded.");
+           }
+           
+           //
+           // Uncompress the data using VTK's algorithm
+           //
+           if ( ! data.empty()) {
+               DataCompressZLib compressor;
+               const uint64_t uncompressedDataLength =
+                                  compressor.uncompressData(&decodedData[0],
+                                                            decodedData.size(),
+                                                            (unsigned char*)&data[0],
+                                                            data.size());
+               if (uncompressedDataLength != data.size()) {
+                  std::ostringstream str;
+                  str << "Decompression of Binary data failed.\n"
+                   << "Uncompressed " << AString::number(uncompressedDataLength).toStdString() << " bytes but should be "
+                   << AString::number(static_cast<uint64_t>(data.size())).toStdString() << " bytes.";
+                  throw GiftiException(AString::fromStdString(str.str()));
+               }
+           }
+           std::vector<uint8_t>().swap(decodedData);
+       }
+           break;
+       default:
+           CaretAssertMessage(0, "Encoding is not base64");
+           break;
+   }
+   
+   //
+   // Is byte swapping needed ?
+   //
+   if (endian != getSystemEndian()) {
+      byteSwapData(getSystemEndian());
+   }
+}
+
 /**
  * convert array indexing order of data.
  */
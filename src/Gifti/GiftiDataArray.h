@@ -123,6 +123,14 @@ namespace caret {
                           const int64_t externalFileOffsetForReading,
                           const bool isReadOnlyMetaData);
         
+        // read a data array from base64 data that has already been decoded
+        void readFromDecodedBase64(std::vector<uint8_t>& decodedData,
+                                   const GiftiEndianEnum::Enum dataEndianForReading,
+                                   const GiftiArrayIndexingOrderEnum::Enum arraySubscriptingOrderForReading,
+                                   const NiftiDataTypeEnum::Enum dataTypeForReading,
+                                   const std::vector<int64_t>& dimensionsForReading,
+                                   const GiftiEncodingEnum::Enum encodingForReading);
+        
         // write the data as XML
         void writeAsXML(std::ostream& stream, 
                         std::ostream* externalBinaryOutputStream,
@@ -326,6 +334,20 @@ namespace caret {
         /// convert array indexing order of data
         void convertArrayIndexingOrder();
         
+        // set the encoding, dimensions, etc. before reading data
+        NiftiDataTypeEnum::Enum prepareForReading(const GiftiEndianEnum::Enum dataEndianForReading,
+                                                  const GiftiArrayIndexingOrderEnum::Enum arraySubscriptingOrderForReading,
+                                                  const NiftiDataTypeEnum::Enum dataTypeForReading,
+                                                  const std::vector<int64_t>& dimensionsForReading,
+                                                  const GiftiEncodingEnum::Enum encodingForReading);
+        
+        // convert data type and indexing order after reading data
+        void finishReading(const NiftiDataTypeEnum::Enum requiredDataType,
+                           const GiftiArrayIndexingOrderEnum::Enum arraySubscriptingOrderForReading);
+        
+        // set the data from decoded base64 or gzip base64 data
+        void setDataFromDecodedBase64(std::vector<uint8_t>& decodedData);
+        
         /// the data
         std::vector<uint8_t> data;
         
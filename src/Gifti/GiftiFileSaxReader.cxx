@@ -18,9 +18,11 @@
  */
 /*LICENSE_END*/
 
+#include <cstring>
 #include <sstream>
 
 #include "CaretLogger.h"
+#include "CaretOMP.h"
 #include "FileInformation.h"
 #include "GiftiEndianEnum.h"
 #include "GiftiLabel.h"
@@ -50,6 +52,7 @@ GiftiFileSaxReader::GiftiFileSaxReader(GiftiFile* giftiFileIn)
     this->labelTableSaxReader = NULL;
     this->metaDataSaxReader = NULL;
     this->dataArrayDataHasBeenRead = false;
+    this->base64DecodingFlag = false;
 }
 
 /**
@@ -138,6 +141,36 @@ GiftiFileSaxReader::startElement(const AString& namespaceURI,
          }
          else if (qName == GiftiXmlElements::TAG_DATA) {
             this->state = STATE_DATA_ARRAY_DATA;
+             
+             /*
+              * Base64 text is decoded as the parser delivers it
+              * instead of being collected in the element text
+              */
+             if (((this->encodingForReadingArrayData == GiftiEncodingEnum::BASE64_BINARY)
+                  || (this->encodingForReadingArrayData == GiftiEncodingEnum::GZIP_BASE64_BINARY))
+                 && (this->giftiFile->getReadMetaDataOnlyFlag() == false)) {
+                 int64_t expectedNumberOfBytes = 0;
+                 if (this->encodingForReadingArrayData == GiftiEncodingEnum::BASE64_BINARY) {
+                     switch (this->dataTypeForReadingArrayData) {
+                         case NiftiDataTypeEnum::NIFTI_TYPE_FLOAT32:
+                         case NiftiDataTypeEnum::NIFTI_TYPE_INT32:
+                             expectedNumberOfBytes = 4;
+                             break;
+                         case NiftiDataTypeEnum::NIFTI_TYPE_UINT8:
+                             expectedNumberOfBytes = 1;
+                             break;
+                         default:
+                             break;
+                     }
+                     for (std::vector<int64_t>::const_iterator dimIter = this->dimensionsForReadingArrayData.begin();
+                          dimIter != this->dimensionsForReadingArrayData.end();
+                          dimIter++) {
+                         expectedNumberOfBytes *= *dimIter;
+                     }
+                 }
+                 this->base64Decoder.reset(expectedNumberOfBytes);
+                 this->base64DecodingFlag = true;
+             }
          }
          else if (qName == GiftiXmlElements::TAG_COORDINATE_TRANSFORMATION_MATRIX) {
             this->state = STATE_DATA_ARRAY_MATRIX;
@@ -228,6 +261,7 @@ GiftiFileSaxReader::endElement(const AString& namespaceURI,
       case STATE_NONE:
          break;
       case STATE_GIFTI:
+         this->processDecodedArrayData();
          break;
       case STATE_METADATA:
            this->metaDataSaxReader->endElement(namespaceURI, localName, qName);
@@ -515,6 +549,33 @@ GiftiFileSaxReader::processArrayData()
     this->dataArrayDataHasBeenRead = true;
 
     CaretAssert(dataArray);
+    
+    /*
+     * Text was decoded while parsing, conversion to the array's data
+     * is done, for all arrays at once, when the GIFTI element ends.
+     */
+    if (this->base64DecodingFlag) {
+        this->base64DecodingFlag = false;
+        try {
+            this->base64Decoder.finish();
+        }
+        catch (const CaretException& e) {
+            throw XmlSaxParserException("Decoding of Base64 Binary data failed.\n"
+                                        + e.whatString());
+        }
+        
+        this->decodedDataArrays.push_back(DecodedDataArray());
+        DecodedDataArray& dda = this->decodedDataArrays.back();
+        dda.dataArray = this->dataArray.getPointer();
+        this->base64Decoder.takeDecodedData(dda.decodedData);
+        dda.endian = this->endianForReadingArrayData;
+        dda.arraySubscriptingOrder = this->arraySubscriptingOrderForReadingArrayData;
+        dda.dataType = this->dataTypeForReadingArrayData;
+        dda.dimensions = this->dimensionsForReadingArrayData;
+        dda.encoding = this->encodingForReadingArrayData;
+        return;
+    }
+    
     try {
         dataArray->readFromText(elementText,
                                 this->endianForReadingArrayData,
@@ -531,6 +592,47 @@ GiftiFileSaxReader::processArrayData()
     }
 }
 
+/**
+ * Convert the decoded base64 data into the data of the data arrays.
+ * Uncompressing, byte swapping, etc. of each array is independent
+ * of the others so the arrays are processed in parallel.
+ */
+void
+GiftiFileSaxReader::processDecodedArrayData()
+{
+    const int64_t numArrays = static_cast<int64_t>(this->decodedDataArrays.size());
+    if (numArrays <= 0) {
+        return;
+    }
+    
+    std::vector<AString> errorMessages(numArrays);
+#pragma omp CARET_PARFOR schedule(dynamic)
+    for (int64_t i = 0; i < numArrays; i++) {
+        DecodedDataArray& dda = this->decodedDataArrays[i];
+        try {
+            dda.dataArray->readFromDecodedBase64(dda.decodedData,
+                                                 dda.endian,
+                                                 dda.arraySubscriptingOrder,
+                                                 dda.dataType,
+                                                 dda.dimensions,
+                                                 dda.encoding);
+        }
+        catch (const CaretException& e) {
+            errorMessages[i] = e.whatString();
+        }
+        catch (const std::bad_alloc&) {
+            errorMessages[i] = "Insufficient memory for data array " + AString::number(i);
+        }
+    }
+    this->decodedDataArrays.clear();
+    
+    for (int64_t i = 0; i < numArrays; i++) {
+        if ( ! errorMessages[i].isEmpty()) {
+            throw XmlSaxParserException(errorMessages[i]);
+        }
+    }
+}
+
 /**
  * get characters in an element.
  */
@@ -543,6 +645,20 @@ GiftiFileSaxReader::characters(const char* ch)
     else if (this->labelTableSaxReader != NULL) {
         this->labelTableSaxReader->characters(ch);
     }
+    else if (this->base64DecodingFlag) {
+        /*
+         * The parser has already converted this piece of text, but only
+         * the piece, the element's text is never gathered as a whole
+         */
+        try {
+            this->base64Decoder.decode(ch,
+                                       strlen(ch));
+        }
+        catch (const CaretException& e) {
+            throw XmlSaxParserException("Decoding of Base64 Binary data failed.\n"
+                                        + e.whatString());
+        }
+    }
     else {
         elementText += ch;
     }
@@ -594,5 +710,6 @@ GiftiFileSaxReader::startDocument()
 void 
 GiftiFileSaxReader::endDocument()
 {
+    this->processDecodedArrayData();
 }
 
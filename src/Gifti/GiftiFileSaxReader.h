@@ -23,9 +23,11 @@
 /*LICENSE_END*/
 
 #include <stack>
+#include <vector>
 #include <AString.h>
 #include <stdint.h>
 
+#include "Base64StreamDecoder.h"
 #include "CaretPointer.h"
 #include "GiftiArrayIndexingOrderEnum.h"
 #include "GiftiEndianEnum.h"
@@ -106,6 +108,27 @@ namespace caret {
         // create a data array
         void createDataArray(const XmlAttributes& attributes);
         
+        // decode the base64 data arrays that were decoded during parsing
+        void processDecodedArrayData();
+        
+        /// a data array whose base64 text was decoded while parsing
+        struct DecodedDataArray {
+            /// the data array (owned by the GIFTI file)
+            GiftiDataArray* dataArray;
+            /// the decoded (possibly compressed) data
+            std::vector<uint8_t> decodedData;
+            /// endian of the data
+            GiftiEndianEnum::Enum endian;
+            /// array subscripting order of the data
+            GiftiArrayIndexingOrderEnum::Enum arraySubscriptingOrder;
+            /// data type of the data
+            NiftiDataTypeEnum::Enum dataType;
+            /// dimensions of the data
+            std::vector<int64_t> dimensions;
+            /// encoding of the data
+            GiftiEncodingEnum::Enum encoding;
+        };
+        
         /// file reading state
         STATE state;
         
@@ -162,6 +185,15 @@ namespace caret {
         
         /// tracks if data has been read since external binary may not have DATA tag
         bool dataArrayDataHasBeenRead;
+        
+        /// decodes base64 element text as it arrives
+        Base64StreamDecoder base64Decoder;
+        
+        /// true while the text of a base64 DATA element is being decoded
+        bool base64DecodingFlag;
+        
+        /// base64 data arrays waiting for conversion to their data
+        std::vector<DecodedDataArray> decodedDataArrays;
     };
 
 } // namespace
@@ -0,0 +1,354 @@
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2019 Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#define __GRAPHICS_OPEN_G_L_TRIANGLE_MESH_BUFFERS_DECLARE__
+#include "GraphicsOpenGLTriangleMeshBuffers.h"
+#undef __GRAPHICS_OPEN_G_L_TRIANGLE_MESH_BUFFERS_DECLARE__
+
+#include "CaretAssert.h"
+#include "CaretLogger.h"
+#include "CaretOpenGLInclude.h"
+#include "EventGraphicsOpenGLCreateBufferObject.h"
+#include "EventManager.h"
+#include "GraphicsOpenGLBufferObject.h"
+
+using namespace caret;
+
+
+
+/**
+ * \class caret::GraphicsOpenGLTriangleMeshBuffers
+ * \brief OpenGL buffer objects for drawing a triangle mesh such as a surface.
+ * \ingroup Graphics
+ *
+ * The coordinates, normal vectors, and triangles are loaded into buffer
+ * objects once and remain in the graphics memory until the mesh is
+ * invalidated.  Vertex colors are converted to packed unsigned byte RGBA
+ * and a buffer is kept for each set of colors (such as the coloring for
+ * each tab) until those colors are invalidated.
+ */
+
+/**
+ * Constructor.
+ */
+GraphicsOpenGLTriangleMeshBuffers::GraphicsOpenGLTriangleMeshBuffers()
+: CaretObject()
+{
+
+}
+
+/**
+ * Destructor.
+ */
+GraphicsOpenGLTriangleMeshBuffers::~GraphicsOpenGLTriangleMeshBuffers()
+{
+}
+
+/**
+ * Invalidate the coordinates, normal vectors, and triangles after
+ * any of them have changed.
+ */
+void
+GraphicsOpenGLTriangleMeshBuffers::invalidateMesh()
+{
+    m_meshValidFlag = false;
+}
+
+/**
+ * Invalidate the buffer for the given colors after they have changed
+ * or before their memory is released.
+ *
+ * @param rgba
+ *     The colors.
+ */
+void
+GraphicsOpenGLTriangleMeshBuffers::invalidateColors(const float* rgba)
+{
+    m_colorBufferObjects.erase(rgba);
+}
+
+/**
+ * Invalidate the buffers for all colors.
+ */
+void
+GraphicsOpenGLTriangleMeshBuffers::invalidateAllColors()
+{
+    m_colorBufferObjects.clear();
+}
+
+/**
+ * @return A new buffer object or NULL if it cannot be created.
+ */
+GraphicsOpenGLBufferObject*
+GraphicsOpenGLTriangleMeshBuffers::createBufferObject()
+{
+    EventGraphicsOpenGLCreateBufferObject createEvent;
+    EventManager::get()->sendEvent(createEvent.getPointer());
+    GraphicsOpenGLBufferObject* bufferObject = createEvent.getOpenGLBufferObject();
+    if (bufferObject != NULL) {
+        if (bufferObject->getBufferObjectName() == 0) {
+            delete bufferObject;
+            bufferObject = NULL;
+        }
+    }
+    return bufferObject;
+}
+
+/**
+ * Load the coordinate, normal vector, and triangle buffers.
+ *
+ * @param xyz
+ *     Coordinates of the vertices.
+ * @param normalXYZ
+ *     Normal vectors of the vertices.
+ * @param numberOfVertices
+ *     Number of vertices.
+ * @param triangles
+ *     Vertex indices of the triangles.
+ * @param numberOfTriangles
+ *     Number of triangles.
+ * @return
+ *     True if the buffers were loaded, else false.
+ */
+bool
+GraphicsOpenGLTriangleMeshBuffers::loadMeshBuffers(const float* xyz,
+                                                   const float* normalXYZ,
+                                                   const int32_t numberOfVertices,
+                                                   const int32_t* triangles,
+                                                   const int32_t numberOfTriangles)
+{
+    if (m_coordinateBufferObject == NULL) {
+        m_coordinateBufferObject.reset(createBufferObject());
+    }
+    if (m_normalVectorBufferObject == NULL) {
+        m_normalVectorBufferObject.reset(createBufferObject());
+    }
+    if (m_triangleBufferObject == NULL) {
+        m_triangleBufferObject.reset(createBufferObject());
+    }
+    if ((m_coordinateBufferObject == NULL)
+        || (m_normalVectorBufferObject == NULL)
+        || (m_triangleBufferObject == NULL)) {
+        return false;
+    }
+
+    /*
+     * Colors are sized for the vertices
+     */
+    if (numberOfVertices != m_numberOfVertices) {
+        m_colorBufferObjects.clear();
+    }
+
+    const GLsizeiptr xyzSizeBytes = static_cast<GLsizeiptr>(numberOfVertices) * 3 * sizeof(float);
+    glBindBuffer(GL_ARRAY_BUFFER,
+                 m_coordinateBufferObject->getBufferObjectName());
+    glBufferData(GL_ARRAY_BUFFER,
+                 xyzSizeBytes,
+                 (const GLvoid*)xyz,
+                 GL_STATIC_DRAW);
+
+    glBindBuffer(GL_ARRAY_BUFFER,
+                 m_normalVectorBufferObject->getBufferObjectName());
+    glBufferData(GL_ARRAY_BUFFER,
+                 xyzSizeBytes,
+                 (const GLvoid*)normalXYZ,
+                 GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER,
+                 0);
+
+    const GLsizeiptr triangleSizeBytes = static_cast<GLsizeiptr>(numberOfTriangles) * 3 * sizeof(int32_t);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,
+                 m_triangleBufferObject->getBufferObjectName());
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                 triangleSizeBytes,
+                 (const GLvoid*)triangles,
+                 GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,
+                 0);
+
+    m_numberOfVertices  = numberOfVertices;
+    m_numberOfTriangles = numberOfTriangles;
+    m_meshValidFlag     = true;
+
+    return true;
+}
+
+/**
+ * Get the buffer for the given colors, loading it if needed.
+ *
+ * @param rgba
+ *     Float RGBA, four components for each vertex.
+ * @return
+ *     The buffer containing the colors as unsigned byte RGBA or
+ *     NULL if the buffer cannot be created.
+ */
+GraphicsOpenGLBufferObject*
+GraphicsOpenGLTriangleMeshBuffers::loadColorBuffer(const float* rgba)
+{
+    std::unique_ptr<GraphicsOpenGLBufferObject>& colorBufferObject = m_colorBufferObjects[rgba];
+    if (colorBufferObject != NULL) {
+        return colorBufferObject.get();
+    }
+
+    colorBufferObject.reset(createBufferObject());
+    if (colorBufferObject == NULL) {
+        m_colorBufferObjects.erase(rgba);
+        return NULL;
+    }
+
+    /*
+     * Packed bytes are one quarter the size of float colors
+     */
+    const int64_t numberOfComponents = static_cast<int64_t>(m_numberOfVertices) * 4;
+    m_colorBytesRGBA.resize(numberOfComponents);
+    uint8_t* bytes = m_colorBytesRGBA.data();
+    for (int64_t i = 0; i < numberOfComponents; i++) {
+        float value = rgba[i];
+        if (value < 0.0f) value = 0.0f;
+        if (value > 1.0f) value = 1.0f;
+        bytes[i] = static_cast<uint8_t>(value * 255.0f + 0.5f);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER,
+                 colorBufferObject->getBufferObjectName());
+    glBufferData(GL_ARRAY_BUFFER,
+                 static_cast<GLsizeiptr>(numberOfComponents),
+                 (const GLvoid*)bytes,
+                 GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER,
+                 0);
+
+    return colorBufferObject.get();
+}
+
+/**
+ * Draw the triangles using the buffers, loading any buffers
+ * that are not valid.
+ *
+ * @param xyz
+ *     Coordinates of the vertices.
+ * @param normalXYZ
+ *     Normal vectors of the vertices.
+ * @param numberOfVertices
+ *     Number of vertices.
+ * @param triangles
+ *     Vertex indices of the triangles.
+ * @param numberOfTriangles
+ *     Number of triangles.
+ * @param rgba
+ *     Float RGBA for each vertex.  If NULL, no color array is used
+ *     and the triangles are drawn with the current color.
+ * @return
+ *     True if the triangles were drawn, false if buffers are not
+ *     available and the caller must draw the triangles some other way.
+ */
+bool
+GraphicsOpenGLTriangleMeshBuffers::draw(const float* xyz,
+                                        const float* normalXYZ,
+                                        const int32_t numberOfVertices,
+                                        const int32_t* triangles,
+                                        const int32_t numberOfTriangles,
+                                        const float* rgba)
+{
+    if ((numberOfVertices <= 0)
+        || (numberOfTriangles <= 0)) {
+        return true;
+    }
+
+    if ( ! m_meshValidFlag
+        || (numberOfVertices != m_numberOfVertices)
+        || (numberOfTriangles != m_numberOfTriangles)) {
+        if ( ! loadMeshBuffers(xyz,
+                               normalXYZ,
+                               numberOfVertices,
+                               triangles,
+                               numberOfTriangles)) {
+            return false;
+        }
+    }
+
+    /*
+     * Buffers are lost when the context sharing group is destroyed
+     */
+    if ( ! glIsBuffer(m_coordinateBufferObject->getBufferObjectName())) {
+        CaretLogFine("Triangle mesh coordinate buffer is INVALID");
+        m_meshValidFlag = false;
+        m_colorBufferObjects.clear();
+        return false;
+    }
+
+    GraphicsOpenGLBufferObject* colorBufferObject = NULL;
+    if (rgba != NULL) {
+        colorBufferObject = loadColorBuffer(rgba);
+        if (colorBufferObject == NULL) {
+            return false;
+        }
+    }
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glBindBuffer(GL_ARRAY_BUFFER,
+                 m_coordinateBufferObject->getBufferObjectName());
+    glVertexPointer(3, GL_FLOAT, 0, (GLvoid*)0);
+
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glBindBuffer(GL_ARRAY_BUFFER,
+                 m_normalVectorBufferObject->getBufferObjectName());
+    glNormalPointer(GL_FLOAT, 0, (GLvoid*)0);
+
+    if (colorBufferObject != NULL) {
+        glEnableClientState(GL_COLOR_ARRAY);
+        glBindBuffer(GL_ARRAY_BUFFER,
+                     colorBufferObject->getBufferObjectName());
+        glColorPointer(4, GL_UNSIGNED_BYTE, 0, (GLvoid*)0);
+    }
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,
+                 m_triangleBufferObject->getBufferObjectName());
+    glDrawElements(GL_TRIANGLES,
+                   (3 * m_numberOfTriangles),
+                   GL_UNSIGNED_INT,
+                   (GLvoid*)0);
+
+    /*
+     * Unbind buffers
+     */
+    glBindBuffer(GL_ARRAY_BUFFER,
+                 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,
+                 0);
+
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_COLOR_ARRAY);
+
+    return true;
+}
+
+/**
+ * Get a description of this object's content.
+ * @return String describing this object's content.
+ */
+AString
+GraphicsOpenGLTriangleMeshBuffers::toString() const
+{
+    return "GraphicsOpenGLTriangleMeshBuffers";
+}
+
@@ -0,0 +1,103 @@
+#ifndef __GRAPHICS_OPEN_G_L_TRIANGLE_MESH_BUFFERS_H__
+#define __GRAPHICS_OPEN_G_L_TRIANGLE_MESH_BUFFERS_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2019 Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "CaretObject.h"
+
+
+
+namespace caret {
+
+    class GraphicsOpenGLBufferObject;
+
+    class GraphicsOpenGLTriangleMeshBuffers : public CaretObject {
+
+    public:
+        GraphicsOpenGLTriangleMeshBuffers();
+
+        virtual ~GraphicsOpenGLTriangleMeshBuffers();
+
+        GraphicsOpenGLTriangleMeshBuffers(const GraphicsOpenGLTriangleMeshBuffers&) = delete;
+
+        GraphicsOpenGLTriangleMeshBuffers& operator=(const GraphicsOpenGLTriangleMeshBuffers&) = delete;
+
+        void invalidateMesh();
+
+        void invalidateColors(const float* rgba);
+
+        void invalidateAllColors();
+
+        bool draw(const float* xyz,
+                  const float* normalXYZ,
+                  const int32_t numberOfVertices,
+                  const int32_t* triangles,
+                  const int32_t numberOfTriangles,
+                  const float* rgba);
+
+        // ADD_NEW_METHODS_HERE
+
+        virtual AString toString() const;
+
+    private:
+        static GraphicsOpenGLBufferObject* createBufferObject();
+
+        bool loadMeshBuffers(const float* xyz,
+                             const float* normalXYZ,
+                             const int32_t numberOfVertices,
+                             const int32_t* triangles,
+                             const int32_t numberOfTriangles);
+
+        GraphicsOpenGLBufferObject* loadColorBuffer(const float* rgba);
+
+        std::unique_ptr<GraphicsOpenGLBufferObject> m_coordinateBufferObject;
+
+        std::unique_ptr<GraphicsOpenGLBufferObject> m_normalVectorBufferObject;
+
+        std::unique_ptr<GraphicsOpenGLBufferObject> m_triangleBufferObject;
+
+        /** Color buffers, packed RGBA bytes, keyed by the float RGBA they were created from */
+        std::map<const float*, std::unique_ptr<GraphicsOpenGLBufferObject>> m_colorBufferObjects;
+
+        /** Converted colors are placed here for loading into a buffer */
+        std::vector<uint8_t> m_colorBytesRGBA;
+
+        int32_t m_numberOfVertices = 0;
+
+        int32_t m_numberOfTriangles = 0;
+
+        bool m_meshValidFlag = false;
+
+        // ADD_NEW_MEMBERS_HERE
+
+    };
+
+#ifdef __GRAPHICS_OPEN_G_L_TRIANGLE_MESH_BUFFERS_DECLARE__
+    // <PLACE DECLARATIONS OF STATIC MEMBERS HERE>
+#endif // __GRAPHICS_OPEN_G_L_TRIANGLE_MESH_BUFFERS_DECLARE__
+
+} // namespace
+#endif  //__GRAPHICS_OPEN_G_L_TRIANGLE_MESH_BUFFERS_H__
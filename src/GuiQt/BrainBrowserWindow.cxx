@@ -1608,6 +1608,21 @@ BrainBrowserWindow::createActions()
                                 this,
                                 SLOT(processDevelopGraphicsTiming()));
     
+    m_developerEventProfilingAction =
+    WuQtUtilities::createAction("Profile Events",
+                                "Record the time spent processing each type of event and by each listener",
+                                this,
+                                this,
+                                SLOT(processDevelopEventProfiling()));
+    m_developerEventProfilingAction->setCheckable(true);
+    
+    m_developerEventProfileReportAction =
+    WuQtUtilities::createAction("Show Event Profile...",
+                                "Show the times recorded while profiling events",
+                                this,
+                                this,
+                                SLOT(processDevelopEventProfileReport()));
+    
     m_developerExportVtkFileAction = 
     WuQtUtilities::createAction("Export to VTK File",
                                 "Export model(s) to VTK File",
@@ -1679,6 +1694,8 @@ BrainBrowserWindow::createMenuDevelop()
     m_developerExportVtkFileAction->setVisible(false);
     
     menu->addAction(m_developerGraphicsTimingAction);
+    menu->addAction(m_developerEventProfilingAction);
+    menu->addAction(m_developerEventProfileReportAction);
     
     std::vector<DeveloperFlagsEnum::Enum> developerFlags;
     DeveloperFlagsEnum::getAllEnums(developerFlags);
@@ -1723,6 +1740,8 @@ BrainBrowserWindow::createMenuDevelop()
 void
 BrainBrowserWindow::developerMenuAboutToShow()
 {
+    m_developerEventProfilingAction->setChecked(EventManager::get()->isProfilingEnabled());
+    
     std::vector<DeveloperFlagsEnum::Enum> developerFlags;
     DeveloperFlagsEnum::getAllEnums(developerFlags);
     
@@ -3053,6 +3072,39 @@ BrainBrowserWindow::processDevelopGraphicsTiming()
     WuQMessageBox::informationOk(this, msg);
 }
 
+/**
+ * Enable or disable profiling of events.  Enabling profiling
+ * discards any previously recorded times.
+ */
+void
+BrainBrowserWindow::processDevelopEventProfiling()
+{
+    EventManager* eventManager = EventManager::get();
+    if (m_developerEventProfilingAction->isChecked()) {
+        eventManager->resetProfiling();
+    }
+    eventManager->setProfilingEnabled(m_developerEventProfilingAction->isChecked());
+}
+
+/**
+ * Show the times recorded while profiling events.
+ */
+void
+BrainBrowserWindow::processDevelopEventProfileReport()
+{
+    EventManager* eventManager = EventManager::get();
+    AString text = eventManager->getProfilingReport();
+    if ( ! eventManager->isProfilingEnabled()) {
+        text.insert(0, "Event profiling is not enabled.\n\n");
+    }
+    
+    WuQTextEditorDialog::runNonModal("Event Profile",
+                                     text,
+                                     WuQTextEditorDialog::TextMode::PLAIN,
+                                     WuQTextEditorDialog::WrapMode::NO,
+                                     this);
+}
+
 
 /**
  * Export to VTK file.
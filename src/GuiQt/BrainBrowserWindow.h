@@ -232,6 +232,9 @@ namespace caret {
         
         void processDevelopGraphicsTiming();
         
+        void processDevelopEventProfiling();
+        void processDevelopEventProfileReport();
+        
         void processDevelopExportVtkFile();
         void developerMenuAboutToShow();
         void developerMenuFlagTriggered(QAction*);
@@ -420,6 +423,8 @@ namespace caret {
         QAction* m_developMenuAction;
         QActionGroup* m_developerFlagsActionGroup;
         QAction* m_developerGraphicsTimingAction;
+        QAction* m_developerEventProfilingAction;
+        QAction* m_developerEventProfileReportAction;
         QAction* m_developerExportVtkFileAction;
         
         QAction* m_overlayToolBoxAction;
@@ -30,6 +30,7 @@
 #include <QLabel>
 #include <QPushButton>
 #include <QSignalMapper>
+#include <QSpinBox>
 #include <QTabWidget>
 
 #define __PREFERENCES_DIALOG__H__DECLARE__
@@ -40,6 +41,7 @@
 #include "CaretAssert.h"
 #include "CaretLogger.h"
 #include "CaretPreferences.h"
+#include "ConnectivityMatrixRowCache.h"
 #include "EnumComboBoxTemplate.h"
 #include "EventGraphicsUpdateAllWindows.h"
 #include "EventManager.h"
@@ -367,6 +369,20 @@ PreferencesDialog::createMiscellaneousWidget()
     m_dynamicConnectivityComboBox->setToolTip("Sets default (checked or unchecked) for dynamic connectivity files "
                                               "on the Overlay ToolBox --> Connectivity tab.");
     
+    /*
+     * Connectivity row cache size
+     */
+    m_connectivityRowCacheSpinBox = WuQFactory::newSpinBoxWithMinMaxStepSignalInt(0,
+                                                                                  64 * 1024,
+                                                                                  64,
+                                                                                  this,
+                                                                                  SLOT(miscConnectivityRowCacheSpinBoxChanged(int)));
+    m_connectivityRowCacheSpinBox->setSuffix(" MB");
+    m_allWidgets->add(m_connectivityRowCacheSpinBox);
+    m_connectivityRowCacheSpinBox->setToolTip("Memory used to keep rows loaded from connectivity matrix files, "
+                                              "so that returning to a brainordinate does not read the file again.  "
+                                              "Zero disables the cache.");
+    
     /*
      * Logging Level
      */
@@ -414,6 +430,9 @@ PreferencesDialog::createMiscellaneousWidget()
     m_allWidgets->add(m_miscSpecFileDialogViewFilesTypeEnumComboBox->getWidget());
     
     QGridLayout* gridLayout = new QGridLayout();
+    addWidgetToLayout(gridLayout,
+                      "Connectivity Row Cache: ",
+                      m_connectivityRowCacheSpinBox);
     addWidgetToLayout(gridLayout,
                       "Dynconn As Layer Default: ",
                       m_dynamicConnectivityComboBox->getWidget());
@@ -448,6 +467,8 @@ PreferencesDialog::updateMiscellaneousWidget(CaretPreferences* prefs)
 {
     m_dynamicConnectivityComboBox->setStatus(prefs->isDynamicConnectivityDefaultedOn());
     
+    m_connectivityRowCacheSpinBox->setValue(prefs->getConnectivityRowCacheMegabytes());
+    
     const LogLevelEnum::Enum loggingLevel = prefs->getLoggingLevel();
     int indx = m_miscLoggingLevelComboBox->findData(LogLevelEnum::toIntegerCode(loggingLevel));
     if (indx >= 0) {
@@ -1093,6 +1114,18 @@ void PreferencesDialog::miscDynamicConnectivityComboBoxChanged(bool value)
     prefs->setDynamicConnectivityDefaultedOn(value);
 }
 
+/**
+ * Called when connectivity row cache size is changed.
+ * @param value
+ *   New value in megabytes.
+ */
+void PreferencesDialog::miscConnectivityRowCacheSpinBoxChanged(int value)
+{
+    CaretPreferences* prefs = SessionManager::get()->getCaretPreferences();
+    prefs->setConnectivityRowCacheMegabytes(value);
+    ConnectivityMatrixRowCache::getCache()->setByteBudget(static_cast<int64_t>(value) * 1024 * 1024);
+}
+
 /**
  * Called when show develop menu option changed.
  * @param value
@@ -62,6 +62,8 @@ namespace caret {
         
         void miscDynamicConnectivityComboBoxChanged(bool value);
         
+        void miscConnectivityRowCacheSpinBoxChanged(int value);
+        
         void openGLDrawingMethodEnumComboBoxItemActivated();
         void openGLImageCaptureMethodEnumComboBoxItemActivated();
         
@@ -148,6 +150,8 @@ namespace caret {
 
         WuQTrueFalseComboBox* m_dynamicConnectivityComboBox;
         
+        QSpinBox* m_connectivityRowCacheSpinBox;
+        
         EnumComboBoxTemplate* m_volumeAllSlicePlanesLayoutComboBox;
         WuQTrueFalseComboBox* m_volumeAxesCrosshairsComboBox;
         WuQTrueFalseComboBox* m_volumeAxesLabelsComboBox;
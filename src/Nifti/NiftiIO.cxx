@@ -25,6 +25,25 @@
 using namespace std;
 using namespace caret;
 
+namespace
+{
+    const size_t SCRATCH_KEEP_BYTES = 1<<24;//16MiB, larger than any cifti row we expect to read repeatedly
+    thread_local vector<char> t_scratch;
+}
+
+NiftiIO::ThreadScratch::ThreadScratch(const int64_t& size) : m_mem(t_scratch)
+{
+    m_mem.resize(size);
+}
+
+NiftiIO::ThreadScratch::~ThreadScratch()
+{
+    if (m_mem.capacity() > SCRATCH_KEEP_BYTES)
+    {
+        vector<char>().swap(m_mem);
+    }
+}
+
 void NiftiIO::openRead(const QString& filename)
 {
     m_file.open(filename);
@@ -74,7 +93,40 @@ int NiftiIO::getNumComponents() const
     return m_header.getNumComponents();
 }
 
-int NiftiIO::numBytesPerElem()
+void NiftiIO::getSelection(const int& fullDims, const vector<int64_t>& indexSelect, int64_t& numElemsOut, int64_t& numSkipOut) const
+{
+    CaretAssert(fullDims >= 0 && fullDims <= (int)m_dims.size());
+    CaretAssert((size_t)fullDims + indexSelect.size() == m_dims.size());//could be >=, but should catch more stupid mistakes as ==
+    numElemsOut = getNumComponents();//for now, calculate read size on the fly, as the read call will be the slowest part
+    int curDim;
+    for (curDim = 0; curDim < fullDims; ++curDim)
+    {
+        numElemsOut *= m_dims[curDim];
+    }
+    int64_t numDimSkip = numElemsOut;
+    numSkipOut = 0;
+    for (; curDim < (int)m_dims.size(); ++curDim)
+    {
+        CaretAssert(indexSelect[curDim - fullDims] >= 0 && indexSelect[curDim - fullDims] < m_dims[curDim]);
+        numSkipOut += indexSelect[curDim - fullDims] * numDimSkip;
+        numDimSkip *= m_dims[curDim];
+    }
+}
+
+const float* NiftiIO::getMappedFloatData(const int& fullDims, const vector<int64_t>& indexSelect) const
+{
+    const char* mapped = m_file.getMemoryMap();
+    if (mapped == NULL || m_header.isSwapped() || m_header.getDataType() != NIFTI_TYPE_FLOAT32) return NULL;
+    double mult, offset;
+    if (m_header.getDataScaling(mult, offset)) return NULL;
+    int64_t numElems, numSkip;
+    getSelection(fullDims, indexSelect, numElems, numSkip);
+    const char* start = mapped + numSkip * sizeof(float) + m_header.getDataOffset();
+    if ((uintptr_t)start % sizeof(float) != 0) return NULL;
+    return (const float*)start;//openRead already checked that the file isn't truncated
+}
+
+int NiftiIO::numBytesPerElem() const
 {
     switch (m_header.getDataType())
     {
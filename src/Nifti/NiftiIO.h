@@ -24,7 +24,6 @@
 #include "ByteSwapping.h"
 #include "CaretAssert.h"
 #include "CaretBinaryFile.h"
-#include "CaretMutex.h"
 #include "DataFileException.h"
 #include "NiftiHeader.h"
 
@@ -32,6 +31,7 @@
 
 #include <cmath>
 #include <limits>
+#include <type_traits>
 #include <vector>
 
 namespace caret
@@ -42,15 +42,35 @@ namespace caret
         CaretBinaryFile m_file;
         NiftiHeader m_header;
         std::vector<int64_t> m_dims;
-        std::vector<char> m_scratch;//scratch memory for byteswapping, type conversion, etc
-        CaretMutex m_mutex;//protect multithreaded calls from each other
-        int numBytesPerElem();//for resizing scratch
+        class ThreadScratch
+        {//scratch memory for byteswapping, type conversion, etc - one buffer per thread, so concurrent reads and writes don't need a lock
+            std::vector<char>& m_mem;
+            ThreadScratch(const ThreadScratch&);
+            ThreadScratch& operator=(const ThreadScratch&);
+        public:
+            ThreadScratch(const int64_t& size);
+            ~ThreadScratch();//releases the buffer if it is large, so a one-off full-file read doesn't pin memory for the life of the thread
+            char* data() { return m_mem.data(); }
+            int64_t size() const { return m_mem.size(); }
+        };
+        int numBytesPerElem() const;//for resizing scratch
+        void getSelection(const int& fullDims, const std::vector<int64_t>& indexSelect, int64_t& numElemsOut, int64_t& numSkipOut) const;
+        template<typename T>
+        bool readMapped(T* dataOut, const int64_t& numElems, const int64_t& numSkip);//returns false if the fast path can't be used
+        template<typename T>
+        bool isNativeType() const;//true if the file stores exactly T without scaling, so it can be read straight into the output
         template<typename TO, typename FROM>
         void convertRead(TO* out, FROM* in, const int64_t& count);//for reading from file
         template<typename TO, typename FROM>
+        void convertValues(TO* out, const FROM* in, const int64_t& count);//scaling and casting only, input must already be native endian
+        template<typename TO, typename FROM>
         void convertWrite(TO* out, const FROM* in, const int64_t& count);//for writing to file
         template<typename TO, typename FROM>
         static TO clamp(const FROM& in);//deal with integer cast being undefined when converting from outside range
+        template<typename T>
+        static bool isNarrowType() { return std::numeric_limits<T>::digits <= 24; }//narrow enough that scaling in double is as good as long double for a float result
+        template<typename T>
+        static bool isFloatResult() { return !std::numeric_limits<T>::is_integer && std::numeric_limits<T>::digits <= std::numeric_limits<float>::digits; }//floating point, and no more precise than float
     public:
         void openRead(const QString& filename);
         void writeNew(const QString& filename, const NiftiHeader& header, const int& version = 1, const bool& withRead = false, const bool& swapEndian = false);
@@ -66,34 +86,45 @@ namespace caret
         void readData(T* dataOut, const int& fullDims, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead = false);
         template<typename T>
         void writeData(const T* dataIn, const int& fullDims, const std::vector<int64_t>& indexSelect);
+        //read a contiguous run of elements, indexed as if the whole data array was flattened (first dimension fastest, components count as elements)
+        template<typename T>
+        void readDataRange(T* dataOut, const int64_t& firstElem, const int64_t& numElems, const bool& tolerateShortRead = false);
+        //write a contiguous run of elements, same indexing as readDataRange
+        template<typename T>
+        void writeDataRange(const T* dataIn, const int64_t& firstElem, const int64_t& numElems);
+        //pointer directly into the memory mapped file, NULL unless the file is mapped, native endian, unscaled float32 - valid until close()
+        const float* getMappedFloatData(const int& fullDims, const std::vector<int64_t>& indexSelect) const;
     };
     
     template<typename T>
     void NiftiIO::readData(T* dataOut, const int& fullDims, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead)
     {
-        CaretAssert(fullDims >= 0 && fullDims <= (int)m_dims.size());
-        CaretAssert((size_t)fullDims + indexSelect.size() == m_dims.size());//could be >=, but should catch more stupid mistakes as ==
-        int64_t numElems = getNumComponents();//for now, calculate read size on the fly, as the read call will be the slowest part
-        int curDim;
-        for (curDim = 0; curDim < fullDims; ++curDim)
-        {
-            numElems *= m_dims[curDim];
-        }
-        int64_t numDimSkip = numElems, numSkip = 0;
-        for (; curDim < (int)m_dims.size(); ++curDim)
-        {
-            CaretAssert(indexSelect[curDim - fullDims] >= 0 && indexSelect[curDim - fullDims] < m_dims[curDim]);
-            numSkip += indexSelect[curDim - fullDims] * numDimSkip;
-            numDimSkip *= m_dims[curDim];
+        int64_t numElems, numSkip;
+        getSelection(fullDims, indexSelect, numElems, numSkip);
+        readDataRange(dataOut, numSkip, numElems, tolerateShortRead);
+    }
+    
+    template<typename T>
+    void NiftiIO::readDataRange(T* dataOut, const int64_t& firstElem, const int64_t& numElems, const bool& tolerateShortRead)
+    {
+        if (readMapped(dataOut, numElems, firstElem)) return;//no copy or scratch needed
+        const int64_t readStart = firstElem * numBytesPerElem() + m_header.getDataOffset();
+        int64_t numRead = 0;
+        //readAt doesn't use the shared file position, and scratch memory is per-thread, so concurrent reads don't need a lock here
+        if (isNativeType<T>())
+        {//read straight into the output, swap in place if needed
+            m_file.readAt(dataOut, readStart, numElems * numBytesPerElem(), &numRead);
+            if ((numRead != numElems * numBytesPerElem() && !tolerateShortRead) || numRead < 0)
+            {
+                throw DataFileException("error while reading from nifti file '" + m_file.getFilename() + "'");
+            }
+            if (m_header.isSwapped()) ByteSwapping::swapArray(dataOut, numElems);
+            return;
         }
-        CaretMutexLocker locked(&m_mutex);//protect starting with resizing until we are done converting, because we use an internal variable for scratch space
         //we can't guarantee that the output memory is enough to use as scratch space, as we might be doing a narrowing conversion
-        //we are doing FILE ACCESS, so cpu performance isn't really something to worry about
-        m_scratch.resize(numElems * numBytesPerElem());
-        m_file.seek(numSkip * numBytesPerElem() + m_header.getDataOffset());
-        int64_t numRead = 0;
-        m_file.read(m_scratch.data(), m_scratch.size(), &numRead);
-        if ((numRead != (int64_t)m_scratch.size() && !tolerateShortRead) || numRead < 0)//for now, assume read giving -1 is always a problem
+        ThreadScratch scratch(numElems * numBytesPerElem());
+        m_file.readAt(scratch.data(), readStart, scratch.size(), &numRead);
+        if ((numRead != scratch.size() && !tolerateShortRead) || numRead < 0)//for now, assume read giving -1 is always a problem
         {
             throw DataFileException("error while reading from nifti file '" + m_file.getFilename() + "'");
         }
@@ -101,40 +132,40 @@ namespace caret
         {
             case NIFTI_TYPE_UINT8:
             case NIFTI_TYPE_RGB24://handled by components
-                convertRead(dataOut, (uint8_t*)m_scratch.data(), numElems);
+                convertRead(dataOut, (uint8_t*)scratch.data(), numElems);
                 break;
             case NIFTI_TYPE_INT8:
-                convertRead(dataOut, (int8_t*)m_scratch.data(), numElems);
+                convertRead(dataOut, (int8_t*)scratch.data(), numElems);
                 break;
             case NIFTI_TYPE_UINT16:
-                convertRead(dataOut, (uint16_t*)m_scratch.data(), numElems);
+                convertRead(dataOut, (uint16_t*)scratch.data(), numElems);
                 break;
             case NIFTI_TYPE_INT16:
-                convertRead(dataOut, (int16_t*)m_scratch.data(), numElems);
+                convertRead(dataOut, (int16_t*)scratch.data(), numElems);
                 break;
             case NIFTI_TYPE_UINT32:
-                convertRead(dataOut, (uint32_t*)m_scratch.data(), numElems);
+                convertRead(dataOut, (uint32_t*)scratch.data(), numElems);
                 break;
             case NIFTI_TYPE_INT32:
-                convertRead(dataOut, (int32_t*)m_scratch.data(), numElems);
+                convertRead(dataOut, (int32_t*)scratch.data(), numElems);
                 break;
             case NIFTI_TYPE_UINT64:
-                convertRead(dataOut, (uint64_t*)m_scratch.data(), numElems);
+                convertRead(dataOut, (uint64_t*)scratch.data(), numElems);
                 break;
             case NIFTI_TYPE_INT64:
-                convertRead(dataOut, (int64_t*)m_scratch.data(), numElems);
+                convertRead(dataOut, (int64_t*)scratch.data(), numElems);
                 break;
             case NIFTI_TYPE_FLOAT32:
             case NIFTI_TYPE_COMPLEX64://components
-                convertRead(dataOut, (float*)m_scratch.data(), numElems);
+                convertRead(dataOut, (float*)scratch.data(), numElems);
                 break;
             case NIFTI_TYPE_FLOAT64:
             case NIFTI_TYPE_COMPLEX128:
-                convertRead(dataOut, (double*)m_scratch.data(), numElems);
+                convertRead(dataOut, (double*)scratch.data(), numElems);
                 break;
             case NIFTI_TYPE_FLOAT128:
             case NIFTI_TYPE_COMPLEX256:
-                convertRead(dataOut, (long double*)m_scratch.data(), numElems);
+                convertRead(dataOut, (long double*)scratch.data(), numElems);
                 break;
             default:
                 CaretAssert(0);
@@ -145,69 +176,159 @@ namespace caret
     template<typename T>
     void NiftiIO::writeData(const T* dataIn, const int& fullDims, const std::vector<int64_t>& indexSelect)
     {
-        CaretAssert(fullDims >= 0 && fullDims <= (int)m_dims.size());
-        CaretAssert((size_t)fullDims + indexSelect.size() == m_dims.size());//could be >=, but should catch more stupid mistakes as ==
-        int64_t numElems = getNumComponents();//for now, calculate read size on the fly, as the read call will be the slowest part
-        int curDim;
-        for (curDim = 0; curDim < fullDims; ++curDim)
-        {
-            numElems *= m_dims[curDim];
-        }
-        int64_t numDimSkip = numElems, numSkip = 0;
-        for (; curDim < (int)m_dims.size(); ++curDim)
-        {
-            CaretAssert(indexSelect[curDim - fullDims] >= 0 && indexSelect[curDim - fullDims] < m_dims[curDim]);
-            numSkip += indexSelect[curDim - fullDims] * numDimSkip;
-            numDimSkip *= m_dims[curDim];
+        int64_t numElems, numSkip;
+        getSelection(fullDims, indexSelect, numElems, numSkip);
+        writeDataRange(dataIn, numSkip, numElems);
+    }
+    
+    template<typename T>
+    void NiftiIO::writeDataRange(const T* dataIn, const int64_t& firstElem, const int64_t& numElems)
+    {
+        const int64_t writeStart = firstElem * numBytesPerElem() + m_header.getDataOffset();
+        if (isNativeType<T>() && !m_header.isSwapped())
+        {//nothing to convert, write straight from the input
+            m_file.writeAt(dataIn, writeStart, numElems * numBytesPerElem());
+            return;
         }
-        CaretMutexLocker locked(&m_mutex);//protect starting with resizing until we are done writing, because we use an internal variable for scratch space
-        //we are doing FILE ACCESS, so cpu performance isn't really something to worry about
-        m_scratch.resize(numElems * numBytesPerElem());
-        m_file.seek(numSkip * numBytesPerElem() + m_header.getDataOffset());
+        //scratch memory is per-thread and writeAt is thread-safe, so rows can be written concurrently
+        ThreadScratch scratch(numElems * numBytesPerElem());
         switch (m_header.getDataType())
         {
             case NIFTI_TYPE_UINT8:
             case NIFTI_TYPE_RGB24://handled by components
-                convertWrite((uint8_t*)m_scratch.data(), dataIn, numElems);
+                convertWrite((uint8_t*)scratch.data(), dataIn, numElems);
                 break;
             case NIFTI_TYPE_INT8:
-                convertWrite((int8_t*)m_scratch.data(), dataIn, numElems);
+                convertWrite((int8_t*)scratch.data(), dataIn, numElems);
                 break;
             case NIFTI_TYPE_UINT16:
-                convertWrite((uint16_t*)m_scratch.data(), dataIn, numElems);
+                convertWrite((uint16_t*)scratch.data(), dataIn, numElems);
                 break;
             case NIFTI_TYPE_INT16:
-                convertWrite((int16_t*)m_scratch.data(), dataIn, numElems);
+                convertWrite((int16_t*)scratch.data(), dataIn, numElems);
                 break;
             case NIFTI_TYPE_UINT32:
-                convertWrite((uint32_t*)m_scratch.data(), dataIn, numElems);
+                convertWrite((uint32_t*)scratch.data(), dataIn, numElems);
                 break;
             case NIFTI_TYPE_INT32:
-                convertWrite((int32_t*)m_scratch.data(), dataIn, numElems);
+                convertWrite((int32_t*)scratch.data(), dataIn, numElems);
                 break;
             case NIFTI_TYPE_UINT64:
-                convertWrite((uint64_t*)m_scratch.data(), dataIn, numElems);
+                convertWrite((uint64_t*)scratch.data(), dataIn, numElems);
                 break;
             case NIFTI_TYPE_INT64:
-                convertWrite((int64_t*)m_scratch.data(), dataIn, numElems);
+                convertWrite((int64_t*)scratch.data(), dataIn, numElems);
                 break;
             case NIFTI_TYPE_FLOAT32:
             case NIFTI_TYPE_COMPLEX64://components
-                convertWrite((float*)m_scratch.data(), dataIn, numElems);
+                convertWrite((float*)scratch.data(), dataIn, numElems);
                 break;
             case NIFTI_TYPE_FLOAT64:
             case NIFTI_TYPE_COMPLEX128:
-                convertWrite((double*)m_scratch.data(), dataIn, numElems);
+                convertWrite((double*)scratch.data(), dataIn, numElems);
                 break;
             case NIFTI_TYPE_FLOAT128:
             case NIFTI_TYPE_COMPLEX256:
-                convertWrite((long double*)m_scratch.data(), dataIn, numElems);
+                convertWrite((long double*)scratch.data(), dataIn, numElems);
                 break;
             default:
                 CaretAssert(0);
                 throw DataFileException("internal error, tell the developers what you just tried to do");
         }
-        m_file.write(m_scratch.data(), m_scratch.size());
+        m_file.writeAt(scratch.data(), writeStart, scratch.size());
+    }
+    
+    template<typename T>
+    bool NiftiIO::readMapped(T* dataOut, const int64_t& numElems, const int64_t& numSkip)
+    {
+        const char* mapped = m_file.getMemoryMap();
+        if (mapped == NULL || m_header.isSwapped()) return false;//swapping would need scratch memory anyway
+        const int64_t bytesPerElem = numBytesPerElem();
+        const int64_t startByte = numSkip * bytesPerElem + m_header.getDataOffset();
+        if (startByte + numElems * bytesPerElem > m_file.size()) return false;//let the normal path deal with short reads
+        const char* start = mapped + startByte;
+        if ((uintptr_t)start % bytesPerElem != 0) return false;//vox_offset is supposed to be a multiple of 16, but don't trust it
+        switch (m_header.getDataType())
+        {
+            case NIFTI_TYPE_UINT8:
+            case NIFTI_TYPE_RGB24:
+                convertValues(dataOut, (const uint8_t*)start, numElems);
+                break;
+            case NIFTI_TYPE_INT8:
+                convertValues(dataOut, (const int8_t*)start, numElems);
+                break;
+            case NIFTI_TYPE_UINT16:
+                convertValues(dataOut, (const uint16_t*)start, numElems);
+                break;
+            case NIFTI_TYPE_INT16:
+                convertValues(dataOut, (const int16_t*)start, numElems);
+                break;
+            case NIFTI_TYPE_UINT32:
+                convertValues(dataOut, (const uint32_t*)start, numElems);
+                break;
+            case NIFTI_TYPE_INT32:
+                convertValues(dataOut, (const int32_t*)start, numElems);
+                break;
+            case NIFTI_TYPE_UINT64:
+                convertValues(dataOut, (const uint64_t*)start, numElems);
+                break;
+            case NIFTI_TYPE_INT64:
+                convertValues(dataOut, (const int64_t*)start, numElems);
+                break;
+            case NIFTI_TYPE_FLOAT32:
+            case NIFTI_TYPE_COMPLEX64:
+                convertValues(dataOut, (const float*)start, numElems);
+                break;
+            case NIFTI_TYPE_FLOAT64:
+            case NIFTI_TYPE_COMPLEX128:
+                convertValues(dataOut, (const double*)start, numElems);
+                break;
+            case NIFTI_TYPE_FLOAT128:
+            case NIFTI_TYPE_COMPLEX256:
+                convertValues(dataOut, (const long double*)start, numElems);
+                break;
+            default:
+                return false;
+        }
+        return true;
+    }
+    
+    template<typename T>
+    bool NiftiIO::isNativeType() const
+    {
+        double mult, offset;
+        if (m_header.getDataScaling(mult, offset)) return false;
+        switch (m_header.getDataType())
+        {
+            case NIFTI_TYPE_UINT8:
+            case NIFTI_TYPE_RGB24:
+                return std::is_same<T, uint8_t>::value;
+            case NIFTI_TYPE_INT8:
+                return std::is_same<T, int8_t>::value;
+            case NIFTI_TYPE_UINT16:
+                return std::is_same<T, uint16_t>::value;
+            case NIFTI_TYPE_INT16:
+                return std::is_same<T, int16_t>::value;
+            case NIFTI_TYPE_UINT32:
+                return std::is_same<T, uint32_t>::value;
+            case NIFTI_TYPE_INT32:
+                return std::is_same<T, int32_t>::value;
+            case NIFTI_TYPE_UINT64:
+                return std::is_same<T, uint64_t>::value;
+            case NIFTI_TYPE_INT64:
+                return std::is_same<T, int64_t>::value;
+            case NIFTI_TYPE_FLOAT32:
+            case NIFTI_TYPE_COMPLEX64:
+                return std::is_same<T, float>::value;
+            case NIFTI_TYPE_FLOAT64:
+            case NIFTI_TYPE_COMPLEX128:
+                return std::is_same<T, double>::value;
+            case NIFTI_TYPE_FLOAT128:
+            case NIFTI_TYPE_COMPLEX256:
+                return std::is_same<T, long double>::value;
+            default:
+                return false;
+        }
     }
     
     template<typename TO, typename FROM>
@@ -217,6 +338,12 @@ namespace caret
         {
             ByteSwapping::swapArray(in, count);
         }
+        convertValues(out, in, count);
+    }
+    
+    template<typename TO, typename FROM>
+    void NiftiIO::convertValues(TO* out, const FROM* in, const int64_t& count)
+    {
         double mult, offset;
         bool doScale = m_header.getDataScaling(mult, offset);
         if (std::numeric_limits<TO>::is_integer)//do round to nearest when integer output type
@@ -236,9 +363,17 @@ namespace caret
         } else {
             if (doScale)
             {
-                for (int64_t i = 0; i < count; ++i)
-                {
-                    out[i] = (TO)(offset + mult * (long double)in[i]);//we don't always need that much precision, but it will still be faster than hard drives
+                if (isNarrowType<FROM>() && isFloatResult<TO>())
+                {//float output from narrow input doesn't need long double, and double arithmetic vectorizes
+                    for (int64_t i = 0; i < count; ++i)
+                    {
+                        out[i] = (TO)(offset + mult * (double)in[i]);
+                    }
+                } else {
+                    for (int64_t i = 0; i < count; ++i)
+                    {
+                        out[i] = (TO)(offset + mult * (long double)in[i]);//we don't always need that much precision, but it will still be faster than hard drives
+                    }
                 }
             } else {
                 for (int64_t i = 0; i < count; ++i)
@@ -271,9 +406,17 @@ namespace caret
         } else {
             if (doScale)
             {
-                for (int64_t i = 0; i < count; ++i)
-                {
-                    out[i] = (TO)(((long double)in[i] - offset) / mult);//we don't always need that much precision, but it will still be faster than hard drives
+                if (isNarrowType<FROM>() && isFloatResult<TO>())
+                {//ditto
+                    for (int64_t i = 0; i < count; ++i)
+                    {
+                        out[i] = (TO)(((double)in[i] - offset) / mult);
+                    }
+                } else {
+                    for (int64_t i = 0; i < count; ++i)
+                    {
+                        out[i] = (TO)(((long double)in[i] - offset) / mult);//we don't always need that much precision, but it will still be faster than hard drives
+                    }
                 }
             } else {
                 for (int64_t i = 0; i < count; ++i)
@@ -24,15 +24,23 @@
 #include "CaretAssert.h"
 #include "CaretLogger.h"
 #include "CaretMathExpression.h"
+#include "CaretOMP.h"
 #include "CiftiFile.h"
 #include "CiftiXML.h"
 #include "MultiDimIterator.h"
 
+#include <algorithm>
+#include <exception>
 #include <iostream>
 
 using namespace caret;
 using namespace std;
 
+namespace
+{
+    const int64_t ROWS_PER_THREAD = 4;//output rows per thread per batch, there are two batches in memory, plus one input row per variable per thread
+}
+
 AString OperationCiftiMath::getCommandSwitch()
 {
     return "-cifti-math";
@@ -235,57 +243,161 @@ void OperationCiftiMath::useParameters(OperationParameters* myParams, ProgressOb
     }
     if (outXML.getNumberOfDimensions() < 1) throw OperationException("output must have at least 1 dimension");
     myCiftiOut->setCiftiXML(outXML);
-    vector<float> values(numVars), scratchRow(outDims[0]);
-    vector<vector<float> > inputRows(numVars);
-    vector<vector<int64_t> > loadedRow(numVars);//to detect and prevent rereading the same row
+    vector<vector<int64_t> > outRowIndices;//the output rows in file order, so that threads can take them out of order and the writes can still be in order
+    for (MultiDimIterator<int64_t> iter(vector<int64_t>(outDims.begin() + 1, outDims.end())); !iter.atEnd(); ++iter)
+    {
+        outRowIndices.push_back(*iter);
+    }
+    const int64_t numOutRows = (int64_t)outRowIndices.size(), rowLength = outDims[0];
+#ifdef CARET_OMP
+    const int64_t batchRows = omp_get_max_threads() * ROWS_PER_THREAD;
+#else
+    const int64_t batchRows = ROWS_PER_THREAD;
+#endif
+    vector<float> batchBuffers[2];//one batch is being computed while the previous one is written out
+    batchBuffers[0].resize(batchRows * rowLength);
+    batchBuffers[1].resize(batchRows * rowLength);
+    bool concurrentReads = true;//remote inputs can't be read from multiple threads at once, so their reads take turns while the math stays parallel
     for (int v = 0; v < numVars; ++v)
     {
-        inputRows[v].resize(varCiftiFiles[v]->getCiftiXML().getDimensionLength(CiftiXML::ALONG_ROW));
-        loadedRow[v].resize(varCiftiFiles[v]->getCiftiXML().getNumberOfDimensions() - 1, -1);//we always load a full row, so ignore first dim
+        if (!varCiftiFiles[v]->canReadConcurrently()) concurrentReads = false;
     }
-    for (MultiDimIterator<int64_t> iter(vector<int64_t>(outDims.begin() + 1, outDims.end())); !iter.atEnd(); ++iter)
+    bool failed = false;//only touched inside the critical sections, other threads may be setting it
+    exception_ptr firstError;
+#pragma omp CARET_PAR
     {
-        for (int v = 0; v < numVars; ++v)//first, retrieve whichever rows are needed
+        vector<vector<float> > inputRows(numVars), selectRows(numVars);//selectRows holds the -select value for the row dimension, repeated across the row
+        vector<const float*> inputPointers(numVars), exprRows(numVars);
+        vector<vector<int64_t> > loadedRow(numVars);//per thread, to detect and prevent rereading the same row
+        for (int v = 0; v < numVars; ++v)
         {
-            bool needToLoad = false;
-            for (int dim = 0; dim < (int)loadedRow[v].size(); ++dim)
-            {
-                int64_t indexNeeded = -1;
-                if (selectInfo[v][dim + 1] == -1)
+            loadedRow[v].resize(varCiftiFiles[v]->getCiftiXML().getNumberOfDimensions() - 1, -1);//we always load a full row, so ignore first dim
+        }
+        for (int64_t batchStart = 0; batchStart < numOutRows + batchRows; batchStart += batchRows)//one extra pass to write the last batch
+        {
+            const int64_t batchIndex = batchStart / batchRows;
+#pragma omp CARET_SINGLE nowait
+            {//write the previous batch in order, while the other threads start on this one
+                bool skip = true;
+                if (batchStart > 0)
                 {
-                    CaretAssert(dim + 1 < (int)outDims.size());//"match to output index" can't work past output dimensionality
-                    indexNeeded = (*iter)[dim];//NOTE: iter also doesn't include the first dim
-                } else {
-                    indexNeeded = selectInfo[v][dim + 1];
+#pragma omp critical(OperationCiftiMathFail)
+                    skip = failed;
                 }
-                if (indexNeeded != loadedRow[v][dim])
+                if (!skip)
                 {
-                    needToLoad = true;
-                    loadedRow[v][dim] = indexNeeded;
+                    const vector<float>& toWrite = batchBuffers[(batchIndex - 1) % 2];
+                    try
+                    {
+                        for (int64_t row = batchStart - batchRows; row < min(batchStart, numOutRows); ++row)
+                        {
+                            myCiftiOut->setRow(toWrite.data() + (row - (batchStart - batchRows)) * rowLength, outRowIndices[row]);
+                        }
+                    } catch (...) {
+#pragma omp critical(OperationCiftiMathFail)
+                        {
+                            if (!failed)
+                            {
+                                firstError = current_exception();
+                                failed = true;
+                            }
+                        }
+                    }
                 }
             }
-            if (needToLoad)
-            {
-                varCiftiFiles[v]->getRow(inputRows[v].data(), loadedRow[v]);
-            }
-        }
-        for (int j = 0; j < outDims[0]; ++j)
-        {
-            for (int v = 0; v < numVars; ++v)//now we check for select along row
+            vector<float>& toCompute = batchBuffers[batchIndex % 2];
+            const int64_t batchEnd = min(batchStart + batchRows, numOutRows);
+#pragma omp CARET_FOR schedule(dynamic)
+            for (int64_t row = batchStart; row < batchEnd; ++row)
             {
-                if (selectInfo[v][0] == -1)
+                bool skip;
+#pragma omp critical(OperationCiftiMathFail)
+                skip = failed;
+                if (skip) continue;//can't break out of an omp for, so skip the rest quickly
+                try
                 {
-                    values[v] = inputRows[v][j];
-                } else {
-                    values[v] = inputRows[v][selectInfo[v][0]];
+                    for (int v = 0; v < numVars; ++v)//first, retrieve whichever rows are needed
+                    {
+                        bool needToLoad = false;
+                        for (int dim = 0; dim < (int)loadedRow[v].size(); ++dim)
+                        {
+                            int64_t indexNeeded = -1;
+                            if (selectInfo[v][dim + 1] == -1)
+                            {
+                                CaretAssert(dim + 1 < (int)outDims.size());//"match to output index" can't work past output dimensionality
+                                indexNeeded = outRowIndices[row][dim];//NOTE: output row indices also don't include the first dim
+                            } else {
+                                indexNeeded = selectInfo[v][dim + 1];
+                            }
+                            if (indexNeeded != loadedRow[v][dim])
+                            {
+                                needToLoad = true;
+                                loadedRow[v][dim] = indexNeeded;
+                            }
+                        }
+                        if (needToLoad)
+                        {
+                            inputPointers[v] = varCiftiFiles[v]->getRowPointer(loadedRow[v]);//no copy needed if the input is in memory
+                            if (inputPointers[v] == NULL)
+                            {
+                                inputRows[v].resize(varCiftiFiles[v]->getCiftiXML().getDimensionLength(CiftiXML::ALONG_ROW));
+                                if (concurrentReads)
+                                {
+                                    varCiftiFiles[v]->getRow(inputRows[v].data(), loadedRow[v]);
+                                } else {
+                                    exception_ptr readError;//an exception can't leave the critical section
+#pragma omp critical(OperationCiftiMathRead)
+                                    {
+                                        try
+                                        {
+                                            varCiftiFiles[v]->getRow(inputRows[v].data(), loadedRow[v]);
+                                        } catch (...) {
+                                            readError = current_exception();
+                                        }
+                                    }
+                                    if (readError) rethrow_exception(readError);
+                                }
+                                inputPointers[v] = inputRows[v].data();
+                            }
+                            if (selectInfo[v][0] != -1)//now we check for select along row
+                            {
+                                selectRows[v].assign(rowLength, inputPointers[v][selectInfo[v][0]]);
+                            }
+                        }
+                        if (selectInfo[v][0] == -1)
+                        {
+                            exprRows[v] = inputPointers[v];
+                        } else {
+                            exprRows[v] = selectRows[v].data();
+                        }
+                    }
+                    float* outRow = toCompute.data() + (row - batchStart) * rowLength;
+                    myExpr.evaluateRow(exprRows, outRow, rowLength);
+                    if (nanfix)
+                    {
+                        for (int64_t j = 0; j < rowLength; ++j)
+                        {
+                            if (outRow[j] != outRow[j])
+                            {
+                                outRow[j] = nanfixval;
+                            }
+                        }
+                    }
+                } catch (...) {
+#pragma omp critical(OperationCiftiMathFail)
+                    {
+                        if (!failed)
+                        {
+                            firstError = current_exception();
+                            failed = true;
+                        }
+                    }
                 }
-            }
-            scratchRow[j] = (float)myExpr.evaluate(values);
-            if (nanfix && scratchRow[j] != scratchRow[j])
-            {
-                scratchRow[j] = nanfixval;
-            }
+            }//implicit barrier: the batch is computed, and the previous batch is written
         }
-        myCiftiOut->setRow(scratchRow.data(), *iter);
+    }
+    if (failed)
+    {
+        rethrow_exception(firstError);
     }
 }
@@ -22,14 +22,21 @@
 #include "OperationException.h"
 
 #include "CaretAssert.h"
+#include "CaretOMP.h"
 #include "CaretPointer.h"
 #include "CiftiFile.h"
 
 #include <algorithm>
+#include <exception>
 
 using namespace caret;
 using namespace std;
 
+namespace
+{
+    const int64_t BATCH_BYTES = 1<<24;//16MiB of output rows per read and write
+}
+
 AString OperationCiftiMerge::getCommandSwitch()
 {
     return "-cifti-merge";
@@ -140,7 +147,7 @@ void OperationCiftiMerge::useParameters(OperationParameters* myParams, ProgressO
         default:
             CaretAssert(false);
     }
-    int64_t curCol = 0, scratchRowLength = 0;
+    int64_t curCol = 0;
     for (int i = 0; i < numInputs; ++i)
     {
         const CiftiFile* ciftiIn = myInputs[i]->getCifti(1);
@@ -150,7 +157,6 @@ void OperationCiftiMerge::useParameters(OperationParameters* myParams, ProgressO
         int numColumnOpts = (int)columnOpts.size();
         if (numColumnOpts > 0)
         {
-            scratchRowLength = max(scratchRowLength, thisXML.getDimensionLength(CiftiXML::ALONG_ROW));//if we use the entire row, we don't need a separate scratch row for it
             if (doLoop)
             {
                 for (int j = 0; j < numColumnOpts; ++j)
@@ -256,53 +262,142 @@ void OperationCiftiMerge::useParameters(OperationParameters* myParams, ProgressO
     }
     ciftiOut->setCiftiXML(outXML);
     int64_t numRows = baseColMapping.getLength();
-    vector<float> outRow(numOutColumns), scratchRow(scratchRowLength);
-    for (int64_t row = 0; row < numRows; ++row)
+    vector<int64_t> inputOutStart(numInputs);//where each input's columns start in the output row
+    vector<vector<int64_t> > inputColumns(numInputs);//which input columns to use, in output order, empty means the entire row
+    curCol = 0;
+    for (int i = 0; i < numInputs; ++i)
     {
-        curCol = 0;
-        for (int i = 0; i < numInputs; ++i)
+        const CiftiFile* ciftiIn = myInputs[i]->getCifti(1);
+        const CiftiXML& thisXML = ciftiIn->getCiftiXML();
+        const vector<ParameterComponent*>& columnOpts = *(myInputs[i]->getRepeatableParameterInstances(2));
+        int numColumnOpts = (int)columnOpts.size();
+        inputOutStart[i] = curCol;
+        if (numColumnOpts > 0)
         {
-            const CiftiFile* ciftiIn = myInputs[i]->getCifti(1);
-            vector<int64_t> thisDims = ciftiIn->getDimensions();
-            const CiftiXML& thisXML = ciftiIn->getCiftiXML();
-            const vector<ParameterComponent*>& columnOpts = *(myInputs[i]->getRepeatableParameterInstances(2));
-            int numColumnOpts = (int)columnOpts.size();
-            if (numColumnOpts > 0)
+            for (int j = 0; j < numColumnOpts; ++j)
             {
-                ciftiIn->getRow(scratchRow.data(), row);
-                for (int j = 0; j < numColumnOpts; ++j)
+                int64_t initialColumn = thisXML.getMap(CiftiXML::ALONG_ROW)->getIndexFromNumberOrName(columnOpts[j]->getString(1));//this function has the 1-indexing convention built in
+                OptionalParameter* upToOpt = columnOpts[j]->getOptionalParameter(2);//we already checked that these strings give a valid column
+                if (upToOpt->m_present)
                 {
-                    int64_t initialColumn = thisXML.getMap(CiftiXML::ALONG_ROW)->getIndexFromNumberOrName(columnOpts[j]->getString(1));//this function has the 1-indexing convention built in
-                    OptionalParameter* upToOpt = columnOpts[j]->getOptionalParameter(2);//we already checked that these strings give a valid column
-                    if (upToOpt->m_present)
+                    int finalColumn = thisXML.getMap(CiftiXML::ALONG_ROW)->getIndexFromNumberOrName(upToOpt->getString(1));//ditto
+                    bool reverse = upToOpt->getOptionalParameter(2)->m_present;
+                    if (reverse)
                     {
-                        int finalColumn = thisXML.getMap(CiftiXML::ALONG_ROW)->getIndexFromNumberOrName(upToOpt->getString(1));//ditto
-                        bool reverse = upToOpt->getOptionalParameter(2)->m_present;
-                        if (reverse)
+                        for (int c = finalColumn; c >= initialColumn; --c)
                         {
-                            for (int c = finalColumn; c >= initialColumn; --c)
+                            inputColumns[i].push_back(c);
+                        }
+                    } else {
+                        for (int c = initialColumn; c <= finalColumn; ++c)
+                        {
+                            inputColumns[i].push_back(c);
+                        }
+                    }
+                } else {
+                    inputColumns[i].push_back(initialColumn);
+                }
+            }
+            curCol += (int64_t)inputColumns[i].size();
+        } else {
+            curCol += ciftiIn->getNumberOfColumns();
+        }
+    }
+    CaretAssert(curCol == numOutColumns);
+    //move blocks of rows: each input block is one large read, and the previous output block is written while the next one is read
+    int64_t maxRowLength = numOutColumns;//an input row can be longer than the output row when selecting columns, and each thread holds a block of input rows
+    for (int i = 0; i < numInputs; ++i)
+    {
+        maxRowLength = max(maxRowLength, myInputs[i]->getCifti(1)->getNumberOfColumns());
+    }
+    const int64_t batchRows = max((int64_t)1, min(numRows, BATCH_BYTES / (maxRowLength * (int64_t)sizeof(float))));
+    vector<float> batchBuffers[2];
+    batchBuffers[0].resize(batchRows * numOutColumns);
+    batchBuffers[1].resize(batchRows * numOutColumns);
+    bool failed = false;//only touched inside the critical sections, other threads may be setting it
+    exception_ptr firstError;
+#pragma omp CARET_PAR
+    {
+        vector<float> inputBlock;
+        for (int64_t batchStart = 0; batchStart < numRows + batchRows; batchStart += batchRows)//one extra pass to write the last batch
+        {
+            const int64_t batchIndex = batchStart / batchRows;
+#pragma omp CARET_SINGLE nowait
+            {//write the previous batch, while the other threads start reading this one
+                bool skip = true;
+                if (batchStart > 0)
+                {
+#pragma omp critical(OperationCiftiMergeFail)
+                    skip = failed;
+                }
+                if (!skip)
+                {
+                    const int64_t writeStart = batchStart - batchRows;
+                    try
+                    {
+                        ciftiOut->setRowBlock(batchBuffers[(batchIndex - 1) % 2].data(), writeStart, min(batchRows, numRows - writeStart));
+                    } catch (...) {
+#pragma omp critical(OperationCiftiMergeFail)
+                        {
+                            if (!failed)
                             {
-                                outRow[curCol] = scratchRow[c];
-                                ++curCol;
+                                firstError = current_exception();
+                                failed = true;
+                            }
+                        }
+                    }
+                }
+            }
+            float* toFill = batchBuffers[batchIndex % 2].data();
+            const int64_t thisBatchRows = min(batchRows, numRows - batchStart);//zero or negative on the extra pass
+#pragma omp CARET_FOR schedule(dynamic)
+            for (int i = 0; i < numInputs; ++i)
+            {
+                if (thisBatchRows < 1) continue;
+                bool skip;
+#pragma omp critical(OperationCiftiMergeFail)
+                skip = failed;
+                if (skip) continue;//can't break out of an omp for, so skip the rest quickly
+                try
+                {
+                    const CiftiFile* ciftiIn = myInputs[i]->getCifti(1);
+                    const int64_t inRowLength = ciftiIn->getNumberOfColumns();
+                    inputBlock.resize(thisBatchRows * inRowLength);
+                    ciftiIn->getRowBlock(inputBlock.data(), batchStart, thisBatchRows);//CiftiFile reads are thread-safe, so the inputs can be read at the same time
+                    const vector<int64_t>& thisColumns = inputColumns[i];
+                    const int64_t numThisColumns = (int64_t)thisColumns.size();
+                    for (int64_t row = 0; row < thisBatchRows; ++row)
+                    {
+                        const float* inRow = inputBlock.data() + row * inRowLength;
+                        float* outRow = toFill + row * numOutColumns + inputOutStart[i];
+                        if (numThisColumns == 0)
+                        {
+                            for (int64_t c = 0; c < inRowLength; ++c)
+                            {
+                                outRow[c] = inRow[c];
                             }
                         } else {
-                            for (int c = initialColumn; c <= finalColumn; ++c)
+                            for (int64_t c = 0; c < numThisColumns; ++c)
                             {
-                                outRow[curCol] = scratchRow[c];
-                                ++curCol;
+                                outRow[c] = inRow[thisColumns[c]];
                             }
                         }
-                    } else {
-                        outRow[curCol] = scratchRow[initialColumn];
-                        ++curCol;
+                    }
+                } catch (...) {
+#pragma omp critical(OperationCiftiMergeFail)
+                    {
+                        if (!failed)
+                        {
+                            firstError = current_exception();
+                            failed = true;
+                        }
                     }
                 }
-            } else {
-                ciftiIn->getRow(outRow.data() + curCol, row);
-                curCol += thisDims[0];
-            }
+            }//implicit barrier: the batch is read, and the previous batch is written
         }
-        CaretAssert(curCol == numOutColumns);
-        ciftiOut->setRow(outRow.data(), row);
+    }
+    if (failed)
+    {
+        rethrow_exception(firstError);
     }
 }
@@ -19,8 +19,11 @@
  */
 /*LICENSE_END*/
 
+#include <algorithm>
 #include <cstdio>
 #include <fstream>
+#include <map>
+#include <memory>
 
 #ifdef HAVE_GLEW
 #include <GL/glew.h>
@@ -32,6 +35,11 @@
 
 #include <QImage>
 #include <QColor>
+#include <QDir>
+#include <QFuture>
+#include <QThreadPool>
+
+#include <QtConcurrent/QtConcurrent>
 
 
 #include "Brain.h"
@@ -61,6 +69,7 @@
 #include "SceneFile.h"
 #include "ScenePrimitiveArray.h"
 #include "SessionManager.h"
+#include "TextFile.h"
 #include "TileTabsConfiguration.h"
 #include "VolumeFile.h"
 
@@ -124,6 +133,10 @@ OperationShowScene::getParameters()
     connDbOpt->addStringParameter(1, "Username", "Connectome DB Username");
     connDbOpt->addStringParameter(2, "Password", "Connectome DB Password");
     
+    const QString batchSwitch("-batch");
+    OptionalParameter* batchOpt = ret->createOptionalParameter(10, batchSwitch, "After the scene on the command line, render the scenes listed in a job file");
+    batchOpt->addStringParameter(1, "job-file", "text file listing the scenes to render, one per line");
+    
     AString helpText("Render content of browser windows displayed in a scene "
                      "into image file(s).  The image file name should be "
                      "similar to \"capture.png\".  If there is only one image "
@@ -168,6 +181,24 @@ OperationShowScene::getParameters()
                  "      of the graphics region, the width and height specified\n"
                  "      on the command line is used for the size of the \n"
                  "      output image.\n"
+                 "\n"
+                 "The \"" + batchSwitch + "\" option renders many scenes with one\n"
+                 "command.  Each line of the job file contains fields\n"
+                 "separated by tabs:\n"
+                 "    scene-file  scene-name-or-number  image-file-name\n"
+                 "optionally followed by pairs of fields that override the\n"
+                 "selected map of a map yoking group, the same as the\n"
+                 "\"-set-map-yoke\" option:\n"
+                 "    Map-Yoking-Roman-Numeral  Map-Index\n"
+                 "Empty lines and lines starting with \"#\" are ignored.\n"
+                 "Relative file names are relative to the directory\n"
+                 "containing the job file.  The scene on the command line is\n"
+                 "rendered first, followed by the jobs in the order listed.\n"
+                 "Data files that are not changed by a scene remain loaded\n"
+                 "for the following scenes that use them, the offscreen\n"
+                 "graphics context is reused, and images are written in\n"
+                 "background threads.  A job that fails does not stop the\n"
+                 "remaining jobs and all failures are reported at the end.\n"
                  );
     
     
@@ -176,6 +207,131 @@ OperationShowScene::getParameters()
     return ret;
 }
 
+/**
+ * A scene to render and the name of its image file.
+ */
+struct OperationShowScene::SceneJob {
+    /** Absolute path of scene file */
+    AString m_sceneFileName;
+
+    /** Name or number (starting at one) of the scene */
+    AString m_sceneNameOrNumber;
+
+    /** Absolute path of the image file */
+    AString m_imageFileName;
+
+    /** Map yoking groups and their selected map index (starting at zero) */
+    std::vector<std::pair<MapYokingGroupEnum::Enum, int32_t>> m_mapYokings;
+};
+
+/**
+ * Add an override of the selected map for a map yoking group to a job.
+ *
+ * @param romanNumeral
+ *     Roman numeral identifying the map yoking group.
+ * @param mapIndex
+ *     Map index starting at one.
+ * @param job
+ *     Job that receives the override.
+ */
+void
+OperationShowScene::addMapYokingToJob(const AString& romanNumeral,
+                                      const int32_t mapIndex,
+                                      SceneJob& job)
+{
+    bool validFlag = false;
+    const MapYokingGroupEnum::Enum mapYokingGroup = MapYokingGroupEnum::fromGuiName(romanNumeral, &validFlag);
+    if ( ! validFlag) {
+        throw OperationException(romanNumeral
+                                 + " does not identify a valid Map Yoking Group.  ");
+    }
+    if (mapIndex < 1) {
+        throw OperationException("Map yoking map index must be one or greater.");
+    }
+
+    /*
+     * Map indice in code start at zero
+     */
+    job.m_mapYokings.push_back(std::make_pair(mapYokingGroup,
+                                              mapIndex - 1));
+}
+
+/**
+ * Read the jobs from a job file.
+ *
+ * @param jobFileName
+ *     Name of the job file.
+ * @param jobsInOut
+ *     Jobs from the file are added to these jobs.
+ */
+void
+OperationShowScene::readJobFile(const AString& jobFileName,
+                                std::vector<SceneJob>& jobsInOut)
+{
+    TextFile textFile;
+    try {
+        textFile.readFile(jobFileName);
+    }
+    catch (const DataFileException& dfe) {
+        throw OperationException(dfe);
+    }
+
+    /*
+     * Files are found before any scene is loaded since
+     * loading a scene may change the current directory
+     */
+    const QDir jobFileDirectory(FileInformation(FileInformation(jobFileName).getAbsoluteFilePath()).getPathName());
+    auto getAbsoluteFileName = [&](const QString& name) {
+        return AString(jobFileDirectory.absoluteFilePath(name.trimmed()));
+    };
+
+    const QStringList lines = textFile.getText().split('\n');
+    for (int32_t iLine = 0; iLine < lines.size(); iLine++) {
+        const QString line = lines[iLine].trimmed();
+        if (line.isEmpty()
+            || line.startsWith('#')) {
+            continue;
+        }
+
+        const AString lineMessage(" on line "
+                                  + AString::number(iLine + 1)
+                                  + " of job file "
+                                  + jobFileName);
+        const QStringList fields = line.split('\t');
+        if ((fields.size() < 3)
+            || (((fields.size() - 3) % 2) != 0)) {
+            throw OperationException("Job must contain scene file, scene, image file, "
+                                     "and pairs of map yoking group and map index separated by tabs"
+                                     + lineMessage);
+        }
+
+        SceneJob job;
+        job.m_sceneFileName     = getAbsoluteFileName(fields[0]);
+        job.m_sceneNameOrNumber = fields[1].trimmed();
+        job.m_imageFileName     = getAbsoluteFileName(fields[2]);
+        for (int32_t i = 3; i < fields.size(); i += 2) {
+            bool validFlag = false;
+            const int32_t mapIndex = fields[i + 1].trimmed().toInt(&validFlag);
+            if ( ! validFlag) {
+                throw OperationException("Map index \""
+                                         + fields[i + 1]
+                                         + "\" is not an integer"
+                                         + lineMessage);
+            }
+            try {
+                addMapYokingToJob(fields[i].trimmed(),
+                                  mapIndex,
+                                  job);
+            }
+            catch (const OperationException& oe) {
+                throw OperationException(oe.whatString()
+                                         + lineMessage);
+            }
+        }
+        jobsInOut.push_back(job);
+    }
+}
+
 /**
  * Use Parameters and perform operation
  */
@@ -188,86 +344,193 @@ OperationShowScene::useParameters(OperationParameters* /*myParams*/,
                              "not being built with the Mesa OffScreen Library");
 }
 #else // HAVE_OSMESA
-void
-OperationShowScene::useParameters(OperationParameters* myParams,
-                                  ProgressObject* myProgObj)
+
+/**
+ * \class caret::OperationShowScene::SceneRenderer
+ * \brief Renders scenes into image files
+ *
+ * One offscreen Mesa context and one OpenGL rendering are used for
+ * all scenes.  Scenes are restored into the same session so that
+ * files that are not modified by a scene remain loaded for following
+ * scenes that use them (see Brain::resetBrainKeepSceneFiles()).
+ * Images are encoded and written in separate threads.
+ */
+class OperationShowScene::SceneRenderer {
+public:
+    SceneRenderer(const int32_t userImageWidth,
+                  const int32_t userImageHeight,
+                  const bool useWindowSizeForImageSizeFlag,
+                  const AString& useWindowSizeSwitch,
+                  const bool doNotUseSceneColorsFlag);
+
+    ~SceneRenderer();
+
+    SceneRenderer(const SceneRenderer&) = delete;
+
+    SceneRenderer& operator=(const SceneRenderer&) = delete;
+
+    void renderJob(const SceneJob& job);
+
+    bool waitForImagesToFinishWriting(AString& errorMessageInOut);
+
+private:
+    /**
+     * Used to write images in separate thread
+     */
+    class ImageWriter {
+    public:
+        ImageWriter(const AString& imageFileName,
+                    const int32_t imageIndex,
+                    const std::vector<unsigned char>& imageContent,
+                    const int32_t imageWidth,
+                    const int32_t imageHeight);
+
+        bool writeImage();
+
+        const AString m_imageFileName;
+
+        const int32_t m_imageIndex;
+
+        const std::vector<unsigned char> m_imageContent;
+
+        const int32_t m_imageWidth;
+
+        const int32_t m_imageHeight;
+
+        AString m_errorMessage;
+    };
+
+    Scene* getScene(const SceneJob& job);
+
+    void makeCurrent(const int32_t imageWidth,
+                     const int32_t imageHeight);
+
+    void addImageToWrite(const AString& imageFileName,
+                         const int32_t imageIndex,
+                         const int32_t imageWidth,
+                         const int32_t imageHeight);
+
+    void waitForImageToFinishWriting(const int32_t writerIndex);
+
+    const int32_t m_userImageWidth;
+
+    const int32_t m_userImageHeight;
+
+    const bool m_useWindowSizeForImageSizeFlag;
+
+    const AString m_useWindowSizeSwitch;
+
+    const bool m_doNotUseSceneColorsFlag;
+
+    bool m_missingWindowMessageHasBeenDisplayed = false;
+
+    OSMesaContext m_mesaContext = 0;
+
+    /** Must be destroyed before the Mesa context */
+    CaretPointer<BrainOpenGL> m_brainOpenGL;
+
+    std::vector<unsigned char> m_imageBuffer;
+
+    /** Scene files are read once and kept for following jobs */
+    std::map<AString, std::unique_ptr<SceneFile>> m_sceneFiles;
+
+    std::vector<std::unique_ptr<ImageWriter>> m_imageWriters;
+
+    std::vector<QFuture<bool>> m_imageWriteResultFutures;
+
+    /** Errors from images that have finished writing */
+    AString m_imageWriteErrorMessage;
+
+    /** Limits memory used by images waiting to be written */
+    const int32_t m_maximumImagesWaitingToWrite;
+};
+
+/**
+ * Constructor.
+ *
+ * @param userImageWidth
+ *     Image width from the command line.
+ * @param userImageHeight
+ *     Image height from the command line.
+ * @param useWindowSizeForImageSizeFlag
+ *     Use the window size from the scene for the image size.
+ * @param useWindowSizeSwitch
+ *     Switch for window size option, used in messages.
+ * @param doNotUseSceneColorsFlag
+ *     Do not use background and foreground colors in scene.
+ */
+OperationShowScene::SceneRenderer::SceneRenderer(const int32_t userImageWidth,
+                                                 const int32_t userImageHeight,
+                                                 const bool useWindowSizeForImageSizeFlag,
+                                                 const AString& useWindowSizeSwitch,
+                                                 const bool doNotUseSceneColorsFlag)
+: m_userImageWidth(userImageWidth),
+m_userImageHeight(userImageHeight),
+m_useWindowSizeForImageSizeFlag(useWindowSizeForImageSizeFlag),
+m_useWindowSizeSwitch(useWindowSizeSwitch),
+m_doNotUseSceneColorsFlag(doNotUseSceneColorsFlag),
+m_maximumImagesWaitingToWrite(std::max(2, QThreadPool::globalInstance()->maxThreadCount() * 2))
 {
-    LevelProgress myProgress(myProgObj);
-    AString sceneFileName = FileInformation(myParams->getString(1)).getAbsoluteFilePath();
-    AString sceneNameOrNumber = myParams->getString(2);
-    AString imageFileName = FileInformation(myParams->getString(3)).getAbsoluteFilePath();
-    const int32_t userImageWidth  = myParams->getInteger(4);
-    const int32_t userImageHeight = myParams->getInteger(5);
-    
-    OptionalParameter* useWindowSizeParam = myParams->getOptionalParameter(6);
-    const bool useWindowSizeForImageSizeFlag = useWindowSizeParam->m_present;
-    
-    const bool doNotUseSceneColorsFlag = myParams->getOptionalParameter(7)->m_present;
-    
-    MapYokingGroupEnum::Enum mapYokingGroup = MapYokingGroupEnum::MAP_YOKING_GROUP_OFF;
-    int32_t mapYokingMapIndex = -1;
-    OptionalParameter* mapYokeOpt = myParams->getOptionalParameter(8);
-    if (mapYokeOpt->m_present) {
-        const AString romanNumeral = mapYokeOpt->getString(1);
-        bool validFlag = false;
-        mapYokingGroup = MapYokingGroupEnum::fromGuiName(romanNumeral, &validFlag);
-        if ( ! validFlag) {
-            throw OperationException(romanNumeral
-                                     + " does not identify a valid Map Yoking Group.  ");
-        }
-        mapYokingMapIndex = mapYokeOpt->getInteger(2);
-        if (mapYokingMapIndex < 1) {
-            throw OperationException("Map yoking map index must be one or greater.");
-        }
-        
-        /*
-         * Map indice in code start at zero
-         */
-        mapYokingMapIndex--;
-    }
-    
-    if ( ! useWindowSizeForImageSizeFlag) {
-        if ((userImageWidth <= 0)
-            || (userImageHeight <= 0)) {
-            throw OperationException("Invalid image size width="
-                                     + QString::number(userImageWidth)
-                                     + " height="
-                                     + QString::number(userImageHeight));
-        }
+    //
+    // Create the Mesa Context
+    //
+    const int depthBits = 16;
+    const int stencilBits = 0;
+    const int accumBits = 0;
+    m_mesaContext = OSMesaCreateContextExt(OSMESA_RGBA,
+                                           depthBits,
+                                           stencilBits,
+                                           accumBits,
+                                           NULL);
+    if (m_mesaContext == 0) {
+        throw OperationException("Creating Mesa Context failed.");
     }
+}
+
+/**
+ * Destructor.
+ */
+OperationShowScene::SceneRenderer::~SceneRenderer()
+{
+    AString errorMessage;
+    waitForImagesToFinishWriting(errorMessage);
 
     /*
-     * Need to set username/password for files in ConnectomeDB
+     * OpenGL must be destroyed while its context is valid
      */
-    AString username;
-    AString password;
-    OptionalParameter* connDbOpt = myParams->getOptionalParameter(9);
-    if (connDbOpt->m_present) {
-        username = connDbOpt->getString(1);
-        password = connDbOpt->getString(2);
-    }
-    else {
-        CaretPreferences* prefs = SessionManager::get()->getCaretPreferences();
-        prefs->getRemoteFileUserNameAndPassword(username,
-                                                password);
+    m_brainOpenGL.grabNew(NULL);
+    OSMesaDestroyContext(m_mesaContext);
+}
+
+/**
+ * Get the scene for a job, reading the scene file if it
+ * has not been read by a previous job.
+ *
+ * @param job
+ *     The job.
+ * @return
+ *     The scene.
+ */
+Scene*
+OperationShowScene::SceneRenderer::getScene(const SceneJob& job)
+{
+    std::unique_ptr<SceneFile>& sceneFile = m_sceneFiles[job.m_sceneFileName];
+    if (sceneFile == NULL) {
+        std::unique_ptr<SceneFile> newSceneFile(new SceneFile());
+        newSceneFile->readFile(job.m_sceneFileName);
+        sceneFile = std::move(newSceneFile);
     }
-    CaretDataFile::setFileReadingUsernameAndPassword(username,
-                                                     password);
 
-    /*
-     * Read the scene file and load the scene
-     */
-    SceneFile sceneFile;
-    sceneFile.readFile(sceneFileName);
-    Scene* scene = sceneFile.getSceneWithName(sceneNameOrNumber);
+    const AString& sceneNameOrNumber = job.m_sceneNameOrNumber;
+    Scene* scene = sceneFile->getSceneWithName(sceneNameOrNumber);
     if (scene == NULL) {
         bool valid = false;
         const int32_t sceneIndexStartAtOne = sceneNameOrNumber.toInt(&valid);
         if (valid) {
             const int32_t sceneIndex = sceneIndexStartAtOne - 1;
             if ((sceneIndex >= 0)
-                && (sceneIndex < sceneFile.getNumberOfScenes())) {
-                scene = sceneFile.getSceneAtIndex(sceneIndex);
+                && (sceneIndex < sceneFile->getNumberOfScenes())) {
+                scene = sceneFile->getSceneAtIndex(sceneIndex);
             }
             else {
                 throw OperationException("Scene index is invalid");
@@ -277,19 +540,169 @@ OperationShowScene::useParameters(OperationParameters* myParams,
             throw OperationException("Scene name is invalid");
         }
     }
-    
+
+    return scene;
+}
+
+/**
+ * Size the image buffer, assign it to the Mesa Context, and make
+ * the context current.
+ *
+ * @param imageWidth
+ *     Width of image.
+ * @param imageHeight
+ *     Height of image.
+ */
+void
+OperationShowScene::SceneRenderer::makeCurrent(const int32_t imageWidth,
+                                               const int32_t imageHeight)
+{
+    //
+    // Allocate image buffer
+    //
+    const int64_t imageBufferSize = static_cast<int64_t>(imageWidth) * imageHeight * 4 * sizeof(unsigned char);
+    try {
+        m_imageBuffer.resize(imageBufferSize);
+    }
+    catch (const std::bad_alloc&) {
+        throw OperationException("Allocating image buffer size="
+                                 + QString::number(imageBufferSize)
+                                 + " failed.");
+    }
+
+    //
+    // Assign buffer to Mesa Context and make current
+    //
+    if (OSMesaMakeCurrent(m_mesaContext,
+                          m_imageBuffer.data(),
+                          GL_UNSIGNED_BYTE,
+                          imageWidth,
+                          imageHeight) == 0) {
+        throw OperationException("Assigning buffer to context and make current failed.");
+    }
+
     /*
-     * Enable voxel coloring since it is defaulted off for commands
+     * OpenGL is initialized after the context is current
      */
-    VolumeFile::setVoxelColoringEnabled(true);
-    
+    if (m_brainOpenGL == NULL) {
+        m_brainOpenGL.grabNew(createBrainOpenGL());
+    }
+}
+
+/**
+ * Copy the image buffer and write it to an image file in a separate thread.
+ *
+ * @param imageFileName
+ *     Name of image file.
+ * @param imageIndex
+ *     Index of image.
+ * @param imageWidth
+ *     width of image.
+ * @param imageHeight
+ *     height of image.
+ */
+void
+OperationShowScene::SceneRenderer::addImageToWrite(const AString& imageFileName,
+                                                   const int32_t imageIndex,
+                                                   const int32_t imageWidth,
+                                                   const int32_t imageHeight)
+{
+    /*
+     * Wait for any earlier image with the same name so that the
+     * last image rendered is the image in the file
+     */
+    for (int32_t i = static_cast<int32_t>(m_imageWriters.size()) - 1; i >= 0; i--) {
+        if ((m_imageWriters[i]->m_imageFileName == imageFileName)
+            && (m_imageWriters[i]->m_imageIndex == imageIndex)) {
+            waitForImageToFinishWriting(i);
+        }
+    }
+
+    ImageWriter* iw = new ImageWriter(imageFileName,
+                                      imageIndex,
+                                      m_imageBuffer,
+                                      imageWidth,
+                                      imageHeight);
+    m_imageWriters.push_back(std::unique_ptr<ImageWriter>(iw));
+    QFuture<bool> f = QtConcurrent::run(iw, &ImageWriter::writeImage);
+    m_imageWriteResultFutures.push_back(f);
+
+    /*
+     * Limit the number of image copies waiting to be written
+     */
+    if (static_cast<int32_t>(m_imageWriters.size()) > m_maximumImagesWaitingToWrite) {
+        waitForImageToFinishWriting(0);
+    }
+}
+
+/**
+ * Wait for an image to finish writing and remove its writer.
+ *
+ * @param writerIndex
+ *     Index of the image writer.
+ */
+void
+OperationShowScene::SceneRenderer::waitForImageToFinishWriting(const int32_t writerIndex)
+{
+    CaretAssertVectorIndex(m_imageWriters, writerIndex);
+    CaretAssertVectorIndex(m_imageWriteResultFutures, writerIndex);
+
+    if ( ! m_imageWriteResultFutures[writerIndex].result()) {
+        if ( ! m_imageWriteErrorMessage.isEmpty()) {
+            m_imageWriteErrorMessage += "\n";
+        }
+        m_imageWriteErrorMessage += m_imageWriters[writerIndex]->m_errorMessage;
+    }
+
+    m_imageWriters.erase(m_imageWriters.begin() + writerIndex);
+    m_imageWriteResultFutures.erase(m_imageWriteResultFutures.begin() + writerIndex);
+}
+
+/**
+ * Wait for all images to finish writing.
+ *
+ * @param errorMessageInOut
+ *     Error messages from writing images are appended to this.
+ * @return
+ *     True if all images were written successfully.
+ */
+bool
+OperationShowScene::SceneRenderer::waitForImagesToFinishWriting(AString& errorMessageInOut)
+{
+    while ( ! m_imageWriters.empty()) {
+        waitForImageToFinishWriting(0);
+    }
+
+    const bool allValid = m_imageWriteErrorMessage.isEmpty();
+    if ( ! allValid) {
+        if ( ! errorMessageInOut.isEmpty()) {
+            errorMessageInOut += "\n";
+        }
+        errorMessageInOut += m_imageWriteErrorMessage;
+        m_imageWriteErrorMessage.clear();
+    }
+
+    return allValid;
+}
+
+/**
+ * Restore a scene and render each of its windows into an image.
+ *
+ * @param job
+ *     The job containing the scene.
+ */
+void
+OperationShowScene::SceneRenderer::renderJob(const SceneJob& job)
+{
+    Scene* scene = getScene(job);
+
     SceneAttributes sceneAttributes(SceneTypeEnum::SCENE_TYPE_FULL,
                                     scene);
-    
-    if (doNotUseSceneColorsFlag) {
+
+    if (m_doNotUseSceneColorsFlag) {
         sceneAttributes.setUseSceneForegroundAndBackgroundColors(false);
     }
-    
+
     /*
      * Restore the scene
      */
@@ -298,32 +711,48 @@ OperationShowScene::useParameters(OperationParameters* myParams,
         throw OperationException("Top level scene class should be guiManager but it is: "
                                  + guiManagerClass->getName());
     }
-    
+
+    /*
+     * Windows from a previous scene must not be rendered
+     * if they are not in this scene
+     */
+    for (int32_t i = 0; i < BrainConstants::MAXIMUM_NUMBER_OF_BROWSER_WINDOWS; i++) {
+        std::unique_ptr<EventBrowserWindowContent> browserContentEvent = EventBrowserWindowContent::getWindowContent(i);
+        EventManager::get()->sendEvent(browserContentEvent->getPointer());
+        BrowserWindowContent* bwc = browserContentEvent->getBrowserWindowContent();
+        CaretAssert(bwc);
+        bwc->reset();
+        bwc->setValid(false);
+    }
+
     SessionManager* sessionManager = SessionManager::get();
     sessionManager->restoreFromScene(&sceneAttributes,
                                      guiManagerClass->getClass("m_sessionManager"));
-    
+
     /*
      * Get the error message but continue processing since the error
      * may not affect the scene.  Print error message later.
      */
     const AString sceneErrorMessage = sceneAttributes.getErrorMessage();
-    
+
     if (sessionManager->getNumberOfBrains() <= 0) {
         throw OperationException("Scene loading failure, SessionManager contains no Brains");
     }
     Brain* brain = SessionManager::get()->getBrain(0);
-    
+
     const GapsAndMargins* gapsAndMargins = brain->getGapsAndMargins();
-    
-    bool missingWindowMessageHasBeenDisplayed = false;
-    
+
     /*
      * Apply map yoking
      */
-    if (mapYokingGroup != MapYokingGroupEnum::MAP_YOKING_GROUP_OFF) {
+    for (const auto& mapYoking : job.m_mapYokings) {
+        const MapYokingGroupEnum::Enum mapYokingGroup = mapYoking.first;
+        const int32_t mapYokingMapIndex = mapYoking.second;
+        if (mapYokingGroup == MapYokingGroupEnum::MAP_YOKING_GROUP_OFF) {
+            continue;
+        }
         MapYokingGroupEnum::setSelectedMapIndex(mapYokingGroup, mapYokingMapIndex);
-        
+
         EventMapYokingSelectMap yokeEvent(mapYokingGroup,
                                           NULL,
                                           NULL,
@@ -331,7 +760,7 @@ OperationShowScene::useParameters(OperationParameters* myParams,
                                           true);
         EventManager::get()->sendEvent(yokeEvent.getPointer());
     }
-    
+
     std::vector<BrowserWindowContent*> allBrowserWindowContent;
     for (int32_t i = 0; i < BrainConstants::MAXIMUM_NUMBER_OF_BROWSER_WINDOWS; i++) {
         std::unique_ptr<EventBrowserWindowContent> browserContentEvent = EventBrowserWindowContent::getWindowContent(i);
@@ -346,21 +775,21 @@ OperationShowScene::useParameters(OperationParameters* myParams,
     if (numberOfWindows <= 0) {
         throw OperationException("No BrowserWindowContent was found for showing as scene");
     }
-    
+
     /*
      * Restore windows
      */
     for (int32_t iWindow = 0; iWindow < numberOfWindows; iWindow++) {
         CaretAssertVectorIndex(allBrowserWindowContent, iWindow);
         auto bwc = allBrowserWindowContent[iWindow];
-        
+
         const bool restoreToTabTiles = bwc->isTileTabsEnabled();
         const int32_t windowIndex = bwc->getWindowIndex();
-        
-        int32_t imageWidth  = userImageWidth;
-        int32_t imageHeight = userImageHeight;
-        
-        if (useWindowSizeForImageSizeFlag) {
+
+        int32_t imageWidth  = m_userImageWidth;
+        int32_t imageHeight = m_userImageHeight;
+
+        if (m_useWindowSizeForImageSizeFlag) {
             /*
              * Requires version AFTER 1.2.0-pre1
              */
@@ -375,19 +804,19 @@ OperationShowScene::useParameters(OperationParameters* myParams,
                 if ((imageWidth <= 0)
                     || (imageHeight <= 0)) {
                     const QString msg("Option "
-                                      + useWindowSizeParam->m_optionSwitch
+                                      + m_useWindowSizeSwitch
                                       + " is used but window size not found in scene and width="
                                       + QString::number(imageWidth)
                                       + " height="
                                       + QString::number(imageWidth)
                                       + " on command line is invalid.");
-                    
+
                     throw OperationException(msg);
                 }
-                
-                if ( ! missingWindowMessageHasBeenDisplayed) {
+
+                if ( ! m_missingWindowMessageHasBeenDisplayed) {
                     const QString msg("Option \""
-                                      + useWindowSizeParam->m_optionSwitch
+                                      + m_useWindowSizeSwitch
                                       + "\" is used but window size not found in scene.\n"
                                       "   Scene was created prior to implementation of this option.\n"
                                       "   Image size will be width="
@@ -397,16 +826,16 @@ OperationShowScene::useParameters(OperationParameters* myParams,
                                       + " as specified on command line.\n"
                                       "   Recreating the scene will allow use of the option.\n");
                     CaretLogWarning(msg);
-                    
+
                     /*
                      * Avoid message being displayed more than once when
                      * there are more than one windows.
                      */
-                    missingWindowMessageHasBeenDisplayed = true;
+                    m_missingWindowMessageHasBeenDisplayed = true;
                 }
             }
         }
-        
+
         if ((imageWidth <= 0)
             || (imageHeight <= 0)) {
             throw OperationException("Invalid image size width="
@@ -414,132 +843,93 @@ OperationShowScene::useParameters(OperationParameters* myParams,
                                      + " height="
                                      + QString::number(imageHeight));
         }
-        
+
         int windowViewport[4] = { 0, 0, imageWidth, imageHeight };
-        
+
         const int windowWidth  = windowViewport[2];
         const int windowHeight = windowViewport[3];
-        
-        //
-        // Create the Mesa Context
-        //
-        const int depthBits = 16;
-        const int stencilBits = 0;
-        const int accumBits = 0;
-        OSMesaContext mesaContext = OSMesaCreateContextExt(OSMESA_RGBA,
-                                                           depthBits,
-                                                           stencilBits,
-                                                           accumBits,
-                                                           NULL);
-        if (mesaContext == 0) {
-            throw ("Creating Mesa Context failed.");
-        }
-        
-        //
-        // Allocate image buffer
-        //
-        const int32_t imageBufferSize =imageWidth * imageHeight * 4 * sizeof(unsigned char);
-        unsigned char* imageBuffer = new unsigned char[imageBufferSize];
-        if (imageBuffer == 0) {
-            throw OperationException("Allocating image buffer size="
-                                     + QString::number(imageBufferSize)
-                                     + " failed.");
-        }
-        
-        //
-        // Assign buffer to Mesa Context and make current
-        //
-        if (OSMesaMakeCurrent(mesaContext,
-                              imageBuffer,
-                              GL_UNSIGNED_BYTE,
-                              imageWidth,
-                              imageHeight) == 0) {
-            throw OperationException("Assigning buffer to context and make current failed.");
-        }
-        
+
+        makeCurrent(imageWidth,
+                    imageHeight);
+
+        const int32_t outputImageIndex = ((numberOfWindows > 1)
+                                          ? iWindow
+                                          : -1);
+
         /*
          * If tile tabs was saved to the scene, restore it as the scenes tile tabs configuration
          */
         if (restoreToTabTiles) {
-            CaretPointer<BrainOpenGL> brainOpenGL(createBrainOpenGL());
-            
             TileTabsConfiguration* tileTabsConfiguration = bwc->getSelectedTileTabsConfiguration();
             CaretAssert(tileTabsConfiguration);
-            
-                const std::vector<int32_t> tabIndices = bwc->getSceneTabIndices();
-                if ( ! tabIndices.empty()) {
-                    std::vector<BrowserTabContent*> allTabContent;
-                    const int32_t numTabs = static_cast<int32_t>(tabIndices.size());
-                    for (int32_t iTab = 0; iTab < numTabs; iTab++) {
-                        CaretAssertVectorIndex(tabIndices, iTab);
-                        const int32_t tabIndex = tabIndices[iTab];
-                        EventBrowserTabGet getTabContent(tabIndex);
-                        EventManager::get()->sendEvent(getTabContent.getPointer());
-                        BrowserTabContent* tabContent = getTabContent.getBrowserTab();
-                        if (tabContent == NULL) {
-                            throw OperationException("Failed to obtain tab number "
-                                                     + AString::number(tabIndex + 1)
-                                                     + " for window "
-                                                     + AString::number(windowIndex + 1));
-                        }
-                        allTabContent.push_back(tabContent);
-                    }
-                    
-                    const int32_t numTabContent = static_cast<int32_t>(allTabContent.size());
-                    if (numTabContent <= 0) {
-                        throw OperationException("Failed to find any tab content");
-                    }
-                    std::vector<int32_t> rowHeights;
-                    std::vector<int32_t> columnWidths;
-                    if ( ! tileTabsConfiguration->getRowHeightsAndColumnWidthsForWindowSize(windowWidth,
-                                                                                            windowHeight,
-                                                                                            numTabContent,
-                                                                                            bwc->getTileTabsConfigurationMode(),
-                                                                                            rowHeights,
-                                                                                            columnWidths)) {
-                        throw OperationException("Tile Tabs Row/Column sizing failed !!!");
-                    }
-                    
-                    const int32_t tabIndexToHighlight = -1;
-                    std::vector<BrainOpenGLViewportContent*> viewports =
-                    BrainOpenGLViewportContent::createViewportContentForTileTabs(allTabContent,
-                                                                                 bwc,
-                                                                                 gapsAndMargins,
-                                                                                 windowViewport,
-                                                                                 windowIndex,
-                                                                                 tabIndexToHighlight);
-                    
-                    std::vector<const BrainOpenGLViewportContent*> constViewports(viewports.begin(),
-                                                                                  viewports.end());
-                    brainOpenGL->drawModels(windowIndex,
-                                            UserInputModeEnum::VIEW,
-                                            brain,
-                                            mesaContext,
-                                            constViewports);
-                    
-                    const int32_t outputImageIndex = ((numberOfWindows > 1)
-                                                      ? iWindow
-                                                      : -1);
-                    
-                    writeImage(imageFileName,
-                               outputImageIndex,
-                               imageBuffer,
-                               imageWidth,
-                               imageHeight);
-                    
-                    for (std::vector<BrainOpenGLViewportContent*>::iterator vpIter = viewports.begin();
-                         vpIter != viewports.end();
-                         vpIter++) {
-                        delete *vpIter;
+
+            const std::vector<int32_t> tabIndices = bwc->getSceneTabIndices();
+            if ( ! tabIndices.empty()) {
+                std::vector<BrowserTabContent*> allTabContent;
+                const int32_t numTabs = static_cast<int32_t>(tabIndices.size());
+                for (int32_t iTab = 0; iTab < numTabs; iTab++) {
+                    CaretAssertVectorIndex(tabIndices, iTab);
+                    const int32_t tabIndex = tabIndices[iTab];
+                    EventBrowserTabGet getTabContent(tabIndex);
+                    EventManager::get()->sendEvent(getTabContent.getPointer());
+                    BrowserTabContent* tabContent = getTabContent.getBrowserTab();
+                    if (tabContent == NULL) {
+                        throw OperationException("Failed to obtain tab number "
+                                                 + AString::number(tabIndex + 1)
+                                                 + " for window "
+                                                 + AString::number(windowIndex + 1));
                     }
-                    viewports.clear();
+                    allTabContent.push_back(tabContent);
                 }
+
+                const int32_t numTabContent = static_cast<int32_t>(allTabContent.size());
+                if (numTabContent <= 0) {
+                    throw OperationException("Failed to find any tab content");
+                }
+                std::vector<int32_t> rowHeights;
+                std::vector<int32_t> columnWidths;
+                if ( ! tileTabsConfiguration->getRowHeightsAndColumnWidthsForWindowSize(windowWidth,
+                                                                                        windowHeight,
+                                                                                        numTabContent,
+                                                                                        bwc->getTileTabsConfigurationMode(),
+                                                                                        rowHeights,
+                                                                                        columnWidths)) {
+                    throw OperationException("Tile Tabs Row/Column sizing failed !!!");
+                }
+
+                const int32_t tabIndexToHighlight = -1;
+                std::vector<BrainOpenGLViewportContent*> viewports =
+                BrainOpenGLViewportContent::createViewportContentForTileTabs(allTabContent,
+                                                                             bwc,
+                                                                             gapsAndMargins,
+                                                                             windowViewport,
+                                                                             windowIndex,
+                                                                             tabIndexToHighlight);
+
+                std::vector<const BrainOpenGLViewportContent*> constViewports(viewports.begin(),
+                                                                              viewports.end());
+                m_brainOpenGL->drawModels(windowIndex,
+                                          UserInputModeEnum::VIEW,
+                                          brain,
+                                          m_mesaContext,
+                                          constViewports);
+
+                for (std::vector<BrainOpenGLViewportContent*>::iterator vpIter = viewports.begin();
+                     vpIter != viewports.end();
+                     vpIter++) {
+                    delete *vpIter;
+                }
+                viewports.clear();
+
+                addImageToWrite(job.m_imageFileName,
+                                outputImageIndex,
+                                imageWidth,
+                                imageHeight);
+            }
         }
         else {
-            CaretPointer<BrainOpenGL> brainOpenGL(createBrainOpenGL());
-            
             const int32_t selectedTabIndex = bwc->getSceneSelectedTabIndex();
-            
+
             EventBrowserTabGet getTabContent(selectedTabIndex);
             EventManager::get()->sendEvent(getTabContent.getPointer());
             BrowserTabContent* tabContent = getTabContent.getBrowserTab();
@@ -549,7 +939,7 @@ OperationShowScene::useParameters(OperationParameters* myParams,
                                          + " for window "
                                          + AString::number(iWindow + 1));
             }
-            
+
             CaretPointer<BrainOpenGLViewportContent> content(NULL);
             std::vector<BrowserTabContent*> allTabs;
             allTabs.push_back(tabContent);
@@ -560,31 +950,20 @@ OperationShowScene::useParameters(OperationParameters* myParams,
                                                                                    windowViewport));
             std::vector<const BrainOpenGLViewportContent*> viewportContents;
             viewportContents.push_back(content);
-            
-            brainOpenGL->drawModels(windowIndex,
-                                    UserInputModeEnum::VIEW,
-                                    brain,
-                                    mesaContext,
-                                    viewportContents);
-            
-            const int32_t outputImageIndex = ((numberOfWindows > 1)
-                                              ? iWindow
-                                              : -1);
-            
-            writeImage(imageFileName,
-                       outputImageIndex,
-                       imageBuffer,
-                       imageWidth,
-                       imageHeight);
+
+            m_brainOpenGL->drawModels(windowIndex,
+                                      UserInputModeEnum::VIEW,
+                                      brain,
+                                      m_mesaContext,
+                                      viewportContents);
+
+            addImageToWrite(job.m_imageFileName,
+                            outputImageIndex,
+                            imageWidth,
+                            imageHeight);
         }
-        
-        /*
-         * Free image memory and Mesa context
-         */
-        delete[] imageBuffer;
-        OSMesaDestroyContext(mesaContext);
     }
-    
+
     /*
      * Print error messages
      */
@@ -594,6 +973,162 @@ OperationShowScene::useParameters(OperationParameters* myParams,
     }
 }
 
+/**
+ * Constructor.
+ *
+ * @param imageFileName
+ *     Name of image file.
+ * @param imageIndex
+ *     Index of image.
+ * @param imageContent
+ *     content of image, it is copied.
+ * @param imageWidth
+ *     width of image.
+ * @param imageHeight
+ *     height of image.
+ */
+OperationShowScene::SceneRenderer::ImageWriter::ImageWriter(const AString& imageFileName,
+                                                            const int32_t imageIndex,
+                                                            const std::vector<unsigned char>& imageContent,
+                                                            const int32_t imageWidth,
+                                                            const int32_t imageHeight)
+: m_imageFileName(imageFileName),
+m_imageIndex(imageIndex),
+m_imageContent(imageContent),
+m_imageWidth(imageWidth),
+m_imageHeight(imageHeight)
+{
+}
+
+/**
+ * Write the image
+ *
+ * @return True if written, false if error.
+ */
+bool
+OperationShowScene::SceneRenderer::ImageWriter::writeImage()
+{
+    try {
+        OperationShowScene::writeImage(m_imageFileName,
+                                       m_imageIndex,
+                                       m_imageContent.data(),
+                                       m_imageWidth,
+                                       m_imageHeight);
+    }
+    catch (const CaretException& ce) {
+        m_errorMessage = ce.whatString();
+        return false;
+    }
+
+    return true;
+}
+
+void
+OperationShowScene::useParameters(OperationParameters* myParams,
+                                  ProgressObject* myProgObj)
+{
+    LevelProgress myProgress(myProgObj);
+    std::vector<SceneJob> jobs(1);
+    jobs[0].m_sceneFileName     = FileInformation(myParams->getString(1)).getAbsoluteFilePath();
+    jobs[0].m_sceneNameOrNumber = myParams->getString(2);
+    jobs[0].m_imageFileName     = FileInformation(myParams->getString(3)).getAbsoluteFilePath();
+    const int32_t userImageWidth  = myParams->getInteger(4);
+    const int32_t userImageHeight = myParams->getInteger(5);
+
+    OptionalParameter* useWindowSizeParam = myParams->getOptionalParameter(6);
+    const bool useWindowSizeForImageSizeFlag = useWindowSizeParam->m_present;
+
+    const bool doNotUseSceneColorsFlag = myParams->getOptionalParameter(7)->m_present;
+
+    OptionalParameter* mapYokeOpt = myParams->getOptionalParameter(8);
+    if (mapYokeOpt->m_present) {
+        addMapYokingToJob(mapYokeOpt->getString(1),
+                          mapYokeOpt->getInteger(2),
+                          jobs[0]);
+    }
+
+    OptionalParameter* batchOpt = myParams->getOptionalParameter(10);
+    if (batchOpt->m_present) {
+        readJobFile(batchOpt->getString(1),
+                    jobs);
+    }
+
+    if ( ! useWindowSizeForImageSizeFlag) {
+        if ((userImageWidth <= 0)
+            || (userImageHeight <= 0)) {
+            throw OperationException("Invalid image size width="
+                                     + QString::number(userImageWidth)
+                                     + " height="
+                                     + QString::number(userImageHeight));
+        }
+    }
+
+    /*
+     * Need to set username/password for files in ConnectomeDB
+     */
+    AString username;
+    AString password;
+    OptionalParameter* connDbOpt = myParams->getOptionalParameter(9);
+    if (connDbOpt->m_present) {
+        username = connDbOpt->getString(1);
+        password = connDbOpt->getString(2);
+    }
+    else {
+        CaretPreferences* prefs = SessionManager::get()->getCaretPreferences();
+        prefs->getRemoteFileUserNameAndPassword(username,
+                                                password);
+    }
+    CaretDataFile::setFileReadingUsernameAndPassword(username,
+                                                     password);
+
+    /*
+     * Enable voxel coloring since it is defaulted off for commands
+     */
+    VolumeFile::setVoxelColoringEnabled(true);
+
+    SceneRenderer sceneRenderer(userImageWidth,
+                                userImageHeight,
+                                useWindowSizeForImageSizeFlag,
+                                useWindowSizeParam->m_optionSwitch,
+                                doNotUseSceneColorsFlag);
+
+    /*
+     * With more than one job, a failed job is reported
+     * and the remaining jobs are rendered
+     */
+    const int32_t numberOfJobs = static_cast<int32_t>(jobs.size());
+    AString errorMessage;
+    for (int32_t iJob = 0; iJob < numberOfJobs; iJob++) {
+        const SceneJob& job = jobs[iJob];
+        try {
+            sceneRenderer.renderJob(job);
+        }
+        catch (const CaretException& ce) {
+            if (numberOfJobs == 1) {
+                throw;
+            }
+            const AString msg("Failed to render scene "
+                              + job.m_sceneNameOrNumber
+                              + " from "
+                              + job.m_sceneFileName
+                              + " into "
+                              + job.m_imageFileName
+                              + ": "
+                              + ce.whatString());
+            std::cerr << msg << std::endl;
+            if ( ! errorMessage.isEmpty()) {
+                errorMessage += "\n";
+            }
+            errorMessage += msg;
+        }
+    }
+
+    sceneRenderer.waitForImagesToFinishWriting(errorMessage);
+    if ( ! errorMessage.isEmpty()) {
+        throw OperationException(errorMessage);
+    }
+}
+
 /**
  * Estimate the size of the graphics region from scenes that lack
  * an explicit entry for the graphics region size.  Scenes in version
@@ -22,6 +22,8 @@
 /*LICENSE_END*/
 
 
+#include <vector>
+
 #include "AbstractOperation.h"
 
 namespace caret {
@@ -43,6 +45,17 @@ namespace caret {
         static bool isShowSceneCommandAvailable();
         
     private:
+        struct SceneJob;
+        
+        class SceneRenderer;
+        
+        static void readJobFile(const AString& jobFileName,
+                                std::vector<SceneJob>& jobsInOut);
+        
+        static void addMapYokingToJob(const AString& romanNumeral,
+                                      const int32_t mapIndex,
+                                      SceneJob& job);
+        
         static BrainOpenGLFixedPipeline* createBrainOpenGL();
         
         static void writeImage(const AString& imageFileName,
@@ -124,13 +124,14 @@ void OperationSurfaceGeodesicDistanceAllToAll::useParameters(OperationParameters
         } else {
             privHelper = mySurf->getGeodesicHelper();
         }
+        vector<float> outRow(mapLength), outDists;//reused for every row this thread computes, rows go to the output as they finish
+        vector<int32_t> outNodes;
 #pragma omp CARET_FOR schedule(dynamic)
         for (int64_t i = 0; i < mapLength; ++i)
         {
-            vector<float> outRow(mapLength, -1.0f), outDists;
-            vector<int32_t> outNodes;
             if (distLimit > 0.0f)
             {
+                outRow.assign(mapLength, -1.0f);
                 privHelper->getNodesToGeoDist(surfMap[i].m_surfaceNode, distLimit, outNodes, outDists, !naive);
                 for (int j = 0; j < int(outNodes.size()); ++j)
                 {
@@ -24,13 +24,20 @@
 #include "CaretAssert.h"
 #include "CaretLogger.h"
 #include "CaretMathExpression.h"
+#include "CaretOMP.h"
 #include "VolumeFile.h"
 
+#include <algorithm>
 #include <iostream>
 
 using namespace caret;
 using namespace std;
 
+namespace
+{
+    const int64_t CHUNK_SIZE = 65536;//voxels per parallel work unit, large enough to amortize scheduling, small enough to balance
+}
+
 AString OperationVolumeMath::getCommandSwitch()
 {
     return "-volume-math";
@@ -200,7 +207,7 @@ void OperationVolumeMath::useParameters(OperationParameters* myParams, ProgressO
         throw OperationException("all -var options used -repeat, there is no file to get number of desired output subvolumes from");
     }
     int64_t frameSize = outDims[0] * outDims[1] * outDims[2];
-    vector<float> values(numVars), outFrame(frameSize);
+    vector<float> outFrame(frameSize);
     vector<const float*> inputFrames(numVars);
     if (toClone != NULL)
     {//don't take volume type from the selected volume, because we don't check for or copy label tables, nor do we want to (might be changing all the label keys, splitting label by roi...)
@@ -220,18 +227,28 @@ void OperationVolumeMath::useParameters(OperationParameters* myParams, ProgressO
                 inputFrames[v] = varVolumes[v]->getFrame(varSubvolumes[v]);
             }
         }
-        for (int64_t i = 0; i < frameSize; ++i)
-        {
+        const int64_t numChunks = (frameSize + CHUNK_SIZE - 1) / CHUNK_SIZE;
+#pragma omp CARET_PARFOR schedule(dynamic)
+        for (int64_t chunk = 0; chunk < numChunks; ++chunk)
+        {//CaretMathExpression::evaluateRow is thread-safe, so split the frame between threads
+            const int64_t chunkStart = chunk * CHUNK_SIZE, chunkLength = min(CHUNK_SIZE, frameSize - chunkStart);
+            vector<const float*> chunkInputs(numVars);
             for (int v = 0; v < numVars; ++v)
             {
-                values[v] = inputFrames[v][i];
+                chunkInputs[v] = inputFrames[v] + chunkStart;
             }
-            float tempf = (float)myExpr.evaluate(values);
-            if (nanfix && tempf != tempf)
+            float* chunkOut = outFrame.data() + chunkStart;
+            myExpr.evaluateRow(chunkInputs, chunkOut, chunkLength);
+            if (nanfix)
             {
-                tempf = nanfixval;
+                for (int64_t i = 0; i < chunkLength; ++i)
+                {
+                    if (chunkOut[i] != chunkOut[i])
+                    {
+                        chunkOut[i] = nanfixval;
+                    }
+                }
             }
-            outFrame[i] = tempf;
         }
         myVolOut->setFrame(outFrame.data(), s);
     }
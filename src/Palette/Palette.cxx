@@ -85,6 +85,8 @@ Palette::copyHelper(const Palette& o)
 {
     this->name = o.name;
     this->paletteScalars.clear();
+    this->m_lookupTables[0].reset();
+    this->m_lookupTables[1].reset();
     uint64_t num = o.paletteScalars.size();
     for (uint64_t i = 0; i < num; i++) {
         this->paletteScalars.push_back(new PaletteScalarAndColor(*o.paletteScalars[i]));
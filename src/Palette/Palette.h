@@ -32,6 +32,7 @@
 
 namespace caret {
 
+    class PaletteLookupTable;
     class PaletteScalarAndColor;
 
     /**
@@ -144,6 +145,11 @@ namespace caret {
         
         /** The inverted palette with negative inverted separate from positive */
         mutable std::unique_ptr<Palette> m_noneSeparateInvertedPalette;
+        
+        /** Lookup tables for coloring, index is interpolate color flag, lazily created by PaletteLookupTable (DO NOT CLONE) */
+        mutable std::shared_ptr<const PaletteLookupTable> m_lookupTables[2];
+        
+        friend class PaletteLookupTable;
     };
 
     
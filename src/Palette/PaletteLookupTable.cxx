@@ -0,0 +1,271 @@
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2019 Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <cmath>
+
+#define __PALETTE_LOOKUP_TABLE_DECLARE__
+#include "PaletteLookupTable.h"
+#undef __PALETTE_LOOKUP_TABLE_DECLARE__
+
+#include "CaretAssert.h"
+#include "CaretMutex.h"
+#include "PaletteScalarAndColor.h"
+
+using namespace caret;
+
+namespace {
+    /**
+     * @return The palette's scalars, colors, and none color status
+     * in one vector for detecting a change to the palette.
+     */
+    std::vector<float> getPaletteScalarsAndColors(const Palette* palette)
+    {
+        const int32_t numScalarColors = palette->getNumberOfScalarsAndColors();
+        std::vector<float> values;
+        values.reserve(numScalarColors * 6);
+        for (int32_t i = 0; i < numScalarColors; i++) {
+            const PaletteScalarAndColor* psac = palette->getScalarAndColor(i);
+            const float* rgba = psac->getColor();
+            values.push_back(psac->getScalar());
+            values.insert(values.end(), rgba, rgba + 4);
+            values.push_back(psac->isNoneColor() ? 1.0f : 0.0f);
+        }
+        return values;
+    }
+}
+
+/**
+ * \class caret::PaletteLookupTable
+ * \brief Lookup table for fast coloring of normalized scalars with a palette
+ * \ingroup Palette
+ *
+ * The palette is divided into segments, ranges of normalized scalars that
+ * receive a single color or a color interpolated between two colors.
+ * The normalized range is divided into bins and each bin that is entirely
+ * within one segment receives the index of that segment, so that finding
+ * the color of a scalar is a table lookup instead of a search of the
+ * palette.  Scalars in the few bins that contain a change in the palette
+ * are colored by the palette.  Colors are identical to those from
+ * Palette::getPaletteColor().
+ */
+
+/**
+ * Get a lookup table for a palette.  The table is kept by the palette,
+ * so it is deleted with the palette, and it is rebuilt if the palette's
+ * scalars or colors have changed.
+ *
+ * @param palette
+ *     The palette.
+ * @param interpolateColorFlag
+ *     Interpolate the color between scalars.
+ * @return
+ *     Lookup table for the palette.
+ */
+std::shared_ptr<const PaletteLookupTable>
+PaletteLookupTable::getLookupTable(const Palette* palette,
+                                   const bool interpolateColorFlag)
+{
+    CaretAssert(palette);
+
+    /*
+     * Palettes may be used for coloring by more than one thread
+     */
+    static CaretMutex s_tableMutex;
+
+    CaretMutexLocker locker(&s_tableMutex);
+    std::shared_ptr<const PaletteLookupTable>& table = palette->m_lookupTables[interpolateColorFlag ? 1 : 0];
+    if (( ! table)
+        || ( ! table->isMatchingPalette(palette))) {
+        /*
+         * Colors of the palette's scalars may be changed without
+         * the palette knowing, so compare contents instead of
+         * using the palette's modified status.
+         */
+        table.reset(new PaletteLookupTable(palette,
+                                           interpolateColorFlag));
+    }
+    return table;
+}
+
+/**
+ * Constructor.
+ *
+ * @param palette
+ *     The palette.
+ * @param interpolateColorFlag
+ *     Interpolate the color between scalars.
+ */
+PaletteLookupTable::PaletteLookupTable(const Palette* palette,
+                                       const bool interpolateColorFlag)
+: CaretObject(),
+m_palette(*palette),
+m_interpolateColorFlag(interpolateColorFlag)
+{
+    m_paletteScalarsAndColors = getPaletteScalarsAndColors(&m_palette);
+
+    /*
+     * Segments are in the same order as the palette (descending scalars),
+     * followed by the segment for scalars at or above the first palette
+     * scalar and the segment for scalars at or below the last palette
+     * scalar.  See Palette::getPaletteColor().
+     */
+    const int32_t numScalarColors = m_palette.getNumberOfScalarsAndColors();
+    auto createSegment = [&](const int32_t paletteIndex,
+                             const bool interpolateFlag) {
+        Segment segment;
+        const PaletteScalarAndColor* psac = m_palette.getScalarAndColor(paletteIndex);
+        if (psac->isNoneColor()) {
+            segment.m_rgbaAbove[3] = 0.0f;
+        }
+        else {
+            psac->getColor(segment.m_rgbaAbove);
+            if (interpolateFlag
+                && (paletteIndex < (numScalarColors - 1))) {
+                const PaletteScalarAndColor* psacBelow = m_palette.getScalarAndColor(paletteIndex + 1);
+                const float totalDiff = psac->getScalar() - psacBelow->getScalar();
+                if ((totalDiff != 0.0f)
+                    && ( ! psacBelow->isNoneColor())) {
+                    segment.m_scalarBelow = psacBelow->getScalar();
+                    segment.m_totalDiff   = totalDiff;
+                    psacBelow->getColor(segment.m_rgbaBelow);
+                    segment.m_interpolateFlag = true;
+                }
+            }
+        }
+        return segment;
+    };
+
+    if (numScalarColors <= 0) {
+        m_segments.push_back(Segment());
+    }
+    else if (numScalarColors == 1) {
+        m_segments.push_back(createSegment(0, false));
+    }
+    else {
+        const bool interpolateFlag = ((numScalarColors == 2)
+                                      ? true
+                                      : interpolateColorFlag);
+        for (int32_t i = 0; i < (numScalarColors - 1); i++) {
+            m_segments.push_back(createSegment(i, interpolateFlag));
+        }
+        m_segments.push_back(createSegment(0, false));
+        m_segments.push_back(createSegment(numScalarColors - 1, false));
+    }
+
+    /*
+     * Converting a scalar to a bin index may round to a neighboring
+     * bin so each bin is tested with a small margin.
+     */
+    const float margin = 0.01f / BINS_PER_UNIT;
+    const float justAboveNegativeOne = std::nextafter(-1.0f, 0.0f);
+    const float justBelowPositiveOne = std::nextafter(1.0f, 0.0f);
+    m_tableSegmentIndices.resize(NUMBER_OF_BINS + 2);
+    m_tableSegmentIndices[0] = getSegmentIndex(-1.0f);
+    for (int32_t i = 0; i < NUMBER_OF_BINS; i++) {
+        float binLow  = -1.0f + (i / BINS_PER_UNIT) - margin;
+        float binHigh = -1.0f + ((i + 1) / BINS_PER_UNIT) + margin;
+        if (binLow < justAboveNegativeOne) binLow = justAboveNegativeOne;
+        if (binHigh > justBelowPositiveOne) binHigh = justBelowPositiveOne;
+
+        const int32_t lowSegmentIndex  = getSegmentIndex(binLow);
+        const int32_t highSegmentIndex = getSegmentIndex(binHigh);
+        m_tableSegmentIndices[i + 1] = ((lowSegmentIndex == highSegmentIndex)
+                                        ? lowSegmentIndex
+                                        : -1);
+    }
+    m_tableSegmentIndices[NUMBER_OF_BINS + 1] = getSegmentIndex(1.0f);
+}
+
+/**
+ * Destructor.
+ */
+PaletteLookupTable::~PaletteLookupTable()
+{
+}
+
+/**
+ * @return True if the given palette has the same scalars and
+ * colors as the palette this table was created from.
+ *
+ * @param palette
+ *     The palette.
+ */
+bool
+PaletteLookupTable::isMatchingPalette(const Palette* palette) const
+{
+    return (getPaletteScalarsAndColors(palette) == m_paletteScalarsAndColors);
+}
+
+/**
+ * Get the segment that colors a normalized scalar, the same search
+ * as Palette::getPaletteColor().
+ *
+ * @param scalar
+ *     Normalized scalar in [-1.0, 1.0].
+ * @return
+ *     Index of the segment.
+ */
+int32_t
+PaletteLookupTable::getSegmentIndex(const float scalar) const
+{
+    const int32_t numScalarColors = m_palette.getNumberOfScalarsAndColors();
+    if (numScalarColors <= 1) {
+        return 0;
+    }
+    if (scalar >= m_palette.getScalarAndColor(0)->getScalar()) {
+        return (numScalarColors - 1);
+    }
+    if (scalar <= m_palette.getScalarAndColor(numScalarColors - 1)->getScalar()) {
+        return numScalarColors;
+    }
+    if (numScalarColors == 2) {
+        return 0;
+    }
+
+    /*
+     * Palette scalars are in descending order, find the
+     * first scalar that is less than the given scalar
+     */
+    int32_t low  = 1;
+    int32_t high = numScalarColors - 1;
+    while (low < high) {
+        const int32_t mid = (low + high) / 2;
+        if (scalar > m_palette.getScalarAndColor(mid)->getScalar()) {
+            high = mid;
+        }
+        else {
+            low = mid + 1;
+        }
+    }
+    return (low - 1);
+}
+
+/**
+ * Get a description of this object's content.
+ * @return String describing this object's content.
+ */
+AString
+PaletteLookupTable::toString() const
+{
+    return ("PaletteLookupTable for "
+            + m_palette.getName());
+}
+
@@ -0,0 +1,168 @@
+#ifndef __PALETTE_LOOKUP_TABLE_H__
+#define __PALETTE_LOOKUP_TABLE_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2019 Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+#include "CaretObject.h"
+#include "Palette.h"
+
+namespace caret {
+
+    class PaletteLookupTable : public CaretObject {
+
+    public:
+        static std::shared_ptr<const PaletteLookupTable> getLookupTable(const Palette* palette,
+                                                                        const bool interpolateColorFlag);
+
+        virtual ~PaletteLookupTable();
+
+        PaletteLookupTable(const PaletteLookupTable&) = delete;
+
+        PaletteLookupTable& operator=(const PaletteLookupTable&) = delete;
+
+        /**
+         * Get the color for a normalized scalar, the same color
+         * Palette::getPaletteColor() produces.
+         *
+         * @param scalarIn
+         *     Normalized scalar, clamped to [-1.0, 1.0].
+         * @param rgbaOut
+         *     Output color components ranging zero to one.
+         */
+        inline void getPaletteColor(const float scalarIn,
+                                    float rgbaOut[4]) const {
+            float scalar = scalarIn;
+            int32_t tableIndex = 0;
+            if (scalar >= 1.0f) {
+                scalar = 1.0f;
+                tableIndex = NUMBER_OF_BINS + 1;
+            }
+            else if (scalar > -1.0f) {
+                tableIndex = static_cast<int32_t>((scalar + 1.0f) * BINS_PER_UNIT);
+                if (tableIndex >= NUMBER_OF_BINS) {
+                    tableIndex = NUMBER_OF_BINS - 1;
+                }
+                tableIndex += 1;
+            }
+            else if (scalar <= -1.0f) {
+                scalar = -1.0f;
+            }
+            else {
+                /* NaN */
+                m_palette.getPaletteColor(scalarIn,
+                                           m_interpolateColorFlag,
+                                           rgbaOut);
+                return;
+            }
+
+            const int32_t segmentIndex = m_tableSegmentIndices[tableIndex];
+            if (segmentIndex < 0) {
+                /* Bin contains a change in the palette */
+                m_palette.getPaletteColor(scalar,
+                                           m_interpolateColorFlag,
+                                           rgbaOut);
+                return;
+            }
+
+            const Segment& segment = m_segments[segmentIndex];
+            if (segment.m_interpolateFlag) {
+                const float percentAbove = (scalar - segment.m_scalarBelow) / segment.m_totalDiff;
+                const float percentBelow = 1.0f - percentAbove;
+                rgbaOut[0] = (percentAbove * segment.m_rgbaAbove[0]
+                              + percentBelow * segment.m_rgbaBelow[0]);
+                rgbaOut[1] = (percentAbove * segment.m_rgbaAbove[1]
+                              + percentBelow * segment.m_rgbaBelow[1]);
+                rgbaOut[2] = (percentAbove * segment.m_rgbaAbove[2]
+                              + percentBelow * segment.m_rgbaBelow[2]);
+            }
+            else {
+                rgbaOut[0] = segment.m_rgbaAbove[0];
+                rgbaOut[1] = segment.m_rgbaAbove[1];
+                rgbaOut[2] = segment.m_rgbaAbove[2];
+            }
+            rgbaOut[3] = segment.m_rgbaAbove[3];
+        }
+
+        // ADD_NEW_METHODS_HERE
+
+        virtual AString toString() const;
+
+    private:
+        /**
+         * A range of normalized scalars that receives either a
+         * single color or a color interpolated between two colors.
+         */
+        struct Segment {
+            float m_scalarBelow = 0.0f;
+
+            float m_totalDiff = 1.0f;
+
+            float m_rgbaAbove[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+
+            float m_rgbaBelow[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+
+            bool m_interpolateFlag = false;
+        };
+
+        PaletteLookupTable(const Palette* palette,
+                           const bool interpolateColorFlag);
+
+        bool isMatchingPalette(const Palette* palette) const;
+
+        int32_t getSegmentIndex(const float scalar) const;
+
+        /** Number of bins covering the normalized range (-1.0, 1.0) */
+        static const int32_t NUMBER_OF_BINS = 8192;
+
+        /** Number of bins in a normalized range of one */
+        static constexpr float BINS_PER_UNIT = NUMBER_OF_BINS / 2;
+
+        /** Copy of the palette, so the table never refers to a palette that was changed or deleted */
+        const Palette m_palette;
+
+        const bool m_interpolateColorFlag;
+
+        /** Copy of palette scalars and colors, identifies a changed palette */
+        std::vector<float> m_paletteScalarsAndColors;
+
+        std::vector<Segment> m_segments;
+
+        /**
+         * Segment for each bin or -1 if the bin is not within a single
+         * segment.  First element is for -1.0, last element is for 1.0.
+         */
+        std::vector<int32_t> m_tableSegmentIndices;
+
+        // ADD_NEW_MEMBERS_HERE
+
+    };
+
+#ifdef __PALETTE_LOOKUP_TABLE_DECLARE__
+    // <PLACE DECLARATIONS OF STATIC MEMBERS HERE>
+#endif // __PALETTE_LOOKUP_TABLE_DECLARE__
+
+} // namespace
+#endif  //__PALETTE_LOOKUP_TABLE_H__
@@ -0,0 +1,147 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2019  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "Base64Test.h"
+
+#include "Base64.h"
+#include "Base64StreamDecoder.h"
+#include "CaretException.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+Base64Test::Base64Test(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    string encode(const vector<uint8_t>& data)
+    {
+        vector<unsigned char> buffer(data.size() * 2 + 8);
+        uint64_t length = 0;
+        if (!data.empty())
+        {
+            length = Base64::encode(data.data(), data.size(), buffer.data());
+        }
+        return string((const char*)buffer.data(), length);
+    }
+}
+
+void Base64Test::execute()
+{
+    for (int size = 0; size < 300; ++size)
+    {
+        vector<uint8_t> data(size);
+        for (int i = 0; i < size; ++i)
+        {
+            data[i] = (uint8_t)(rand() & 0xFF);
+        }
+        string text = encode(data);
+        if (size % 3 == 1)
+        {//whitespace between and inside quartets, as a pretty-printing writer might produce
+            string spaced = "\n";
+            for (int i = 0; i < (int)text.size(); ++i)
+            {
+                if (i % 7 == 3) spaced += "\r\n  ";
+                spaced += text[i];
+            }
+            text = spaced + "\n";
+        }
+        vector<uint8_t> decoded;
+        try
+        {
+            Base64StreamDecoder::decode(text.c_str(), text.size(), decoded);
+        } catch (CaretException& e) {
+            setFailed("whole decode of " + AString::number(size) + " bytes threw: " + e.whatString());
+            continue;
+        }
+        if (decoded != data) setFailed("whole decode of " + AString::number(size) + " bytes does not match");
+        Base64StreamDecoder streamDecoder;
+        streamDecoder.reset(size);
+        try
+        {
+            int pos = 0;
+            while (pos < (int)text.size())
+            {//pieces of random length, so quartets get split
+                int pieceLength = min(1 + rand() % 23, (int)text.size() - pos);
+                streamDecoder.decode(text.c_str() + pos, pieceLength);
+                pos += pieceLength;
+            }
+            streamDecoder.finish();
+        } catch (CaretException& e) {
+            setFailed("piecewise decode of " + AString::number(size) + " bytes threw: " + e.whatString());
+            continue;
+        }
+        streamDecoder.takeDecodedData(decoded);
+        if (decoded != data) setFailed("piecewise decode of " + AString::number(size) + " bytes does not match");
+    }
+    {//line-wrapped at 76 columns with CRLF, as MIME encoders write it, large enough that per-line reallocation would be very slow
+        vector<uint8_t> data(3 << 18);
+        for (int i = 0; i < (int)data.size(); ++i)
+        {
+            data[i] = (uint8_t)(rand() & 0xFF);
+        }
+        string text = encode(data), wrapped;
+        for (int i = 0; i < (int)text.size(); i += 76)
+        {
+            wrapped += text.substr(i, 76) + "\r\n";
+        }
+        vector<uint8_t> decoded;
+        try
+        {
+            Base64StreamDecoder::decode(wrapped.c_str(), wrapped.size(), decoded);
+            if (decoded != data) setFailed("whole decode of wrapped text does not match");
+            for (int expected = 0; expected < 2; ++expected)
+            {//with and without knowing the decoded size in advance
+                Base64StreamDecoder streamDecoder;
+                streamDecoder.reset(expected == 0 ? 0 : data.size());
+                for (int pos = 0; pos < (int)wrapped.size(); pos += 4099)
+                {
+                    streamDecoder.decode(wrapped.c_str() + pos, min(4099, (int)wrapped.size() - pos));
+                }
+                streamDecoder.finish();
+                if (streamDecoder.getNumberOfDecodedBytes() != (int64_t)data.size()) setFailed("piecewise decode of wrapped text has the wrong size");
+                streamDecoder.takeDecodedData(decoded);
+                if (decoded != data) setFailed("piecewise decode of wrapped text does not match");
+            }
+        } catch (CaretException& e) {
+            setFailed("decode of wrapped text threw: " + e.whatString());
+        }
+    }
+    const char* badInputs[] = { "QUJD*EVG", "QUJDR", "QQ==QUJD", "=QUJ" };
+    for (int i = 0; i < 4; ++i)
+    {
+        vector<uint8_t> decoded;
+        bool threw = false;
+        try
+        {
+            Base64StreamDecoder::decode(badInputs[i], strlen(badInputs[i]), decoded);
+        } catch (CaretException&) {
+            threw = true;
+        }
+        if (!threw) setFailed(AString("invalid input '") + badInputs[i] + "' was accepted");
+    }
+}
@@ -20,6 +20,10 @@
 
 #include "CiftiFileTest.h"
 #include "CiftiFile.h"
+
+#include <algorithm>
+#include <vector>
+
 using namespace caret;
 CiftiFileTest::CiftiFileTest(const AString &identifier) : TestInterface(identifier)
 {
@@ -96,6 +100,27 @@ void CiftiFileTest::testCiftiRead()
     delete [] column;
 }
 
+void CiftiFileTest::testRowBlock(const CiftiFile& test)
+{
+    //a block of rows must be the same as the rows read one at a time
+    std::vector<int64_t> dim = test.getDimensions();
+    int64_t rowSize = dim[0];
+    int64_t columnSize = dim[1];
+    int64_t blockRows = std::min(columnSize, (int64_t)7);
+    std::vector<float> block(blockRows * rowSize), testRow(rowSize);
+    test.getRowBlock(block.data(), columnSize - blockRows, blockRows);
+    for(int64_t i = 0;i<blockRows;i++)
+    {
+        test.getRow(testRow.data(),columnSize - blockRows + i);
+        if(memcmp((void *)(block.data() + i * rowSize),(void *)testRow.data(),rowSize*sizeof(float)))
+        {
+            this->setFailed("Cifti row block does not match individual rows.");
+            return;
+        }
+    }
+    std::cout << "Reading a block of Cifti rows was successful." << std::endl;
+}
+
 void CiftiFileTest::testCiftiReadWriteInMemory()
 {
     std::cout << "Testing Cifti reader/writer." << std::endl;
@@ -144,6 +169,7 @@ void CiftiFileTest::testCiftiReadWriteInMemory()
         }
     }
     std::cout << "Reading and writing of Cifti was successful for all frames." << std::endl;
+    testRowBlock(test);
     delete [] row;
     delete [] testRow;
 }
@@ -195,6 +221,7 @@ void CiftiFileTest::testCiftiReadWriteOnDisk()
         }
     }
     std::cout << "Reading and writing of Cifti was successful for all frames." << std::endl;
+    testRowBlock(test);
     delete [] row;
     delete [] testRow;
 }
@@ -23,8 +23,11 @@
 #define CIFTIFILETEST_H
 
 namespace caret {
+class CiftiFile;
+
 class CiftiFileTest : public TestInterface
 {
+    void testRowBlock(const CiftiFile& test);
 public:
     CiftiFileTest(const AString &identifier);
     void execute();
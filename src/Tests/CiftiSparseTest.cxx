@@ -0,0 +1,199 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "CiftiSparseTest.h"
+
+#include "CaretException.h"
+#include "CiftiFile.h"
+#include "CiftiScalarsMap.h"
+
+#include <QDir>
+#include <QTemporaryFile>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace caret;
+using namespace std;
+
+CiftiSparseTest::CiftiSparseTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    vector<vector<float> > makeTestData(const int64_t& numRows, const int64_t& rowLength)
+    {
+        vector<vector<float> > ret(numRows, vector<float>(rowLength));
+        for (int64_t r = 0; r < numRows; ++r)
+        {
+            for (int64_t c = 0; c < rowLength; ++c)
+            {
+                if ((r + c) % 5 == 0 || r == 4)//scattered zeros, and one empty row
+                {
+                    ret[r][c] = 0.0f;
+                } else {
+                    ret[r][c] = ((r * 37 + c * 11) % 101) * 0.37f - 17.3f;//positive and negative, no ties in magnitude within a row
+                }
+            }
+        }
+        ret[2][3] = numeric_limits<float>::quiet_NaN();
+        return ret;
+    }
+    
+    //what the reader should give back: dropped values become zero
+    vector<vector<float> > expectedData(const vector<vector<float> >& data, const float& threshold, const int64_t& topK)
+    {
+        vector<vector<float> > ret(data.size());
+        for (size_t r = 0; r < data.size(); ++r)
+        {
+            const vector<float>& row = data[r];
+            vector<pair<float, int64_t> > ranked;
+            for (int64_t c = 0; c < (int64_t)row.size(); ++c)
+            {
+                if (row[c] != 0.0f && !(abs(row[c]) < threshold))
+                {
+                    ranked.push_back(pair<float, int64_t>((row[c] != row[c] ? -1.0f : abs(row[c])), c));
+                }
+            }
+            sort(ranked.begin(), ranked.end(), greater<pair<float, int64_t> >());
+            if (topK > 0 && (int64_t)ranked.size() > topK) ranked.resize(topK);
+            ret[r].resize(row.size(), 0.0f);
+            for (size_t i = 0; i < ranked.size(); ++i)
+            {
+                ret[r][ranked[i].second] = row[ranked[i].second];
+            }
+        }
+        return ret;
+    }
+    
+    bool valuesMatch(const float& correct, const float& test, const float& toler)
+    {
+        if (correct != correct) return test != test;
+        return abs(correct - test) <= toler;
+    }
+}
+
+void CiftiSparseTest::execute()
+{
+    vector<vector<float> > data = makeTestData(9, 23);
+    checkRoundTrip(data, 0.0f, -1, false, false);
+    checkRoundTrip(data, 5.0f, -1, false, false);
+    checkRoundTrip(data, 0.0f, 4, false, false);
+    checkRoundTrip(data, 0.0f, -1, true, false);
+    checkRoundTrip(data, 1.0f, 4, true, true);
+}
+
+void CiftiSparseTest::checkRoundTrip(const vector<vector<float> >& data, const float& threshold, const int64_t& topK, const bool& quantize, const bool& streaming)
+{
+    AString descrip = "threshold " + AString::number(threshold) + ", top-k " + AString::number(topK) + (quantize ? ", quantized" : "") + (streaming ? ", streamed" : "");
+    const int64_t numRows = (int64_t)data.size(), rowLength = (int64_t)data[0].size();
+    QTemporaryFile tempFile(QDir::tempPath() + "/sparse_test_XXXXXX.dconn.csf");//removes the file when it goes out of scope
+    if (!tempFile.open())
+    {
+        setFailed("failed to create temporary file for sparse cifti test");
+        return;
+    }
+    QString fileName = tempFile.fileName();
+    tempFile.close();
+    vector<vector<float> > expected = expectedData(data, threshold, topK);
+    try
+    {
+        {
+            CiftiXML myXML;
+            myXML.setNumberOfDimensions(2);
+            myXML.setMap(CiftiXML::ALONG_ROW, CiftiScalarsMap(rowLength));
+            myXML.setMap(CiftiXML::ALONG_COLUMN, CiftiScalarsMap(numRows));
+            CiftiFile writer;
+            if (streaming) writer.setWritingFile(fileName);
+            writer.setWritingSparse(threshold, topK, quantize);
+            writer.setCiftiXML(myXML);
+            for (int64_t r = 0; r < numRows; ++r)
+            {
+                writer.setRow(data[r].data(), r);
+            }
+            if (streaming)
+            {
+                writer.close();
+            } else {
+                writer.writeFile(fileName);
+            }
+        }
+        CiftiFile reader(fileName);
+        if (reader.getNumberOfRows() != numRows || reader.getNumberOfColumns() != rowLength)
+        {
+            setFailed("sparse cifti read back with wrong dimensions (" + descrip + ")");
+            return;
+        }
+        vector<float> row(rowLength), column(numRows), block(numRows * 3);
+        for (int64_t r = 0; r < numRows; ++r)
+        {
+            float toler = 0.0f;
+            if (quantize)
+            {
+                float maxAbs = 0.0f;
+                for (int64_t c = 0; c < rowLength; ++c)
+                {
+                    if (abs(expected[r][c]) > maxAbs) maxAbs = abs(expected[r][c]);
+                }
+                toler = maxAbs / 32767.0f * 0.501f;//half a quantization step, plus rounding
+            }
+            reader.getRow(row.data(), r);
+            for (int64_t c = 0; c < rowLength; ++c)
+            {
+                if (!valuesMatch(expected[r][c], row[c], toler))
+                {
+                    setFailed("sparse cifti row " + AString::number(r) + " column " + AString::number(c) + " should be " + AString::number(expected[r][c]) +
+                              " but read back as " + AString::number(row[c]) + " (" + descrip + ")");
+                    return;
+                }
+            }
+        }
+        for (int64_t c = 0; c < rowLength; ++c)//columns and column blocks come from a different code path, so they must agree with the rows
+        {
+            reader.getColumn(column.data(), c);
+            for (int64_t r = 0; r < numRows; ++r)
+            {
+                reader.getRow(row.data(), r);
+                if (!valuesMatch(row[c], column[r], 0.0f))
+                {
+                    setFailed("sparse cifti column " + AString::number(c) + " doesn't match rows (" + descrip + ")");
+                    return;
+                }
+            }
+        }
+        const int64_t firstColumn = 5;
+        reader.getColumnBlock(block.data(), firstColumn, 3);
+        for (int64_t i = 0; i < 3; ++i)
+        {
+            for (int64_t r = 0; r < numRows; ++r)
+            {
+                reader.getRow(row.data(), r);
+                if (!valuesMatch(row[firstColumn + i], block[i * numRows + r], 0.0f))
+                {
+                    setFailed("sparse cifti column block doesn't match rows (" + descrip + ")");
+                    return;
+                }
+            }
+        }
+    } catch (CaretException& e) {
+        setFailed("sparse cifti round trip threw (" + descrip + "): " + e.whatString());
+    }
+}
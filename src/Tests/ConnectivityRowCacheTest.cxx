@@ -0,0 +1,104 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "ConnectivityRowCacheTest.h"
+
+#include "CaretException.h"
+#include "CiftiFile.h"
+#include "CiftiScalarsMap.h"
+#include "ConnectivityMatrixRowCache.h"
+
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+ConnectivityRowCacheTest::ConnectivityRowCacheTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+void ConnectivityRowCacheTest::execute()
+{
+    const int64_t numRows = 20, rowLength = 50;
+    const int64_t rowBytes = rowLength * sizeof(float);
+    try
+    {
+        CiftiXML myXML;
+        myXML.setNumberOfDimensions(2);
+        myXML.setMap(CiftiXML::ALONG_ROW, CiftiScalarsMap(rowLength));
+        myXML.setMap(CiftiXML::ALONG_COLUMN, CiftiScalarsMap(numRows));
+        CiftiFile myFile;
+        myFile.setCiftiXML(myXML);
+        vector<vector<float> > data(numRows, vector<float>(rowLength));
+        for (int64_t r = 0; r < numRows; ++r)
+        {
+            for (int64_t c = 0; c < rowLength; ++c)
+            {
+                data[r][c] = r * 1000.0f + c;
+            }
+            myFile.setRow(data[r].data(), r);
+        }
+        ConnectivityMatrixRowCache* myCache = ConnectivityMatrixRowCache::getCache();
+        myCache->setByteBudget(6 * rowBytes);
+        const int64_t fileKey = myCache->newFileKey();
+        for (int64_t r = 0; r < 6; ++r)
+        {//fill the cache to the budget with viewed rows
+            myCache->addRow(fileKey, r, data[r].data(), rowLength);
+        }
+        if (myCache->getBytesUsed() != 6 * rowBytes)
+        {
+            setFailed("row cache is not full after adding rows up to the budget");
+        }
+        vector<int64_t> prefetch;
+        prefetch.push_back(10);
+        prefetch.push_back(11);
+        myCache->prefetchRows(fileKey, &myFile, prefetch);
+        myCache->waitForPrefetch();
+        vector<float> row(rowLength);
+        for (size_t i = 0; i < prefetch.size(); ++i)
+        {//prefetching at the budget must keep the rows it read
+            if (!myCache->getRow(fileKey, prefetch[i], row.data(), rowLength))
+            {
+                setFailed("prefetched row " + AString::number(prefetch[i]) + " is not in a full cache");
+            } else if (row != data[prefetch[i]]) {
+                setFailed("prefetched row " + AString::number(prefetch[i]) + " has the wrong data");
+            }
+        }
+        if (!myCache->getRow(fileKey, 5, row.data(), rowLength) || row != data[5])
+        {
+            setFailed("prefetching removed the most recently viewed row");
+        }
+        if (myCache->getRow(fileKey, 0, row.data(), rowLength))
+        {
+            setFailed("least recently viewed row was not removed for the prefetched rows");
+        }
+        if (myCache->getBytesUsed() > myCache->getByteBudget())
+        {
+            setFailed("row cache is over its budget");
+        }
+        myCache->removeFile(fileKey);
+        if (myCache->getBytesUsed() != 0)
+        {
+            setFailed("row cache is not empty after removing the file");
+        }
+        ConnectivityMatrixRowCache::deleteCache();
+    } catch (CaretException& e) {
+        setFailed("caught exception in connectivity row cache test: " + e.whatString());
+    }
+}
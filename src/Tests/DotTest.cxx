@@ -104,6 +104,29 @@ namespace
         return dotval / (stdev1 * stdev2);
     }
     
+    //reference for the tile functions, all in double, and the sum of the absolute products for the error bound
+    void referenceTile(const vector<const float*>& rows, const int& length, vector<double>& correct, vector<double>& absSum)
+    {
+        const int numRows = (int)rows.size(), numCols = numRows - 2;
+        correct.resize(numRows * numCols);
+        absSum.resize(numRows * numCols);
+        for (int i = 0; i < numRows; ++i)
+        {
+            for (int j = 0; j < numCols; ++j)
+            {
+                double accum = 0.0, absAccum = 0.0;
+                for (int k = 0; k < length; ++k)
+                {
+                    double product = (double)rows[i][k] * rows[j + 2][k];//exact in double
+                    accum += product;
+                    absAccum += abs(product);
+                }
+                correct[i * numCols + j] = accum;
+                absSum[i * numCols + j] = absAccum;
+            }
+        }
+    }
+    
 }
 
 void DotTest::checkVal(const float& correct, const float& test, const AString& descrip)
@@ -113,6 +136,18 @@ void DotTest::checkVal(const float& correct, const float& test, const AString& d
     if (!(abs(test - correct) < TOLER_ABS + TOLER_RATIO * abs(correct))) setFailed(descrip + " got " + AString::number(test) + ", expected " + AString::number(correct));
 }//use "not less than" in order to catch NaNs
 
+void DotTest::checkTile(const vector<double>& correct, const vector<double>& absSum, const vector<const float*>& rows, const int& length, const AString& descrip)
+{//tile of all rows against all but the first two, so that neither dimension is a multiple of the register blocking
+    const int numRows = (int)rows.size(), numCols = numRows - 2;
+    vector<double> tile(numRows * numCols);
+    dsdot_tile(rows.data(), numRows, rows.data() + 2, numCols, length, tile.data(), numCols);
+    const double TOLER_RATIO = 1e-7;//some paths round each product to float, which is at most 2^-24 of each term, accumulation in double adds much less, float accumulation would be far worse on long rows
+    for (int i = 0; i < numRows * numCols; ++i)
+    {//the bound is relative to the sum of absolute products, because mixed signs can cancel to a result much smaller than the rounding error
+        if (!(abs(tile[i] - correct[i]) <= TOLER_RATIO * absSum[i])) setFailed(descrip + " tile element " + AString::number(i) + " got " + AString::number(tile[i]) + ", expected " + AString::number(correct[i]));
+    }
+}
+
 void DotTest::execute()
 {
     dot_flags impl_in_use = dot_set_impl(DOT_NAIVE);
@@ -122,6 +157,7 @@ void DotTest::execute()
     vector<float> lowsnrA = vectorAdd(rand1, vectorMult(rand2, 20.0f)), lowsnrB = vectorAdd(rand1, vectorMult(rand3, 20.0f));
     vector<float> midsnrA = vectorAdd(rand1, vectorMult(rand2, 2.0f)), midsnrB = vectorAdd(rand1, vectorMult(rand3, 2.0f));
     vector<float> highsnrA = vectorAdd(rand1, vectorMult(rand2, 0.2f)), highsnrB = vectorAdd(rand1, vectorMult(rand3, 0.2f));
+    vector<float> centered = vectorAdd(rand3, -0.5f);
     cout << "pointers: " << rand1.data() << ", " << rand2.data() << ", " << rand3.data() <<
             ", " << lowsnrA.data() << ", " << lowsnrB.data() << ", " <<
             ", " << midsnrA.data() << ", " << midsnrB.data() << ", " <<
@@ -134,6 +170,16 @@ void DotTest::execute()
     const float midsnr_naive = correlate(midsnrA, midsnrB);
     const float highsnr_naive = correlate(highsnrA, highsnrB);
     const float cross_snr_naive = correlate(lowsnrA, highsnrB);
+    vector<const float*> tileRows;
+    tileRows.push_back(rand1.data()); tileRows.push_back(rand2.data()); tileRows.push_back(rand3.data());
+    tileRows.push_back(lowsnrA.data()); tileRows.push_back(lowsnrB.data());
+    tileRows.push_back(midsnrA.data()); tileRows.push_back(midsnrB.data());
+    tileRows.push_back(highsnrA.data()); tileRows.push_back(highsnrB.data());
+    tileRows.push_back(centered.data());//mixed signs, so its products with the positive rows mostly cancel
+    const int TILE_LENGTH = ROWSIZE - 3;//also not a multiple of the vector width
+    vector<double> tile_correct, tile_absSum;
+    referenceTile(tileRows, TILE_LENGTH, tile_correct, tile_absSum);
+    checkTile(tile_correct, tile_absSum, tileRows, TILE_LENGTH, "naive");
     //sse2
     impl_in_use = dot_set_impl(DOT_SSE2);
     if (impl_in_use == DOT_SSE2)
@@ -144,6 +190,7 @@ void DotTest::execute()
         checkVal(midsnr_naive, correlate(midsnrA, midsnrB), "sse2 mid snr correlation");
         checkVal(highsnr_naive, correlate(highsnrA, highsnrB), "sse2 high snr correlation");
         checkVal(cross_snr_naive, correlate(lowsnrA, highsnrB), "sse2 cross snr correlation");
+        checkTile(tile_correct, tile_absSum, tileRows, TILE_LENGTH, "sse2");
     } else {
         cout << "skipping SSE2, not supported" << endl;
     }
@@ -157,6 +204,7 @@ void DotTest::execute()
         checkVal(midsnr_naive, correlate(midsnrA, midsnrB), "avx mid snr correlation");
         checkVal(highsnr_naive, correlate(highsnrA, highsnrB), "avx high snr correlation");
         checkVal(cross_snr_naive, correlate(lowsnrA, highsnrB), "avx cross snr correlation");
+        checkTile(tile_correct, tile_absSum, tileRows, TILE_LENGTH, "avx");
     } else {
         cout << "skipping AVX, not supported" << endl;
     }
@@ -170,6 +218,7 @@ void DotTest::execute()
         checkVal(midsnr_naive, correlate(midsnrA, midsnrB), "avxfma mid snr correlation");
         checkVal(highsnr_naive, correlate(highsnrA, highsnrB), "avxfma high snr correlation");
         checkVal(cross_snr_naive, correlate(lowsnrA, highsnrB), "avxfma cross snr correlation");
+        checkTile(tile_correct, tile_absSum, tileRows, TILE_LENGTH, "avxfma");
     } else {
         cout << "skipping AVXFMA, not supported" << endl;
     }
@@ -183,6 +232,7 @@ void DotTest::execute()
         checkVal(midsnr_naive, correlate(midsnrA, midsnrB), "avx512 mid snr correlation");
         checkVal(highsnr_naive, correlate(highsnrA, highsnrB), "avx512 high snr correlation");
         checkVal(cross_snr_naive, correlate(lowsnrA, highsnrB), "avx512 cross snr correlation");
+        checkTile(tile_correct, tile_absSum, tileRows, TILE_LENGTH, "avx512");
     } else {
         cout << "skipping AVX512, not supported" << endl;
     }
@@ -196,6 +246,7 @@ void DotTest::execute()
         checkVal(midsnr_naive, correlate(midsnrA, midsnrB), "avx512fma mid snr correlation");
         checkVal(highsnr_naive, correlate(highsnrA, highsnrB), "avx512fma high snr correlation");
         checkVal(cross_snr_naive, correlate(lowsnrA, highsnrB), "avx512fma cross snr correlation");
+        checkTile(tile_correct, tile_absSum, tileRows, TILE_LENGTH, "avx512fma");
     } else {
         cout << "skipping AVX512FMA, not supported" << endl;
     }
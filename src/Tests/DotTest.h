@@ -22,11 +22,14 @@
 /*LICENSE_END*/
 #include "TestInterface.h"
 
+#include <vector>
+
 namespace caret {
 
     class DotTest : public TestInterface
     {
         void checkVal(const float& correct, const float& test, const AString& descrip);
+        void checkTile(const std::vector<double>& correct, const std::vector<double>& absSum, const std::vector<const float*>& rows, const int& length, const AString& descrip);
     public:
         DotTest(const AString& identifier);
         virtual void execute();
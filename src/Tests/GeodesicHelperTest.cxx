@@ -76,6 +76,11 @@ void GeodesicHelperTest::execute()
     {
         followData[i] = 1.0f + ((float)rand()) / RAND_MAX;
     }
+    vector<int32_t> allNodes(numNodes);
+    for (int i = 0; i < numNodes; ++i)
+    {
+        allNodes[i] = i;
+    }
     const int TEST_SAMPLES = 10;
     vector<float> distsNorm, distsQuarter, distsQuad;
     vector<int32_t> nodesNorm, nodesQuarter, nodesQuad;
@@ -95,5 +100,19 @@ void GeodesicHelperTest::execute()
         quadHelp->getPathFollowingData(startNode, endNode, followData.data(), nodesQuad, distsQuad);
         checkNodeLists(this, "Comparing normal to quarter areas, getPathFollowingData", nodesNorm, nodesQuarter);
         checkNodeLists(this, "Comparing normal to quad areas, getPathFollowingData", nodesNorm, nodesQuad);
+        
+        for (int smooth = 0; !failed() && smooth < 2; ++smooth)
+        {//whole surface uses a bucket queue, restricted uses the heap, distances must be identical
+            normalHelp->getGeoFromNode(startNode, distsNorm, smooth != 0);
+            normalHelp->getGeoToTheseNodes(startNode, allNodes, distsQuarter, smooth != 0);
+            for (int j = 0; j < numNodes; ++j)
+            {
+                if (distsNorm[j] != distsQuarter[j])
+                {
+                    setFailed("getGeoFromNode and getGeoToTheseNodes disagree at vertex " + AString::number(j) + ": " + AString::number(distsNorm[j]) + " vs " + AString::number(distsQuarter[j]));
+                    break;
+                }
+            }
+        }
     }
 }
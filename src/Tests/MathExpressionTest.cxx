@@ -55,4 +55,26 @@ void MathExpressionTest::execute()
     {
         setFailed("output value incorrect, expected " + AString::number(correctresult) + ", got " + AString::number(testresult));
     }
+    const int ROWLENGTH = 1000;//more than one evaluation block, and not a multiple of it
+    vector<float> row0(ROWLENGTH), row1(ROWLENGTH), rowOut(ROWLENGTH);
+    for (int i = 0; i < ROWLENGTH; ++i)
+    {
+        row0[i] = (i - 500) / 100.0f;
+        row1[i] = (i % 37) / 7.0f - 2.5f;
+    }
+    vector<const float*> rowPointers(2);
+    rowPointers[0] = row0.data();
+    rowPointers[1] = row1.data();
+    myExpr.evaluateRow(rowPointers, rowOut.data(), ROWLENGTH);
+    for (int i = 0; i < ROWLENGTH; ++i)
+    {
+        vars[0] = row0[i];
+        vars[1] = row1[i];
+        float expected = (float)myExpr.evaluate(vars);
+        if (rowOut[i] != expected && !(rowOut[i] != rowOut[i] && expected != expected))//compiled evaluation should match exactly, including NaNs
+        {
+            setFailed("row evaluation mismatch at element " + AString::number(i) + ", expected " + AString::number(expected) + ", got " + AString::number(rowOut[i]));
+            break;
+        }
+    }
 }
@@ -38,6 +38,8 @@ void NiftiFileTest::execute()
     if(this->failed()) return;
     testNiftiReadWrite();
     if(this->failed()) return;
+    testCompressedRandomAccess();
+    if(this->failed()) return;
 }
 
 void NiftiFileTest::testNiftiReadWrite()
@@ -90,6 +92,50 @@ void NiftiFileTest::testNiftiReadWrite()
     std::cout << "Reading and writing of Nifti was successful for all frames." << std::endl;
 }
 
+void NiftiFileTest::testCompressedRandomAccess()
+{
+    std::cout << "Testing random access reading of compressed nifti." << std::endl;
+    NiftiIO reader;
+    AString inputFile = this->m_default_path + "/nifti/fcMRI1_nonlin_Subcortical_Smoothed_s6.nii";
+    reader.openRead(inputFile);
+    AString outFile = this->m_default_path + "/nifti/Nifti1TestOut.nii.gz";
+    NiftiIO writer;
+    writer.writeNew(outFile, reader.getHeader());
+    const vector<int64_t>& dims = reader.getDimensions();
+    if (dims.size() < 3)
+    {
+        setFailed("this test requires nifti files with 3 or more dimensions");
+        return;
+    }
+    int64_t frameLength = dims[0] * dims[1] * dims[2] * reader.getNumComponents();
+    vector<float> frame(frameLength), frameTest(frameLength);
+    vector<int64_t> extraDims(dims.begin() + 3, dims.end());
+    vector<vector<int64_t> > frameIndices;
+    for(MultiDimIterator<int64_t> iter(extraDims); !iter.atEnd(); ++iter)
+    {
+        reader.readData(frame.data(), 3, *iter);
+        writer.writeData(frame.data(), 3, *iter);
+        frameIndices.push_back(*iter);
+    }
+    writer.close();
+    NiftiIO test;
+    test.openRead(outFile);
+    for (int64_t i = (int64_t)frameIndices.size() - 1; i >= 0; --i)//backwards, to make sure we aren't relying on sequential decompression
+    {
+        reader.readData(frame.data(), 3, frameIndices[i]);
+        test.readData(frameTest.data(), 3, frameIndices[i]);
+        for(int64_t j = 0; j < frameLength; j++)
+        {
+            if(frame[j]>frameTest[j]+0.0001 || frame[j]<frameTest[j]-0.0001)
+            {
+                this->setFailed("Input and compressed output nifti file frames are not the same.");
+                return;
+            }
+        }
+    }
+    std::cout << "Random access reading of compressed Nifti was successful for all frames." << std::endl;
+}
+
 //Tests for reading and writing Nifti Headers
 
 NiftiHeaderTest::NiftiHeaderTest(const AString &identifier) : TestInterface(identifier)
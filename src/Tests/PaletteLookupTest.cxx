@@ -0,0 +1,163 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "PaletteLookupTest.h"
+
+#include "Palette.h"
+#include "PaletteFile.h"
+#include "PaletteLookupTable.h"
+#include "PaletteScalarAndColor.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+PaletteLookupTest::PaletteLookupTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    //scalars where the table is most likely to differ from the palette: bin edges, palette scalars, and the ends of the range, with their neighbors
+    vector<float> getTestScalars(const Palette* palette)
+    {
+        vector<float> ret;
+        const int NUM_BINS = 8192;
+        for (int i = 0; i <= NUM_BINS; ++i)
+        {
+            ret.push_back(-1.0f + i / (NUM_BINS / 2.0f));
+        }
+        for (int i = 0; i < palette->getNumberOfScalarsAndColors(); ++i)
+        {
+            ret.push_back(palette->getScalarAndColor(i)->getScalar());
+        }
+        ret.push_back(-1.5f);
+        ret.push_back(1.5f);
+        ret.push_back(0.0f);
+        ret.push_back(-0.0f);
+        int numExact = (int)ret.size();
+        for (int i = 0; i < numExact; ++i)
+        {
+            ret.push_back(nextafter(ret[i], 2.0f));
+            ret.push_back(nextafter(ret[i], -2.0f));
+        }
+        for (int i = 0; i < 20000; ++i)
+        {
+            ret.push_back(-1.2f + 2.4f * (rand() / (float)RAND_MAX));
+        }
+        ret.push_back(numeric_limits<float>::quiet_NaN());
+        return ret;
+    }
+    
+    void setColors(Palette& palette)
+    {//arbitrary colors, so interpolation isn't between simple values
+        for (int i = 0; i < palette.getNumberOfScalarsAndColors(); ++i)
+        {
+            float rgba[4] = { (i * 37 % 101) / 100.0f, (i * 59 % 103) / 102.0f, 1.0f / (i + 3.0f), 1.0f };
+            palette.getScalarAndColor(i)->setColor(rgba);
+        }
+    }
+}
+
+void PaletteLookupTest::comparePalette(const Palette* palette, const AString& description)
+{
+    vector<float> scalars = getTestScalars(palette);
+    for (int interp = 0; interp < 2; ++interp)
+    {
+        shared_ptr<const PaletteLookupTable> table = PaletteLookupTable::getLookupTable(palette, interp == 1);
+        for (size_t i = 0; i < scalars.size(); ++i)
+        {
+            float expected[4], found[4];
+            palette->getPaletteColor(scalars[i], interp == 1, expected);
+            table->getPaletteColor(scalars[i], found);
+            if (memcmp(expected, found, sizeof(expected)) != 0)
+            {
+                setFailed("lookup table color differs from palette '" + description + "' at scalar " + AString::number(scalars[i], 'g', 9) +
+                          (interp == 1 ? " with" : " without") + " interpolation");
+                break;
+            }
+        }
+    }
+}
+
+void PaletteLookupTest::execute()
+{
+    PaletteFile myPaletteFile;//contains the default palettes
+    for (int i = 0; i < myPaletteFile.getNumberOfPalettes(); ++i)
+    {
+        const Palette* palette = myPaletteFile.getPalette(i);
+        comparePalette(palette, palette->getName());
+        comparePalette(palette->getInvertedPalette(), palette->getName() + " inverted");
+    }
+    Palette custom;//none color, repeated scalars, and scalars that aren't on bin edges
+    custom.setName("custom");
+    custom.addScalarAndColor(1.0f, "red");
+    custom.addScalarAndColor(0.7f, "orange");
+    custom.addScalarAndColor(0.33333334f, "yellow");
+    custom.addScalarAndColor(0.33333334f, "green");
+    custom.addScalarAndColor(0.0001f, "none");
+    custom.addScalarAndColor(-0.0001f, "blue");
+    custom.addScalarAndColor(-0.6f, "none");
+    custom.addScalarAndColor(-0.61f, "purple");
+    custom.addScalarAndColor(-1.0f, "black");
+    setColors(custom);
+    comparePalette(&custom, "custom");
+    Palette twoColor, oneColor, empty;
+    twoColor.addScalarAndColor(0.5f, "white");
+    twoColor.addScalarAndColor(-0.25f, "black");
+    setColors(twoColor);
+    comparePalette(&twoColor, "two colors");
+    oneColor.addScalarAndColor(0.0f, "white");
+    setColors(oneColor);
+    comparePalette(&oneColor, "one color");
+    comparePalette(&empty, "empty");
+    
+    shared_ptr<const PaletteLookupTable> first = PaletteLookupTable::getLookupTable(&custom, true);
+    if (PaletteLookupTable::getLookupTable(&custom, true) != first) setFailed("lookup table was rebuilt for an unchanged palette");
+    if (PaletteLookupTable::getLookupTable(&custom, false) == first) setFailed("same lookup table was used with and without interpolation");
+    float newColor[4] = { 0.25f, 0.5f, 0.75f, 1.0f };
+    custom.getScalarAndColor(1)->setColor(newColor);//changes the color without the palette knowing
+    if (PaletteLookupTable::getLookupTable(&custom, true) == first) setFailed("lookup table was not rebuilt for a changed palette");
+    comparePalette(&custom, "custom changed");
+    
+    Palette* temporary = new Palette(custom);//tables must not refer to a deleted palette
+    temporary->getScalarAndColor(2)->setColor(newColor);
+    Palette reference(*temporary);
+    shared_ptr<const PaletteLookupTable> orphan = PaletteLookupTable::getLookupTable(temporary, true);
+    delete temporary;
+    vector<float> scalars = getTestScalars(&reference);
+    for (size_t i = 0; i < scalars.size(); ++i)
+    {
+        float expected[4], found[4];
+        reference.getPaletteColor(scalars[i], true, expected);
+        orphan->getPaletteColor(scalars[i], found);
+        if (memcmp(expected, found, sizeof(expected)) != 0)
+        {
+            setFailed("lookup table of a deleted palette changed colors at scalar " + AString::number(scalars[i], 'g', 9));
+            break;
+        }
+    }
+}
@@ -0,0 +1,303 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "PointLocatorTest.h"
+#include "CaretPointLocator.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <set>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+PointLocatorTest::PointLocatorTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    float randomFloat(const float& low, const float& high)
+    {
+        return low + (high - low) * (rand() / (float)RAND_MAX);
+    }
+    
+    float distSquared(const float* point, const float* target)
+    {
+        double dx = point[0] - target[0], dy = point[1] - target[1], dz = point[2] - target[2];
+        return (float)(dx * dx + dy * dy + dz * dz);
+    }
+    
+    //brute force answers over all points in the sets that haven't been removed
+    struct BruteForce
+    {
+        vector<const vector<float>*> m_sets;
+        
+        float closestDist2(const float* target) const
+        {
+            float ret = numeric_limits<float>::infinity();
+            for (int s = 0; s < (int)m_sets.size(); ++s)
+            {
+                if (m_sets[s] == NULL) continue;
+                const vector<float>& coords = *(m_sets[s]);
+                for (size_t i = 0; i < coords.size(); i += 3)
+                {
+                    ret = min(ret, distSquared(coords.data() + i, target));
+                }
+            }
+            return ret;
+        }
+        
+        set<LocatorInfo> inRange(const float* target, const float& maxDist) const
+        {
+            set<LocatorInfo> ret;
+            for (int s = 0; s < (int)m_sets.size(); ++s)
+            {
+                if (m_sets[s] == NULL) continue;
+                const vector<float>& coords = *(m_sets[s]);
+                for (size_t i = 0; i < coords.size(); i += 3)
+                {
+                    if (distSquared(coords.data() + i, target) <= maxDist * maxDist) ret.insert(LocatorInfo(i / 3, s, Vector3D(coords.data() + i)));
+                }
+            }
+            return ret;
+        }
+    };
+    
+    //distances are computed in double here, but in float in the locator, so allow a little difference
+    bool closeEnough(const float& found, const float& expected)
+    {
+        return abs(found - expected) <= 1e-5f * max(1.0f, expected);
+    }
+}
+
+void PointLocatorTest::execute()
+{
+    testRandomPoints();
+    testLimitDistance();
+}
+
+void PointLocatorTest::testRandomPoints()
+{
+    const int NUM_POINTS = 3000, NUM_TARGETS = 500;
+    vector<float> firstSet(NUM_POINTS * 3), secondSet;
+    for (int i = 0; i < NUM_POINTS * 3; ++i)
+    {
+        firstSet[i] = randomFloat(-50.0f, 50.0f);
+    }
+    for (int i = 0; i < 200; ++i)
+    {//coincident points and a plane of equal x values, so splits have lots of ties
+        int which = rand() % NUM_POINTS;
+        secondSet.insert(secondSet.end(), firstSet.begin() + which * 3, firstSet.begin() + which * 3 + 3);
+        secondSet.push_back(10.0f);
+        secondSet.push_back(randomFloat(-50.0f, 50.0f));
+        secondSet.push_back(randomFloat(-50.0f, 50.0f));
+    }
+    CaretPointLocator myLocator(firstSet);
+    int32_t secondIndex = myLocator.addPointSet(secondSet);
+    BruteForce myBrute;
+    myBrute.m_sets.resize(secondIndex + 1, NULL);
+    myBrute.m_sets[0] = &firstSet;
+    myBrute.m_sets[secondIndex] = &secondSet;
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        if (pass == 1)
+        {//removing a set rebuilds the tree without it
+            myLocator.removePointSet(0);
+            myBrute.m_sets[0] = NULL;
+        }
+        vector<float> targets(NUM_TARGETS * 3);
+        for (int i = 0; i < NUM_TARGETS * 3; ++i)
+        {
+            targets[i] = randomFloat(-70.0f, 70.0f);//some targets are outside the points' bounding box
+        }
+        const float LIMIT = 4.0f;
+        vector<int64_t> batchIndices(NUM_TARGETS), batchLimited(NUM_TARGETS);
+        vector<LocatorInfo> batchInfo(NUM_TARGETS);
+        myLocator.closestPoints(targets.data(), NUM_TARGETS, batchIndices.data(), batchInfo.data());
+        myLocator.closestPoints(targets.data(), NUM_TARGETS, batchLimited.data(), NULL, LIMIT);
+        for (int t = 0; t < NUM_TARGETS; ++t)
+        {
+            const float* target = targets.data() + t * 3;
+            AString where = "pass " + AString::number(pass) + ", target " + AString::number(t);
+            float expected = myBrute.closestDist2(target);
+            LocatorInfo myInfo;
+            int64_t found = myLocator.closestPoint(target, &myInfo);
+            if (found < 0 || myInfo.index != found || myInfo.whichSet < 0 || myInfo.whichSet >= (int32_t)myBrute.m_sets.size() || myBrute.m_sets[myInfo.whichSet] == NULL)
+            {
+                setFailed("closestPoint returned an invalid point at " + where);
+                continue;
+            }
+            const float* foundCoords = myBrute.m_sets[myInfo.whichSet]->data() + found * 3;
+            if (myInfo.coords[0] != foundCoords[0] || myInfo.coords[1] != foundCoords[1] || myInfo.coords[2] != foundCoords[2])
+            {
+                setFailed("closestPoint returned the wrong coordinates at " + where);
+            }
+            if (!closeEnough(distSquared(foundCoords, target), expected))
+            {
+                setFailed("closestPoint didn't find the closest point at " + where);
+            }
+            if (batchIndices[t] != found || !(batchInfo[t] == myInfo))
+            {
+                setFailed("closestPoints doesn't match closestPoint at " + where);
+            }
+            int64_t limited = myLocator.closestPointLimited(target, LIMIT, &myInfo);
+            if (expected <= LIMIT * LIMIT * (1.0f - 1e-5f))
+            {
+                if (limited < 0 || !closeEnough(distSquared(myBrute.m_sets[myInfo.whichSet]->data() + limited * 3, target), expected))
+                {
+                    setFailed("closestPointLimited didn't find the closest point at " + where);
+                }
+            } else if (expected > LIMIT * LIMIT * (1.0f + 1e-5f)) {
+                if (limited != -1 || myInfo.index != -1 || myInfo.whichSet != -1)
+                {
+                    setFailed("closestPointLimited found a point beyond the limit at " + where);
+                }
+            }//don't test within rounding of the limit here, that is tested on exact values
+            if (batchLimited[t] != limited)
+            {
+                setFailed("closestPoints with a limit doesn't match closestPointLimited at " + where);
+            }
+            float radius = randomFloat(0.0f, 15.0f);
+            vector<LocatorInfo> inRange = myLocator.pointsInRange(target, radius);
+            set<LocatorInfo> foundSet(inRange.begin(), inRange.end()), expectedSet = myBrute.inRange(target, radius);
+            if (foundSet.size() != inRange.size())
+            {
+                setFailed("pointsInRange returned duplicate points at " + where);
+            }
+            for (set<LocatorInfo>::const_iterator iter = foundSet.begin(); iter != foundSet.end(); ++iter)
+            {
+                if (iter->whichSet < 0 || iter->whichSet >= (int32_t)myBrute.m_sets.size() || myBrute.m_sets[iter->whichSet] == NULL)
+                {
+                    setFailed("pointsInRange returned an invalid point at " + where);
+                    break;
+                }
+                if (expectedSet.find(*iter) == expectedSet.end() &&
+                    !closeEnough(distSquared(myBrute.m_sets[iter->whichSet]->data() + iter->index * 3, target), radius * radius))
+                {
+                    setFailed("pointsInRange returned a point that is out of range at " + where);
+                }
+            }
+            for (set<LocatorInfo>::const_iterator iter = expectedSet.begin(); iter != expectedSet.end(); ++iter)
+            {
+                if (foundSet.find(*iter) == foundSet.end() &&
+                    !closeEnough(distSquared(myBrute.m_sets[iter->whichSet]->data() + iter->index * 3, target), radius * radius))
+                {
+                    setFailed("pointsInRange missed a point that is in range at " + where);
+                }
+            }
+            if (!closeEnough(expected, radius * radius) && myLocator.anyInRange(target, radius) != (expected < radius * radius))
+            {
+                setFailed("anyInRange is wrong at " + where);
+            }
+        }
+    }
+    CaretPointLocator emptyLocator(firstSet);
+    emptyLocator.removePointSet(0);
+    LocatorInfo emptyInfo;
+    float origin[3] = { 0.0f, 0.0f, 0.0f };
+    if (emptyLocator.closestPoint(origin, &emptyInfo) != -1 || emptyInfo.index != -1 || emptyInfo.whichSet != -1 ||
+        emptyLocator.closestPointLimited(origin, 1000.0f) != -1 || emptyLocator.pointsInRange(origin, 1000.0f).size() != 0 || emptyLocator.anyInRange(origin, 1000.0f))
+    {
+        setFailed("empty point locator found a point");
+    }
+}
+
+void PointLocatorTest::testLimitDistance()
+{//integer coordinates, so squared distances are exact
+    const int SIDE = 10;
+    vector<float> grid;
+    for (int k = 0; k < SIDE; ++k)
+    {
+        for (int j = 0; j < SIDE; ++j)
+        {
+            for (int i = 0; i < SIDE; ++i)
+            {
+                grid.push_back(i);
+                grid.push_back(j);
+                grid.push_back(k);
+            }
+        }
+    }
+    CaretPointLocator myLocator(grid);
+    BruteForce myBrute;
+    myBrute.m_sets.push_back(&grid);
+    const float targets[][3] = { { 3.0f, 4.0f, -5.0f },//closest is (3, 4, 0) at distance 5
+                                 { -3.0f, 5.0f, 5.0f },//closest is (0, 5, 5) at distance 3, and inside the grid's y and z range
+                                 { 12.0f, 13.0f, 9.0f },//closest is (9, 9, 9) at distance 5
+                                 { 4.0f, 4.0f, 4.0f } };//on a grid point, distance 0
+    const float distances[] = { 5.0f, 3.0f, 5.0f, 0.0f };
+    const float BIG = numeric_limits<float>::infinity();
+    for (int t = 0; t < 4; ++t)
+    {
+        const float* target = targets[t];
+        AString where = "target " + AString::number(t);
+        if (myBrute.closestDist2(target) != distances[t] * distances[t])
+        {
+            setFailed("limit test has the wrong expected distance at " + where);
+            continue;
+        }
+        LocatorInfo myInfo;
+        int64_t found = myLocator.closestPointLimited(target, distances[t], &myInfo);
+        if (found < 0 || distSquared(grid.data() + found * 3, target) != distances[t] * distances[t])
+        {
+            setFailed("closestPointLimited didn't accept a point exactly at the limit at " + where);
+        }
+        if (distances[t] > 0.0f)
+        {
+            found = myLocator.closestPointLimited(target, nextafter(distances[t], 0.0f), &myInfo);
+            if (found != -1 || myInfo.index != -1)
+            {
+                setFailed("closestPointLimited accepted a point just beyond the limit at " + where);
+            }
+        }
+        if (myLocator.closestPointLimited(target, nextafter(distances[t], BIG)) < 0)
+        {
+            setFailed("closestPointLimited didn't find a point just within the limit at " + where);
+        }
+        int64_t limitedIndex[2];
+        const float limits[2] = { distances[t], nextafter(distances[t], 0.0f) };
+        myLocator.closestPoints(target, 1, limitedIndex, NULL, limits[0]);
+        myLocator.closestPoints(target, 1, limitedIndex + 1, NULL, limits[1]);
+        if (limitedIndex[0] < 0 || (distances[t] > 0.0f && limitedIndex[1] != -1))
+        {
+            setFailed("closestPoints with a limit doesn't handle points exactly at the limit at " + where);
+        }
+        vector<LocatorInfo> inRange = myLocator.pointsInRange(target, distances[t]);//includes points exactly at the distance
+        set<LocatorInfo> foundSet(inRange.begin(), inRange.end());
+        if (foundSet.size() != inRange.size() || foundSet != myBrute.inRange(target, distances[t]))
+        {
+            setFailed("pointsInRange doesn't match brute force at the limit at " + where);
+        }
+    }
+    float below[3] = { 4.5f, 4.5f, -1.0f };//equidistant from 4 grid points, at squared distance 1.5, the next closest are at 3.5
+    LocatorInfo myInfo;
+    int64_t found = myLocator.closestPoint(below, &myInfo);
+    if (found < 0 || myInfo.coords[2] != 0.0f || (myInfo.coords[0] != 4.0f && myInfo.coords[0] != 5.0f) || (myInfo.coords[1] != 4.0f && myInfo.coords[1] != 5.0f))
+    {
+        setFailed("closestPoint didn't find one of the tied closest points");
+    }
+    if (myLocator.pointsInRange(below, 1.5f).size() != 4)
+    {
+        setFailed("pointsInRange didn't find all of the tied closest points");
+    }
+}
@@ -18,10 +18,14 @@
  */
 /*LICENSE_END*/
 #include "StatisticsTest.h"
+#include <algorithm>
 #include <cstdlib>
 #include <cmath>
+#include <sstream>
 
+#include "DataBlockSource.h"
 #include "FastStatistics.h"
+#include "Histogram.h"
 #include "DescriptiveStatistics.h"
 
 using namespace caret;
@@ -76,4 +80,95 @@ void StatisticsTest::execute()
     {
         setFailed(AString("mismatch in 90% negative percentile, full: ") + AString::number(myFullStats.getNegativePercentile(90.0f)) + ", fast: " + AString::number(myFastStats.getApproxNegativePercentile(90.0f)));
     }
+    const int BLOCK_SIZE = 12345;//not a divisor of the data size, so the last block is short
+    DataBlockSource myBlocks([&](const int64_t& block, vector<float>& dataOut)
+                             {
+                                 int64_t start = block * BLOCK_SIZE, end = min((int64_t)NUM_ELEMENTS, start + BLOCK_SIZE);
+                                 dataOut.assign(myData.begin() + start, myData.begin() + end);
+                             }, (NUM_ELEMENTS + BLOCK_SIZE - 1) / BLOCK_SIZE);
+    FastStatistics myBlockStats;
+    myBlockStats.update(myBlocks);
+    if (myBlockStats.getMin() != myFastStats.getMin() || myBlockStats.getMax() != myFastStats.getMax())
+    {
+        setFailed(AString("mismatch in range, blocks: ") + AString::number(myBlockStats.getMin()) + " to " + AString::number(myBlockStats.getMax()));
+    }
+    if (abs(myBlockStats.getMean() - myFastStats.getMean()) > exacttolerance)
+    {
+        setFailed(AString("mismatch in mean, blocks: ") + AString::number(myBlockStats.getMean()) + ", fast: " + AString::number(myFastStats.getMean()));
+    }
+    if (abs(myBlockStats.getPopulationStdDev() - myFastStats.getPopulationStdDev()) > exacttolerance)
+    {
+        setFailed(AString("mismatch in population stddev, blocks: ") + AString::number(myBlockStats.getPopulationStdDev()) + ", fast: " + AString::number(myFastStats.getPopulationStdDev()));
+    }
+    if (myBlockStats.getApproxPositivePercentile(90.0f) != myFastStats.getApproxPositivePercentile(90.0f)
+        || myBlockStats.getApproxNegativePercentile(90.0f) != myFastStats.getApproxNegativePercentile(90.0f))
+    {
+        setFailed(AString("mismatch in 90% percentiles, blocks: ") + AString::number(myBlockStats.getApproxPositivePercentile(90.0f)) + ", " + AString::number(myBlockStats.getApproxNegativePercentile(90.0f)));
+    }
+    ostringstream binaryOut;//the file statistics cache stores this, and must reject damaged data
+    myBlockStats.writeBinary(binaryOut);
+    const string binaryStats = binaryOut.str();
+    FastStatistics readStats;
+    istringstream binaryIn(binaryStats);
+    if (!readStats.readBinary(binaryIn) || binaryIn.peek() != char_traits<char>::eof())
+    {
+        setFailed("failed to read binary statistics");
+    } else {
+        if (readStats.getMin() != myBlockStats.getMin() || readStats.getMax() != myBlockStats.getMax() || readStats.getMean() != myBlockStats.getMean() ||
+            readStats.getApproxPositivePercentile(90.0f) != myBlockStats.getApproxPositivePercentile(90.0f) ||
+            readStats.getApproxNegativePercentile(90.0f) != myBlockStats.getApproxNegativePercentile(90.0f))
+        {
+            setFailed("mismatch in statistics read from binary");
+        }
+    }
+    istringstream truncatedIn(binaryStats.substr(0, binaryStats.size() - 1));
+    if (readStats.readBinary(truncatedIn))
+    {
+        setFailed("truncated binary statistics were accepted");
+    }
+    string negativeStats = binaryStats;
+    const int64_t negativeCount = -1;
+    negativeStats.replace(11 * sizeof(float), sizeof(negativeCount), (const char*)&negativeCount, sizeof(negativeCount));//first count after the values
+    istringstream negativeIn(negativeStats);
+    if (readStats.readBinary(negativeIn))
+    {
+        setFailed("binary statistics with a negative count were accepted");
+    }
+    vector<float> histData = myData;//exact values for the degenerate ranges, and values that are never in a histogram
+    for (int i = 0; i < NUM_ELEMENTS; i += 97) histData[i] = 5.0f;
+    for (int i = 50; i < NUM_ELEMENTS; i += 101) histData[i] = 0.0f;
+    histData[7] = sqrt(-1.0f);
+    histData[8] = 1.0f / 0.0f;
+    histData[9] = -1.0f / 0.0f;
+    DataBlockSource myHistBlocks([&](const int64_t& block, vector<float>& dataOut)
+                                 {
+                                     int64_t start = block * BLOCK_SIZE, end = min((int64_t)NUM_ELEMENTS, start + BLOCK_SIZE);
+                                     dataOut.assign(histData.begin() + start, histData.begin() + end);
+                                 }, (NUM_ELEMENTS + BLOCK_SIZE - 1) / BLOCK_SIZE);
+    const int NUM_LIMITS = 4;
+    const float limits[NUM_LIMITS][4] = { { 40.0f, 1.0f, -1.0f, -40.0f },
+                                          { 5.0f, 5.0f, 0.0f, 0.0f },//degenerate ranges only count the values equal to the range
+                                          { 0.0f, 0.0f, -5.0f, -5.0f },
+                                          { 0.0f, 0.0f, 0.0f, 0.0f } };
+    for (int l = 0; l < NUM_LIMITS; ++l)
+    {
+        for (int includeZero = 0; includeZero < 2; ++includeZero)
+        {
+            Histogram arrayHist, blockHist;
+            arrayHist.update(50, histData.data(), NUM_ELEMENTS, limits[l][0], limits[l][1], limits[l][2], limits[l][3], includeZero == 1);
+            blockHist.update(50, myHistBlocks, limits[l][0], limits[l][1], limits[l][2], limits[l][3], includeZero == 1);
+            int64_t arrayCounts[6], blockCounts[6];
+            arrayHist.getCounts(arrayCounts[0], arrayCounts[1], arrayCounts[2], arrayCounts[3], arrayCounts[4], arrayCounts[5]);
+            blockHist.getCounts(blockCounts[0], blockCounts[1], blockCounts[2], blockCounts[3], blockCounts[4], blockCounts[5]);
+            float arrayRange[2], blockRange[2];
+            arrayHist.getRange(arrayRange[0], arrayRange[1]);
+            blockHist.getRange(blockRange[0], blockRange[1]);
+            if (!equal(arrayCounts, arrayCounts + 6, blockCounts) || arrayRange[0] != blockRange[0] || arrayRange[1] != blockRange[1] ||
+                arrayHist.getHistogramCounts() != blockHist.getHistogramCounts() || arrayHist.getHistogramDisplay() != blockHist.getHistogramDisplay())
+            {
+                setFailed("mismatch in limited histogram from blocks, range " + AString::number(limits[l][3]) + " to " + AString::number(limits[l][0]) +
+                          (includeZero == 1 ? " with" : " without") + " zeros");
+            }
+        }
+    }
 }
@@ -0,0 +1,242 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "TFCETest.h"
+#include "TFCEHelper.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+TFCETest::TFCETest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    //integral of e(h, p)^E * h^H * dh straight from the definition: the extent is constant between consecutive data values, so find the clusters at every value
+    void bruteForceTFCE(const vector<vector<int64_t> >& neighbors, const vector<float>& sizes, const vector<float>& data, const vector<float>& roi,
+                        const float& param_e, const float& param_h, vector<double>& outData)
+    {
+        int64_t numElements = (int64_t)data.size();
+        outData.assign(numElements, 0.0);
+        for (int sign = 1; sign >= -1; sign -= 2)
+        {
+            vector<float> levels;
+            for (int64_t i = 0; i < numElements; ++i)
+            {
+                if (roi[i] > 0.0f && sign * data[i] > 0.0f) levels.push_back(sign * data[i]);
+            }
+            sort(levels.begin(), levels.end());
+            levels.erase(unique(levels.begin(), levels.end()), levels.end());
+            double lastLevel = 0.0;
+            for (size_t l = 0; l < levels.size(); ++l)
+            {//for h in (lastLevel, levels[l]], the elements at or above levels[l] are above the threshold
+                double slice = (pow((double)levels[l], param_h + 1.0) - pow(lastLevel, param_h + 1.0)) / (param_h + 1.0);
+                vector<int64_t> cluster(numElements, -1);
+                for (int64_t seed = 0; seed < numElements; ++seed)
+                {
+                    if (roi[seed] <= 0.0f || sign * data[seed] < levels[l] || cluster[seed] != -1) continue;
+                    vector<int64_t> members(1, seed);
+                    cluster[seed] = seed;
+                    double extent = 0.0;
+                    for (size_t m = 0; m < members.size(); ++m)
+                    {
+                        extent += sizes[members[m]];
+                        const vector<int64_t>& elemNeighbors = neighbors[members[m]];
+                        for (size_t n = 0; n < elemNeighbors.size(); ++n)
+                        {
+                            int64_t neighbor = elemNeighbors[n];
+                            if (roi[neighbor] <= 0.0f || sign * data[neighbor] < levels[l] || cluster[neighbor] != -1) continue;
+                            cluster[neighbor] = seed;
+                            members.push_back(neighbor);
+                        }
+                    }
+                    for (size_t m = 0; m < members.size(); ++m)
+                    {
+                        outData[members[m]] += sign * pow(extent, (double)param_e) * slice;
+                    }
+                }
+                lastLevel = levels[l];
+            }
+        }
+    }
+    
+    //values are small integers so there are many ties, both within clusters and between the clusters that merge
+    vector<float> randomTiedData(const int64_t& numElements)
+    {
+        vector<float> ret(numElements);
+        for (int64_t i = 0; i < numElements; ++i)
+        {
+            ret[i] = (float)(rand() % 9 - 4);
+        }
+        return ret;
+    }
+    
+    bool closeEnough(const float& found, const double& expected)
+    {
+        return abs(found - expected) <= 1e-5 * max(1.0, abs(expected));
+    }
+    
+    const int NUM_PARAMS = 3;
+    const float PARAMS[NUM_PARAMS][2] = { { 0.5f, 2.0f }, { 1.0f, 1.0f }, { 0.66f, 3.5f } };
+}
+
+void TFCETest::execute()
+{
+    testSurface();
+    testVolume();
+}
+
+void TFCETest::testSurface()
+{//a triangulated grid with irregular neighbor counts, random areas, and an roi that cuts some clusters apart
+    const int64_t ROWS = 9, COLS = 11, numElements = ROWS * COLS;
+    vector<vector<int64_t> > neighbors(numElements);
+    for (int64_t r = 0; r < ROWS; ++r)
+    {
+        for (int64_t c = 0; c < COLS; ++c)
+        {
+            int64_t index = r * COLS + c;
+            if (c + 1 < COLS)
+            {
+                neighbors[index].push_back(index + 1);
+                neighbors[index + 1].push_back(index);
+            }
+            if (r + 1 < ROWS)
+            {
+                neighbors[index].push_back(index + COLS);
+                neighbors[index + COLS].push_back(index);
+                if (c + 1 < COLS && (r + c) % 3 != 0)
+                {
+                    neighbors[index].push_back(index + COLS + 1);
+                    neighbors[index + COLS + 1].push_back(index);
+                }
+            }
+        }
+    }
+    vector<int64_t> neighborStart(numElements + 1);
+    vector<int32_t> flatNeighbors;
+    vector<float> sizes(numElements), roi(numElements);
+    for (int64_t i = 0; i < numElements; ++i)
+    {
+        neighborStart[i] = (int64_t)flatNeighbors.size();
+        flatNeighbors.insert(flatNeighbors.end(), neighbors[i].begin(), neighbors[i].end());
+        sizes[i] = 0.5f + (rand() % 8) * 0.25f;
+        roi[i] = (rand() % 10 == 0 ? 0.0f : 1.0f);
+    }
+    neighborStart[numElements] = (int64_t)flatNeighbors.size();
+    TFCEHelper withRoi(neighborStart, flatNeighbors, sizes, roi.data()), noRoi(neighborStart, flatNeighbors, sizes);
+    const vector<float> fullRoi(numElements, 1.0f);
+    const int NUM_COLUMNS = 8;
+    for (int p = 0; p < NUM_PARAMS; ++p)
+    {
+        vector<vector<float> > columns(NUM_COLUMNS), outColumns(NUM_COLUMNS, vector<float>(numElements));
+        vector<const float*> inPointers(NUM_COLUMNS);
+        vector<float*> outPointers(NUM_COLUMNS);
+        for (int col = 0; col < NUM_COLUMNS; ++col)
+        {
+            columns[col] = randomTiedData(numElements);
+            inPointers[col] = columns[col].data();
+            outPointers[col] = outColumns[col].data();
+        }
+        withRoi.computeColumns(inPointers, outPointers, PARAMS[p][0], PARAMS[p][1]);
+        for (int col = 0; col < NUM_COLUMNS; ++col)
+        {
+            vector<double> expected, expectedNoRoi;
+            bruteForceTFCE(neighbors, sizes, columns[col], roi, PARAMS[p][0], PARAMS[p][1], expected);
+            bruteForceTFCE(neighbors, sizes, columns[col], fullRoi, PARAMS[p][0], PARAMS[p][1], expectedNoRoi);
+            vector<float> single(numElements), singleNoRoi(numElements);
+            withRoi.compute(columns[col].data(), single.data(), PARAMS[p][0], PARAMS[p][1]);
+            noRoi.compute(columns[col].data(), singleNoRoi.data(), PARAMS[p][0], PARAMS[p][1]);
+            AString where = "params " + AString::number(p) + ", column " + AString::number(col);
+            for (int64_t i = 0; i < numElements; ++i)
+            {
+                if (!closeEnough(single[i], expected[i]))
+                {
+                    setFailed("surface TFCE doesn't match brute force at " + where + ", vertex " + AString::number(i) +
+                              ": " + AString::number(single[i]) + ", expected " + AString::number(expected[i]));
+                    return;
+                }
+                if (!closeEnough(singleNoRoi[i], expectedNoRoi[i]))
+                {
+                    setFailed("surface TFCE without roi doesn't match brute force at " + where + ", vertex " + AString::number(i));
+                    return;
+                }
+                if (outColumns[col][i] != single[i])
+                {
+                    setFailed("surface TFCE on many columns doesn't match single column at " + where + ", vertex " + AString::number(i));
+                    return;
+                }
+            }
+        }
+    }
+}
+
+void TFCETest::testVolume()
+{//odd sizes in each dimension, so a mistake in the neighbor index math doesn't cancel out
+    const int64_t dims[3] = { 7, 5, 4 };
+    const int64_t numElements = dims[0] * dims[1] * dims[2];
+    const float VOXEL_VOLUME = 1.5f;
+    vector<vector<int64_t> > neighbors(numElements);
+    for (int64_t k = 0; k < dims[2]; ++k)
+    {
+        for (int64_t j = 0; j < dims[1]; ++j)
+        {
+            for (int64_t i = 0; i < dims[0]; ++i)
+            {
+                int64_t index = i + dims[0] * (j + dims[1] * k);
+                if (i > 0) neighbors[index].push_back(index - 1);
+                if (i + 1 < dims[0]) neighbors[index].push_back(index + 1);
+                if (j > 0) neighbors[index].push_back(index - dims[0]);
+                if (j + 1 < dims[1]) neighbors[index].push_back(index + dims[0]);
+                if (k > 0) neighbors[index].push_back(index - dims[0] * dims[1]);
+                if (k + 1 < dims[2]) neighbors[index].push_back(index + dims[0] * dims[1]);
+            }
+        }
+    }
+    vector<float> sizes(numElements, VOXEL_VOLUME), roi(numElements);
+    for (int64_t i = 0; i < numElements; ++i)
+    {
+        roi[i] = (rand() % 8 == 0 ? 0.0f : 1.0f);
+    }
+    TFCEHelper myTFCE(dims, VOXEL_VOLUME, roi.data());
+    for (int p = 0; p < NUM_PARAMS; ++p)
+    {
+        for (int frame = 0; frame < 4; ++frame)
+        {
+            vector<float> data = randomTiedData(numElements), outData(numElements);
+            myTFCE.compute(data.data(), outData.data(), PARAMS[p][0], PARAMS[p][1]);
+            vector<double> expected;
+            bruteForceTFCE(neighbors, sizes, data, roi, PARAMS[p][0], PARAMS[p][1], expected);
+            for (int64_t i = 0; i < numElements; ++i)
+            {
+                if (!closeEnough(outData[i], expected[i]))
+                {
+                    setFailed("volume TFCE doesn't match brute force at params " + AString::number(p) + ", frame " + AString::number(frame) +
+                              ", voxel " + AString::number(i) + ": " + AString::number(outData[i]) + ", expected " + AString::number(expected[i]));
+                    return;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,398 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "WeightsFileTest.h"
+
+#include "CaretException.h"
+#include "RibbonMappingHelper.h"
+#include "SurfaceFile.h"
+#include "SurfaceResamplingHelper.h"
+#include "SystemUtilities.h"
+#include "Vector3D.h"
+#include "VolumeFile.h"
+#include "VolumeSpace.h"
+#include "WeightsFileHelper.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QTemporaryFile>
+
+#include <cmath>
+#include <map>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+WeightsFileTest::WeightsFileTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    //subdivided octahedron, rotated so different subdivisions don't share vertex positions
+    void makeSphere(SurfaceFile& sphereOut, const int& subdivisions, const float& angle)
+    {
+        vector<Vector3D> coords;
+        coords.push_back(Vector3D(1.0f, 0.0f, 0.0f));
+        coords.push_back(Vector3D(-1.0f, 0.0f, 0.0f));
+        coords.push_back(Vector3D(0.0f, 1.0f, 0.0f));
+        coords.push_back(Vector3D(0.0f, -1.0f, 0.0f));
+        coords.push_back(Vector3D(0.0f, 0.0f, 1.0f));
+        coords.push_back(Vector3D(0.0f, 0.0f, -1.0f));
+        const int32_t faces[8][3] = { { 0, 2, 4 }, { 2, 1, 4 }, { 1, 3, 4 }, { 3, 0, 4 }, { 2, 0, 5 }, { 1, 2, 5 }, { 3, 1, 5 }, { 0, 3, 5 } };//outward normals
+        vector<int32_t> tris(&faces[0][0], &faces[0][0] + 24);
+        for (int s = 0; s < subdivisions; ++s)
+        {
+            map<pair<int32_t, int32_t>, int32_t> midpoints;
+            vector<int32_t> newTris;
+            for (int t = 0; t < (int)tris.size(); t += 3)
+            {
+                int32_t mid[3];
+                for (int e = 0; e < 3; ++e)
+                {
+                    int32_t a = tris[t + e], b = tris[t + (e + 1) % 3];
+                    pair<int32_t, int32_t> edge(min(a, b), max(a, b));
+                    map<pair<int32_t, int32_t>, int32_t>::iterator iter = midpoints.find(edge);
+                    if (iter == midpoints.end())
+                    {
+                        mid[e] = (int32_t)coords.size();
+                        coords.push_back((coords[a] + coords[b]).normal());
+                        midpoints[edge] = mid[e];
+                    } else {
+                        mid[e] = iter->second;
+                    }
+                }
+                const int32_t pieces[12] = { tris[t], mid[0], mid[2],   mid[0], tris[t + 1], mid[1],   mid[2], mid[1], tris[t + 2],   mid[0], mid[1], mid[2] };
+                newTris.insert(newTris.end(), pieces, pieces + 12);
+            }
+            tris = newTris;
+        }
+        const float c = cos(angle), s = sin(angle);
+        sphereOut.setNumberOfNodesAndTriangles((int32_t)coords.size(), (int32_t)tris.size() / 3);
+        for (int i = 0; i < (int)coords.size(); ++i)
+        {//rotate around z, then x
+            Vector3D rotZ(c * coords[i][0] - s * coords[i][1], s * coords[i][0] + c * coords[i][1], coords[i][2]);
+            sphereOut.setCoordinate(i, 100.0f * rotZ[0], 100.0f * (c * rotZ[1] - s * rotZ[2]), 100.0f * (s * rotZ[1] + c * rotZ[2]));
+        }
+        for (int t = 0; t < (int)tris.size() / 3; ++t)
+        {
+            sphereOut.setTriangle(t, tris[t * 3], tris[t * 3 + 1], tris[t * 3 + 2]);
+        }
+    }
+    
+    //flat grid at height z, for ribbon mapping
+    void makeSheet(SurfaceFile& sheetOut, const float& z)
+    {
+        const int SIDE = 5;
+        sheetOut.setNumberOfNodesAndTriangles(SIDE * SIDE, (SIDE - 1) * (SIDE - 1) * 2);
+        for (int j = 0; j < SIDE; ++j)
+        {
+            for (int i = 0; i < SIDE; ++i)
+            {
+                sheetOut.setCoordinate(i + SIDE * j, 1.3f + 1.1f * i, 1.6f + 1.1f * j, z);
+            }
+        }
+        int t = 0;
+        for (int j = 0; j < SIDE - 1; ++j)
+        {
+            for (int i = 0; i < SIDE - 1; ++i)
+            {
+                int32_t corner = i + SIDE * j;
+                sheetOut.setTriangle(t++, corner, corner + 1, corner + SIDE + 1);
+                sheetOut.setTriangle(t++, corner, corner + SIDE + 1, corner + SIDE);
+            }
+        }
+    }
+    
+    AString makeKey(const AString& text)
+    {
+        QCryptographicHash myHash(QCryptographicHash::Sha1);
+        QByteArray bytes = text.toLatin1();
+        WeightsFileHelper::addToHash(myHash, bytes.constData(), bytes.size());
+        return WeightsFileHelper::getKey(myHash);
+    }
+    
+    //a file that is a valid weights file cut short
+    void writeTruncated(const AString& fromName, const AString& toName)
+    {
+        QFile fromFile(fromName), toFile(toName);
+        if (!fromFile.open(QIODevice::ReadOnly)) throw CaretException("failed to open '" + fromName + "'");
+        QByteArray contents = fromFile.readAll();
+        if (!toFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) throw CaretException("failed to open '" + toName + "'");
+        toFile.write(contents.constData(), contents.size() - 5);
+    }
+    
+    bool sameValues(const vector<float>& first, const vector<float>& second)
+    {
+        if (first.size() != second.size()) return false;
+        for (size_t i = 0; i < first.size(); ++i)
+        {
+            if (first[i] != second[i]) return false;
+        }
+        return true;
+    }
+    
+    AString makeTempName(QTemporaryFile& tempFile)
+    {
+        if (!tempFile.open()) throw CaretException("failed to create temporary file");
+        AString ret = tempFile.fileName();
+        tempFile.close();
+        return ret;
+    }
+}
+
+void WeightsFileTest::execute()
+{
+    try
+    {
+        testResampleWeights();
+        testRibbonWeights();
+        testRibbonApply();
+    } catch (CaretException& e) {
+        setFailed("weights file test threw: " + e.whatString());
+    }
+}
+
+void WeightsFileTest::testResampleWeights()
+{
+    SurfaceFile currentSphere, newSphere;
+    makeSphere(currentSphere, 3, 0.0f);
+    makeSphere(newSphere, 2, 0.3f);
+    int numCurrent = currentSphere.getNumberOfNodes(), numNew = newSphere.getNumberOfNodes();
+    vector<float> currentAreas, newAreas, roi(numCurrent), input(numCurrent);
+    currentSphere.computeNodeAreas(currentAreas);
+    newSphere.computeNodeAreas(newAreas);
+    for (int i = 0; i < numCurrent; ++i)
+    {
+        roi[i] = (i % 7 == 0 ? 0.0f : 2.0f);
+        input[i] = sin(i * 0.37f) * 10.0f;
+    }
+    QTemporaryFile tempFile(QDir::tempPath() + "/resample_weights_test_XXXXXX.bin"), truncFile(QDir::tempPath() + "/resample_weights_test_XXXXXX.bin");
+    AString fileName = makeTempName(tempFile), truncName = makeTempName(truncFile);
+    for (int method = 0; method < 2; ++method)
+    {
+        SurfaceResamplingMethodEnum::Enum myMethod = (method == 0 ? SurfaceResamplingMethodEnum::BARYCENTRIC : SurfaceResamplingMethodEnum::ADAP_BARY_AREA);
+        AString methodName = SurfaceResamplingMethodEnum::toName(myMethod);
+        SurfaceResamplingHelper fresh(myMethod, &currentSphere, &newSphere, currentAreas.data(), newAreas.data(), roi.data());
+        vector<float> freshOut(numNew), freshValid(numNew), testOut(numNew), testValid(numNew);
+        fresh.resampleNormal(input.data(), freshOut.data(), -1.0f);
+        fresh.getResampleValidROI(freshValid.data());
+        AString key = SurfaceResamplingHelper::computeWeightsKey(myMethod, &currentSphere, &newSphere, currentAreas.data(), newAreas.data(), roi.data());
+        fresh.writeWeights(fileName, key);
+        
+        SurfaceResamplingHelper loaded;
+        if (!loaded.readWeights(fileName, key))
+        {
+            setFailed(methodName + ": weights file was rejected for its own key");
+            continue;
+        }
+        loaded.resampleNormal(input.data(), testOut.data(), -1.0f);
+        loaded.getResampleValidROI(testValid.data());
+        if (!sameValues(freshOut, testOut) || !sameValues(freshValid, testValid)) setFailed(methodName + ": weights read from file don't match computed weights");
+        
+        vector<float> otherRoi(numCurrent, 1.0f);//a different roi mask must give a different key, and the file must be rejected for it
+        AString otherKey = SurfaceResamplingHelper::computeWeightsKey(myMethod, &currentSphere, &newSphere, currentAreas.data(), newAreas.data(), otherRoi.data());
+        if (otherKey == key) setFailed(methodName + ": different roi gave the same weights key");
+        if (loaded.readWeights(fileName, otherKey)) setFailed(methodName + ": weights file was accepted for a different key");
+        loaded.resampleNormal(input.data(), testOut.data(), -1.0f);
+        if (!sameValues(freshOut, testOut)) setFailed(methodName + ": rejected weights file changed the existing weights");
+        
+        writeTruncated(fileName, truncName);
+        bool threw = false;
+        try
+        {
+            loaded.readWeights(truncName, key);
+        } catch (CaretException&) {
+            threw = true;
+        }
+        if (!threw) setFailed(methodName + ": truncated weights file was accepted");
+        
+        AString cacheDir = QDir::tempPath() + "/resample_weights_cache_" + SystemUtilities::createUniqueID();
+        AString cacheName = WeightsFileHelper::getCacheFileName(cacheDir, "resample_weights_", key);
+        for (int pass = 0; pass < 3; ++pass)
+        {//compute and save, then load, then replace a corrupt file
+            if (pass == 2) writeTruncated(fileName, cacheName);
+            SurfaceResamplingHelper cached(myMethod, &currentSphere, &newSphere, currentAreas.data(), newAreas.data(), roi.data(), cacheDir);
+            cached.resampleNormal(input.data(), testOut.data(), -1.0f);
+            if (!sameValues(freshOut, testOut)) setFailed(methodName + ": weights from cache directory don't match computed weights, pass " + AString::number(pass));
+            SurfaceResamplingHelper check;
+            if (!QFile::exists(cacheName) || !check.readWeights(cacheName, key)) setFailed(methodName + ": cache directory doesn't have a valid weights file, pass " + AString::number(pass));
+        }
+        QFile::remove(cacheName);
+        QDir().rmdir(cacheDir);
+    }
+}
+
+void WeightsFileTest::testRibbonWeights()
+{
+    const int64_t dims[3] = { 8, 8, 8 };
+    const float sform[12] = { 1.0f, 0.0f, 0.0f, 0.0f,
+                              0.0f, 1.0f, 0.0f, 0.0f,
+                              0.0f, 0.0f, 1.0f, 0.0f };
+    VolumeSpace volSpace(dims, sform);
+    SurfaceFile inner, outer;
+    makeSheet(inner, 2.2f);
+    makeSheet(outer, 4.7f);
+    vector<vector<VoxelWeight> > nested;
+    RibbonMappingHelper::computeWeightsRibbon(nested, volSpace, &inner, &outer);
+    VoxelWeightMatrix fresh(nested, dims);
+    int64_t numVertices = fresh.getNumberOfVertices(), frameSize = dims[0] * dims[1] * dims[2];
+    vector<vector<float> > frames(3, vector<float>(frameSize)), freshOut(3, vector<float>(numVertices)), testOut(3, vector<float>(numVertices));
+    for (int f = 0; f < 3; ++f)
+    {
+        for (int64_t i = 0; i < frameSize; ++i)
+        {
+            frames[f][i] = cos(i * 0.11f + f);
+        }
+    }
+    const float* framePointers[3] = { frames[0].data(), frames[1].data(), frames[2].data() };
+    float* freshPointers[3] = { freshOut[0].data(), freshOut[1].data(), freshOut[2].data() };
+    float* testPointers[3] = { testOut[0].data(), testOut[1].data(), testOut[2].data() };
+    fresh.apply(framePointers, freshPointers, 3, true);
+    
+    QTemporaryFile tempFile(QDir::tempPath() + "/ribbon_weights_test_XXXXXX.bin"), truncFile(QDir::tempPath() + "/ribbon_weights_test_XXXXXX.bin");
+    AString fileName = makeTempName(tempFile), truncName = makeTempName(truncFile);
+    AString key = makeKey("ribbon weights test"), otherKey = makeKey("other ribbon weights");
+    fresh.writeFile(fileName, key);
+    VoxelWeightMatrix loaded;
+    if (!loaded.readFile(fileName, key))
+    {
+        setFailed("ribbon weights file was rejected for its own key");
+        return;
+    }
+    if (loaded.getNumberOfVertices() != numVertices)
+    {
+        setFailed("ribbon weights file has the wrong number of vertices");
+        return;
+    }
+    vector<VoxelWeight> freshWeights, testWeights;
+    for (int64_t v = 0; v < numVertices; ++v)
+    {
+        fresh.getVertexWeights(v, freshWeights);
+        loaded.getVertexWeights(v, testWeights);
+        bool same = (freshWeights.size() == testWeights.size());
+        for (size_t j = 0; same && j < freshWeights.size(); ++j)
+        {
+            same = (freshWeights[j].weight == testWeights[j].weight && freshWeights[j].ijk[0] == testWeights[j].ijk[0] &&
+                    freshWeights[j].ijk[1] == testWeights[j].ijk[1] && freshWeights[j].ijk[2] == testWeights[j].ijk[2]);
+        }
+        if (!same)
+        {
+            setFailed("ribbon weights read from file don't match computed weights for vertex " + AString::number(v));
+            return;
+        }
+    }
+    loaded.apply(framePointers, testPointers, 3, true);
+    for (int f = 0; f < 3; ++f)
+    {
+        if (!sameValues(freshOut[f], testOut[f])) setFailed("mapping with ribbon weights read from file doesn't match computed weights");
+    }
+    
+    if (loaded.readFile(fileName, otherKey)) setFailed("ribbon weights file was accepted for a different key");
+    if (loaded.getNumberOfVertices() != numVertices) setFailed("rejected ribbon weights file changed the existing weights");
+    
+    writeTruncated(fileName, truncName);
+    bool threw = false;
+    try
+    {
+        loaded.readFile(truncName, key);
+    } catch (CaretException&) {
+        threw = true;
+    }
+    if (!threw) setFailed("truncated ribbon weights file was accepted");
+    
+    SurfaceResamplingHelper resampleReader;//each kind of weights file must reject the other
+    threw = false;
+    try
+    {
+        resampleReader.readWeights(fileName, key);
+    } catch (CaretException&) {
+        threw = true;
+    }
+    if (!threw) setFailed("ribbon weights file was accepted as resampling weights");
+}
+
+void WeightsFileTest::testRibbonApply()
+{//the flattened weights must map the same as summing the nested weights with VolumeFile::getValue, vertex by vertex
+    const int64_t dims[3] = { 8, 8, 8 };
+    const float sform[12] = { 1.0f, 0.0f, 0.0f, 0.0f,
+                              0.0f, 1.0f, 0.0f, 0.0f,
+                              0.0f, 0.0f, 1.0f, 0.0f };
+    VolumeSpace volSpace(dims, sform);
+    SurfaceFile inner, outer;
+    makeSheet(inner, 2.2f);
+    makeSheet(outer, 4.7f);
+    vector<vector<VoxelWeight> > nested;
+    RibbonMappingHelper::computeWeightsRibbon(nested, volSpace, &inner, &outer);
+    VoxelWeightMatrix flat(nested, dims);
+    const int NUM_FRAMES = 3;
+    int64_t numVertices = (int64_t)nested.size(), frameSize = dims[0] * dims[1] * dims[2];
+    VolumeFile myVol;
+    myVol.reinitialize(volSpace, NUM_FRAMES);
+    vector<vector<float> > frames(NUM_FRAMES, vector<float>(frameSize)), flatOut(NUM_FRAMES, vector<float>(numVertices));
+    for (int f = 0; f < NUM_FRAMES; ++f)
+    {
+        for (int64_t i = 0; i < frameSize; ++i)
+        {
+            frames[f][i] = sin(i * 0.23f - f) * 5.0f;//mixed signs
+        }
+        myVol.setFrame(frames[f].data(), f);
+    }
+    const float* framePointers[NUM_FRAMES] = { myVol.getFrame(0), myVol.getFrame(1), myVol.getFrame(2) };
+    float* outPointers[NUM_FRAMES] = { flatOut[0].data(), flatOut[1].data(), flatOut[2].data() };
+    const float TOLERANCE = 1e-5f;//values are at most 5 in magnitude, only contracting multiply-adds could make them differ
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        bool normalize = (pass == 0);//ribbon-constrained divides by the weight sum, myelin style weights are already normalized
+        flat.apply(framePointers, outPointers, NUM_FRAMES, normalize);
+        for (int f = 0; f < NUM_FRAMES; ++f)
+        {
+            for (int64_t node = 0; node < numVertices; ++node)
+            {
+                float expected = 0.0f;
+                if (normalize)
+                {
+                    float totalWeight = 0.0f;
+                    for (int voxel = 0; voxel < (int)nested[node].size(); ++voxel)
+                    {
+                        float thisWeight = nested[node][voxel].weight;
+                        totalWeight += thisWeight;
+                        expected += thisWeight * myVol.getValue(nested[node][voxel].ijk, f);
+                    }
+                    expected = (totalWeight != 0.0f ? expected / totalWeight : 0.0f);
+                } else {
+                    double accum = 0.0;
+                    for (int voxel = 0; voxel < (int)nested[node].size(); ++voxel)
+                    {
+                        accum += nested[node][voxel].weight * myVol.getValue(nested[node][voxel].ijk, f);
+                    }
+                    expected = accum;
+                }
+                if (!(abs(flatOut[f][node] - expected) <= TOLERANCE))
+                {
+                    setFailed(AString(normalize ? "normalized" : "unnormalized") + " ribbon mapping of frame " + AString::number(f) + " vertex " + AString::number(node) +
+                              " got " + AString::number(flatOut[f][node]) + ", expected " + AString::number(expected));
+                    return;
+                }
+            }
+        }
+    }
+}
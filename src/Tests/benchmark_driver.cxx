@@ -0,0 +1,594 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+//program for timing wb_command hot paths on reproducible synthetic inputs, reports results as JSON
+//inputs are generated from a fixed seed, then each benchmark runs the actual command in-process, the same way wb_command does,
+//so the numbers are comparable across workbench versions as long as the command syntax is unchanged
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+#include "AlgorithmSurfaceCreateSphere.h"
+#include "ApplicationInformation.h"
+#include "CaretCommandLine.h"
+#include "CaretException.h"
+#include "CaretHttpManager.h"
+#include "CaretOMP.h"
+#include "CiftiFile.h"
+#include "CommandOperationManager.h"
+#include "ElapsedTimer.h"
+#include "MetricFile.h"
+#include "ProgramParameters.h"
+#include "SessionManager.h"
+#include "SurfaceFile.h"
+#include "SystemUtilities.h"
+#include "VolumeFile.h"
+
+using namespace std;
+using namespace caret;
+
+namespace
+{
+    struct BenchmarkSettings
+    {
+        int vertices;//target vertex count, actual count is the closest divided icosahedron
+        int timepoints;//dtseries length
+        int maps;//columns in the metric inputs
+        int volumeDim;//voxels along each axis of the cubic volume
+        int volumeFrames;
+        int geodesicSources;//number of vertices in the all-to-all geodesic roi
+        int repeat;
+        unsigned int seed;
+        bool keepFiles;
+        AString workDir, outputFile, only;
+        BenchmarkSettings()
+        {
+            vertices = 5000;
+            timepoints = 200;
+            maps = 10;
+            volumeDim = 96;
+            volumeFrames = 10;
+            geodesicSources = 100;
+            repeat = 3;
+            seed = 12345;
+            keepFiles = false;
+        }
+    };
+
+    struct BenchmarkCase
+    {
+        AString name, unit;
+        vector<AString> command;
+        double workUnits;//divided by time for the throughput number
+    };
+
+    void printUsage()
+    {
+        cout << "usage: benchmark_driver [options]" << endl
+             << "   -vertices <n>           target number of vertices in the synthetic sphere (default 5000)" << endl
+             << "   -timepoints <n>         number of timepoints in the dtseries (default 200)" << endl
+             << "   -maps <n>               number of maps in the metric inputs (default 10)" << endl
+             << "   -volume-dim <n>         voxels along each axis of the volume (default 96)" << endl
+             << "   -volume-frames <n>      number of frames in the volume (default 10)" << endl
+             << "   -geodesic-sources <n>   number of source vertices for geodesic distance (default 100)" << endl
+             << "   -repeat <n>             number of timed runs of each benchmark (default 3)" << endl
+             << "   -seed <n>               random seed for the synthetic data (default 12345)" << endl
+             << "   -only <name,...>        only run the listed benchmarks" << endl
+             << "   -work-dir <dir>         where to put the synthetic files (default: a new directory in the system temp dir)" << endl
+             << "   -keep-files             don't delete the synthetic files afterwards" << endl
+             << "   -output <file>          write the JSON report to a file instead of standard output" << endl;
+    }
+
+    bool parseSettings(int argc, char** argv, BenchmarkSettings& settings)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            AString option(argv[i]);
+            if (option == "-keep-files")
+            {
+                settings.keepFiles = true;
+                continue;
+            }
+            if (option == "-help")
+            {
+                return false;
+            }
+            if (i + 1 >= argc)
+            {
+                cerr << "option " << argv[i] << " is unrecognized or missing its argument" << endl;
+                return false;
+            }
+            AString value(argv[++i]);
+            bool ok = true;
+            if (option == "-vertices")
+            {
+                settings.vertices = value.toInt(&ok);
+            } else if (option == "-timepoints") {
+                settings.timepoints = value.toInt(&ok);
+            } else if (option == "-maps") {
+                settings.maps = value.toInt(&ok);
+            } else if (option == "-volume-dim") {
+                settings.volumeDim = value.toInt(&ok);
+            } else if (option == "-volume-frames") {
+                settings.volumeFrames = value.toInt(&ok);
+            } else if (option == "-geodesic-sources") {
+                settings.geodesicSources = value.toInt(&ok);
+            } else if (option == "-repeat") {
+                settings.repeat = value.toInt(&ok);
+            } else if (option == "-seed") {
+                settings.seed = value.toUInt(&ok);
+            } else if (option == "-only") {
+                settings.only = value;
+            } else if (option == "-work-dir") {
+                settings.workDir = value;
+            } else if (option == "-output") {
+                settings.outputFile = value;
+            } else {
+                cerr << "unrecognized option: " << argv[i - 1] << endl;
+                return false;
+            }
+            if (!ok)
+            {
+                cerr << "non-numeric argument to " << argv[i - 1] << ": " << argv[i] << endl;
+                return false;
+            }
+        }
+        if (settings.vertices < 12 || settings.timepoints < 2 || settings.maps < 1 || settings.volumeDim < 2 ||
+            settings.volumeFrames < 1 || settings.geodesicSources < 1 || settings.repeat < 1)
+        {
+            cerr << "sizes and repeat count must be positive (at least 12 vertices, 2 timepoints, 2 voxels per axis)" << endl;
+            return false;
+        }
+        return true;
+    }
+
+    //peak resident memory in megabytes, -1 if unknown
+    //on linux, VmHWM can be reset between benchmarks, elsewhere this is the peak over the whole process
+    double getPeakRssMegabytes()
+    {
+#ifdef __linux__
+        ifstream status("/proc/self/status");
+        string line;
+        while (getline(status, line))
+        {
+            if (line.compare(0, 6, "VmHWM:") == 0)
+            {
+                return atof(line.c_str() + 6) / 1024.0;//reported in kB
+            }
+        }
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+        struct rusage myUsage;
+        if (getrusage(RUSAGE_SELF, &myUsage) == 0)
+        {
+#ifdef __APPLE__
+            return myUsage.ru_maxrss / (1024.0 * 1024.0);//bytes on mac
+#else
+            return myUsage.ru_maxrss / 1024.0;//kB elsewhere
+#endif
+        }
+#endif
+        return -1.0;
+    }
+
+    //returns whether the peak was actually reset
+    bool resetPeakRss()
+    {
+#ifdef __linux__
+        ofstream clearRefs("/proc/self/clear_refs");
+        if (!clearRefs) return false;
+        clearRefs << "5" << endl;//resets VmHWM to the current RSS, linux 4.0 and later
+        return clearRefs.good();
+#else
+        return false;
+#endif
+    }
+
+    //smooth spatial pattern plus noise, so that smoothing and TFCE see structure rather than only white noise
+    float pattern(const float* xyz, const int& map, mt19937& rng)
+    {
+        normal_distribution<float> noise(0.0f, 0.5f);
+        float phase = map * 0.3f;
+        return 3.0f * sin(xyz[0] / 15.0f + phase) * cos(xyz[1] / 20.0f - phase) + xyz[2] / 50.0f + noise(rng);
+    }
+
+    void makeSphere(const int& vertices, const float& radius, SurfaceFile& surfOut)
+    {
+        AlgorithmSurfaceCreateSphere(NULL, vertices, &surfOut);//always radius 100
+        int numNodes = surfOut.getNumberOfNodes();
+        vector<float> coords(surfOut.getCoordinateData(), surfOut.getCoordinateData() + numNodes * 3);
+        for (int i = 0; i < numNodes * 3; ++i)
+        {
+            coords[i] *= radius / 100.0f;
+        }
+        surfOut.setCoordinates(coords.data());
+        surfOut.setStructure(StructureEnum::CORTEX_LEFT);
+    }
+
+    CiftiBrainModelsMap makeSurfaceModels(const int& numNodes)
+    {
+        CiftiBrainModelsMap ret;
+        ret.addSurfaceModel(numNodes, StructureEnum::CORTEX_LEFT);
+        return ret;
+    }
+
+    //writes all inputs into the work directory, returns the number of vertices actually used
+    int generateInputs(const BenchmarkSettings& settings, const QDir& workDir)
+    {
+        mt19937 rng(settings.seed);
+        SurfaceFile midSurf, innerSurf, outerSurf;
+        makeSphere(settings.vertices, 100.0f, midSurf);
+        makeSphere(settings.vertices, 97.5f, innerSurf);
+        makeSphere(settings.vertices, 102.5f, outerSurf);
+        midSurf.writeFile(workDir.filePath("bench.midthickness.surf.gii"));
+        innerSurf.writeFile(workDir.filePath("bench.white.surf.gii"));
+        outerSurf.writeFile(workDir.filePath("bench.pial.surf.gii"));
+        const int numNodes = midSurf.getNumberOfNodes();
+
+        MetricFile myMetric;
+        myMetric.setNumberOfNodesAndColumns(numNodes, settings.maps);
+        myMetric.setStructure(StructureEnum::CORTEX_LEFT);
+        vector<float> scratch(numNodes);
+        for (int map = 0; map < settings.maps; ++map)
+        {
+            for (int node = 0; node < numNodes; ++node)
+            {
+                scratch[node] = pattern(midSurf.getCoordinate(node), map, rng);
+            }
+            myMetric.setValuesForColumn(map, scratch.data());
+        }
+        myMetric.writeFile(workDir.filePath("bench.func.gii"));
+
+        MetricFile geoRoi;//evenly spaced sources, the sphere has no preferred region
+        geoRoi.setNumberOfNodesAndColumns(numNodes, 1);
+        geoRoi.setStructure(StructureEnum::CORTEX_LEFT);
+        vector<float> roiData(numNodes, 0.0f);
+        int numSources = min(settings.geodesicSources, numNodes);
+        for (int i = 0; i < numSources; ++i)
+        {
+            roiData[(int64_t)i * numNodes / numSources] = 1.0f;
+        }
+        geoRoi.setValuesForColumn(0, roiData.data());
+        geoRoi.writeFile(workDir.filePath("bench.geo_roi.func.gii"));
+
+        CiftiBrainModelsMap surfModels = makeSurfaceModels(numNodes);
+        {
+            CiftiXML seriesXML;
+            seriesXML.setNumberOfDimensions(2);
+            seriesXML.setMap(CiftiXML::ALONG_ROW, CiftiSeriesMap(settings.timepoints, 0.0f, 0.72f));
+            seriesXML.setMap(CiftiXML::ALONG_COLUMN, surfModels);
+            CiftiFile dtseries;
+            dtseries.setWritingFile(workDir.filePath("bench.dtseries.nii"));//starts on-disk writing
+            dtseries.setCiftiXML(seriesXML);
+            vector<float> rowScratch(settings.timepoints);
+            for (int node = 0; node < numNodes; ++node)
+            {
+                const float* xyz = midSurf.getCoordinate(node);
+                for (int t = 0; t < settings.timepoints; ++t)
+                {
+                    rowScratch[t] = pattern(xyz, t, rng);
+                }
+                dtseries.setRow(rowScratch.data(), node);
+            }
+            dtseries.close();
+        }
+        {
+            CiftiXML dconnXML;
+            dconnXML.setNumberOfDimensions(2);
+            dconnXML.setMap(CiftiXML::ALONG_ROW, surfModels);
+            dconnXML.setMap(CiftiXML::ALONG_COLUMN, surfModels);
+            CiftiFile dconn;
+            dconn.setWritingFile(workDir.filePath("bench.dconn.nii"));//starts on-disk writing
+            dconn.setCiftiXML(dconnXML);
+            uniform_real_distribution<float> corrDist(-1.0f, 1.0f);
+            for (int row = 0; row < numNodes; ++row)
+            {
+                for (int col = 0; col < numNodes; ++col)
+                {
+                    scratch[col] = corrDist(rng);
+                }
+                dconn.setRow(scratch.data(), row);
+            }
+            dconn.close();
+        }
+
+        //cubic volume that contains all three spheres with a bit of margin
+        const int dim = settings.volumeDim;
+        const float spacing = 240.0f / dim;
+        vector<int64_t> volDims(3, dim);
+        volDims.push_back(settings.volumeFrames);
+        vector<vector<float> > sform(3, vector<float>(4, 0.0f));
+        for (int i = 0; i < 3; ++i)
+        {
+            sform[i][i] = spacing;
+            sform[i][3] = -120.0f;
+        }
+        VolumeFile myVol(volDims, sform);
+        const int64_t frameSize = (int64_t)dim * dim * dim;
+        vector<float> frame(frameSize);
+        for (int f = 0; f < settings.volumeFrames; ++f)
+        {
+            int64_t index = 0;
+            for (int k = 0; k < dim; ++k)
+            {
+                for (int j = 0; j < dim; ++j)
+                {
+                    for (int i = 0; i < dim; ++i)
+                    {
+                        float xyz[3] = { i * spacing - 120.0f, j * spacing - 120.0f, k * spacing - 120.0f };
+                        frame[index] = pattern(xyz, f, rng);
+                        ++index;
+                    }
+                }
+            }
+            myVol.setFrame(frame.data(), f);
+        }
+        myVol.writeFile(workDir.filePath("bench.nii.gz"));
+        return numNodes;
+    }
+
+    vector<BenchmarkCase> makeCases(const BenchmarkSettings& settings, const QDir& workDir, const int& numNodes)
+    {
+        vector<BenchmarkCase> ret;
+        const AString mid = workDir.filePath("bench.midthickness.surf.gii"), white = workDir.filePath("bench.white.surf.gii"), pial = workDir.filePath("bench.pial.surf.gii");
+        const AString metric = workDir.filePath("bench.func.gii"), dtseries = workDir.filePath("bench.dtseries.nii"), dconn = workDir.filePath("bench.dconn.nii");
+        const AString volume = workDir.filePath("bench.nii.gz");
+        const double nodesD = numNodes, voxelsD = pow((double)settings.volumeDim, 3.0);
+        BenchmarkCase myCase;
+
+        myCase.name = "cifti-correlation";
+        myCase.command = { "-cifti-correlation", dtseries, workDir.filePath("out.corr.dconn.nii") };
+        myCase.workUnits = nodesD * nodesD;
+        myCase.unit = "correlations/s";
+        ret.push_back(myCase);
+
+        myCase.name = "metric-smoothing";
+        myCase.command = { "-metric-smoothing", mid, metric, "4", workDir.filePath("out.smooth.func.gii") };
+        myCase.workUnits = nodesD * settings.maps;
+        myCase.unit = "vertex-maps/s";
+        ret.push_back(myCase);
+
+        myCase.name = "cifti-smoothing";
+        myCase.command = { "-cifti-smoothing", dtseries, "4", "4", "COLUMN", workDir.filePath("out.smooth.dtseries.nii"), "-left-surface", mid };
+        myCase.workUnits = nodesD * settings.timepoints;
+        myCase.unit = "vertex-maps/s";
+        ret.push_back(myCase);
+
+        myCase.name = "volume-to-surface-trilinear";
+        myCase.command = { "-volume-to-surface-mapping", volume, mid, workDir.filePath("out.trilinear.func.gii"), "-trilinear" };
+        myCase.workUnits = nodesD * settings.volumeFrames;
+        myCase.unit = "vertex-frames/s";
+        ret.push_back(myCase);
+
+        myCase.name = "volume-to-surface-ribbon";
+        myCase.command = { "-volume-to-surface-mapping", volume, mid, workDir.filePath("out.ribbon.func.gii"), "-ribbon-constrained", white, pial };
+        myCase.workUnits = nodesD * settings.volumeFrames;
+        myCase.unit = "vertex-frames/s";
+        ret.push_back(myCase);
+
+        myCase.name = "volume-smoothing";
+        myCase.command = { "-volume-smoothing", volume, "4", workDir.filePath("out.smooth.nii.gz") };
+        myCase.workUnits = voxelsD * settings.volumeFrames;
+        myCase.unit = "voxel-frames/s";
+        ret.push_back(myCase);
+
+        myCase.name = "cifti-math";
+        myCase.command = { "-cifti-math", "0.5 * log((1 + x) / (1 - x))", workDir.filePath("out.math.dconn.nii"), "-var", "x", dconn };
+        myCase.workUnits = nodesD * nodesD;
+        myCase.unit = "elements/s";
+        ret.push_back(myCase);
+
+        myCase.name = "surface-geodesic-distance";
+        myCase.command = { "-surface-geodesic-distance-all-to-all", mid, workDir.filePath("out.geo.dconn.nii"), "-roi", workDir.filePath("bench.geo_roi.func.gii") };
+        myCase.workUnits = nodesD * min(settings.geodesicSources, numNodes);
+        myCase.unit = "vertex-distances/s";
+        ret.push_back(myCase);
+
+        myCase.name = "metric-tfce";
+        myCase.command = { "-metric-tfce", mid, metric, workDir.filePath("out.tfce.func.gii") };
+        myCase.workUnits = nodesD * settings.maps;
+        myCase.unit = "vertex-maps/s";
+        ret.push_back(myCase);
+
+        if (!settings.only.isEmpty())
+        {
+            QStringList wanted = settings.only.split(',', QString::SkipEmptyParts);
+            vector<BenchmarkCase> filtered;
+            for (size_t i = 0; i < ret.size(); ++i)
+            {
+                if (wanted.contains(ret[i].name)) filtered.push_back(ret[i]);
+            }
+            ret = filtered;
+        }
+        return ret;
+    }
+
+    void runCommand(const vector<AString>& command)
+    {
+        ProgramParameters parameters;
+        for (size_t i = 0; i < command.size(); ++i)
+        {
+            parameters.addParameter(command[i]);
+        }
+        CommandOperationManager::getCommandOperationManager()->runCommand(parameters);
+    }
+
+    QJsonArray toJsonArray(const vector<double>& values)
+    {
+        QJsonArray ret;
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+            ret.append(values[i]);
+        }
+        return ret;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    BenchmarkSettings settings;
+    if (!parseSettings(argc, argv, settings))
+    {
+        printUsage();
+        return 1;
+    }
+    int failCount = 0;
+    {
+        QCoreApplication myApp(argc, argv);
+        caret_global_commandLine_init(argc, argv);
+        SessionManager::createSessionManager(ApplicationTypeEnum::APPLICATION_TYPE_COMMAND_LINE);
+        QDir workDir;
+        bool madeDir = false;
+        if (settings.workDir.isEmpty())
+        {
+            settings.workDir = QDir(QDir::tempPath()).filePath("wb_benchmark_" + SystemUtilities::createUniqueID());
+        }
+        if (!QDir(settings.workDir).exists())
+        {
+            madeDir = QDir().mkpath(settings.workDir);
+            if (!madeDir)
+            {
+                cerr << "unable to create work directory " << settings.workDir.toLocal8Bit().constData() << endl;
+                return 1;
+            }
+        }
+        workDir = QDir(settings.workDir);
+        QJsonObject report;
+        ApplicationInformation appInfo;
+        report["version"] = appInfo.getVersion();
+        report["commit"] = appInfo.getCommit();
+#ifdef CARET_OMP
+        report["threads"] = omp_get_max_threads();
+#else
+        report["threads"] = 1;
+#endif
+        report["processors"] = SystemUtilities::getNumberOfProcessors();
+        QJsonObject settingsJson;
+        settingsJson["vertices_requested"] = settings.vertices;
+        settingsJson["timepoints"] = settings.timepoints;
+        settingsJson["maps"] = settings.maps;
+        settingsJson["volume_dim"] = settings.volumeDim;
+        settingsJson["volume_frames"] = settings.volumeFrames;
+        settingsJson["geodesic_sources"] = settings.geodesicSources;
+        settingsJson["repeat"] = settings.repeat;
+        settingsJson["seed"] = (double)settings.seed;
+        QJsonArray results;
+        try
+        {
+            ElapsedTimer myTimer;
+            myTimer.start();
+            int numNodes = generateInputs(settings, workDir);
+            settingsJson["vertices"] = numNodes;
+            report["generate_seconds"] = myTimer.getElapsedTimeSeconds();
+            vector<BenchmarkCase> cases = makeCases(settings, workDir, numNodes);
+            bool peakIsPerBenchmark = true;
+            for (size_t i = 0; i < cases.size(); ++i)
+            {
+                QJsonObject result;
+                result["name"] = cases[i].name;
+                QJsonArray commandJson;
+                for (size_t j = 0; j < cases[i].command.size(); ++j)
+                {
+                    commandJson.append(cases[i].command[j]);
+                }
+                result["command"] = commandJson;
+                vector<double> times;
+                peakIsPerBenchmark = resetPeakRss() && peakIsPerBenchmark;
+                try
+                {
+                    for (int r = 0; r < settings.repeat; ++r)
+                    {
+                        myTimer.reset();
+                        runCommand(cases[i].command);
+                        times.push_back(myTimer.getElapsedTimeSeconds());
+                    }
+                } catch (CaretException& e) {
+                    ++failCount;
+                    result["error"] = e.whatString();
+                    cerr << "benchmark " << cases[i].name.toLocal8Bit().constData() << " failed: " << e.whatString().toLocal8Bit().constData() << endl;
+                }
+                result["peak_rss_mb"] = getPeakRssMegabytes();
+                result["seconds"] = toJsonArray(times);
+                if (!times.empty())
+                {
+                    vector<double> sorted = times;
+                    sort(sorted.begin(), sorted.end());
+                    double median = sorted[sorted.size() / 2];
+                    if (sorted.size() % 2 == 0) median = (median + sorted[sorted.size() / 2 - 1]) / 2.0;
+                    result["seconds_min"] = sorted[0];
+                    result["seconds_median"] = median;
+                    result["throughput"] = (median > 0.0 ? cases[i].workUnits / median : 0.0);//median is less sensitive to a cold first run
+                    result["throughput_unit"] = cases[i].unit;
+                }
+                results.append(result);
+            }
+            report["peak_rss_per_benchmark"] = peakIsPerBenchmark;//if false, peak_rss_mb is cumulative over the process
+        } catch (CaretException& e) {
+            ++failCount;
+            cerr << "failed to generate inputs: " << e.whatString().toLocal8Bit().constData() << endl;
+            report["error"] = e.whatString();
+        }
+        report["settings"] = settingsJson;
+        report["benchmarks"] = results;
+        report["peak_rss_mb"] = getPeakRssMegabytes();
+        QByteArray jsonText = QJsonDocument(report).toJson(QJsonDocument::Indented);
+        if (settings.outputFile.isEmpty())
+        {
+            cout << jsonText.constData();
+        } else {
+            QFile outFile(settings.outputFile);
+            if (!outFile.open(QIODevice::WriteOnly | QIODevice::Truncate) || outFile.write(jsonText) != jsonText.size())
+            {
+                cerr << "unable to write report to " << settings.outputFile.toLocal8Bit().constData() << endl;
+                ++failCount;
+            }
+        }
+        if (!settings.keepFiles)
+        {
+            QStringList benchFiles = workDir.entryList(QStringList() << "bench.*" << "out.*", QDir::Files);
+            for (int i = 0; i < benchFiles.size(); ++i)
+            {
+                workDir.remove(benchFiles[i]);
+            }
+            if (madeDir) QDir().rmdir(settings.workDir);
+        }
+        CommandOperationManager::deleteCommandOperationManager();
+        SessionManager::deleteSessionManager();
+        CaretHttpManager::deleteHttpManager();
+        myApp.processEvents();
+    }
+    return (failCount == 0 ? 0 : 1);
+}
@@ -33,7 +33,10 @@
 #include "CaretException.h"
 
 //tests
+#include "Base64Test.h"
 #include "CiftiFileTest.h"
+#include "CiftiSparseTest.h"
+#include "ConnectivityRowCacheTest.h"
 #include "DotTest.h"
 #include "GeodesicHelperTest.h"
 #include "HttpTest.h"
@@ -41,13 +44,17 @@
 #include "LookupTest.h"
 #include "MathExpressionTest.h"
 #include "NiftiTest.h"
+#include "PaletteLookupTest.h"
 #include "PointerTest.h"
+#include "PointLocatorTest.h"
 #include "ProgressTest.h"
 #include "QuatTest.h"
 #include "StatisticsTest.h"
+#include "TFCETest.h"
 #include "TimerTest.h"
 #include "TopologyHelperTest.h"
 #include "VolumeFileTest.h"
+#include "WeightsFileTest.h"
 #include "XnatTest.h"
 
 using namespace std;
@@ -69,7 +76,10 @@ int main(int argc, char** argv)
         caret_global_commandLine_init(argc, argv);
         SessionManager::createSessionManager(ApplicationTypeEnum::APPLICATION_TYPE_COMMAND_LINE);
         vector<TestInterface*> mytests;
+        mytests.push_back(new Base64Test("base64"));
         mytests.push_back(new CiftiFileTest("ciftifile"));
+        mytests.push_back(new CiftiSparseTest("ciftisparse"));
+        mytests.push_back(new ConnectivityRowCacheTest("rowcache"));
         mytests.push_back(new DotTest("dotsimd"));
         mytests.push_back(new GeodesicHelperTest("geohelp"));
         mytests.push_back(new HeapTest("heap"));
@@ -78,13 +88,17 @@ int main(int argc, char** argv)
         mytests.push_back(new MathExpressionTest("mathexpression"));
         mytests.push_back(new NiftiFileTest("niftifile"));
         mytests.push_back(new NiftiHeaderTest("niftiheader"));
+        mytests.push_back(new PaletteLookupTest("palettelookup"));
         mytests.push_back(new PointerTest("pointer"));
+        mytests.push_back(new PointLocatorTest("pointlocator"));
         mytests.push_back(new ProgressTest("progress"));
         mytests.push_back(new QuatTest("quaternion"));
         mytests.push_back(new StatisticsTest("statistics"));
+        mytests.push_back(new TFCETest("tfce"));
         mytests.push_back(new TimerTest("timer"));
         mytests.push_back(new TopologyHelperTest("topohelp"));
         mytests.push_back(new VolumeFileTest("volumefile"));
+        mytests.push_back(new WeightsFileTest("weightsfile"));
         mytests.push_back(new XnatTest("xnat"));
         if (argc < 2)
         {
@@ -14,6 +14,9 @@
 extern float  sdot  (const float  *a, const float  *b, int n);
 extern double ddot  (const double *a, const double *b, int n);
 extern double dsdot (const float  *a, const float  *b, int n);
+extern void   dsdot_tile (const float *const *a, int na,
+                          const float *const *b, int nb, int n,
+                          double *c, int ldc);
 
 /*----------------------------------------------------------------------------
   Global Variables
@@ -21,6 +24,7 @@ extern double dsdot (const float  *a, const float  *b, int n);
 sdot_func  *sdot_ptr  = &sdot_select;
 ddot_func  *ddot_ptr  = &ddot_select;
 dsdot_func *dsdot_ptr = &dsdot_select;
+dsdot_tile_func *dsdot_tile_ptr = &dsdot_tile_select;
 
 /*----------------------------------------------------------------------------
   Functions
@@ -41,6 +45,13 @@ double dsdot_select (const float *a, const float *b, int n) {
   return (*dsdot_ptr)(a,b,n);
 }
 
+void dsdot_tile_select (const float *const *a, int na,
+                        const float *const *b, int nb, int n,
+                        double *c, int ldc) {
+  dot_set_impl(DOT_AUTO);
+  (*dsdot_tile_ptr)(a,na,b,nb,n,c,ldc);
+}
+
 dot_flags dot_set_impl (dot_flags impl) {
 
   // forcibly select the naive implementations if the architecture
@@ -49,6 +60,7 @@ dot_flags dot_set_impl (dot_flags impl) {
   sdot_ptr  = &sdot_naive;
   ddot_ptr  = &ddot_naive;
   dsdot_ptr = &dsdot_naive;
+  dsdot_tile_ptr = &dsdot_tile_naive;
   return DOT_NAIVE;
   // note that the cpuinfo functions are currently only being made
   // available if the architecture is x86_64 (see top of file)
@@ -62,6 +74,7 @@ dot_flags dot_set_impl (dot_flags impl) {
         sdot_ptr  = &sdot_avx512fma;
         ddot_ptr  = &ddot_avx512fma;
         dsdot_ptr = &dsdot_avx512fma;
+        dsdot_tile_ptr = &dsdot_tile_avx512fma;
         return DOT_AVX512FMA;
       }
      #endif
@@ -70,6 +83,7 @@ dot_flags dot_set_impl (dot_flags impl) {
         sdot_ptr  = &sdot_avx512;
         ddot_ptr  = &ddot_avx512;
         dsdot_ptr = &dsdot_avx512;
+        dsdot_tile_ptr = &dsdot_tile_avx512;
         return DOT_AVX512;
       }
     #endif
@@ -81,6 +95,7 @@ dot_flags dot_set_impl (dot_flags impl) {
         sdot_ptr  = &sdot_avxfma;
         ddot_ptr  = &ddot_avxfma;
         dsdot_ptr = &dsdot_avxfma;
+        dsdot_tile_ptr = &dsdot_tile_avxfma;
         return DOT_AVXFMA;
       }
     #endif
@@ -89,6 +104,13 @@ dot_flags dot_set_impl (dot_flags impl) {
         sdot_ptr  = &sdot_avx;
         ddot_ptr  = &ddot_avx;
         dsdot_ptr = &dsdot_avx;
+        dsdot_tile_ptr = &dsdot_tile_avx;
+        #ifndef DOT_NOFMA
+        // Unlike the plain dot products, the register-blocked tile kernel
+        // is compute bound and does profit from FMA3, so use it if possible.
+        if ((impl == DOT_AUTO) && hasFMA3())
+          dsdot_tile_ptr = &dsdot_tile_avxfma;
+        #endif
         return DOT_AVX;
       }
     case DOT_SSE2 :
@@ -96,12 +118,14 @@ dot_flags dot_set_impl (dot_flags impl) {
         sdot_ptr  = &sdot_sse2;
         ddot_ptr  = &ddot_sse2;
         dsdot_ptr = &dsdot_sse2;
+        dsdot_tile_ptr = &dsdot_tile_naive; // no SSE2 tile kernel
         return DOT_SSE2;
       }
     case DOT_NAIVE :
       sdot_ptr  = &sdot_naive;
       ddot_ptr  = &ddot_naive;
       dsdot_ptr = &dsdot_naive;
+      dsdot_tile_ptr = &dsdot_tile_naive;
       return DOT_NAIVE;
     default :
       return dot_set_impl(DOT_AUTO);
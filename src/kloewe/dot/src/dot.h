@@ -43,6 +43,9 @@ typedef enum {
 typedef float  (sdot_func)    (const float  *a, const float  *b, int n);
 typedef double (ddot_func)    (const double *a, const double *b, int n);
 typedef double (dsdot_func)   (const float  *a, const float  *b, int n);
+typedef void   (dsdot_tile_func) (const float *const *a, int na,
+                                  const float *const *b, int nb, int n,
+                                  double *c, int ldc);
 
 /*----------------------------------------------------------------------------
   Global Variables
@@ -50,6 +53,7 @@ typedef double (dsdot_func)   (const float  *a, const float  *b, int n);
 extern sdot_func  *sdot_ptr;
 extern ddot_func  *ddot_ptr;
 extern dsdot_func *dsdot_ptr;
+extern dsdot_tile_func *dsdot_tile_ptr;
 
 /*----------------------------------------------------------------------------
   Function Prototypes
@@ -58,6 +62,19 @@ inline float  sdot            (const float  *a, const float  *b, int n);
 inline double ddot            (const double *a, const double *b, int n);
 inline double dsdot           (const float  *a, const float  *b, int n);
 
+/* dsdot_tile
+ * ----------
+ * compute a tile of dot products, c[i*ldc+j] = a[i] . b[j]
+ * for all i < na and j < nb, where all rows have n elements
+ *
+ * The SIMD implementations are register and cache blocked, so that each
+ * element loaded from memory is used in several products; this is much
+ * faster than computing the tile with one dsdot call per element.
+ */
+inline void   dsdot_tile      (const float *const *a, int na,
+                               const float *const *b, int nb, int n,
+                               double *c, int ldc);
+
 /* dot_set_impl
  * ------------
  * specify the set of implementations that is used
@@ -85,10 +102,16 @@ extern dot_flags dot_set_impl (dot_flags impl);
 extern float  sdot_select     (const float  *a, const float  *b, int n);
 extern double ddot_select     (const double *a, const double *b, int n);
 extern double dsdot_select    (const float  *a, const float  *b, int n);
+extern void   dsdot_tile_select (const float *const *a, int na,
+                                 const float *const *b, int nb, int n,
+                                 double *c, int ldc);
 
 extern float  sdot_naive      (const float  *a, const float  *b, int n);
 extern double ddot_naive      (const double *a, const double *b, int n);
 extern double dsdot_naive     (const float  *a, const float  *b, int n);
+extern void   dsdot_tile_naive (const float *const *a, int na,
+                                const float *const *b, int nb, int n,
+                                double *c, int ldc);
 
 #ifdef ARCH_IS_X86_64
 extern float  sdot_sse2       (const float  *a, const float  *b, int n);
@@ -98,20 +121,32 @@ extern double dsdot_sse2      (const float  *a, const float  *b, int n);
 extern float  sdot_avx        (const float  *a, const float  *b, int n);
 extern double ddot_avx        (const double *a, const double *b, int n);
 extern double dsdot_avx       (const float  *a, const float  *b, int n);
+extern void   dsdot_tile_avx  (const float *const *a, int na,
+                               const float *const *b, int nb, int n,
+                               double *c, int ldc);
 
 # ifndef DOT_NOFMA
 extern float  sdot_avxfma     (const float  *a, const float  *b, int n);
 extern double ddot_avxfma     (const double *a, const double *b, int n);
 extern double dsdot_avxfma    (const float  *a, const float  *b, int n);
+extern void   dsdot_tile_avxfma (const float *const *a, int na,
+                                 const float *const *b, int nb, int n,
+                                 double *c, int ldc);
 # endif
 # ifndef DOT_NOAVX512
 extern float  sdot_avx512     (const float  *a, const float  *b, int n);
 extern double ddot_avx512     (const double *a, const double *b, int n);
 extern double dsdot_avx512    (const float  *a, const float  *b, int n);
+extern void   dsdot_tile_avx512 (const float *const *a, int na,
+                                 const float *const *b, int nb, int n,
+                                 double *c, int ldc);
 #  ifndef DOT_NOFMA
 extern float  sdot_avx512fma  (const float  *a, const float  *b, int n);
 extern double ddot_avx512fma  (const double *a, const double *b, int n);
 extern double dsdot_avx512fma (const float  *a, const float  *b, int n);
+extern void   dsdot_tile_avx512fma (const float *const *a, int na,
+                                    const float *const *b, int nb, int n,
+                                    double *c, int ldc);
 #  endif
 # endif
 #endif
@@ -132,6 +167,12 @@ inline double dsdot (const float *a, const float *b, int n) {
   return (*dsdot_ptr)(a,b,n);
 }
 
+inline void dsdot_tile (const float *const *a, int na,
+                        const float *const *b, int nb, int n,
+                        double *c, int ldc) {
+  (*dsdot_tile_ptr)(a,na,b,nb,n,c,ldc);
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -12,8 +12,14 @@
 extern float  sdot_avxfma  (const float  *a, const float  *b, int n);
 extern double ddot_avxfma  (const double *a, const double *b, int n);
 extern double dsdot_avxfma (const float  *a, const float  *b, int n);
+extern void   dsdot_tile_avxfma (const float *const *a, int na,
+                                 const float *const *b, int nb, int n,
+                                 double *c, int ldc);
 #else
 extern float  sdot_avx     (const float  *a, const float  *b, int n);
 extern double ddot_avx     (const double *a, const double *b, int n);
 extern double dsdot_avx    (const float  *a, const float  *b, int n);
+extern void   dsdot_tile_avx    (const float *const *a, int na,
+                                 const float *const *b, int nb, int n,
+                                 double *c, int ldc);
 #endif
@@ -30,6 +30,15 @@ inline float  sdot_avx     (const float  *a, const float  *b, int n);
 inline double ddot_avx     (const double *a, const double *b, int n);
 inline double dsdot_avx    (const float  *a, const float  *b, int n);
 #endif
+#ifdef __FMA__
+inline void   dsdot_tile_avxfma (const float *const *a, int na,
+                                 const float *const *b, int nb, int n,
+                                 double *c, int ldc);
+#else
+inline void   dsdot_tile_avx    (const float *const *a, int na,
+                                 const float *const *b, int nb, int n,
+                                 double *c, int ldc);
+#endif
 
 /*----------------------------------------------------------------------------
   Inline Functions
@@ -198,4 +207,132 @@ inline double dsdot_avx    (const float *a, const float *b, int n)
   return s;
 }  // dsdot_avx()
 
+/*--------------------------------------------------------------------------*/
+
+// number of elements of each row that are processed per pass of the tile
+// kernel, so that the rows of a panel stay in L1 during the pass
+#ifndef DOT_TILE_KC
+#define DOT_TILE_KC 256
+#endif
+
+#ifdef __FMA__
+#define dot_tile_madd(a,b,s) _mm256_fmadd_pd(a, b, s)
+#else
+#define dot_tile_madd(a,b,s) _mm256_add_pd(_mm256_mul_pd(a, b), s)
+#endif
+
+static inline double dot_tile_hsum (__m256d s4)
+{
+  __m128d sh = _mm_add_pd(_mm256_castpd256_pd128(s4),
+                          _mm256_extractf128_pd(s4, 1));
+  sh = _mm_add_sd(sh, _mm_unpackhi_pd(sh, sh));
+  return _mm_cvtsd_f64(sh);
+}  // dot_tile_hsum()
+
+// --- tile of dot products (input: single; intermediate and output: double)
+// c[i*ldc+j] = a[i] . b[j] for all i < na, j < nb
+// The rows are processed in passes of DOT_TILE_KC elements, so that a panel
+// of 4 rows of a stays in L1 while the rows of b are streamed from L2, and
+// each 4x3 block of the output is accumulated in 12 registers.  The inputs
+// are converted to double before they are multiplied, so the products are
+// exact and the sums have the same precision as dsdot.
+#ifdef __FMA__
+inline void dsdot_tile_avxfma (const float *const *a, int na,
+                               const float *const *b, int nb, int n,
+                               double *c, int ldc)
+#else
+inline void dsdot_tile_avx    (const float *const *a, int na,
+                               const float *const *b, int nb, int n,
+                               double *c, int ldc)
+#endif
+{
+  for (int i = 0; i < na; i++)
+    for (int j = 0; j < nb; j++)
+      c[i*ldc+j] = 0.0;
+
+  for (int k0 = 0; k0 < n; k0 += DOT_TILE_KC) {
+    int kn = (n-k0 < DOT_TILE_KC) ? n-k0 : DOT_TILE_KC;
+    int kq = 4*(kn/4);
+    int i = 0;
+    for ( ; i+4 <= na; i += 4) {
+      const float *a0 = a[i]+k0,   *a1 = a[i+1]+k0;
+      const float *a2 = a[i+2]+k0, *a3 = a[i+3]+k0;
+      int j = 0;
+      for ( ; j+3 <= nb; j += 3) {
+        const float *b0 = b[j]+k0, *b1 = b[j+1]+k0, *b2 = b[j+2]+k0;
+
+        // initialize 4x3 blocks of 4 sums
+        __m256d s00 = _mm256_setzero_pd(), s01 = s00, s02 = s00;
+        __m256d s10 = s00, s11 = s00, s12 = s00;
+        __m256d s20 = s00, s21 = s00, s22 = s00;
+        __m256d s30 = s00, s31 = s00, s32 = s00;
+
+        // in each iteration, load 3 vectors of b once and reuse them
+        // for all 4 rows of a
+        for (int k = 0; k < kq; k += 4) {
+          __m256d v0 = _mm256_cvtps_pd(_mm_loadu_ps(b0+k));
+          __m256d v1 = _mm256_cvtps_pd(_mm_loadu_ps(b1+k));
+          __m256d v2 = _mm256_cvtps_pd(_mm_loadu_ps(b2+k));
+          __m256d u  = _mm256_cvtps_pd(_mm_loadu_ps(a0+k));
+          s00 = dot_tile_madd(u, v0, s00);
+          s01 = dot_tile_madd(u, v1, s01);
+          s02 = dot_tile_madd(u, v2, s02);
+          u   = _mm256_cvtps_pd(_mm_loadu_ps(a1+k));
+          s10 = dot_tile_madd(u, v0, s10);
+          s11 = dot_tile_madd(u, v1, s11);
+          s12 = dot_tile_madd(u, v2, s12);
+          u   = _mm256_cvtps_pd(_mm_loadu_ps(a2+k));
+          s20 = dot_tile_madd(u, v0, s20);
+          s21 = dot_tile_madd(u, v1, s21);
+          s22 = dot_tile_madd(u, v2, s22);
+          u   = _mm256_cvtps_pd(_mm_loadu_ps(a3+k));
+          s30 = dot_tile_madd(u, v0, s30);
+          s31 = dot_tile_madd(u, v1, s31);
+          s32 = dot_tile_madd(u, v2, s32);
+        }
+
+        // compute horizontal sums
+        double r[12] = {
+          dot_tile_hsum(s00), dot_tile_hsum(s01), dot_tile_hsum(s02),
+          dot_tile_hsum(s10), dot_tile_hsum(s11), dot_tile_hsum(s12),
+          dot_tile_hsum(s20), dot_tile_hsum(s21), dot_tile_hsum(s22),
+          dot_tile_hsum(s30), dot_tile_hsum(s31), dot_tile_hsum(s32) };
+
+        // add the remaining products
+        for (int k = kq; k < kn; k++) {
+          double x0 = a0[k], x1 = a1[k], x2 = a2[k], x3 = a3[k];
+          double y0 = b0[k], y1 = b1[k], y2 = b2[k];
+          r[0] += x0*y0; r[1]  += x0*y1; r[2]  += x0*y2;
+          r[3] += x1*y0; r[4]  += x1*y1; r[5]  += x1*y2;
+          r[6] += x2*y0; r[7]  += x2*y1; r[8]  += x2*y2;
+          r[9] += x3*y0; r[10] += x3*y1; r[11] += x3*y2;
+        }
+        for (int ii = 0; ii < 4; ii++)
+          for (int jj = 0; jj < 3; jj++)
+            c[(i+ii)*ldc+j+jj] += r[ii*3+jj];
+      }
+
+      // columns that do not fill a block of 3
+      for ( ; j < nb; j++)
+        for (int ii = 0; ii < 4; ii++)
+          #ifdef __FMA__
+          c[(i+ii)*ldc+j] += dsdot_avxfma(a[i+ii]+k0, b[j]+k0, kn);
+          #else
+          c[(i+ii)*ldc+j] += dsdot_avx   (a[i+ii]+k0, b[j]+k0, kn);
+          #endif
+    }
+
+    // rows that do not fill a block of 4
+    for ( ; i < na; i++)
+      for (int j = 0; j < nb; j++)
+        #ifdef __FMA__
+        c[i*ldc+j] += dsdot_avxfma(a[i]+k0, b[j]+k0, kn);
+        #else
+        c[i*ldc+j] += dsdot_avx   (a[i]+k0, b[j]+k0, kn);
+        #endif
+  }
+}  // dsdot_tile_avx()
+
+#undef dot_tile_madd
+
 #endif // DOT_AVX_H
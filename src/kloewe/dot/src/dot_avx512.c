@@ -12,8 +12,14 @@
 extern float  sdot_avx512fma  (const float  *a, const float  *b, int n);
 extern double ddot_avx512fma  (const double *a, const double *b, int n);
 extern double dsdot_avx512fma (const float  *a, const float  *b, int n);
+extern void   dsdot_tile_avx512fma (const float *const *a, int na,
+                                    const float *const *b, int nb, int n,
+                                    double *c, int ldc);
 #else
 extern float  sdot_avx512     (const float  *a, const float  *b, int n);
 extern double ddot_avx512     (const double *a, const double *b, int n);
 extern double dsdot_avx512    (const float  *a, const float  *b, int n);
+extern void   dsdot_tile_avx512    (const float *const *a, int na,
+                                    const float *const *b, int nb, int n,
+                                    double *c, int ldc);
 #endif
@@ -24,6 +24,15 @@ inline float  sdot_avx512     (const float  *a, const float  *b, int n);
 inline double ddot_avx512     (const double *a, const double *b, int n);
 inline double dsdot_avx512    (const float  *a, const float  *b, int n);
 #endif
+#ifdef __FMA__
+inline void   dsdot_tile_avx512fma (const float *const *a, int na,
+                                    const float *const *b, int nb, int n,
+                                    double *c, int ldc);
+#else
+inline void   dsdot_tile_avx512    (const float *const *a, int na,
+                                    const float *const *b, int nb, int n,
+                                    double *c, int ldc);
+#endif
 
 /*----------------------------------------------------------------------------
   Inline Functions
@@ -121,4 +130,99 @@ inline double dsdot_avx512    (const float *a, const float *b, int n)
   return s;
 }  // dsdot_avx512()
 
+/*--------------------------------------------------------------------------*/
+
+// number of elements of each row that are processed per pass of the tile
+// kernel, so that the rows of a panel stay in L1 during the pass
+#ifndef DOT_TILE_KC
+#define DOT_TILE_KC 256
+#endif
+
+#ifdef __FMA__
+#define dot_tile_madd(a,b,s) _mm512_fmadd_pd(a, b, s)
+#else
+#define dot_tile_madd(a,b,s) _mm512_add_pd(_mm512_mul_pd(a, b), s)
+#endif
+
+// --- tile of dot products (input: single; intermediate and output: double)
+// c[i*ldc+j] = a[i] . b[j] for all i < na, j < nb
+// Same scheme as the AVX version, but with the 32 registers of AVX512 each
+// 4x6 block of the output is accumulated in 24 registers.
+#ifdef __FMA__
+inline void dsdot_tile_avx512fma (const float *const *a, int na,
+                                  const float *const *b, int nb, int n,
+                                  double *c, int ldc)
+#else
+inline void dsdot_tile_avx512    (const float *const *a, int na,
+                                  const float *const *b, int nb, int n,
+                                  double *c, int ldc)
+#endif
+{
+  for (int i = 0; i < na; i++)
+    for (int j = 0; j < nb; j++)
+      c[i*ldc+j] = 0.0;
+
+  for (int k0 = 0; k0 < n; k0 += DOT_TILE_KC) {
+    int kn = (n-k0 < DOT_TILE_KC) ? n-k0 : DOT_TILE_KC;
+    int kq = 8*(kn/8);
+    int i = 0;
+    for ( ; i+4 <= na; i += 4) {
+      const float *ap[4] = { a[i]+k0, a[i+1]+k0, a[i+2]+k0, a[i+3]+k0 };
+      int j = 0;
+      for ( ; j+6 <= nb; j += 6) {
+        const float *bp[6] = { b[j]+k0,   b[j+1]+k0, b[j+2]+k0,
+                               b[j+3]+k0, b[j+4]+k0, b[j+5]+k0 };
+
+        // initialize 4x6 blocks of 8 sums
+        __m512d s[4][6];
+        for (int ii = 0; ii < 4; ii++)
+          for (int jj = 0; jj < 6; jj++)
+            s[ii][jj] = _mm512_setzero_pd();
+
+        // in each iteration, load 6 vectors of b once and reuse them
+        // for all 4 rows of a (fully unrolled by the compiler)
+        for (int k = 0; k < kq; k += 8) {
+          __m512d v[6];
+          for (int jj = 0; jj < 6; jj++)
+            v[jj] = _mm512_cvtps_pd(_mm256_loadu_ps(bp[jj]+k));
+          for (int ii = 0; ii < 4; ii++) {
+            __m512d u = _mm512_cvtps_pd(_mm256_loadu_ps(ap[ii]+k));
+            for (int jj = 0; jj < 6; jj++)
+              s[ii][jj] = dot_tile_madd(u, v[jj], s[ii][jj]);
+          }
+        }
+
+        // compute horizontal sums and add the remaining products
+        for (int ii = 0; ii < 4; ii++)
+          for (int jj = 0; jj < 6; jj++) {
+            double r = _mm512_reduce_add_pd(s[ii][jj]);
+            for (int k = kq; k < kn; k++)
+              r += (double)ap[ii][k]*bp[jj][k];
+            c[(i+ii)*ldc+j+jj] += r;
+          }
+      }
+
+      // columns that do not fill a block of 6
+      for ( ; j < nb; j++)
+        for (int ii = 0; ii < 4; ii++)
+          #ifdef __FMA__
+          c[(i+ii)*ldc+j] += dsdot_avx512fma(ap[ii], b[j]+k0, kn);
+          #else
+          c[(i+ii)*ldc+j] += dsdot_avx512   (ap[ii], b[j]+k0, kn);
+          #endif
+    }
+
+    // rows that do not fill a block of 4
+    for ( ; i < na; i++)
+      for (int j = 0; j < nb; j++)
+        #ifdef __FMA__
+        c[i*ldc+j] += dsdot_avx512fma(a[i]+k0, b[j]+k0, kn);
+        #else
+        c[i*ldc+j] += dsdot_avx512   (a[i]+k0, b[j]+k0, kn);
+        #endif
+  }
+}  // dsdot_tile_avx512()
+
+#undef dot_tile_madd
+
 #endif // DOT_AVX512_H
@@ -11,3 +11,6 @@
 extern float  sdot_naive  (const float  *a, const float  *b, int n);
 extern double ddot_naive  (const double *a, const double *b, int n);
 extern double dsdot_naive (const float  *a, const float  *b, int n);
+extern void   dsdot_tile_naive (const float *const *a, int na,
+                                const float *const *b, int nb, int n,
+                                double *c, int ldc);
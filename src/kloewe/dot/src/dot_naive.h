@@ -12,6 +12,9 @@
 inline float  sdot_naive  (const float  *a, const float  *b, int n);
 inline double ddot_naive  (const double *a, const double *b, int n);
 inline double dsdot_naive (const float  *a, const float  *b, int n);
+inline void   dsdot_tile_naive (const float *const *a, int na,
+                                const float *const *b, int nb, int n,
+                                double *c, int ldc);
 
 /*----------------------------------------------------------------------------
   Inline Functions
@@ -60,4 +63,17 @@ inline double dsdot_naive (const float *a, const float *b, int n)
   return sum;
 }  // dsdot_naive()
 
+/*--------------------------------------------------------------------------*/
+
+// --- tile of dot products (input: single; output: double)
+// c[i*ldc+j] = a[i] . b[j] for all i < na, j < nb
+inline void dsdot_tile_naive (const float *const *a, int na,
+                              const float *const *b, int nb, int n,
+                              double *c, int ldc)
+{
+  for (int i = 0; i < na; i++)
+    for (int j = 0; j < nb; j++)
+      c[i*ldc+j] = dsdot_naive(a[i], b[j], n);
+}  // dsdot_tile_naive()
+
 #endif // DOT_NAIVE_H